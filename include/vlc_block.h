@@ -163,6 +163,28 @@ VLC_API block_t *block_Init(block_t *block,
  */
 VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
+/**
+ * Block allocator statistics.
+ *
+ * Blocks allocated with block_Alloc() are recycled through size-classed free
+ * lists rather than returned to the heap.
+ */
+struct vlc_block_pool_stats
+{
+    uint64_t hits; /**< Allocations served from the free lists */
+    uint64_t misses; /**< Allocations served from the heap */
+    size_t resident; /**< Bytes held in the free lists */
+};
+
+/**
+ * Gets block allocator statistics.
+ *
+ * The figures are updated lazily by each thread, so they are approximate.
+ *
+ * @param stats structure to fill [OUT]
+ */
+VLC_API void block_PoolGetStats(struct vlc_block_pool_stats *stats);
+
 VLC_API block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
 /**
@@ -639,6 +661,94 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 
 /** @} */
 
+/**
+ * \defgroup spsc_fifo Single-producer single-consumer block FIFO
+ * Lock-free block queue for one producer thread and one consumer thread
+ *
+ * This is a faster alternative to @ref fifo when exactly one thread queues
+ * blocks and exactly one (other) thread dequeues them. Queueing and dequeuing
+ * do not take any lock; the producer only signals the consumer when the
+ * consumer is actually waiting for data.
+ * @{
+ */
+
+typedef struct vlc_spsc_fifo vlc_spsc_fifo_t;
+
+/**
+ * Creates a single-producer single-consumer FIFO queue of blocks.
+ *
+ * The created queue must be released with vlc_spsc_fifo_Delete().
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API vlc_spsc_fifo_t *vlc_spsc_fifo_New(void) VLC_USED VLC_MALLOC;
+
+/**
+ * Destroys a FIFO created by vlc_spsc_fifo_New().
+ *
+ * @note Any queued blocks are also destroyed.
+ * @warning Neither the producer nor the consumer may be using the FIFO when
+ * this function is called.
+ */
+VLC_API void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *);
+
+/**
+ * Queues a linked-list of blocks into a FIFO.
+ *
+ * @note This function is not a cancellation point.
+ * @warning This function may only be called from the producer thread.
+ *
+ * @param block the head of the list of blocks
+ *              (if NULL, this function has no effects)
+ */
+VLC_API void vlc_spsc_fifo_Queue(vlc_spsc_fifo_t *, block_t *);
+
+/**
+ * Dequeues the first block from a FIFO, if any.
+ *
+ * @note This function is not a cancellation point.
+ * @warning This function may only be called from the consumer thread.
+ *
+ * @return the first block in the FIFO or NULL if the FIFO is empty
+ */
+VLC_API block_t *vlc_spsc_fifo_Dequeue(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Dequeues the first block from a FIFO, waiting until there is one.
+ *
+ * @note This function is (always) a cancellation point.
+ * @warning This function may only be called from the consumer thread.
+ *
+ * @return a valid block
+ */
+VLC_API block_t *vlc_spsc_fifo_DequeueWait(vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Counts blocks in a FIFO.
+ *
+ * @note The result is exact only from the consumer thread: the producer may
+ * have queued more blocks in the meantime.
+ *
+ * @return the number of blocks in the FIFO (zero if it is empty)
+ */
+VLC_API size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *) VLC_USED;
+
+/**
+ * Counts bytes in a FIFO.
+ *
+ * @note As with vlc_spsc_fifo_GetCount(), the result may be stale.
+ *
+ * @return the total number of bytes
+ */
+VLC_API size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *) VLC_USED;
+
+VLC_USED static inline bool vlc_spsc_fifo_IsEmpty(const vlc_spsc_fifo_t *fifo)
+{
+    return vlc_spsc_fifo_GetCount(fifo) == 0;
+}
+
+/** @} */
+
 /** @} */
 
 #endif /* VLC_BLOCK_H */
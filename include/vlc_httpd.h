@@ -106,6 +106,13 @@ typedef struct httpd_message_t
 
 typedef struct httpd_url_t      httpd_url_t;
 typedef struct httpd_callback_sys_t httpd_callback_sys_t;
+/**
+ * Answers a query on a URL.
+ *
+ * A callback that cannot answer yet may succeed and leave the answer type
+ * to HTTPD_MSG_NONE: it is then called again, from the server thread, until
+ * it answers. The server answers 503 on its behalf after a few seconds.
+ */
 typedef int    (*httpd_callback_t)( httpd_callback_sys_t *, httpd_client_t *, httpd_message_t *answer, const httpd_message_t *query );
 /* register a new url */
 VLC_API httpd_url_t * httpd_UrlNew( httpd_host_t *, const char *psz_url, const char *psz_user, const char *psz_password ) VLC_USED;
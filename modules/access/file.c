@@ -43,6 +43,13 @@
 #   include <linux/magic.h>
 #endif
 
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
+#ifdef HAVE_LIBURING
+#   include <liburing.h>
+#endif
+
 #if defined( _WIN32 )
 #   include <io.h>
 #   include <ctype.h>
@@ -61,14 +68,57 @@
 #include <vlc_fs.h>
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
+#include <vlc_block.h>
+
+/* reads kept in flight with io_uring */
+#define URING_DEPTH     8
+/* size of each read, and alignment of their offsets */
+#define URING_READ_SIZE (256 << 10)
+
+#ifdef HAVE_LIBURING
+struct uring_slot
+{
+    block_t *block;
+    uint64_t offset;
+    size_t   length;
+    uintptr_t seq; /* generation of the read in flight, 0 if none */
+    int      result;
+    bool     done;
+};
+#endif
 
 typedef struct
 {
     int fd;
 
     bool b_pace_control;
+
+#ifdef HAVE_MMAP
+    /* memory mapped mode */
+    uint64_t offset;
+    uint64_t size;
+    uint64_t last_end;
+    uint64_t readahead;
+    size_t   page_size;
+#endif
+
+#ifdef HAVE_LIBURING
+    /* io_uring mode */
+    struct io_uring ring;
+    bool     uring;
+    uint64_t uring_offset; /* file offset of the next read to submit */
+    unsigned head; /* oldest read, the next one to be returned */
+    unsigned count; /* reads in flight or completed, in file order */
+    uintptr_t uring_seq; /* generation of the last submitted read */
+    struct uring_slot slots[URING_DEPTH];
+#endif
 } access_sys_t;
 
+/* size of each mapped block */
+#define MMAP_WINDOW        (4 << 20)
+/* how far ahead sequential reads are advised at most */
+#define MMAP_READAHEAD_MAX (64 << 20)
+
 #if !defined (_WIN32) && !defined (__OS2__)
 static bool IsRemote (int fd)
 {
@@ -124,10 +174,23 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
 static int FileControl (stream_t *, int, va_list);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+#endif
+#ifdef HAVE_LIBURING
+static int UringInit (stream_t *);
+static void UringClean (stream_t *);
+static block_t *UringBlock (stream_t *, bool *);
+static int UringSeek (stream_t *, uint64_t);
+#endif
 
 /*****************************************************************************
  * FileOpen: open the file
@@ -208,6 +271,9 @@ int FileOpen( stream_t *p_access )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+#ifdef HAVE_LIBURING
+    p_sys->uring = false;
+#endif
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
@@ -226,6 +292,33 @@ int FileOpen( stream_t *p_access )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Blocks backed by the mapping spare a copy of every byte. The file
+         * must not shrink while mapped, so keep away from network shares. */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->size = st.st_size;
+            p_sys->last_end = 0;
+            p_sys->readahead = 0;
+            p_sys->page_size = sysconf (_SC_PAGESIZE);
+        }
+#endif
+#ifdef HAVE_LIBURING
+        /* Keep several reads in flight rather than blocking on each one */
+        if (p_access->pf_block == NULL
+         && var_InheritBool (p_access, "file-io-uring")
+         && UringInit (p_access) == VLC_SUCCESS)
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = UringBlock;
+            p_access->pf_seek = UringSeek;
+        }
 #endif
     }
     else
@@ -246,7 +339,7 @@ error:
  *****************************************************************************/
 void FileClose (stream_t *p_access)
 {
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_access);
         return;
@@ -254,6 +347,10 @@ void FileClose (stream_t *p_access)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_LIBURING
+    if (p_sys->uring)
+        UringClean (p_access);
+#endif
     vlc_close (p_sys->fd);
 }
 
@@ -292,6 +389,331 @@ static int FileSeek (stream_t *p_access, uint64_t i_pos)
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    if (sys->offset >= sys->size)
+    {
+        /* The file may still be growing (recording in progress) */
+        struct stat st;
+
+        if (fstat (sys->fd, &st) == 0)
+            sys->size = st.st_size;
+        if (sys->offset >= sys->size)
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    const uint64_t offset = sys->offset;
+    const uint64_t base = offset & ~(uint64_t)(sys->page_size - 1);
+    const size_t skew = offset - base;
+    const size_t length = __MIN(sys->size - offset, MMAP_WINDOW);
+    block_t *block;
+
+    void *addr = mmap (NULL, skew + length, PROT_READ, MAP_SHARED, sys->fd, base);
+    if (addr != MAP_FAILED)
+    {
+        /* Follow the access pattern of the demuxer: read ahead further and
+         * further while it reads sequentially, stop as soon as it seeks. */
+        if (offset == sys->last_end)
+        {
+            sys->readahead = __MAX(__MIN(2 * sys->readahead, MMAP_READAHEAD_MAX),
+                                   MMAP_WINDOW);
+            posix_madvise (addr, skew + length, POSIX_MADV_SEQUENTIAL);
+            posix_fadvise (sys->fd, offset + length, sys->readahead,
+                           POSIX_FADV_WILLNEED);
+        }
+        else
+        {
+            sys->readahead = 0;
+            posix_madvise (addr, skew + length, POSIX_MADV_RANDOM);
+        }
+        posix_madvise (addr, skew + length, POSIX_MADV_WILLNEED);
+
+        block = block_mmap_Alloc ((char *)addr + skew, length);
+    }
+    else
+    {
+        msg_Warn (p_access, "cannot map file: %s", vlc_strerror_c(errno));
+
+        block = block_Alloc (length);
+        if (likely(block != NULL))
+        {
+            ssize_t val = pread (sys->fd, block->p_buffer, length, offset);
+            if (val <= 0)
+            {
+                block_Release (block);
+                *eof = val == 0;
+                return NULL;
+            }
+            block->i_buffer = val;
+        }
+    }
+
+    if (unlikely(block == NULL))
+        return NULL;
+
+    sys->offset += block->i_buffer;
+    sys->last_end = sys->offset;
+    return block;
+}
+
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    sys->offset = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
+#ifdef HAVE_LIBURING
+/* Completions carry the slot index and the generation of the read, so that
+ * those of abandoned reads are not mistaken for reads that reuse the slot.
+ * The generation is never 0, which tags the cancellation requests. */
+static void *UringTag (unsigned idx, uintptr_t seq)
+{
+    return (void *)(seq * URING_DEPTH + idx);
+}
+
+/* Submits reads until URING_DEPTH are in flight */
+static void UringFill (stream_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+    unsigned submitted = 0;
+
+    while (sys->count < URING_DEPTH)
+    {
+        unsigned idx = (sys->head + sys->count) % URING_DEPTH;
+        struct uring_slot *slot = &sys->slots[idx];
+        /* after a seek, the first read realigns the following ones */
+        size_t length = URING_READ_SIZE - (sys->uring_offset % URING_READ_SIZE);
+
+        block_t *block = block_Alloc (length);
+        if (unlikely(block == NULL))
+            break;
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe (&sys->ring);
+        if (unlikely(sqe == NULL))
+        {
+            block_Release (block);
+            break;
+        }
+
+        if (++sys->uring_seq >= UINTPTR_MAX / URING_DEPTH)
+            sys->uring_seq = 1;
+
+        io_uring_prep_read (sqe, sys->fd, block->p_buffer, length,
+                            sys->uring_offset);
+        io_uring_sqe_set_data (sqe, UringTag (idx, sys->uring_seq));
+
+        slot->block = block;
+        slot->seq = sys->uring_seq;
+        slot->offset = sys->uring_offset;
+        slot->length = length;
+        slot->done = false;
+        sys->uring_offset += length;
+        sys->count++;
+        submitted++;
+    }
+
+    if (submitted > 0)
+        io_uring_submit (&sys->ring);
+}
+
+/* Waits for the completion of any read */
+static int UringWait (stream_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+    struct io_uring_cqe *cqe;
+
+    int ret = io_uring_wait_cqe (&sys->ring, &cqe);
+    if (ret < 0)
+    {
+        if (ret != -EINTR)
+            msg_Err (p_access, "io_uring error: %s", vlc_strerror_c(-ret));
+        return ret;
+    }
+
+    uintptr_t tag = (uintptr_t)io_uring_cqe_get_data (cqe);
+    uintptr_t seq = tag / URING_DEPTH;
+    struct uring_slot *slot = &sys->slots[tag % URING_DEPTH];
+
+    /* Ignore cancellations, and reads abandoned by UringDrain() */
+    if (seq != 0 && slot->seq == seq && !slot->done)
+    {
+        slot->result = cqe->res;
+        slot->done = true;
+    }
+    io_uring_cqe_seen (&sys->ring, cqe);
+    return 0;
+}
+
+/* Requests the cancellation of the reads in flight */
+static void UringCancel (stream_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+    unsigned submitted = 0;
+
+    for (unsigned i = 0; i < sys->count; i++)
+    {
+        unsigned idx = (sys->head + i) % URING_DEPTH;
+        struct uring_slot *slot = &sys->slots[idx];
+
+        if (slot->done)
+            continue;
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe (&sys->ring);
+        if (unlikely(sqe == NULL))
+            break;
+
+        io_uring_prep_cancel (sqe, UringTag (idx, slot->seq), 0);
+        io_uring_sqe_set_data (sqe, UringTag (0, 0));
+        submitted++;
+    }
+
+    if (submitted > 0)
+        io_uring_submit (&sys->ring);
+}
+
+/* Waits for all reads and drops them */
+static void UringDrain (stream_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+    bool cancelled = false;
+
+    for (unsigned i = 0; i < sys->count; i++)
+    {
+        struct uring_slot *slot = &sys->slots[(sys->head + i) % URING_DEPTH];
+
+        while (!slot->done)
+        {
+            int ret = UringWait (p_access);
+            if (ret == 0 || ret == -EINTR)
+                continue;
+            if (cancelled)
+                break;
+            /* Cancel the reads in flight, then try waiting again */
+            UringCancel (p_access);
+            cancelled = true;
+        }
+
+        /* The kernel owns the buffer until the read completes: if it has
+         * not, leak the block. The read completion will be ignored. */
+        if (slot->done)
+            block_Release (slot->block);
+        slot->block = NULL;
+        slot->seq = 0;
+    }
+
+    sys->head = 0;
+    sys->count = 0;
+}
+
+/* Drops all reads, then starts reading again from the given offset */
+static void UringRestart (stream_t *p_access, uint64_t offset)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    UringDrain (p_access);
+    sys->uring_offset = offset;
+    UringFill (p_access);
+}
+
+static int UringInit (stream_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    int ret = io_uring_queue_init (URING_DEPTH, &sys->ring, 0);
+    if (ret < 0)
+    {
+        msg_Dbg (p_access, "io_uring not available: %s", vlc_strerror_c(-ret));
+        return VLC_EGENERIC;
+    }
+
+    sys->uring = true;
+    sys->head = 0;
+    sys->count = 0;
+    sys->uring_seq = 0;
+    sys->uring_offset = 0;
+    UringFill (p_access);
+    return VLC_SUCCESS;
+}
+
+static void UringClean (stream_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    UringDrain (p_access);
+    io_uring_queue_exit (&sys->ring);
+}
+
+static block_t *UringBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    if (unlikely(sys->count == 0))
+    {
+        UringFill (p_access);
+        if (sys->count == 0)
+            return NULL;
+    }
+
+    struct uring_slot *slot = &sys->slots[sys->head];
+    while (!slot->done)
+        if (UringWait (p_access) < 0)
+            return NULL;
+
+    block_t *block = slot->block;
+    const uint64_t offset = slot->offset;
+    const size_t length = slot->length;
+    const int result = slot->result;
+
+    slot->block = NULL;
+    sys->head = (sys->head + 1) % URING_DEPTH;
+    sys->count--;
+
+    if (result <= 0)
+    {
+        block_Release (block);
+        /* Retry from there later on, the file might grow */
+        UringRestart (p_access, offset);
+
+        switch (result)
+        {
+            case -EINTR:
+            case -EAGAIN:
+                return NULL;
+            case 0:
+                break;
+            default:
+                msg_Err (p_access, "read error: %s", vlc_strerror_c(-result));
+        }
+        *eof = true;
+        return NULL;
+    }
+
+    block->i_buffer = result;
+
+    if ((size_t)result < length)
+        /* Short read: the reads in flight are not contiguous anymore */
+        UringRestart (p_access, offset + result);
+    else
+        UringFill (p_access);
+    return block;
+}
+
+static int UringSeek (stream_t *p_access, uint64_t i_pos)
+{
+    UringRestart (p_access, i_pos);
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
@@ -36,6 +36,17 @@ vlc_plugin_begin ()
     add_shortcut( "file", "fd", "stream" )
     set_capability( VLC_CAP_ACCESS, 50, FileOpen, FileClose )
 
+    set_subcategory( SUBCAT_INPUT_ACCESS )
+    add_bool("file-mmap", false, N_("Memory map files"),
+             N_("Serve local files from memory mapped blocks instead of "
+                "copying them, with read-ahead following the access pattern. "
+                "The file must not be truncated while it is played."), true)
+#ifdef HAVE_LIBURING
+    add_bool("file-io-uring", false, N_("Asynchronous reads"),
+             N_("Keep several reads of local files in flight with io_uring "
+                "instead of waiting for each one."), true)
+#endif
+
     add_submodule()
 #ifndef HAVE_FDOPENDIR
     add_shortcut( "file", "directory", "dir" )
@@ -63,6 +63,15 @@ void vlc_http_dbg(void *, const char *msg, ...) VLC_FORMAT(2, 3);
  */
 struct vlc_http_conn *vlc_h1_conn_create(void *ctx, struct vlc_tls *,
                                          bool proxy);
+
+/**
+ * Checks whether an HTTP/1.x connection is serving a request.
+ *
+ * An HTTP/1.x connection carries only one stream at a time: it cannot be
+ * used for another request until the current stream is closed.
+ */
+bool vlc_h1_conn_busy(struct vlc_http_conn *);
+
 struct vlc_http_stream *vlc_chunked_open(struct vlc_http_stream *,
                                          struct vlc_tls *);
 
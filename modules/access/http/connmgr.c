@@ -26,6 +26,7 @@
 #include <vlc_common.h>
 #include <vlc_network.h>
 #include <vlc_tls.h>
+#include <vlc_strings.h>
 #include <vlc_url.h>
 #include "transport.h"
 #include "conn.h"
@@ -96,88 +97,235 @@ static char *vlc_http_proxy_find(const char *hostname, unsigned port,
 }
 
 
+/* Connections kept for reuse, per origin server */
+#define VLC_HTTP_MGR_MAX_CONNS 8
+
+struct vlc_http_mgr_conn
+{
+    struct vlc_http_mgr_conn *next;
+    struct vlc_http_conn *conn;
+    unsigned refs; /**< list and threads opening a stream (under mgr lock) */
+    bool multiplex; /**< HTTP/2: accepts concurrent streams */
+    bool secure;
+    unsigned port;
+    char host[];
+};
+
 struct vlc_http_mgr
 {
     struct vlc_logger *logger;
     vlc_object_t *obj;
     vlc_tls_client_t *creds;
     struct vlc_http_cookie_jar_t *jar;
-    struct vlc_http_conn *conn;
+    vlc_mutex_t lock; /**< conns and creds */
+    struct vlc_http_mgr_conn *conns; /**< most recently used first */
 };
 
-static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
-                                               const char *host, unsigned port)
+/* Finds an idle or multiplexing connection to the given origin */
+static struct vlc_http_mgr_conn **vlc_http_mgr_find(struct vlc_http_mgr *mgr,
+                                                    bool secure,
+                                                    const char *host,
+                                                    unsigned port)
+{
+    for (struct vlc_http_mgr_conn **pp = &mgr->conns; *pp != NULL;
+         pp = &(*pp)->next)
+    {
+        struct vlc_http_mgr_conn *c = *pp;
+
+        if (c->secure == secure && c->port == port
+         && !vlc_ascii_strcasecmp(c->host, host)
+         && (c->multiplex || !vlc_h1_conn_busy(c->conn)))
+            return pp;
+    }
+    return NULL;
+}
+
+/* Drops a reference to a connection; mgr->lock must be held */
+static void vlc_http_mgr_put(struct vlc_http_mgr_conn *c)
+{
+    assert(c->refs > 0);
+    if (--c->refs > 0)
+        return;
+
+    vlc_http_conn_release(c->conn);
+    free(c);
+}
+
+static void vlc_http_mgr_unhold(struct vlc_http_mgr *mgr,
+                                struct vlc_http_mgr_conn *c)
 {
-    (void) host; (void) port;
-    return mgr->conn;
+    vlc_mutex_lock(&mgr->lock);
+    vlc_http_mgr_put(c);
+    vlc_mutex_unlock(&mgr->lock);
+}
+
+static void vlc_http_mgr_remove(struct vlc_http_mgr_conn **pp)
+{
+    struct vlc_http_mgr_conn *c = *pp;
+
+    *pp = c->next;
+    vlc_http_mgr_put(c);
 }
 
+/* Forgets a connection, unless another thread already did, and drops the
+ * reference of the calling thread */
 static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
-                                 struct vlc_http_conn *conn)
+                                 struct vlc_http_mgr_conn *c)
 {
-    assert(mgr->conn == conn);
-    mgr->conn = NULL;
+    vlc_mutex_lock(&mgr->lock);
+    for (struct vlc_http_mgr_conn **pp = &mgr->conns; *pp != NULL;
+         pp = &(*pp)->next)
+        if (*pp == c)
+        {
+            vlc_http_mgr_remove(pp);
+            break;
+        }
+    vlc_http_mgr_put(c);
+    vlc_mutex_unlock(&mgr->lock);
+}
+
+/* Takes ownership of a new connection to the given origin, and returns it
+ * with a reference for the calling thread */
+static struct vlc_http_mgr_conn *vlc_http_mgr_add(struct vlc_http_mgr *mgr,
+                                                  bool secure,
+                                                  const char *host,
+                                                  unsigned port,
+                                                  struct vlc_http_conn *conn,
+                                                  bool multiplex)
+{
+    size_t len = strlen(host) + 1;
+    struct vlc_http_mgr_conn *c = malloc(sizeof (*c) + len);
+
+    if (unlikely(c == NULL))
+    {
+        vlc_http_conn_release(conn);
+        return NULL;
+    }
 
-    vlc_http_conn_release(conn);
+    c->conn = conn;
+    c->refs = 2;
+    c->multiplex = multiplex;
+    c->secure = secure;
+    c->port = port;
+    memcpy(c->host, host, len);
+
+    /* Other connections to the same origin are kept: busy HTTP/1
+     * connections become reusable once their current stream ends. */
+    vlc_mutex_lock(&mgr->lock);
+    c->next = mgr->conns;
+    mgr->conns = c;
+
+    /* Expire the least recently used connection. If it is still in use, it
+     * is destroyed when its last stream ends. */
+    unsigned n = 0;
+    for (struct vlc_http_mgr_conn **pp = &mgr->conns; *pp != NULL;
+         pp = &(*pp)->next)
+        if (++n > VLC_HTTP_MGR_MAX_CONNS)
+        {
+            vlc_http_mgr_remove(pp);
+            break;
+        }
+    vlc_mutex_unlock(&mgr->lock);
+    return c;
 }
 
+/* Sends a request on a connection the calling thread holds a reference to,
+ * and drops that reference. The manager lock is not held, so that a slow
+ * server only blocks the requests sent to it. */
 static
-struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
-                                        const char *host, unsigned port,
-                                        const struct vlc_http_msg *req)
+struct vlc_http_msg *vlc_http_mgr_send(struct vlc_http_mgr *mgr,
+                                       struct vlc_http_mgr_conn *c,
+                                       const struct vlc_http_msg *req)
 {
-    struct vlc_http_conn *conn = vlc_http_mgr_find(mgr, host, port);
-    if (conn == NULL)
+    struct vlc_http_stream *stream = vlc_http_stream_open(c->conn, req);
+    if (stream == NULL)
+    {
+        if (c->multiplex || !vlc_h1_conn_busy(c->conn))
+        {   /* Get rid of closing or reset connection */
+            vlc_http_mgr_release(mgr, c);
+            return NULL;
+        }
+
+        /* Another thread took this HTTP/1 connection in the mean time */
+        vlc_http_mgr_unhold(mgr, c);
         return NULL;
+    }
 
-    struct vlc_http_stream *stream = vlc_http_stream_open(conn, req);
-    if (stream != NULL)
+    struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+    if (m != NULL)
     {
-        struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
-        if (m != NULL)
-            return m;
-
-        /* NOTE: If the request were not idempotent, we would not know if it
-         * was processed by the other end. Thus POST is not used/supported so
-         * far, and CONNECT is treated as if it were idempotent (which works
-         * fine here). */
+        vlc_http_mgr_unhold(mgr, c);
+        return m;
     }
-    /* Get rid of closing or reset connection */
-    vlc_http_mgr_release(mgr, conn);
+
+    /* NOTE: If the request were not idempotent, we would not know if it
+     * was processed by the other end. Thus POST is not used/supported so
+     * far, and CONNECT is treated as if it were idempotent (which works
+     * fine here). */
+    vlc_http_mgr_release(mgr, c);
     return NULL;
 }
 
+static
+struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr, bool secure,
+                                        const char *host, unsigned port,
+                                        const struct vlc_http_msg *req)
+{
+    /* HTTP/2 connections accept concurrent streams: requests from several
+     * threads to the same origin are multiplexed on a single connection. */
+    vlc_mutex_lock(&mgr->lock);
+    struct vlc_http_mgr_conn **pp = vlc_http_mgr_find(mgr, secure, host, port);
+    if (pp == NULL)
+    {
+        vlc_mutex_unlock(&mgr->lock);
+        return NULL;
+    }
+
+    struct vlc_http_mgr_conn *c = *pp;
+
+    /* Most recently used first */
+    *pp = c->next;
+    c->next = mgr->conns;
+    mgr->conns = c;
+    c->refs++;
+    vlc_mutex_unlock(&mgr->lock);
+
+    return vlc_http_mgr_send(mgr, c, req);
+}
+
 static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
                                               const char *host, unsigned port,
                                               const struct vlc_http_msg *req)
 {
+    vlc_tls_client_t *creds;
     vlc_tls_t *tls;
     bool http2 = true;
 
-    if (mgr->creds == NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTP to HTTPS not implemented */
-
+    vlc_mutex_lock(&mgr->lock);
     if (mgr->creds == NULL)
     {   /* First TLS connection: load x509 credentials */
         mgr->creds = vlc_tls_ClientCreate(mgr->obj);
-        if (mgr->creds == NULL)
-            return NULL;
     }
+    creds = mgr->creds;
+    vlc_mutex_unlock(&mgr->lock);
+
+    if (creds == NULL)
+        return NULL;
 
     /* TODO? non-idempotent request support */
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
+    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, true, host, port, req);
     if (resp != NULL)
         return resp; /* existing connection reused */
 
     char *proxy = vlc_http_proxy_find(host, port, true);
     if (proxy != NULL)
     {
-        tls = vlc_https_connect_proxy(mgr->creds, mgr->creds,
+        tls = vlc_https_connect_proxy(creds, creds,
                                       host, port, &http2, proxy);
         free(proxy);
     }
     else
-        tls = vlc_https_connect(mgr->creds, host, port, &http2);
+        tls = vlc_https_connect(creds, host, port, &http2);
 
     if (tls == NULL)
         return NULL;
@@ -202,19 +350,20 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    mgr->conn = conn;
+    struct vlc_http_mgr_conn *c = vlc_http_mgr_add(mgr, true, host, port,
+                                                   conn, http2);
+    if (c == NULL)
+        return NULL;
 
-    return vlc_http_mgr_reuse(mgr, host, port, req);
+    return vlc_http_mgr_send(mgr, c, req);
 }
 
 static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
                                              const char *host, unsigned port,
                                              const struct vlc_http_msg *req)
 {
-    if (mgr->creds != NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTPS to HTTP not implemented */
-
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
+    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, false, host, port,
+                                                   req);
     if (resp != NULL)
         return resp;
 
@@ -252,7 +401,10 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    mgr->conn = conn;
+    struct vlc_http_mgr_conn *c = vlc_http_mgr_add(mgr, false, host, port,
+                                                   conn, false);
+    if (c != NULL)
+        vlc_http_mgr_unhold(mgr, c);
     return resp;
 }
 
@@ -279,14 +431,16 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->obj = obj;
     mgr->creds = NULL;
     mgr->jar = jar;
-    mgr->conn = NULL;
+    vlc_mutex_init(&mgr->lock);
+    mgr->conns = NULL;
     return mgr;
 }
 
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
 {
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
+    while (mgr->conns != NULL)
+        vlc_http_mgr_remove(&mgr->conns);
+    vlc_mutex_destroy(&mgr->lock);
     if (mgr->creds != NULL)
         vlc_tls_ClientDelete(mgr->creds);
     free(mgr);
@@ -0,0 +1,290 @@
+/*****************************************************************************
+ * connmgr_test.c: HTTP connection manager test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+#include <vlc_tls.h>
+#include "transport.h"
+#include "conn.h"
+#include "connmgr.h"
+#include "message.h"
+
+/* Fake connections: HTTP/1 ones serve one stream at a time */
+struct test_conn
+{
+    struct vlc_http_conn conn;
+    bool multiplex;
+    bool busy;
+    bool closed;
+    unsigned streams;
+    char host[32];
+};
+
+static unsigned created, released;
+static struct test_conn *last;
+static char last_released[32];
+static bool server_h2;
+
+static struct vlc_http_stream stream;
+static char response;
+
+static struct vlc_http_stream *conn_stream_open(struct vlc_http_conn *c,
+                                                const struct vlc_http_msg *m)
+{
+    struct test_conn *tc = container_of(c, struct test_conn, conn);
+
+    (void) m;
+    if (tc->closed || (!tc->multiplex && tc->busy))
+        return NULL;
+
+    tc->busy = true;
+    tc->streams++;
+    last = tc;
+    return &stream;
+}
+
+static void conn_release(struct vlc_http_conn *c)
+{
+    struct test_conn *tc = container_of(c, struct test_conn, conn);
+
+    strcpy(last_released, tc->host);
+    released++;
+    free(tc);
+}
+
+static const struct vlc_http_conn_cbs conn_callbacks =
+{
+    conn_stream_open,
+    conn_release,
+};
+
+static struct test_conn *conn_create(const char *host, bool multiplex)
+{
+    struct test_conn *tc = calloc(1, sizeof (*tc));
+    assert(tc != NULL);
+    tc->conn.cbs = &conn_callbacks;
+    tc->multiplex = multiplex;
+    strcpy(tc->host, host);
+    created++;
+    return tc;
+}
+
+/* Stubs for the connection layer */
+struct vlc_http_stream *vlc_h1_request(void *ctx, const char *hostname,
+                                       unsigned port, bool proxy,
+                                       const struct vlc_http_msg *req,
+                                       bool idempotent,
+                                       struct vlc_http_conn **restrict connp)
+{
+    struct test_conn *tc = conn_create(hostname, false);
+
+    (void) ctx; (void) port; (void) req;
+    assert(!proxy);
+    assert(idempotent);
+    *connp = &tc->conn;
+    return conn_stream_open(&tc->conn, req);
+}
+
+bool vlc_h1_conn_busy(struct vlc_http_conn *c)
+{
+    return container_of(c, struct test_conn, conn)->busy;
+}
+
+static char tls_host[32];
+
+struct vlc_http_conn *vlc_h1_conn_create(void *ctx, vlc_tls_t *tls,
+                                         bool proxy)
+{
+    (void) ctx; (void) tls;
+    assert(!proxy);
+    return &conn_create(tls_host, false)->conn;
+}
+
+struct vlc_http_conn *vlc_h2_conn_create(void *ctx, vlc_tls_t *tls)
+{
+    (void) ctx; (void) tls;
+    return &conn_create(tls_host, true)->conn;
+}
+
+struct vlc_http_msg *vlc_http_msg_get_initial(struct vlc_http_stream *s)
+{
+    assert(s == &stream);
+    return (struct vlc_http_msg *)&response;
+}
+
+static vlc_tls_t tls;
+static char creds;
+
+vlc_tls_client_t *vlc_tls_ClientCreate(vlc_object_t *obj)
+{
+    (void) obj;
+    return (vlc_tls_client_t *)&creds;
+}
+
+void vlc_tls_ClientDelete(vlc_tls_client_t *crd)
+{
+    assert(crd == (vlc_tls_client_t *)&creds);
+}
+
+vlc_tls_t *vlc_tls_SocketOpenTLS(vlc_tls_client_t *crd, const char *hostname,
+                                 unsigned port, const char *service,
+                                 const char *const *alpn, char **alp)
+{
+    (void) crd; (void) port; (void) service;
+    strcpy(tls_host, hostname);
+    *alp = strdup(server_h2 ? alpn[0] : "http/1.1");
+    return &tls;
+}
+
+vlc_tls_t *vlc_https_connect_proxy(void *ctx, vlc_tls_client_t *creds,
+                                   const char *name, unsigned port,
+                                   bool *restrict two, const char *proxy)
+{
+    (void) ctx; (void) creds; (void) name; (void) port; (void) two;
+    (void) proxy;
+    assert(!"no proxy");
+    return NULL;
+}
+
+char *vlc_getProxyUrl(const char *url)
+{
+    (void) url;
+    return NULL;
+}
+
+static struct test_conn *request(struct vlc_http_mgr *mgr, bool https,
+                                 const char *host)
+{
+    last = NULL;
+    if (vlc_http_mgr_request(mgr, https, host, 0, NULL) == NULL)
+        return NULL;
+    assert(last != NULL);
+    return last;
+}
+
+static void test_reuse(vlc_object_t *obj)
+{
+    struct vlc_http_mgr *mgr = vlc_http_mgr_create(obj, NULL);
+    assert(mgr != NULL);
+    created = released = 0;
+
+    /* a busy HTTP/1 connection is not shared: another one is opened */
+    struct test_conn *a = request(mgr, false, "www.example.com");
+    assert(a != NULL && created == 1);
+    struct test_conn *b = request(mgr, false, "www.example.com");
+    assert(b != NULL && b != a && created == 2);
+
+    /* idle connections to the same origin are reused */
+    a->busy = false;
+    assert(request(mgr, false, "www.example.com") == a);
+    b->busy = false;
+    assert(request(mgr, false, "WWW.EXAMPLE.COM") == b);
+    assert(created == 2);
+
+    /* but not for another origin */
+    a->busy = false;
+    assert(request(mgr, false, "www.example.org") != a);
+    assert(request(mgr, true, "www.example.com") != a);
+    assert(created == 4 && released == 0);
+
+    /* a closed connection is dropped for a new one */
+    a->closed = true;
+    struct test_conn *c = request(mgr, false, "www.example.com");
+    assert(c != NULL && c != a && c != b);
+    assert(created == 5 && released == 1);
+
+    vlc_http_mgr_destroy(mgr);
+    assert(released == created);
+}
+
+static void test_limit(vlc_object_t *obj)
+{
+    struct vlc_http_mgr *mgr = vlc_http_mgr_create(obj, NULL);
+    assert(mgr != NULL);
+    created = released = 0;
+
+    char host[16];
+    for (unsigned i = 0; i < 8; i++)
+    {
+        sprintf(host, "host%u", i);
+        request(mgr, false, host)->busy = false;
+    }
+    assert(created == 8 && released == 0);
+
+    /* the least recently used connection is expired */
+    request(mgr, false, "host0")->busy = false;
+    request(mgr, false, "host8")->busy = false;
+    assert(created == 9 && released == 1);
+    assert(!strcmp(last_released, "host1"));
+
+    request(mgr, false, "host0")->busy = false;
+    request(mgr, false, "host1")->busy = false;
+    assert(created == 10 && released == 2);
+    assert(!strcmp(last_released, "host2"));
+
+    vlc_http_mgr_destroy(mgr);
+    assert(released == created);
+}
+
+static void test_multiplex(vlc_object_t *obj)
+{
+    struct vlc_http_mgr *mgr = vlc_http_mgr_create(obj, NULL);
+    assert(mgr != NULL);
+    created = released = 0;
+
+    /* concurrent requests share one HTTP/2 connection */
+    server_h2 = true;
+    struct test_conn *a = request(mgr, true, "www.example.com");
+    assert(a != NULL && a->multiplex);
+    assert(request(mgr, true, "www.example.com") == a);
+    assert(request(mgr, true, "www.example.com") == a);
+    assert(created == 1 && a->streams == 3);
+
+    /* but not HTTP/1 over TLS */
+    server_h2 = false;
+    struct test_conn *b = request(mgr, true, "www.example.net");
+    assert(b != NULL && !b->multiplex);
+    assert(request(mgr, true, "www.example.net") != b);
+    assert(created == 3);
+
+    vlc_http_mgr_destroy(mgr);
+    assert(released == created);
+}
+
+int main(void)
+{
+    vlc_object_t obj;
+
+    memset(&obj, 0, sizeof (obj));
+    test_reuse(&obj);
+    test_limit(&obj);
+    test_multiplex(&obj);
+    return 0;
+}
@@ -117,6 +117,7 @@ struct vlc_h1_conn
     bool released;
     bool proxy;
     void *opaque;
+    vlc_mutex_t lock; /**< active and released, for shared connections */
 };
 
 #define CO(conn) ((conn)->opaque)
@@ -140,6 +141,22 @@ static struct vlc_h1_conn *vlc_h1_stream_conn(struct vlc_http_stream *stream)
     return container_of(stream, struct vlc_h1_conn, stream);
 }
 
+/* Ends the current stream, and destroys the connection if it was released
+ * in the mean time (possibly by another thread) */
+static void vlc_h1_stream_end(struct vlc_h1_conn *conn)
+{
+    bool destroy;
+
+    vlc_mutex_lock(&conn->lock);
+    assert(conn->active);
+    conn->active = false;
+    destroy = conn->released;
+    vlc_mutex_unlock(&conn->lock);
+
+    if (destroy)
+        vlc_h1_conn_destroy(conn);
+}
+
 static struct vlc_http_stream *vlc_h1_stream_open(struct vlc_http_conn *c,
                                                 const struct vlc_http_msg *req)
 {
@@ -147,21 +164,33 @@ static struct vlc_http_stream *vlc_h1_stream_open(struct vlc_http_conn *c,
     size_t len;
     ssize_t val;
 
+    vlc_mutex_lock(&conn->lock);
     if (conn->active || conn->conn.tls == NULL)
+    {
+        vlc_mutex_unlock(&conn->lock);
         return NULL;
+    }
+    conn->active = true;
+    vlc_mutex_unlock(&conn->lock);
 
     char *payload = vlc_http_msg_format(req, &len, conn->proxy);
     if (unlikely(payload == NULL))
+    {
+        vlc_h1_stream_end(conn);
         return NULL;
+    }
 
     vlc_http_dbg(CO(conn), "outgoing request:\n%.*s", (int)len, payload);
     val = vlc_tls_Write(conn->conn.tls, payload, len);
     free(payload);
 
     if (val < (ssize_t)len)
-        return vlc_h1_stream_fatal(conn);
+    {
+        vlc_h1_stream_fatal(conn);
+        vlc_h1_stream_end(conn);
+        return NULL;
+    }
 
-    conn->active = true;
     conn->content_length = 0;
     conn->connection_close = false;
     return &conn->stream;
@@ -272,15 +301,10 @@ static void vlc_h1_stream_close(struct vlc_http_stream *stream, bool abort)
 {
     struct vlc_h1_conn *conn = vlc_h1_stream_conn(stream);
 
-    assert(conn->active);
-
     if (abort)
         vlc_h1_stream_fatal(conn);
 
-    conn->active = false;
-
-    if (conn->released)
-        vlc_h1_conn_destroy(conn);
+    vlc_h1_stream_end(conn);
 }
 
 static const struct vlc_http_stream_cbs vlc_h1_stream_callbacks =
@@ -300,20 +324,36 @@ static void vlc_h1_conn_destroy(struct vlc_h1_conn *conn)
         vlc_tls_Shutdown(conn->conn.tls, true);
         vlc_tls_Close(conn->conn.tls);
     }
+    vlc_mutex_destroy(&conn->lock);
     free(conn);
 }
 
 static void vlc_h1_conn_release(struct vlc_http_conn *c)
 {
     struct vlc_h1_conn *conn = container_of(c, struct vlc_h1_conn, conn);
+    bool destroy;
 
+    vlc_mutex_lock(&conn->lock);
     assert(!conn->released);
     conn->released = true;
+    destroy = !conn->active;
+    vlc_mutex_unlock(&conn->lock);
 
-    if (!conn->active)
+    if (destroy)
         vlc_h1_conn_destroy(conn);
 }
 
+bool vlc_h1_conn_busy(struct vlc_http_conn *c)
+{
+    struct vlc_h1_conn *conn = container_of(c, struct vlc_h1_conn, conn);
+    bool busy;
+
+    vlc_mutex_lock(&conn->lock);
+    busy = conn->active;
+    vlc_mutex_unlock(&conn->lock);
+    return busy;
+}
+
 static const struct vlc_http_conn_cbs vlc_h1_conn_callbacks =
 {
     vlc_h1_stream_open,
@@ -333,6 +373,7 @@ struct vlc_http_conn *vlc_h1_conn_create(void *ctx, vlc_tls_t *tls, bool proxy)
     conn->released = false;
     conn->proxy = proxy;
     conn->opaque = ctx;
+    vlc_mutex_init(&conn->lock);
 
     return &conn->conn;
 }
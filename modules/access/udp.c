@@ -60,6 +60,14 @@ typedef struct {
 
     size_t length;
     char *offset;
+#ifdef HAVE_RECVMMSG
+    /* Batched receive */
+    unsigned batch;
+    size_t mtu;
+    block_t *pending;
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+#endif
     char buf[MRU];
 } access_sys_t;
 
@@ -133,6 +141,138 @@ static ssize_t Read(stream_t *access, void *buf, size_t len)
     return val;
 }
 
+#ifdef HAVE_RECVMMSG
+/**
+ * Receives a batch of datagrams with a single system call.
+ *
+ * Each datagram lands in its own MTU-sized slice of one preallocated block,
+ * with the shared overflow buffer catching the rare oversized datagram.
+ * The slices are then packed together, so the demuxer gets the whole batch
+ * as a single block.
+ */
+static block_t *BlockRecv(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+    block_t *block = sys->pending;
+
+    if (block == NULL) {
+        block = block_Alloc(sys->batch * sys->mtu);
+        if (unlikely(block == NULL))
+            return NULL;
+        sys->pending = block;
+    }
+
+    struct pollfd ufd[1];
+
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    switch (vlc_poll_i11e(ufd, 1, sys->timeout)) {
+        case 0:
+            msg_Err(access, "receive time-out");
+            *eof = true;
+            /* fall through */
+        case -1:
+            return NULL;
+    }
+
+    for (unsigned i = 0; i < sys->batch; i++) {
+        struct iovec *iov = &sys->iovecs[2 * i];
+
+        iov[0].iov_base = block->p_buffer + i * sys->mtu;
+        iov[0].iov_len = sys->mtu;
+        iov[1].iov_base = sys->buf;
+        iov[1].iov_len = MRU;
+        sys->msgs[i].msg_hdr.msg_iov = iov;
+        sys->msgs[i].msg_hdr.msg_iovlen = 2;
+    }
+
+    int count = recvmmsg(sys->fd, sys->msgs, sys->batch, MSG_DONTWAIT, NULL);
+    if (count <= 0)
+        return NULL;
+
+    /* Find the datagram, if any, whose tail is still in the overflow buffer:
+     * only the last oversized one of the batch can be recovered. */
+    int overflow = -1;
+    size_t total = 0, maxlen = 0;
+
+    for (int i = 0; i < count; i++) {
+        size_t len = sys->msgs[i].msg_len;
+
+        if (len > sys->mtu)
+            overflow = i;
+        if (len > maxlen)
+            maxlen = len;
+        total += len;
+    }
+
+    sys->pending = NULL;
+
+    if (unlikely(overflow >= 0)) {
+        /* Slow path: grow the slices for the next batches and copy out. */
+        size_t mtu = sys->mtu;
+        block_t *out = block_Alloc(total);
+
+        msg_Dbg(access, "increasing MTU from %zu to %zu bytes", mtu, maxlen);
+        sys->mtu = maxlen;
+
+        if (unlikely(out == NULL)) {
+            block_Release(block);
+            return NULL;
+        }
+
+        out->i_buffer = 0;
+        for (int i = 0; i < count; i++) {
+            size_t len = sys->msgs[i].msg_len;
+            size_t head = __MIN(len, mtu);
+
+            if (len > head && i != overflow) {
+                msg_Warn(access, "dropped oversized datagram (%zu bytes)", len);
+                continue;
+            }
+
+            memcpy(out->p_buffer + out->i_buffer, block->p_buffer + i * mtu,
+                   head);
+            if (len > head)
+                memcpy(out->p_buffer + out->i_buffer + head, sys->buf,
+                       len - head);
+            out->i_buffer += len;
+        }
+
+        block_Release(block);
+        return out;
+    }
+
+    /* Fast path: pack the datagrams in place. This is a no-op for the common
+     * case of constant datagram size (e.g. 7 TS packets). */
+    size_t offset = 0;
+
+    for (int i = 0; i < count; i++) {
+        size_t len = sys->msgs[i].msg_len;
+        uint8_t *slot = block->p_buffer + i * sys->mtu;
+
+        if (block->p_buffer + offset != slot)
+            memmove(block->p_buffer + offset, slot, len);
+        offset += len;
+    }
+
+    if (offset < block->i_buffer / 2) {
+        /* Mostly empty batch (low bit rate): do not pin a large buffer
+         * in the demuxer caches. */
+        block_t *out = block_Alloc(offset);
+
+        if (likely(out != NULL)) {
+            memcpy(out->p_buffer, block->p_buffer, offset);
+            block_Release(block);
+            return out;
+        }
+    }
+
+    block->i_buffer = offset;
+    return block;
+}
+#endif
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -217,6 +357,28 @@ static int Open( stream_t *p_access )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    sys->mtu = 7 * 188;
+    sys->pending = NULL;
+
+    if( sys->batch > 1 )
+    {
+        sys->msgs = vlc_obj_calloc( VLC_OBJECT(p_access), sys->batch,
+                                    sizeof( *sys->msgs ) );
+        sys->iovecs = vlc_obj_calloc( VLC_OBJECT(p_access), 2 * sys->batch,
+                                      sizeof( *sys->iovecs ) );
+        if( unlikely(sys->msgs == NULL || sys->iovecs == NULL) )
+        {
+            net_Close( sys->fd );
+            return VLC_ENOMEM;
+        }
+
+        p_access->pf_read = NULL;
+        p_access->pf_block = BlockRecv;
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -227,11 +389,19 @@ static void Close( stream_t *p_access )
 {
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    if( sys->pending != NULL )
+        block_Release( sys->pending );
+#endif
     net_Close( sys->fd );
 }
 
 #define TIMEOUT_TEXT N_("Source timeout (secs)")
 #define TIMEOUT_LONGTEXT N_("UDP source timeout (secs), -1 is infinite.")
+#define BATCH_TEXT N_("Receive batch size")
+#define BATCH_LONGTEXT N_("Maximum number of datagrams received per " \
+    "system call. Larger batches reduce the per-packet overhead on high " \
+    "bit rate streams. 1 disables batching.")
 
 vlc_plugin_begin()
     set_shortname("UDP")
@@ -241,4 +411,7 @@ vlc_plugin_begin()
     set_subcategory(SUBCAT_INPUT_ACCESS)
     add_obsolete_integer("udp-buffer") /* since 3.0.0 */
     add_integer_with_range("udp-timeout", -1, -1, INT_MAX, TIMEOUT_TEXT, TIMEOUT_LONGTEXT, true)
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range("udp-batch", 32, 1, 1024, BATCH_TEXT, BATCH_LONGTEXT, true)
+#endif
 vlc_plugin_end()
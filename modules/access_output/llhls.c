@@ -0,0 +1,844 @@
+/*****************************************************************************
+ * llhls.c: Low latency HTTP Live Streaming server
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <limits.h>
+
+#include <vlc_common.h>
+#include <vlc_util.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_arrays.h>
+#include <vlc_memstream.h>
+#include <vlc_httpd.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( sout_access_out_t * );
+static void Close( sout_access_out_t * );
+
+#define SOUT_CFG_PREFIX "sout-llhls-"
+
+#define SEGLEN_TEXT N_("Segment length")
+#define SEGLEN_LONGTEXT N_("Maximum length of the segments, in seconds")
+
+#define PARTLEN_TEXT N_("Partial segment length")
+#define PARTLEN_LONGTEXT N_("Maximum length of the partial segments, in "\
+                            "milliseconds. With fragmented MP4, set the CMAF "\
+                            "chunk duration of the muxer to the same value "\
+                            "or less.")
+
+#define NUMSEGS_TEXT N_("Number of segments")
+#define NUMSEGS_LONGTEXT N_("Number of segments to include in the playlist")
+
+#define MAXSIZE_TEXT N_("Maximum memory size")
+#define MAXSIZE_LONGTEXT N_("Maximum size of the segments kept in memory, in "\
+                            "KiB. Older segments are dropped from the "\
+                            "playlist first. 0 for no limit.")
+
+#define SPLITANYWHERE_TEXT N_("Split segments anywhere")
+#define SPLITANYWHERE_LONGTEXT N_("Don't require a keyframe before splitting "\
+                                  "a segment. Needed for audio only.")
+
+vlc_plugin_begin ()
+    set_description( N_("Low latency HTTP Live streaming") )
+    set_shortname( "LL-HLS" )
+    add_shortcut( "llhls" )
+    set_capability( VLC_CAP_SOUT_ACCESS, 0, Open, Close )
+
+    set_subcategory( SUBCAT_SOUT_ACO )
+    add_integer_with_range( SOUT_CFG_PREFIX "seglen", 4, 1, 60,
+                            SEGLEN_TEXT, SEGLEN_LONGTEXT, false )
+    add_integer_with_range( SOUT_CFG_PREFIX "partlen", 1000, 100, 10000,
+                            PARTLEN_TEXT, PARTLEN_LONGTEXT, false )
+    add_integer_with_range( SOUT_CFG_PREFIX "numsegs", 6, 2, 1000,
+                            NUMSEGS_TEXT, NUMSEGS_LONGTEXT, false )
+    add_integer_with_range( SOUT_CFG_PREFIX "max-size", 65536, 0, INT_MAX,
+                            MAXSIZE_TEXT, MAXSIZE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "splitanywhere", false,
+              SPLITANYWHERE_TEXT, SPLITANYWHERE_LONGTEXT, true )
+vlc_plugin_end ()
+
+
+/*****************************************************************************
+ * Exported prototypes
+ *****************************************************************************/
+static const char *const ppsz_sout_options[] = {
+    "seglen",
+    "partlen",
+    "numsegs",
+    "max-size",
+    "splitanywhere",
+    NULL
+};
+
+static ssize_t Write( sout_access_out_t *, block_t * );
+static int Control( sout_access_out_t *, int, va_list );
+
+#define INIT_NAME       "init.mp4"
+#define SEGMENT_NAME    "segment"
+
+typedef struct
+{
+    size_t      i_offset;
+    size_t      i_size;
+    vlc_tick_t  i_duration;
+    bool        b_independent;
+} hls_part_t;
+
+typedef struct
+{
+    int64_t     i_msn;
+    bool        b_complete;
+
+    uint8_t    *p_data;
+    size_t      i_size;
+    size_t      i_alloc;
+
+    vlc_tick_t  i_start;
+    vlc_tick_t  i_end;
+
+    /* completed parts */
+    hls_part_t *p_parts;
+    size_t      i_parts;
+    size_t      i_parts_alloc;
+
+    /* part being filled */
+    size_t      i_part_offset;
+    vlc_tick_t  i_part_start;
+    bool        b_part_independent;
+} hls_segment_t;
+
+typedef struct
+{
+    httpd_host_t *p_httpd_host;
+    httpd_url_t  *p_playlist_url;
+    httpd_url_t  *p_init_url;
+    httpd_url_t  *p_segment_url;
+
+    vlc_tick_t    i_seglen;     /* target duration, never exceeded */
+    vlc_tick_t    i_partlen;    /* part target, never exceeded */
+    unsigned      i_numsegs;
+    size_t        i_max_size;
+    bool          b_splitanywhere;
+
+    /* everything below is shared with the httpd thread */
+    vlc_mutex_t   lock;
+
+    uint8_t      *p_init;
+    size_t        i_init;
+    bool          b_fmp4;
+
+    vlc_array_t   segments;     /* oldest first, the last one may be ongoing */
+    int64_t       i_next_msn;
+    size_t        i_size;
+
+    /* duration between the last two split points */
+    vlc_tick_t    i_split_end;
+    vlc_tick_t    i_split_step;
+
+    char         *psz_playlist; /* NULL until the first part is complete */
+    size_t        i_playlist;
+} sout_access_out_sys_t;
+
+/*****************************************************************************
+ * Segments
+ *****************************************************************************/
+static void SegmentDelete( hls_segment_t *p_seg )
+{
+    free( p_seg->p_data );
+    free( p_seg->p_parts );
+    free( p_seg );
+}
+
+static hls_segment_t *GetSegment( sout_access_out_sys_t *p_sys, int64_t i_msn )
+{
+    size_t i_count = vlc_array_count( &p_sys->segments );
+    if( i_count == 0 )
+        return NULL;
+
+    hls_segment_t *p_first = vlc_array_item_at_index( &p_sys->segments, 0 );
+    if( i_msn < p_first->i_msn || i_msn - p_first->i_msn >= (int64_t)i_count )
+        return NULL;
+    return vlc_array_item_at_index( &p_sys->segments, i_msn - p_first->i_msn );
+}
+
+static hls_segment_t *GetOngoingSegment( sout_access_out_sys_t *p_sys )
+{
+    size_t i_count = vlc_array_count( &p_sys->segments );
+    if( i_count == 0 )
+        return NULL;
+
+    hls_segment_t *p_seg = vlc_array_item_at_index( &p_sys->segments, i_count - 1 );
+    return p_seg->b_complete ? NULL : p_seg;
+}
+
+static vlc_tick_t SegmentDuration( const hls_segment_t *p_seg )
+{
+    if( p_seg->i_start == VLC_TICK_INVALID || p_seg->i_end < p_seg->i_start )
+        return 0;
+    return p_seg->i_end - p_seg->i_start;
+}
+
+static vlc_tick_t PartDuration( const hls_segment_t *p_seg )
+{
+    if( p_seg->i_part_start == VLC_TICK_INVALID || p_seg->i_end < p_seg->i_part_start )
+        return 0;
+    return p_seg->i_end - p_seg->i_part_start;
+}
+
+static hls_segment_t *SegmentNew( sout_access_out_sys_t *p_sys )
+{
+    hls_segment_t *p_seg = calloc( 1, sizeof(*p_seg) );
+    if( unlikely(p_seg == NULL) )
+        return NULL;
+
+    p_seg->i_msn = p_sys->i_next_msn;
+    p_seg->i_start = VLC_TICK_INVALID;
+    p_seg->i_end = VLC_TICK_INVALID;
+    p_seg->i_part_start = VLC_TICK_INVALID;
+
+    if( vlc_array_append( &p_sys->segments, p_seg ) )
+    {
+        SegmentDelete( p_seg );
+        return NULL;
+    }
+    p_sys->i_next_msn++;
+    return p_seg;
+}
+
+static int SegmentAppend( sout_access_out_sys_t *p_sys, hls_segment_t *p_seg,
+                          const block_t *p_block )
+{
+    if( p_seg->i_size + p_block->i_buffer > p_seg->i_alloc )
+    {
+        size_t i_alloc = __MAX( p_seg->i_alloc * 2, 65536 );
+        while( i_alloc < p_seg->i_size + p_block->i_buffer )
+            i_alloc *= 2;
+        uint8_t *p_data = realloc( p_seg->p_data, i_alloc );
+        if( unlikely(p_data == NULL) )
+            return VLC_ENOMEM;
+        p_seg->p_data = p_data;
+        p_seg->i_alloc = i_alloc;
+    }
+
+    memcpy( &p_seg->p_data[p_seg->i_size], p_block->p_buffer, p_block->i_buffer );
+    p_seg->i_size += p_block->i_buffer;
+    p_sys->i_size += p_block->i_buffer;
+
+    if( p_block->i_dts != VLC_TICK_INVALID )
+    {
+        vlc_tick_t i_end = p_block->i_dts + __MAX( p_block->i_length, 0 );
+        if( p_seg->i_start == VLC_TICK_INVALID )
+            p_seg->i_start = p_block->i_dts;
+        if( p_seg->i_part_start == VLC_TICK_INVALID )
+            p_seg->i_part_start = p_block->i_dts;
+        if( p_seg->i_end == VLC_TICK_INVALID || i_end > p_seg->i_end )
+            p_seg->i_end = i_end;
+    }
+    return VLC_SUCCESS;
+}
+
+static void ClosePart( hls_segment_t *p_seg )
+{
+    if( p_seg->i_part_offset == p_seg->i_size )
+        return;
+
+    if( p_seg->i_parts == p_seg->i_parts_alloc )
+    {
+        size_t i_alloc = p_seg->i_parts_alloc ? p_seg->i_parts_alloc * 2 : 16;
+        hls_part_t *p_parts = vlc_reallocarray( p_seg->p_parts, i_alloc,
+                                                sizeof(*p_parts) );
+        if( unlikely(p_parts == NULL) )
+            return; /* the data will go with the next part */
+        p_seg->p_parts = p_parts;
+        p_seg->i_parts_alloc = i_alloc;
+    }
+
+    hls_part_t *p_part = &p_seg->p_parts[p_seg->i_parts++];
+    p_part->i_offset = p_seg->i_part_offset;
+    p_part->i_size = p_seg->i_size - p_seg->i_part_offset;
+    p_part->i_duration = PartDuration( p_seg );
+    p_part->b_independent = p_seg->b_part_independent;
+
+    p_seg->i_part_offset = p_seg->i_size;
+    p_seg->i_part_start = p_seg->i_end;
+    p_seg->b_part_independent = false;
+}
+
+static void CloseSegment( hls_segment_t *p_seg )
+{
+    ClosePart( p_seg );
+    p_seg->b_complete = true;
+}
+
+/* Keeps the listed segments and a couple more for the clients that are
+ * still reading them, within the memory limit. */
+static void EvictSegments( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    while( vlc_array_count( &p_sys->segments ) > 1 )
+    {
+        hls_segment_t *p_seg = vlc_array_item_at_index( &p_sys->segments, 0 );
+        if( !p_seg->b_complete ||
+            ( vlc_array_count( &p_sys->segments ) <= p_sys->i_numsegs + 2 &&
+              ( p_sys->i_max_size == 0 || p_sys->i_size <= p_sys->i_max_size ) ) )
+            break;
+
+        msg_Dbg( p_access, "Removing segment number %"PRId64, p_seg->i_msn );
+        vlc_array_remove( &p_sys->segments, 0 );
+        p_sys->i_size -= p_seg->i_size;
+        SegmentDelete( p_seg );
+    }
+}
+
+/*****************************************************************************
+ * Playlist
+ *****************************************************************************/
+static void PrintDuration( struct vlc_memstream *ms, vlc_tick_t i_duration )
+{
+    /* locale independent */
+    int64_t i_ms = MS_FROM_VLC_TICK( i_duration );
+    vlc_memstream_printf( ms, "%"PRId64".%03u", i_ms / 1000,
+                          (unsigned)( i_ms % 1000 ) );
+}
+
+static void PrintParts( struct vlc_memstream *ms, const hls_segment_t *p_seg )
+{
+    for( size_t i = 0; i < p_seg->i_parts; i++ )
+    {
+        const hls_part_t *p_part = &p_seg->p_parts[i];
+        vlc_memstream_puts( ms, "#EXT-X-PART:DURATION=" );
+        PrintDuration( ms, p_part->i_duration );
+        vlc_memstream_printf( ms, ",URI=\""SEGMENT_NAME"?msn=%"PRId64"&part=%zu\"%s\n",
+                              p_seg->i_msn, i, p_part->b_independent
+                              ? ",INDEPENDENT=YES" : "" );
+    }
+}
+
+static void UpdatePlaylist( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const size_t i_count = vlc_array_count( &p_sys->segments );
+    hls_segment_t *p_ongoing = GetOngoingSegment( p_sys );
+    const size_t i_complete = p_ongoing ? i_count - 1 : i_count;
+
+    /* wait for something to play */
+    if( i_complete == 0 && ( p_ongoing == NULL || p_ongoing->i_parts == 0 ) )
+        return;
+
+    const size_t i_first = i_complete > p_sys->i_numsegs
+                         ? i_complete - p_sys->i_numsegs : 0;
+    vlc_tick_t i_last_end = VLC_TICK_INVALID;
+    if( i_count > 0 )
+        i_last_end = ((hls_segment_t *)vlc_array_item_at_index( &p_sys->segments,
+                                                                i_count - 1 ))->i_end;
+
+    struct vlc_memstream ms;
+    if( vlc_memstream_open( &ms ) )
+        return;
+
+    vlc_memstream_printf( &ms, "#EXTM3U\n#EXT-X-VERSION:6\n"
+                          "#EXT-X-TARGETDURATION:%"PRId64"\n",
+                          SEC_FROM_VLC_TICK( p_sys->i_seglen ) );
+    vlc_memstream_puts( &ms, "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" );
+    PrintDuration( &ms, 3 * p_sys->i_partlen );
+    vlc_memstream_puts( &ms, "\n#EXT-X-PART-INF:PART-TARGET=" );
+    PrintDuration( &ms, p_sys->i_partlen );
+    vlc_memstream_printf( &ms, "\n#EXT-X-MEDIA-SEQUENCE:%"PRId64"\n",
+                          i_first < i_count
+                          ? ((hls_segment_t *)vlc_array_item_at_index( &p_sys->segments,
+                                                                       i_first ))->i_msn
+                          : p_sys->i_next_msn );
+    if( p_sys->b_fmp4 && p_sys->p_init )
+        vlc_memstream_puts( &ms, "#EXT-X-MAP:URI=\""INIT_NAME"\"\n" );
+
+    for( size_t i = i_first; i < i_complete; i++ )
+    {
+        const hls_segment_t *p_seg = vlc_array_item_at_index( &p_sys->segments, i );
+
+        /* parts are only listed close to the live edge */
+        if( i_last_end != VLC_TICK_INVALID && i_last_end - p_seg->i_end < 3 * p_sys->i_seglen )
+            PrintParts( &ms, p_seg );
+
+        vlc_memstream_puts( &ms, "#EXTINF:" );
+        PrintDuration( &ms, SegmentDuration( p_seg ) );
+        vlc_memstream_printf( &ms, ",\n"SEGMENT_NAME"?msn=%"PRId64"\n", p_seg->i_msn );
+    }
+
+    if( p_ongoing )
+    {
+        PrintParts( &ms, p_ongoing );
+        vlc_memstream_printf( &ms, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\""
+                              SEGMENT_NAME"?msn=%"PRId64"&part=%zu\"\n",
+                              p_ongoing->i_msn, p_ongoing->i_parts );
+    }
+
+    if( vlc_memstream_close( &ms ) )
+        return;
+
+    free( p_sys->psz_playlist );
+    p_sys->psz_playlist = ms.ptr;
+    p_sys->i_playlist = ms.length;
+}
+
+/*****************************************************************************
+ * HTTP callbacks
+ *****************************************************************************/
+static bool GetArg( const uint8_t *psz_args, const char *psz_name, int64_t *pi_value )
+{
+    if( psz_args == NULL )
+        return false;
+
+    const char *psz = (const char *)psz_args;
+    const size_t i_len = strlen( psz_name );
+    while( *psz )
+    {
+        if( !strncmp( psz, psz_name, i_len ) && psz[i_len] == '=' )
+        {
+            char *psz_end;
+            long long i_value = strtoll( &psz[i_len + 1], &psz_end, 10 );
+            if( psz_end == &psz[i_len + 1] || i_value < 0 )
+                return false;
+            *pi_value = i_value;
+            return true;
+        }
+        psz += strcspn( psz, "&" );
+        if( *psz )
+            psz++;
+    }
+    return false;
+}
+
+static void Answer( httpd_message_t *answer, int i_status, const char *psz_mime,
+                    const uint8_t *p_data, size_t i_data )
+{
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_status = i_status;
+
+    if( i_data > 0 && ( answer->p_body = malloc( i_data ) ) != NULL )
+    {
+        memcpy( answer->p_body, p_data, i_data );
+        answer->i_body = i_data;
+    }
+    else
+    {
+        answer->p_body = NULL;
+        answer->i_body = 0;
+    }
+
+    if( psz_mime )
+        httpd_MsgAdd( answer, "Content-Type", "%s", psz_mime );
+    httpd_MsgAdd( answer, "Cache-Control", "%s", "no-cache" );
+    httpd_MsgAdd( answer, "Access-Control-Allow-Origin", "*" );
+    httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+}
+
+static int PlaylistCallback( httpd_callback_sys_t *opaque, httpd_client_t *cl,
+                             httpd_message_t *answer, const httpd_message_t *query )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *)opaque;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int64_t i_msn, i_part;
+    VLC_UNUSED( cl );
+
+    if( !answer || !query )
+        return VLC_SUCCESS;
+
+    /* blocking playlist reload */
+    bool b_block = GetArg( query->psz_args, "_HLS_msn", &i_msn );
+    if( !b_block || !GetArg( query->psz_args, "_HLS_part", &i_part ) )
+        i_part = -1;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( b_block && i_msn > p_sys->i_next_msn + 1 )
+    {
+        /* too far ahead of the last complete segment */
+        Answer( answer, 400, NULL, NULL, 0 );
+    }
+    else
+    {
+        bool b_ready = p_sys->psz_playlist != NULL;
+        if( b_ready && b_block )
+        {
+            const hls_segment_t *p_seg = GetSegment( p_sys, i_msn );
+            if( p_seg )
+                b_ready = p_seg->b_complete ||
+                          ( i_part >= 0 && (size_t)i_part < p_seg->i_parts );
+            else
+                b_ready = i_msn < p_sys->i_next_msn;
+        }
+
+        /* otherwise answer once it is updated */
+        if( b_ready )
+            Answer( answer, 200, "application/vnd.apple.mpegurl",
+                    (const uint8_t *)p_sys->psz_playlist, p_sys->i_playlist );
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return VLC_SUCCESS;
+}
+
+static int InitCallback( httpd_callback_sys_t *opaque, httpd_client_t *cl,
+                         httpd_message_t *answer, const httpd_message_t *query )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *)opaque;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    VLC_UNUSED( cl );
+
+    if( !answer || !query )
+        return VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->p_init )
+        Answer( answer, 200, "video/mp4", p_sys->p_init, p_sys->i_init );
+    else
+        Answer( answer, 404, NULL, NULL, 0 );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return VLC_SUCCESS;
+}
+
+static int SegmentCallback( httpd_callback_sys_t *opaque, httpd_client_t *cl,
+                            httpd_message_t *answer, const httpd_message_t *query )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *)opaque;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int64_t i_msn, i_part;
+    VLC_UNUSED( cl );
+
+    if( !answer || !query )
+        return VLC_SUCCESS;
+
+    if( !GetArg( query->psz_args, "msn", &i_msn ) )
+    {
+        Answer( answer, 400, NULL, NULL, 0 );
+        return VLC_SUCCESS;
+    }
+    if( !GetArg( query->psz_args, "part", &i_part ) )
+        i_part = -1;
+
+    vlc_mutex_lock( &p_sys->lock );
+    const char *psz_mime = p_sys->b_fmp4 ? "video/mp4" : "video/mp2t";
+    const hls_segment_t *p_seg = GetSegment( p_sys, i_msn );
+    if( p_seg == NULL )
+    {
+        /* wait for the first part of the next segment, 404 otherwise */
+        if( i_msn != p_sys->i_next_msn || i_part != 0 )
+            Answer( answer, 404, NULL, NULL, 0 );
+    }
+    else if( i_part < 0 )
+    {
+        /* a whole segment may take longer than the client would wait */
+        if( p_seg->b_complete )
+            Answer( answer, 200, psz_mime, p_seg->p_data, p_seg->i_size );
+        else
+            Answer( answer, 404, NULL, NULL, 0 );
+    }
+    else if( (size_t)i_part < p_seg->i_parts )
+    {
+        const hls_part_t *p_part = &p_seg->p_parts[i_part];
+        Answer( answer, 200, psz_mime, &p_seg->p_data[p_part->i_offset],
+                p_part->i_size );
+    }
+    else if( p_seg->b_complete || (size_t)i_part > p_seg->i_parts )
+    {
+        Answer( answer, 404, NULL, NULL, 0 );
+    }
+    /* else this is the preload hint: answer once the part is complete */
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Open: open the server
+ *****************************************************************************/
+static int Open( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys;
+
+    config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
+
+    const char *path = p_access->psz_path;
+    path += strcspn( path, "/" );
+    if( path > p_access->psz_path )
+    {
+        const char *port = strrchr( p_access->psz_path, ':' );
+        if( port != NULL && strchr( port, ']' ) != NULL )
+            port = NULL; /* IPv6 numeral */
+        if( port != p_access->psz_path )
+        {
+            int len = (port ? port : path) - p_access->psz_path;
+            char host[len + 1];
+            strncpy( host, p_access->psz_path, len );
+            host[len] = '\0';
+
+            var_Create( p_access, "http-host", VLC_VAR_STRING );
+            var_SetString( p_access, "http-host", host );
+        }
+        if( port != NULL )
+        {
+            int bind_port = atoi( port + 1 );
+            if( bind_port > 0 )
+            {
+                var_Create( p_access, "http-port", VLC_VAR_INTEGER );
+                var_SetInteger( p_access, "http-port", bind_port );
+            }
+        }
+    }
+    if( !*path || path[strlen( path ) - 1] == '/' )
+    {
+        msg_Err( p_access, "no playlist name specified" );
+        return VLC_EGENERIC;
+    }
+
+    if( unlikely( !( p_sys = calloc( 1, sizeof( *p_sys ) ) ) ) )
+        return VLC_ENOMEM;
+
+    p_sys->i_seglen = vlc_tick_from_sec( var_GetInteger( p_access, SOUT_CFG_PREFIX "seglen" ) );
+    p_sys->i_partlen = VLC_TICK_FROM_MS( var_GetInteger( p_access, SOUT_CFG_PREFIX "partlen" ) );
+    p_sys->i_numsegs = var_GetInteger( p_access, SOUT_CFG_PREFIX "numsegs" );
+    p_sys->i_max_size = (size_t)var_GetInteger( p_access, SOUT_CFG_PREFIX "max-size" ) * 1024;
+    p_sys->b_splitanywhere = var_GetBool( p_access, SOUT_CFG_PREFIX "splitanywhere" );
+    if( p_sys->i_partlen > p_sys->i_seglen )
+        p_sys->i_partlen = p_sys->i_seglen;
+    p_sys->i_split_end = VLC_TICK_INVALID;
+
+    vlc_mutex_init( &p_sys->lock );
+    vlc_array_init( &p_sys->segments );
+    p_access->p_sys = p_sys;
+
+    /* the segments are served next to the playlist */
+    size_t i_dir = strrchr( path, '/' ) - path + 1;
+    char *psz_init_url, *psz_segment_url;
+    if( asprintf( &psz_init_url, "%.*s"INIT_NAME, (int)i_dir, path ) < 0 )
+        psz_init_url = NULL;
+    if( asprintf( &psz_segment_url, "%.*s"SEGMENT_NAME, (int)i_dir, path ) < 0 )
+        psz_segment_url = NULL;
+
+    p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+    if( p_sys->p_httpd_host == NULL )
+    {
+        msg_Err( p_access, "cannot start HTTP server" );
+        goto error;
+    }
+
+    if( psz_init_url == NULL || psz_segment_url == NULL ||
+        !( p_sys->p_playlist_url = httpd_UrlNew( p_sys->p_httpd_host, path, NULL, NULL ) ) ||
+        !( p_sys->p_init_url = httpd_UrlNew( p_sys->p_httpd_host, psz_init_url, NULL, NULL ) ) ||
+        !( p_sys->p_segment_url = httpd_UrlNew( p_sys->p_httpd_host, psz_segment_url, NULL, NULL ) ) )
+    {
+        msg_Err( p_access, "cannot add playlist %s", path );
+        goto error;
+    }
+    free( psz_init_url );
+    free( psz_segment_url );
+
+    httpd_UrlCatch( p_sys->p_playlist_url, HTTPD_MSG_GET, PlaylistCallback,
+                    (httpd_callback_sys_t *)p_access );
+    httpd_UrlCatch( p_sys->p_init_url, HTTPD_MSG_GET, InitCallback,
+                    (httpd_callback_sys_t *)p_access );
+    httpd_UrlCatch( p_sys->p_segment_url, HTTPD_MSG_GET, SegmentCallback,
+                    (httpd_callback_sys_t *)p_access );
+
+    p_access->pf_write = Write;
+    p_access->pf_control = Control;
+
+    return VLC_SUCCESS;
+
+error:
+    free( psz_init_url );
+    free( psz_segment_url );
+    if( p_sys->p_playlist_url )
+        httpd_UrlDelete( p_sys->p_playlist_url );
+    if( p_sys->p_init_url )
+        httpd_UrlDelete( p_sys->p_init_url );
+    if( p_sys->p_httpd_host )
+        httpd_HostDelete( p_sys->p_httpd_host );
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close: close the server
+ *****************************************************************************/
+static void Close( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    /* pending requests are dropped with their URL */
+    httpd_UrlDelete( p_sys->p_segment_url );
+    httpd_UrlDelete( p_sys->p_init_url );
+    httpd_UrlDelete( p_sys->p_playlist_url );
+    httpd_HostDelete( p_sys->p_httpd_host );
+
+    for( size_t i = 0; i < vlc_array_count( &p_sys->segments ); i++ )
+        SegmentDelete( vlc_array_item_at_index( &p_sys->segments, i ) );
+    vlc_array_clear( &p_sys->segments );
+
+    free( p_sys->psz_playlist );
+    free( p_sys->p_init );
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys );
+
+    msg_Dbg( p_access, "llhls access output closed" );
+}
+
+static int Control( sout_access_out_t *p_access, int i_query, va_list args )
+{
+    (void)p_access;
+
+    switch( i_query )
+    {
+        case ACCESS_OUT_CONTROLS_PACE:
+            *va_arg( args, bool * ) = false;
+            break;
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Write: cut the stream into segments and parts
+ *****************************************************************************/
+static bool IsBox( const block_t *p_block, const char *psz_type )
+{
+    return p_block->i_buffer >= 8 && !memcmp( &p_block->p_buffer[4], psz_type, 4 );
+}
+
+/* fragmented MP4 can only be cut before a chunk, anything else is TS */
+static bool CanSplit( const sout_access_out_sys_t *p_sys, const block_t *p_block )
+{
+    return !p_sys->b_fmp4 || IsBox( p_block, "styp" ) || IsBox( p_block, "moof" );
+}
+
+/* Returns true if the playlist must be updated */
+static bool WriteMedia( sout_access_out_t *p_access, const block_t *p_block )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    hls_segment_t *p_seg = GetOngoingSegment( p_sys );
+    const bool b_random = p_sys->b_splitanywhere ||
+                          ( p_block->i_flags & (BLOCK_FLAG_HEADER | BLOCK_FLAG_TYPE_I) );
+    const bool b_split = CanSplit( p_sys, p_block );
+    bool b_update = false;
+
+    if( p_seg && b_split )
+    {
+        /* assume the next chunk lasts as long as the previous one */
+        if( p_sys->i_split_end != VLC_TICK_INVALID &&
+            p_seg->i_end > p_sys->i_split_end )
+            p_sys->i_split_step = p_seg->i_end - p_sys->i_split_end;
+        p_sys->i_split_end = p_seg->i_end;
+
+        /* the targets are advertised up front: split before exceeding them,
+         * even without a random access point */
+        const vlc_tick_t i_seg = SegmentDuration( p_seg );
+        const vlc_tick_t i_part = PartDuration( p_seg );
+        if( i_seg > 0 && ( ( b_random && i_seg >= p_sys->i_seglen ) ||
+                           i_seg + p_sys->i_split_step > p_sys->i_seglen ) )
+        {
+            msg_Dbg( p_access, "segment %"PRId64" complete", p_seg->i_msn );
+            CloseSegment( p_seg );
+            p_seg = NULL;
+            b_update = true;
+        }
+        else if( i_part > 0 && ( i_part >= p_sys->i_partlen ||
+                                 i_part + p_sys->i_split_step > p_sys->i_partlen ) )
+        {
+            ClosePart( p_seg );
+            b_update = true;
+        }
+    }
+
+    if( p_seg == NULL )
+    {
+        /* segments start on random access points */
+        if( !b_split || ( !b_random && vlc_array_count( &p_sys->segments ) == 0 ) )
+            return b_update;
+
+        p_seg = SegmentNew( p_sys );
+        if( unlikely(p_seg == NULL) )
+            return b_update;
+    }
+
+    if( p_seg->i_part_offset == p_seg->i_size )
+        p_seg->b_part_independent = b_random;
+
+    if( SegmentAppend( p_sys, p_seg, p_block ) )
+        msg_Err( p_access, "cannot store segment %"PRId64, p_seg->i_msn );
+
+    if( b_update )
+        EvictSegments( p_access );
+    return b_update;
+}
+
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    ssize_t i_write = 0;
+    bool b_update = false;
+
+    vlc_mutex_lock( &p_sys->lock );
+    while( p_buffer )
+    {
+        block_t *p_next = p_buffer->p_next;
+
+        if( ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) && IsBox( p_buffer, "ftyp" ) )
+        {
+            /* fragmented MP4 initialization section */
+            uint8_t *p_init = realloc( p_sys->p_init, p_buffer->i_buffer );
+            if( p_init )
+            {
+                memcpy( p_init, p_buffer->p_buffer, p_buffer->i_buffer );
+                p_sys->p_init = p_init;
+                p_sys->i_init = p_buffer->i_buffer;
+                p_sys->b_fmp4 = true;
+            }
+        }
+        else
+            b_update |= WriteMedia( p_access, p_buffer );
+
+        i_write += p_buffer->i_buffer;
+        block_Release( p_buffer );
+        p_buffer = p_next;
+    }
+
+    if( b_update )
+        UpdatePlaylist( p_access );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_write;
+}
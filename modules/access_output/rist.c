@@ -92,7 +92,7 @@ typedef struct
     block_t      *p_pktbuffer;
     uint64_t     i_ticks_caching;
     uint32_t     ssrc;
-    block_fifo_t *p_fifo;
+    vlc_spsc_fifo_t *p_fifo;
     /* stats variables */
     uint64_t     i_last_stat;
     uint32_t     i_retransmit_packets;
@@ -494,7 +494,7 @@ static void* ThreadSend( void *data )
         ssize_t len = 0;
         uint16_t seq = 0;
         uint32_t pkt_ts = 0;
-        block_t *out = block_FifoGet( p_sys->p_fifo );
+        block_t *out = vlc_spsc_fifo_DequeueWait( p_sys->p_fifo );
 
         block_cleanup_push( out );
         vlc_tick_wait (out->i_dts + i_caching);
@@ -592,7 +592,7 @@ static void SendtoFIFO( sout_access_out_t *p_access, block_t *buffer )
     rtp_set_timestamp(bufhdr, pkt_ts);
 
     block_t *pkt = block_Duplicate(buffer);
-    block_FifoPut( p_sys->p_fifo, pkt );
+    vlc_spsc_fifo_Queue( p_sys->p_fifo, pkt );
 }
 
 static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
@@ -689,7 +689,7 @@ static void Clean( sout_access_out_t *p_access )
     sout_access_out_sys_t *p_sys = p_access->p_sys;
 
     if( likely(p_sys->p_fifo != NULL) )
-        block_FifoRelease( p_sys->p_fifo );
+        vlc_spsc_fifo_Delete( p_sys->p_fifo );
 
     if ( p_sys->flow )
     {
@@ -794,7 +794,7 @@ static int Open( sout_access_out_t *p_access )
     p_sys->i_ticks_caching = VLC_TICK_FROM_MS(var_InheritInteger( p_access, 
         SOUT_CFG_PREFIX "caching"));
     p_sys->i_packet_size = var_InheritInteger(p_access, SOUT_CFG_PREFIX "packet-size" );
-    p_sys->p_fifo = block_FifoNew();
+    p_sys->p_fifo = vlc_spsc_fifo_New();
     if( unlikely(p_sys->p_fifo == NULL) )
         goto failed;
     p_sys->p_pktbuffer = block_Alloc( p_sys->i_packet_size );
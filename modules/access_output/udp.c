@@ -45,11 +45,21 @@
 #elif defined (HAVE_SYS_SOCKET_H)
 #   include <sys/socket.h>
 #endif
+#ifdef __linux__
+#   include <netinet/udp.h>
+#endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
 
+#if defined (HAVE_SENDMMSG) && defined (UDP_SEGMENT)
+# define HAVE_UDP_GSO 1
+/* Kernel limits for one segmented (GSO) send */
+# define GSO_MAX_SEGMENTS 64
+# define GSO_MAX_BYTES    (65535 - 40 - 8)
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -70,6 +80,21 @@ static void Close( sout_access_out_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Send batch size")
+#define BATCH_LONGTEXT N_("Maximum number of packets handed to the kernel " \
+                          "with a single system call. Packets are still " \
+                          "paced according to their timestamps. 1 disables " \
+                          "batching." )
+
+#define PACING_TEXT N_("Pacing window (ms)")
+#define PACING_LONGTEXT N_("Packets due within this window are sent " \
+                           "together, with a single system call. 0 sends " \
+                           "each packet exactly on time." )
+
+#define GSO_TEXT N_("UDP segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split runs of equally-sized " \
+                        "packets (Linux UDP GSO), if supported." )
+
 vlc_plugin_begin ()
     set_shortname( "UDP" )
     set_capability( VLC_CAP_SOUT_ACCESS, 0, Open, Close )
@@ -77,6 +102,13 @@ vlc_plugin_begin ()
     set_subcategory( SUBCAT_SOUT_ACO )
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT, true )
+#ifdef HAVE_SENDMMSG
+    add_integer_with_range( SOUT_CFG_PREFIX "batch", 32, 1, 1024, BATCH_TEXT, BATCH_LONGTEXT, true )
+    add_integer_with_range( SOUT_CFG_PREFIX "pacing", 1, 0, 100, PACING_TEXT, PACING_LONGTEXT, true )
+#endif
+#ifdef HAVE_UDP_GSO
+    add_bool( SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT, true )
+#endif
 vlc_plugin_end ()
 
 /*****************************************************************************
@@ -86,6 +118,13 @@ vlc_plugin_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef HAVE_SENDMMSG
+    "batch",
+    "pacing",
+#endif
+#ifdef HAVE_UDP_GSO
+    "gso",
+#endif
     NULL
 };
 
@@ -109,12 +148,34 @@ typedef struct
     bool          b_mtu_warning;
     size_t        i_mtu;
 
-    block_fifo_t *p_fifo;
+    vlc_spsc_fifo_t *p_fifo;
     block_t      *p_buffer;
 
+    /* Packets paced but not yet handed to the kernel */
+    block_t     **pp_batch;
+    unsigned      i_batch;
+    unsigned      i_batch_max;
+    vlc_tick_t    i_pacing;
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr *p_msgs;
+    struct iovec *p_iov;
+#endif
+#ifdef HAVE_UDP_GSO
+    bool          b_gso;
+#endif
+
     vlc_thread_t  thread;
 } sout_access_out_sys_t;
 
+static void FreeBatch( sout_access_out_sys_t *p_sys )
+{
+    free( p_sys->pp_batch );
+#ifdef HAVE_SENDMMSG
+    free( p_sys->p_msgs );
+    free( p_sys->p_iov );
+#endif
+}
+
 #define DEFAULT_PORT 1234
 
 /*****************************************************************************
@@ -200,14 +261,49 @@ static int Open( sout_access_out_t *p_access )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_access, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
+    p_sys->p_fifo = vlc_spsc_fifo_New();
     p_sys->p_buffer = NULL;
+    if( unlikely(p_sys->p_fifo == NULL) )
+    {
+        net_Close (i_handle);
+        free (p_sys);
+        return VLC_ENOMEM;
+    }
+
+#ifdef HAVE_SENDMMSG
+    p_sys->i_batch_max = var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" );
+    p_sys->i_pacing = VLC_TICK_FROM_MS(
+                        var_GetInteger( p_access, SOUT_CFG_PREFIX "pacing" ) );
+    p_sys->p_msgs = calloc( p_sys->i_batch_max, sizeof( *p_sys->p_msgs ) );
+    p_sys->p_iov = calloc( p_sys->i_batch_max, sizeof( *p_sys->p_iov ) );
+#else
+    p_sys->i_batch_max = 1;
+    p_sys->i_pacing = 0;
+#endif
+#ifdef HAVE_UDP_GSO
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
+#endif
+    p_sys->i_batch = 0;
+    p_sys->pp_batch = calloc( p_sys->i_batch_max, sizeof( *p_sys->pp_batch ) );
+    if( unlikely(p_sys->pp_batch == NULL)
+#ifdef HAVE_SENDMMSG
+     || unlikely(p_sys->p_msgs == NULL || p_sys->p_iov == NULL)
+#endif
+      )
+    {
+        FreeBatch( p_sys );
+        vlc_spsc_fifo_Delete( p_sys->p_fifo );
+        net_Close (i_handle);
+        free (p_sys);
+        return VLC_ENOMEM;
+    }
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
-        block_FifoRelease( p_sys->p_fifo );
+        FreeBatch( p_sys );
+        vlc_spsc_fifo_Delete( p_sys->p_fifo );
         net_Close (i_handle);
         free (p_sys);
         return VLC_EGENERIC;
@@ -228,10 +324,14 @@ static void Close( sout_access_out_t *p_access )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
-    block_FifoRelease( p_sys->p_fifo );
+    vlc_spsc_fifo_Delete( p_sys->p_fifo );
 
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
 
+    for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        block_Release( p_sys->pp_batch[i] );
+    FreeBatch( p_sys );
+
     net_Close( p_sys->i_handle );
     free( p_sys );
 }
@@ -283,7 +383,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                          now - p_sys->p_buffer->i_dts
                           - p_sys->i_caching );
             }
-            block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+            vlc_spsc_fifo_Queue( p_sys->p_fifo, p_sys->p_buffer );
             p_sys->p_buffer = NULL;
         }
 
@@ -325,7 +425,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                              vlc_tick_now() - p_sys->p_buffer->i_dts
                               - p_sys->i_caching );
                 }
-                block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+                vlc_spsc_fifo_Queue( p_sys->p_fifo, p_sys->p_buffer );
                 p_sys->p_buffer = NULL;
             }
         }
@@ -338,22 +438,185 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
     return i_len;
 }
 
+#ifdef HAVE_UDP_GSO
+/*****************************************************************************
+ * SegmentRun: count the packets that the kernel can split from one buffer,
+ * i.e. packets of equal size, the last one of the run possibly shorter.
+ *****************************************************************************/
+static unsigned SegmentRun( block_t *const *pp_pk, unsigned i_count )
+{
+    const size_t i_size = pp_pk[0]->i_buffer;
+    size_t i_total = i_size;
+    unsigned i_run = 1;
+
+    while( i_run < i_count && i_run < GSO_MAX_SEGMENTS )
+    {
+        size_t i_next = pp_pk[i_run]->i_buffer;
+
+        if( i_next > i_size || i_total + i_next > GSO_MAX_BYTES )
+            break;
+        i_total += i_next;
+        i_run++;
+        if( i_next < i_size )
+            break;
+    }
+    return i_run;
+}
+
+/*****************************************************************************
+ * SendSegmented: send a run of packets with UDP segmentation offload.
+ *****************************************************************************/
+static int SendSegmented( sout_access_out_t *p_access,
+                          block_t *const *pp_pk, unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    union {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        p_sys->p_iov[i].iov_base = pp_pk[i]->p_buffer;
+        p_sys->p_iov[i].iov_len = pp_pk[i]->i_buffer;
+    }
+
+    struct msghdr msg = {
+        .msg_iov = p_sys->p_iov,
+        .msg_iovlen = i_count,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+    uint16_t i_segment = pp_pk[0]->i_buffer;
+
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (i_segment));
+    memcpy( CMSG_DATA(cmsg), &i_segment, sizeof (i_segment) );
+
+    if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+    {
+        if( errno == EIO || errno == EINVAL || errno == ENOPROTOOPT )
+        {
+            msg_Dbg( p_access, "UDP segmentation offload not available: %s",
+                     vlc_strerror_c(errno) );
+            p_sys->b_gso = false;
+            return -1;
+        }
+        msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+    }
+    return 0;
+}
+#endif
+
+/*****************************************************************************
+ * SendBatch: send packets with as few system calls as possible.
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access,
+                       block_t *const *pp_pk, unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+#ifdef HAVE_SENDMMSG
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        p_sys->p_iov[i].iov_base = pp_pk[i]->p_buffer;
+        p_sys->p_iov[i].iov_len = pp_pk[i]->i_buffer;
+        p_sys->p_msgs[i].msg_hdr.msg_iov = &p_sys->p_iov[i];
+        p_sys->p_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i_sent = 0; i_sent < i_count; )
+    {
+        int i_ret = sendmmsg( p_sys->i_handle, p_sys->p_msgs + i_sent,
+                              i_count - i_sent, 0 );
+        if( i_ret <= 0 )
+        {
+            /* Skip the packet that failed, as the single send path does */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            i_ret = 1;
+        }
+        i_sent += i_ret;
+    }
+#else
+    for( unsigned i = 0; i < i_count; i++ )
+        if( send( p_sys->i_handle, pp_pk[i]->p_buffer,
+                  pp_pk[i]->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+#endif
+}
+
+/*****************************************************************************
+ * Flush: send all the paced packets.
+ *****************************************************************************/
+static void Flush( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    block_t **pp_pk = p_sys->pp_batch;
+    unsigned i_count = p_sys->i_batch;
+
+    for( unsigned i = 0; i < i_count; )
+    {
+        unsigned i_run = i_count - i;
+#ifdef HAVE_UDP_GSO
+        if( p_sys->b_gso )
+        {
+            i_run = SegmentRun( pp_pk + i, i_count - i );
+            if( i_run > 1 && SendSegmented( p_access, pp_pk + i, i_run ) == 0 )
+            {
+                i += i_run;
+                continue;
+            }
+        }
+#endif
+        SendBatch( p_access, pp_pk + i, i_run );
+        i += i_run;
+    }
+
+    for( unsigned i = 0; i < i_count; i++ )
+        block_Release( pp_pk[i] );
+    p_sys->i_batch = 0;
+}
+
+/*****************************************************************************
+ * FlushAt: send the batch once its first packet is due.
+ *****************************************************************************/
+static void FlushAt( sout_access_out_t *p_access, vlc_tick_t i_date )
+{
+    vlc_tick_wait( i_date );
+    Flush( p_access );
+
+    i_date = vlc_tick_now() - i_date;
+    if( i_date > VLC_TICK_FROM_MS(20) )
+        msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                 i_date );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
+ *
+ * Packets are not sent one by one but accumulated: every packet due within
+ * the pacing window of the first one (or within the same group) joins the
+ * batch, which is sent at once when its first packet is due. A PCR always
+ * opens a new batch, so that it is not sent early.
  *****************************************************************************/
 static void* ThreadWrite( void *data )
 {
     sout_access_out_t *p_access = data;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
     vlc_tick_t i_date_last = -1;
+    vlc_tick_t i_batch_date = 0;
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
-    int i_to_send = i_group;
     unsigned i_dropped_packets = 0;
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        if( p_sys->i_batch > 0 && vlc_spsc_fifo_IsEmpty( p_sys->p_fifo ) )
+            FlushAt( p_access, i_batch_date );
+
+        block_t *p_pk = vlc_spsc_fifo_DequeueWait( p_sys->p_fifo );
         vlc_tick_t    i_date;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
@@ -379,16 +642,21 @@ static void* ThreadWrite( void *data )
             }
         }
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+        if( p_sys->i_batch > 0
+         && ( (p_pk->i_flags & BLOCK_FLAG_CLOCK)
+           || ( p_sys->i_batch >= i_group
+             && i_date > i_batch_date + p_sys->i_pacing ) ) )
         {
-            vlc_tick_wait( i_date );
-            i_to_send = i_group;
+            block_cleanup_push( p_pk );
+            FlushAt( p_access, i_batch_date );
+            vlc_cleanup_pop();
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+
+        if( p_sys->i_batch == 0 )
+            i_batch_date = i_date;
+        p_sys->pp_batch[p_sys->i_batch++] = p_pk;
+        if( p_sys->i_batch == p_sys->i_batch_max )
+            FlushAt( p_access, i_batch_date );
 
         if( i_dropped_packets )
         {
@@ -397,18 +665,6 @@ static void* ThreadWrite( void *data )
         }
 
         i_date_last = i_date;
-
-#if 1
-        i_date = vlc_tick_now() - i_date;
-        if ( i_date > VLC_TICK_FROM_MS(20) )
-        {
-            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_date );
-        }
-#endif
-
-        block_Release( p_pk );
-
     }
     return NULL;
 }
@@ -35,20 +35,36 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
+#include <vlc_rand.h>
 #include <vlc_aout.h>
 #include <vlc_block.h>
 #include <vlc_filter.h>
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define HAVE_NEON_INTRINSICS 1
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open(filter_t *);
 
+#define DITHER_TEXT N_("Dither when converting to 16-bits")
+#define DITHER_LONGTEXT N_("Add triangular noise when converting floating " \
+    "point samples to 16-bits integers, to decorrelate the quantization " \
+    "error from the signal.")
+
 vlc_plugin_begin()
     set_shortname("PCM")
     set_description(N_("PCM format conversion"))
     set_capability(VLC_CAP_AUDIO_CONVERTER, 1, Open, NULL)
-    //set_subcategory(SUBCAT_AUDIO_AFILTER)
+    set_subcategory(SUBCAT_AUDIO_AFILTER)
+    add_bool("audio-format-dither", false, DITHER_TEXT, DITHER_LONGTEXT, true)
 vlc_plugin_end()
 
 /*****************************************************************************
@@ -57,6 +73,8 @@ vlc_plugin_end()
 
 typedef block_t *(*cvt_t)(filter_t *, block_t *);
 static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst);
+static cvt_t FindDitherConversion(filter_t *, vlc_fourcc_t src,
+                                  vlc_fourcc_t dst);
 
 static int Open(filter_t *filter)
 {
@@ -68,7 +86,12 @@ static int Open(filter_t *filter)
     if (src->i_codec == dst->i_codec)
         return VLC_EGENERIC;
 
-    filter->pf_audio_filter = FindConversion(src->i_codec, dst->i_codec);
+    filter->pf_audio_filter = NULL;
+    if (var_InheritBool(filter, "audio-format-dither"))
+        filter->pf_audio_filter = FindDitherConversion(filter, src->i_codec,
+                                                       dst->i_codec);
+    if (filter->pf_audio_filter == NULL)
+        filter->pf_audio_filter = FindConversion(src->i_codec, dst->i_codec);
     if (filter->pf_audio_filter == NULL)
         return VLC_EGENERIC;
 
@@ -215,7 +238,7 @@ static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
 
     block_CopyProperties(bdst, bsrc);
     int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
+    double  *dst = (double *)bdst->p_buffer;
     for (size_t i = bsrc->i_buffer / 2; i--;)
         *dst++ = (double)*src++ / 32768.;
 out:
@@ -246,49 +269,55 @@ static block_t *Fl32toU8(filter_t *filter, block_t *b)
     return b;
 }
 
+static inline int16_t Fl32toS16Sample(float f)
+{
+#if 0
+    /* Slow version. */
+    if (f >= 1.0) return 32767;
+    else if (f < -1.0) return -32768;
+    else return lroundf(f * 32768.f);
+#else
+    /* This is Walken's trick based on IEEE float format. */
+    union { float f; int32_t i; } u;
+    u.f = f + 384.f;
+    if (u.i > 0x43c07fff)
+        return 32767;
+    else if (u.i < 0x43bf8000)
+        return isnan(f) ? 32767 : -32768; /* NaN with the sign bit set */
+    else
+        return u.i - 0x43c00000;
+#endif
+}
+
 static block_t *Fl32toS16(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
     float   *src = (float *)b->p_buffer;
     int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = lroundf(*src * 32768.f);
-        src++; dst++;
-#else
-        /* This is Walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.f;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
+    for (int i = b->i_buffer / 4; i--;)
+        *dst++ = Fl32toS16Sample(*src++);
     b->i_buffer /= 2;
     return b;
 }
 
+static inline int32_t Fl32toS32Sample(float f)
+{
+    float s = f * 2147483648.f;
+    if (s >= 2147483647.f)
+        return 2147483647;
+    else
+    if (s <= -2147483648.f)
+        return -2147483648;
+    else
+        return lroundf(s);
+}
+
 static block_t *Fl32toS32(filter_t *filter, block_t *b)
 {
     float   *src = (float *)b->p_buffer;
     int32_t *dst = (int32_t *)src;
     for (size_t i = b->i_buffer / 4; i--;)
-    {
-        float s = *(src++) * 2147483648.f;
-        if (s >= 2147483647.f)
-            *(dst++) = 2147483647;
-        else
-        if (s <= -2147483648.f)
-            *(dst++) = -2147483648;
-        else
-            *(dst++) = lroundf(s);
-    }
+        *(dst++) = Fl32toS32Sample(*(src++));
     VLC_UNUSED(filter);
     return b;
 }
@@ -411,6 +440,7 @@ static block_t *Fl64toFl32(filter_t *filter, block_t *b)
     for (size_t i = b->i_buffer / 8; i--;)
         *(dst++) = *(src++);
 
+    b->i_buffer /= 2;
     VLC_UNUSED(filter);
     return b;
 }
@@ -430,10 +460,389 @@ static block_t *Fl64toS32(filter_t *filter, block_t *b)
         else
             *(dst++) = lround(s);
     }
+    b->i_buffer /= 2;
+    VLC_UNUSED(filter);
+    return b;
+}
+
+
+/*** dithering ***/
+typedef struct
+{
+    uint32_t state[4]; /* one xorshift generator per vector lane */
+} dither_t;
+
+static inline uint32_t DitherNext(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/* Triangular noise of one LSB peak amplitude */
+static inline float DitherSample(uint32_t *state)
+{
+    float a = (int32_t)DitherNext(state);
+    float b = (int32_t)DitherNext(state);
+    return (a + b) * 0x1.p-32f;
+}
+
+static inline int16_t Fl32toS16DitherSample(float f, uint32_t *state)
+{
+    float s = f * 32768.f + DitherSample(state);
+    if (!(s < 32767.f)) /* including NaN */
+        return 32767;
+    else
+    if (s <= -32768.f)
+        return -32768;
+    else
+        return lrintf(s);
+}
+
+static block_t *Fl32toS16Dither(filter_t *filter, block_t *b)
+{
+    dither_t *sys = filter->p_sys;
+    float   *src = (float *)b->p_buffer;
+    int16_t *dst = (int16_t *)src;
+    for (size_t i = b->i_buffer / 4; i--;)
+        *dst++ = Fl32toS16DitherSample(*src++, &sys->state[0]);
+    b->i_buffer /= 2;
+    return b;
+}
+
+
+/*** SIMD ***/
+/* The vector kernels produce the same samples as the scalar code above.
+ * The conversions working in place load a whole vector before storing a
+ * narrower one. */
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i S16toS32Lo_SSE2(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i S16toS32Hi_SSE2(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *S16toFl32_SSE2(filter_t *filter, block_t *bsrc)
+{
+    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    if (unlikely(bdst == NULL))
+        goto out;
+
+    block_CopyProperties(bdst, bsrc);
+    const int16_t *src = (const int16_t *)bsrc->p_buffer;
+    float *dst = (float *)bdst->p_buffer;
+    size_t i = bsrc->i_buffer / 2;
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        __m128 lo = _mm_cvtepi32_ps(S16toS32Lo_SSE2(v));
+        __m128 hi = _mm_cvtepi32_ps(S16toS32Hi_SSE2(v));
+        _mm_storeu_ps(dst, _mm_mul_ps(lo, scale));
+        _mm_storeu_ps(dst + 4, _mm_mul_ps(hi, scale));
+    }
+    while (i--)
+        *dst++ = *src++ / 32768.f;
+out:
+    block_Release(bsrc);
+    VLC_UNUSED(filter);
+    return bdst;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *S16toS32_SSE2(filter_t *filter, block_t *bsrc)
+{
+    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    if (unlikely(bdst == NULL))
+        goto out;
+
+    block_CopyProperties(bdst, bsrc);
+    const int16_t *src = (const int16_t *)bsrc->p_buffer;
+    int32_t *dst = (int32_t *)bdst->p_buffer;
+    size_t i = bsrc->i_buffer / 2;
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(zero, v));
+        _mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(zero, v));
+    }
+    while (i--)
+        *dst++ = *src++ * 65536;
+out:
+    block_Release(bsrc);
+    VLC_UNUSED(filter);
+    return bdst;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i PackS16_SSE2(__m128 a, __m128 b)
+{
+    const __m128 max = _mm_set1_ps(32767.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+
+    /* clip first: out of range conversions yield INT32_MIN. MINPS returns
+     * its second operand if either is NaN, so NaN clips to 32767. */
+    a = _mm_max_ps(_mm_min_ps(a, max), min);
+    b = _mm_max_ps(_mm_min_ps(b, max), min);
+    return _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *Fl32toS16_SSE2(filter_t *filter, block_t *b)
+{
+    const float *src = (const float *)b->p_buffer;
+    int16_t *dst = (int16_t *)b->p_buffer;
+    size_t i = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(32768.f);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        __m128 lo = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+        _mm_storeu_si128((__m128i *)dst, PackS16_SSE2(lo, hi));
+    }
+    while (i--)
+        *dst++ = Fl32toS16Sample(*src++);
+    b->i_buffer /= 2;
+    VLC_UNUSED(filter);
+    return b;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128 DitherNext_SSE2(__m128i *state)
+{
+    __m128i x = *state;
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    *state = x;
+    return _mm_cvtepi32_ps(x);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128 DitherSample_SSE2(__m128i *state)
+{
+    __m128 a = DitherNext_SSE2(state);
+    __m128 b = DitherNext_SSE2(state);
+    return _mm_mul_ps(_mm_add_ps(a, b), _mm_set1_ps(0x1.p-32f));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *Fl32toS16Dither_SSE2(filter_t *filter, block_t *b)
+{
+    dither_t *sys = filter->p_sys;
+    const float *src = (const float *)b->p_buffer;
+    int16_t *dst = (int16_t *)b->p_buffer;
+    size_t i = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(32768.f);
+    __m128i state = _mm_loadu_si128((const __m128i *)sys->state);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        __m128 lo = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+        lo = _mm_add_ps(lo, DitherSample_SSE2(&state));
+        hi = _mm_add_ps(hi, DitherSample_SSE2(&state));
+        _mm_storeu_si128((__m128i *)dst, PackS16_SSE2(lo, hi));
+    }
+    _mm_storeu_si128((__m128i *)sys->state, state);
+    while (i--)
+        *dst++ = Fl32toS16DitherSample(*src++, &sys->state[0]);
+    b->i_buffer /= 2;
+    return b;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *Fl32toS32_SSE2(filter_t *filter, block_t *b)
+{
+    const float *src = (const float *)b->p_buffer;
+    int32_t *dst = (int32_t *)b->p_buffer;
+    size_t i = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128 half = _mm_set1_ps(0x1.fffffep-2f);
+
+    for (; i >= 4; i -= 4, src += 4, dst += 4)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        /* round halfway cases away from zero, like lroundf() */
+        __m128 r = _mm_add_ps(s, _mm_or_ps(_mm_and_ps(s, sign), half));
+        /* positive overflows yield INT32_MIN: flip them to INT32_MAX */
+        __m128i over = _mm_castps_si128(_mm_cmpge_ps(s, scale));
+        __m128i v = _mm_xor_si128(_mm_cvttps_epi32(r), over);
+        _mm_storeu_si128((__m128i *)dst, v);
+    }
+    while (i--)
+        *dst++ = Fl32toS32Sample(*src++);
     VLC_UNUSED(filter);
     return b;
 }
 
+__attribute__ ((__target__ ("sse2")))
+static block_t *S32toFl32_SSE2(filter_t *filter, block_t *b)
+{
+    const int32_t *src = (const int32_t *)b->p_buffer;
+    float *dst = (float *)b->p_buffer;
+    size_t i = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+
+    for (; i >= 4; i -= 4, src += 4, dst += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    while (i--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+    VLC_UNUSED(filter);
+    return b;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *S32toS16_SSE2(filter_t *filter, block_t *b)
+{
+    const int32_t *src = (const int32_t *)b->p_buffer;
+    int16_t *dst = (int16_t *)b->p_buffer;
+    size_t i = b->i_buffer / 4;
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        /* the arithmetic shift leaves values that always fit */
+        __m128i lo = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)src), 16);
+        __m128i hi = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(src + 4)), 16);
+        _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+    }
+    while (i--)
+        *dst++ = (*src++) >> 16;
+    b->i_buffer /= 2;
+    VLC_UNUSED(filter);
+    return b;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *Fl32toFl64_SSE2(filter_t *filter, block_t *bsrc)
+{
+    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    if (unlikely(bdst == NULL))
+        goto out;
+
+    block_CopyProperties(bdst, bsrc);
+    const float *src = (const float *)bsrc->p_buffer;
+    double *dst = (double *)bdst->p_buffer;
+    size_t i = bsrc->i_buffer / 4;
+
+    for (; i >= 4; i -= 4, src += 4, dst += 4)
+    {
+        __m128 v = _mm_loadu_ps(src);
+        _mm_storeu_pd(dst, _mm_cvtps_pd(v));
+        _mm_storeu_pd(dst + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    while (i--)
+        *dst++ = *src++;
+out:
+    block_Release(bsrc);
+    VLC_UNUSED(filter);
+    return bdst;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static block_t *Fl64toFl32_SSE2(filter_t *filter, block_t *b)
+{
+    const double *src = (const double *)b->p_buffer;
+    float *dst = (float *)b->p_buffer;
+    size_t i = b->i_buffer / 8;
+
+    for (; i >= 4; i -= 4, src += 4, dst += 4)
+    {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + 2));
+        _mm_storeu_ps(dst, _mm_movelh_ps(lo, hi));
+    }
+    while (i--)
+        *dst++ = *src++;
+    b->i_buffer /= 2;
+    VLC_UNUSED(filter);
+    return b;
+}
+#endif
+
+#ifdef HAVE_NEON_INTRINSICS
+static block_t *S16toFl32_NEON(filter_t *filter, block_t *bsrc)
+{
+    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    if (unlikely(bdst == NULL))
+        goto out;
+
+    block_CopyProperties(bdst, bsrc);
+    const int16_t *src = (const int16_t *)bsrc->p_buffer;
+    float *dst = (float *)bdst->p_buffer;
+    size_t i = bsrc->i_buffer / 2;
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        int16x8_t v = vld1q_s16(src);
+        /* fixed point conversion with 15 fractional bits */
+        vst1q_f32(dst, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(v)), 15));
+        vst1q_f32(dst + 4, vcvtq_n_f32_s32(vmovl_high_s16(v), 15));
+    }
+    while (i--)
+        *dst++ = *src++ / 32768.f;
+out:
+    block_Release(bsrc);
+    VLC_UNUSED(filter);
+    return bdst;
+}
+
+static block_t *Fl32toS16_NEON(filter_t *filter, block_t *b)
+{
+    const float *src = (const float *)b->p_buffer;
+    int16_t *dst = (int16_t *)b->p_buffer;
+    size_t i = b->i_buffer / 4;
+    const float32x4_t max = vdupq_n_f32(32767.f);
+
+    for (; i >= 8; i -= 8, src += 8, dst += 8)
+    {
+        float32x4_t lo = vmulq_n_f32(vld1q_f32(src), 32768.f);
+        float32x4_t hi = vmulq_n_f32(vld1q_f32(src + 4), 32768.f);
+        /* NaN would convert to 0 */
+        lo = vbslq_f32(vceqq_f32(lo, lo), lo, max);
+        hi = vbslq_f32(vceqq_f32(hi, hi), hi, max);
+        /* both the conversion and the narrowing saturate */
+        int16x4_t l = vqmovn_s32(vcvtnq_s32_f32(lo));
+        vst1q_s16(dst, vqmovn_high_s32(l, vcvtnq_s32_f32(hi)));
+    }
+    while (i--)
+        *dst++ = Fl32toS16Sample(*src++);
+    b->i_buffer /= 2;
+    VLC_UNUSED(filter);
+    return b;
+}
+
+static block_t *S32toFl32_NEON(filter_t *filter, block_t *b)
+{
+    const int32_t *src = (const int32_t *)b->p_buffer;
+    float *dst = (float *)b->p_buffer;
+    size_t i = b->i_buffer / 4;
+
+    for (; i >= 4; i -= 4, src += 4, dst += 4)
+        vst1q_f32(dst, vcvtq_n_f32_s32(vld1q_s32(src), 31));
+    while (i--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+    VLC_UNUSED(filter);
+    return b;
+}
+#endif
 
 /* */
 /* */
@@ -470,8 +879,75 @@ static const struct {
     { 0, 0, NULL }
 };
 
+#ifdef HAVE_SSE2_INTRINSICS
+static const struct {
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+    cvt_t convert;
+} cvt_sse2[] = {
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, S16toFl32_SSE2  },
+    { VLC_CODEC_S16N, VLC_CODEC_S32N, S16toS32_SSE2   },
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, Fl32toS16_SSE2  },
+    { VLC_CODEC_FL32, VLC_CODEC_S32N, Fl32toS32_SSE2  },
+    { VLC_CODEC_FL32, VLC_CODEC_FL64, Fl32toFl64_SSE2 },
+    { VLC_CODEC_S32N, VLC_CODEC_S16N, S32toS16_SSE2   },
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, S32toFl32_SSE2  },
+    { VLC_CODEC_FL64, VLC_CODEC_FL32, Fl64toFl32_SSE2 },
+
+    { 0, 0, NULL }
+};
+#endif
+
+#ifdef HAVE_NEON_INTRINSICS
+static const struct {
+    vlc_fourcc_t src;
+    vlc_fourcc_t dst;
+    cvt_t convert;
+} cvt_neon[] = {
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, S16toFl32_NEON  },
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, Fl32toS16_NEON  },
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, S32toFl32_NEON  },
+
+    { 0, 0, NULL }
+};
+#endif
+
+static cvt_t FindDitherConversion(filter_t *filter, vlc_fourcc_t src,
+                                  vlc_fourcc_t dst)
+{
+    if (src != VLC_CODEC_FL32 || dst != VLC_CODEC_S16N)
+        return NULL;
+
+    dither_t *sys = vlc_obj_malloc(VLC_OBJECT(filter), sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return NULL;
+
+    vlc_rand_bytes(sys->state, sizeof (sys->state));
+    for (size_t i = 0; i < ARRAY_SIZE(sys->state); i++)
+        sys->state[i] |= 1; /* xorshift is stuck on zero */
+    filter->p_sys = sys;
+
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return Fl32toS16Dither_SSE2;
+#endif
+    return Fl32toS16Dither;
+}
+
 static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst)
 {
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        for (int i = 0; cvt_sse2[i].convert; i++)
+            if (cvt_sse2[i].src == src && cvt_sse2[i].dst == dst)
+                return cvt_sse2[i].convert;
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+    if (vlc_CPU_ARM_NEON())
+        for (int i = 0; cvt_neon[i].convert; i++)
+            if (cvt_neon[i].src == src && cvt_neon[i].dst == dst)
+                return cvt_neon[i].convert;
+#endif
     for (int i = 0; cvt_directs[i].convert; i++) {
         if (cvt_directs[i].src == src &&
             cvt_directs[i].dst == dst)
@@ -479,3 +955,117 @@ static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst)
     }
     return NULL;
 }
+
+#ifdef AUDIO_FORMAT_TEST
+#undef NDEBUG
+#include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Checks the float to 16-bits vector kernels against the scalar code, on
+ * the clipping and rounding edges, infinities and NaN, with unaligned
+ * buffers and lengths that are not a multiple of the vector size. */
+static const float edges[] = {
+    0.f, -0.f, FLT_MIN, -FLT_MIN, 0x1p-149f, -0x1p-149f,
+    0.5f / 32768.f, -0.5f / 32768.f, 1.5f / 32768.f, -1.5f / 32768.f,
+    2.5f / 32768.f, -2.5f / 32768.f, 0.999f / 32768.f, 1.001f / 32768.f,
+    1.f, -1.f, 0x1.fffffep-1f, -0x1.fffffep-1f, 0x1.000002p0f, -0x1.000002p0f,
+    32766.5f / 32768.f, -32767.5f / 32768.f, 32767.5f / 32768.f,
+    -32768.5f / 32768.f, 2.f, -2.f, 383.f, -383.f, 385.f, -385.f,
+    1e10f, -1e10f, FLT_MAX, -FLT_MAX, INFINITY, -INFINITY, NAN, -NAN,
+};
+
+static block_t *MakeBlock(size_t i_samples, size_t i_offset, unsigned seed)
+{
+    block_t *b = block_Alloc((i_offset + i_samples) * sizeof (float));
+    assert(b != NULL);
+    b->p_buffer += i_offset * sizeof (float);
+    b->i_buffer = i_samples * sizeof (float);
+
+    float *p = (float *)b->p_buffer;
+    for (size_t i = 0; i < i_samples; i++)
+    {
+        unsigned r = (seed + i) * 2654435761u;
+        if (r % 3 == 0)
+            p[i] = edges[(r >> 8) % ARRAY_SIZE(edges)];
+        else
+            p[i] = (r >> 8) / (float)(1 << 24) * 3.f - 1.5f;
+    }
+    return b;
+}
+
+static void Check(const char *name, cvt_t convert)
+{
+    /* every edge value in every lane */
+    for (size_t i_offset = 0; i_offset < 4; i_offset++)
+        for (size_t i_lane = 0; i_lane < 8; i_lane++)
+            for (size_t e = 0; e < ARRAY_SIZE(edges); e++)
+            {
+                block_t *p_out = MakeBlock(8, i_offset, 0);
+                ((float *)p_out->p_buffer)[i_lane] = edges[e];
+                block_t *p_ref = block_Duplicate(p_out);
+                assert(p_ref != NULL);
+
+                p_out = convert(NULL, p_out);
+                p_ref = Fl32toS16(NULL, p_ref);
+                assert(p_out->i_buffer == p_ref->i_buffer);
+                if (memcmp(p_out->p_buffer, p_ref->p_buffer, p_ref->i_buffer))
+                {
+                    fprintf(stderr, "%s: %a gives %d instead of %d\n", name,
+                            edges[e], ((int16_t *)p_out->p_buffer)[i_lane],
+                            ((int16_t *)p_ref->p_buffer)[i_lane]);
+                    abort();
+                }
+                block_Release(p_ref);
+                block_Release(p_out);
+            }
+
+    /* mixed values with scalar tails */
+    for (size_t i_samples = 0; i_samples < 67; i_samples++)
+        for (size_t i_offset = 0; i_offset < 4; i_offset++)
+        {
+            block_t *p_out = MakeBlock(i_samples, i_offset, i_samples);
+            block_t *p_ref = block_Duplicate(p_out);
+            assert(p_ref != NULL);
+
+            p_out = convert(NULL, p_out);
+            p_ref = Fl32toS16(NULL, p_ref);
+            assert(p_out->i_buffer == i_samples * 2);
+            assert(!memcmp(p_out->p_buffer, p_ref->p_buffer, p_ref->i_buffer));
+            block_Release(p_ref);
+            block_Release(p_out);
+        }
+}
+
+int main(void)
+{
+    /* the scalar code itself */
+    assert(Fl32toS16Sample(NAN) == 32767);
+    assert(Fl32toS16Sample(-NAN) == 32767);
+    assert(Fl32toS16Sample(INFINITY) == 32767);
+    assert(Fl32toS16Sample(-INFINITY) == -32768);
+    assert(Fl32toS16Sample(1.f) == 32767);
+    assert(Fl32toS16Sample(-1.f) == -32768);
+    assert(Fl32toS16Sample(0.5f / 32768.f) == 0);
+    assert(Fl32toS16Sample(1.5f / 32768.f) == 2);
+    assert(Fl32toS16Sample(-2.5f / 32768.f) == -2);
+
+    uint32_t state = 1;
+    assert(Fl32toS16DitherSample(NAN, &state) == 32767);
+    assert(Fl32toS16DitherSample(-NAN, &state) == 32767);
+    assert(Fl32toS16DitherSample(INFINITY, &state) == 32767);
+    assert(Fl32toS16DitherSample(-INFINITY, &state) == -32768);
+
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        Check("SSE2", Fl32toS16_SSE2);
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+    if (vlc_CPU_ARM_NEON())
+        Check("NEON", Fl32toS16_NEON);
+#endif
+    return 0;
+}
+#endif
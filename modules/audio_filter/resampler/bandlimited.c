@@ -30,6 +30,14 @@
  * It uses a Kaiser-windowed sinc-function low-pass filter and the width of the
  * filter is 13 samples.
  *
+ * The filter is applied as a polyphase filter bank: the impulse response is
+ * sampled once for PHASES positions between two input samples, and for the
+ * cut-off frequency of the current rate ratio. Each output sample is then a
+ * dot product of the input with a bank row, linearly interpolated with the
+ * next row. The position in the input is kept in 32.32 fixed point, so that
+ * the rate can change from one block to the next (clock drift compensation)
+ * without any discontinuity.
+ *
  *****************************************************************************/
 
 #ifdef HAVE_CONFIG_H
@@ -38,14 +46,34 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 #include <vlc_block.h>
 
 #include <assert.h>
+#include <math.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define HAVE_NEON_INTRINSICS 1
+#endif
 
 #include "bandlimited.h"
 
+/* Number of bank rows between two input samples */
+#define PHASES          Npc
+/* Zero crossings of the impulse response on each side */
+#define WING_CROSSINGS  (SMALL_FILTER_NWING / Npc)
+/* Rows are padded with zeros to a multiple of the widest vector */
+#define TAPS_ALIGN      8
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -55,28 +83,33 @@ static int  OpenFilter ( filter_t * );
 static void CloseFilter( filter_t * );
 static block_t *Resample( filter_t *, block_t * );
 
-static void ResampleFloat( filter_t *p_filter,
-                           block_t **pp_out_buf,  size_t *pi_out,
-                           float **pp_in,
-                           int i_in, int i_in_end,
-                           double d_factor, bool b_factor_old,
-                           int i_nb_channels, int i_bytes_per_frame );
+typedef float (*fir_dot_t)( const float *, const float *, unsigned );
+typedef void (*fir_interp_t)( float *, const float *, const float *, float,
+                              unsigned );
 
 /*****************************************************************************
  * Local structures
  *****************************************************************************/
 typedef struct
 {
-    int32_t *p_buf;                        /* this filter introduces a delay */
-    size_t i_buf_size;
+    /* polyphase filter bank, PHASES + 1 rows of i_taps coefficients */
+    float *p_bank;
+    float *p_coefs;                         /* interpolated row */
+    unsigned i_taps;
+    unsigned i_wing;                  /* input frames before the output */
+    float f_cutoff;             /* relative to the input Nyquist frequency */
+
+    /* planar input history, i_hist_max frames per channel */
+    float *p_hist;
+    size_t i_hist;
+    size_t i_hist_max;
+    uint64_t i_pos;     /* 32.32 position of the next output in p_hist */
 
-    double d_old_factor;
-    size_t i_old_wing;
-
-    unsigned int i_remainder;                /* remainder of previous sample */
     bool b_first;
-
     date_t end_date;
+
+    fir_dot_t pf_dot;
+    fir_interp_t pf_interp;
 } filter_sys_t;
 
 /*****************************************************************************
@@ -93,6 +126,286 @@ vlc_plugin_begin ()
     //set_subcategory( SUBCAT_AUDIO_RESAMPLER )
 vlc_plugin_end ()
 
+/*****************************************************************************
+ * FIR kernels
+ *****************************************************************************/
+static float DotC( const float *x, const float *h, unsigned i_taps )
+{
+    float f_sum = 0.f;
+    for( unsigned i = 0; i < i_taps; i++ )
+        f_sum += x[i] * h[i];
+    return f_sum;
+}
+
+static void InterpC( float *c, const float *h0, const float *h1, float f_frac,
+                     unsigned i_taps )
+{
+    for( unsigned i = 0; i < i_taps; i++ )
+        c[i] = h0[i] + ( h1[i] - h0[i] ) * f_frac;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static float DotSSE2( const float *x, const float *h, unsigned i_taps )
+{
+    __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+    for( unsigned i = 0; i < i_taps; i += 8 )
+    {
+        a = _mm_add_ps( a, _mm_mul_ps( _mm_loadu_ps( x + i ),
+                                       _mm_loadu_ps( h + i ) ) );
+        b = _mm_add_ps( b, _mm_mul_ps( _mm_loadu_ps( x + i + 4 ),
+                                       _mm_loadu_ps( h + i + 4 ) ) );
+    }
+    a = _mm_add_ps( a, b );
+    a = _mm_add_ps( a, _mm_movehl_ps( a, a ) );
+    a = _mm_add_ss( a, _mm_shuffle_ps( a, a, 1 ) );
+    return _mm_cvtss_f32( a );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void InterpSSE2( float *c, const float *h0, const float *h1,
+                        float f_frac, unsigned i_taps )
+{
+    const __m128 frac = _mm_set1_ps( f_frac );
+    for( unsigned i = 0; i < i_taps; i += 4 )
+    {
+        __m128 a = _mm_loadu_ps( h0 + i );
+        __m128 d = _mm_sub_ps( _mm_loadu_ps( h1 + i ), a );
+        _mm_storeu_ps( c + i, _mm_add_ps( a, _mm_mul_ps( d, frac ) ) );
+    }
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx2")))
+static float DotAVX2( const float *x, const float *h, unsigned i_taps )
+{
+    __m256 a = _mm256_setzero_ps();
+    for( unsigned i = 0; i < i_taps; i += 8 )
+        a = _mm256_add_ps( a, _mm256_mul_ps( _mm256_loadu_ps( x + i ),
+                                             _mm256_loadu_ps( h + i ) ) );
+    __m128 s = _mm_add_ps( _mm256_castps256_ps128( a ),
+                           _mm256_extractf128_ps( a, 1 ) );
+    s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+    s = _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) );
+    _mm256_zeroupper();
+    return _mm_cvtss_f32( s );
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void InterpAVX2( float *c, const float *h0, const float *h1,
+                        float f_frac, unsigned i_taps )
+{
+    const __m256 frac = _mm256_set1_ps( f_frac );
+    for( unsigned i = 0; i < i_taps; i += 8 )
+    {
+        __m256 a = _mm256_loadu_ps( h0 + i );
+        __m256 d = _mm256_sub_ps( _mm256_loadu_ps( h1 + i ), a );
+        _mm256_storeu_ps( c + i, _mm256_add_ps( a, _mm256_mul_ps( d, frac ) ) );
+    }
+    _mm256_zeroupper();
+}
+#endif
+
+#ifdef HAVE_NEON_INTRINSICS
+static float DotNEON( const float *x, const float *h, unsigned i_taps )
+{
+    float32x4_t a = vdupq_n_f32( 0.f ), b = vdupq_n_f32( 0.f );
+    for( unsigned i = 0; i < i_taps; i += 8 )
+    {
+        a = vfmaq_f32( a, vld1q_f32( x + i ), vld1q_f32( h + i ) );
+        b = vfmaq_f32( b, vld1q_f32( x + i + 4 ), vld1q_f32( h + i + 4 ) );
+    }
+    return vaddvq_f32( vaddq_f32( a, b ) );
+}
+
+static void InterpNEON( float *c, const float *h0, const float *h1,
+                        float f_frac, unsigned i_taps )
+{
+    for( unsigned i = 0; i < i_taps; i += 4 )
+    {
+        float32x4_t a = vld1q_f32( h0 + i );
+        float32x4_t d = vsubq_f32( vld1q_f32( h1 + i ), a );
+        vst1q_f32( c + i, vfmaq_n_f32( a, d, f_frac ) );
+    }
+}
+#endif
+
+/*****************************************************************************
+ * Filter bank
+ *****************************************************************************/
+
+/* Impulse response, x in zero crossings */
+static float Impulse( double x )
+{
+    x = fabs( x ) * Npc;
+    if( x >= SMALL_FILTER_NWING - 1 )
+        return 0.f;
+
+    unsigned i = x;
+    return SMALL_FILTER_FLOAT_IMP[i] + SMALL_FILTER_FLOAT_IMPD[i] * (x - i);
+}
+
+/* The cut-off only follows down-sampling ratios, with some margin so that
+ * the small rate changes of drift compensation do not rebuild the bank. */
+static float GetCutoff( double d_factor )
+{
+    return d_factor >= .98 ? 1.f : d_factor * .99;
+}
+
+static int BuildBank( filter_sys_t *p_sys, float f_cutoff )
+{
+    const unsigned i_wing = ceilf( WING_CROSSINGS / f_cutoff );
+    const unsigned i_taps = ( 2 * i_wing + TAPS_ALIGN - 1 ) & ~(TAPS_ALIGN - 1);
+
+    float *p_bank = vlc_alloc( (PHASES + 1) * i_taps, sizeof(float) );
+    float *p_coefs = vlc_alloc( i_taps, sizeof(float) );
+    if( unlikely(p_bank == NULL || p_coefs == NULL) )
+    {
+        free( p_bank );
+        free( p_coefs );
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned p = 0; p <= PHASES; p++ )
+    {
+        float *p_row = &p_bank[p * i_taps];
+        const double d_phase = (double)p / PHASES;
+        double d_sum = 0.;
+
+        /* tap k applies to the input frame k - (i_wing - 1) from the output
+         * integer position, the output being d_phase after that frame */
+        for( unsigned k = 0; k < i_taps; k++ )
+        {
+            p_row[k] = k < 2 * i_wing
+                     ? Impulse( ( (double)k - (i_wing - 1) - d_phase ) * f_cutoff )
+                     : 0.f;
+            d_sum += p_row[k];
+        }
+        /* unity gain */
+        for( unsigned k = 0; k < i_taps; k++ )
+            p_row[k] /= d_sum;
+    }
+
+    free( p_sys->p_bank );
+    free( p_sys->p_coefs );
+    p_sys->p_bank = p_bank;
+    p_sys->p_coefs = p_coefs;
+    p_sys->i_taps = i_taps;
+    p_sys->i_wing = i_wing;
+    p_sys->f_cutoff = f_cutoff;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Input history
+ *****************************************************************************/
+static int ReserveHistory( filter_sys_t *p_sys, unsigned i_channels,
+                           size_t i_frames )
+{
+    if( p_sys->i_hist + i_frames <= p_sys->i_hist_max )
+        return VLC_SUCCESS;
+
+    size_t i_max = __MAX( p_sys->i_hist + i_frames, 2 * p_sys->i_hist_max );
+    float *p_hist = vlc_alloc( i_max * i_channels, sizeof(float) );
+    if( unlikely(p_hist == NULL) )
+        return VLC_ENOMEM;
+
+    if( p_sys->i_hist > 0 )
+        for( unsigned c = 0; c < i_channels; c++ )
+            memcpy( &p_hist[c * i_max], &p_sys->p_hist[c * p_sys->i_hist_max],
+                    p_sys->i_hist * sizeof(float) );
+    free( p_sys->p_hist );
+    p_sys->p_hist = p_hist;
+    p_sys->i_hist_max = i_max;
+    return VLC_SUCCESS;
+}
+
+/* Inserts silence before the history, so that the filter has its whole
+ * left wing available from the next output */
+static int PadHistory( filter_sys_t *p_sys, unsigned i_channels )
+{
+    const size_t i_index = p_sys->i_pos >> 32;
+    if( i_index + 1 >= p_sys->i_wing )
+        return VLC_SUCCESS;
+
+    const size_t i_pad = p_sys->i_wing - 1 - i_index;
+    if( ReserveHistory( p_sys, i_channels, i_pad ) )
+        return VLC_ENOMEM;
+
+    for( unsigned c = 0; c < i_channels; c++ )
+    {
+        float *p_chan = &p_sys->p_hist[c * p_sys->i_hist_max];
+        memmove( p_chan + i_pad, p_chan, p_sys->i_hist * sizeof(float) );
+        memset( p_chan, 0, i_pad * sizeof(float) );
+    }
+    p_sys->i_hist += i_pad;
+    p_sys->i_pos += (uint64_t)i_pad << 32;
+    return VLC_SUCCESS;
+}
+
+static void AppendHistory( filter_sys_t *p_sys, unsigned i_channels,
+                           const float *p_in, size_t i_frames )
+{
+    for( unsigned c = 0; c < i_channels; c++ )
+    {
+        float *p_chan = &p_sys->p_hist[c * p_sys->i_hist_max + p_sys->i_hist];
+        for( size_t i = 0; i < i_frames; i++ )
+            p_chan[i] = p_in[i * i_channels + c];
+    }
+    p_sys->i_hist += i_frames;
+}
+
+/* Drops the frames the next output does not need anymore */
+static void ShiftHistory( filter_sys_t *p_sys, unsigned i_channels )
+{
+    size_t i_drop = p_sys->i_pos >> 32;
+    if( i_drop < p_sys->i_wing - 1 )
+        return;
+    i_drop = __MIN( i_drop - (p_sys->i_wing - 1), p_sys->i_hist );
+
+    for( unsigned c = 0; c < i_channels; c++ )
+    {
+        float *p_chan = &p_sys->p_hist[c * p_sys->i_hist_max];
+        memmove( p_chan, p_chan + i_drop,
+                 (p_sys->i_hist - i_drop) * sizeof(float) );
+    }
+    p_sys->i_hist -= i_drop;
+    p_sys->i_pos -= (uint64_t)i_drop << 32;
+}
+
+/* Returns the frames that were buffered but not resampled yet, and goes
+ * back to pass-through. Only valid on an integer position at unity ratio. */
+static block_t *Drain( filter_t *p_filter, block_t *p_in_buf )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_channels = p_filter->fmt_in.audio.i_channels;
+    const unsigned i_bytes_per_frame = i_channels * sizeof(float);
+    const size_t i_index = p_sys->i_pos >> 32;
+    const size_t i_pending = p_sys->i_hist > i_index ? p_sys->i_hist - i_index : 0;
+
+    p_sys->b_first = true;
+    p_sys->i_hist = 0;
+    if( i_pending == 0 )
+        return p_in_buf;
+
+    p_in_buf = block_Realloc( p_in_buf, i_pending * i_bytes_per_frame,
+                              p_in_buf->i_buffer );
+    if( unlikely(p_in_buf == NULL) )
+        return NULL;
+
+    float *p_out = (float *)p_in_buf->p_buffer;
+    for( size_t i = 0; i < i_pending; i++ )
+        for( unsigned c = 0; c < i_channels; c++ )
+            *(p_out++) = p_sys->p_hist[c * p_sys->i_hist_max + i_index + i];
+
+    p_in_buf->i_nb_samples += i_pending;
+    p_in_buf->i_pts = date_Get( &p_sys->end_date );
+    p_in_buf->i_length = date_Increment( &p_sys->end_date,
+                             p_in_buf->i_nb_samples ) - p_in_buf->i_pts;
+    return p_in_buf;
+}
+
 /*****************************************************************************
  * Resample: convert a buffer
  *****************************************************************************/
@@ -106,176 +419,119 @@ static block_t *Resample( filter_t * p_filter, block_t * p_in_buf )
     }
 
     filter_sys_t *p_sys = p_filter->p_sys;
-    unsigned int i_out_rate = p_filter->fmt_out.audio.i_rate;
-    int i_nb_channels = p_filter->fmt_in.audio.i_channels;
+    const unsigned i_in_rate = p_filter->fmt_in.audio.i_rate;
+    const unsigned i_out_rate = p_filter->fmt_out.audio.i_rate;
+    const unsigned i_channels = p_filter->fmt_in.audio.i_channels;
 
     /* Check if we really need to run the resampler */
-    if( i_out_rate == p_filter->fmt_in.audio.i_rate )
+    if( i_out_rate == i_in_rate )
     {
-        if( !(p_in_buf->i_flags & BLOCK_FLAG_DISCONTINUITY) &&
-            p_sys->i_old_wing )
+        if( p_sys->b_first )
+            return p_in_buf;
+        if( !(p_in_buf->i_flags & BLOCK_FLAG_DISCONTINUITY) )
         {
-            /* output the whole thing with the samples from last time */
-            p_in_buf = block_Realloc( p_in_buf,
-                p_sys->i_old_wing * p_filter->fmt_in.audio.i_bytes_per_frame,
-                p_in_buf->i_buffer );
-            if( !p_in_buf )
-                return NULL;
-            memcpy( p_in_buf->p_buffer, p_sys->p_buf +
-                    i_nb_channels * p_sys->i_old_wing,
-                    p_sys->i_old_wing *
-                    p_filter->fmt_in.audio.i_bytes_per_frame );
-
-            p_in_buf->i_nb_samples += p_sys->i_old_wing;
-
-            p_in_buf->i_pts = date_Get( &p_sys->end_date );
-            p_in_buf->i_length =
-                date_Increment( &p_sys->end_date,
-                                p_in_buf->i_nb_samples ) - p_in_buf->i_pts;
+            /* After a drift correction, the position is almost never on an
+             * input frame, and it would never get back to one at unity
+             * ratio: round it to the nearest frame (an inaudible sub-sample
+             * jump) and go back to pass-through. */
+            p_sys->i_pos = ( p_sys->i_pos + (UINT64_C(1) << 31) )
+                         & ~(uint64_t)UINT32_MAX;
+            return Drain( p_filter, p_in_buf );
         }
-        p_sys->i_old_wing = 0;
-        p_sys->b_first = true;
-        return p_in_buf;
-    }
-
-    unsigned i_bytes_per_frame = p_filter->fmt_out.audio.i_channels *
-                                 p_filter->fmt_out.audio.i_bitspersample / 8;
-    size_t i_out_size = i_bytes_per_frame * ( 1 + ( p_in_buf->i_nb_samples *
-              p_filter->fmt_out.audio.i_rate / p_filter->fmt_in.audio.i_rate) )
-            + p_filter->p_sys->i_buf_size;
-    block_t *p_out_buf = block_Alloc( i_out_size );
-    if( !p_out_buf )
-    {
-        block_Release( p_in_buf );
-        return NULL;
     }
 
     if( (p_in_buf->i_flags & BLOCK_FLAG_DISCONTINUITY) || p_sys->b_first )
     {
         /* Continuity in sound samples has been broken, we'd better reset
          * everything. */
-        p_out_buf->i_flags |= BLOCK_FLAG_DISCONTINUITY;
-        p_sys->i_remainder = 0;
         date_Init( &p_sys->end_date, i_out_rate, 1 );
         date_Set( &p_sys->end_date, p_in_buf->i_pts );
-        p_sys->d_old_factor = 1;
-        p_sys->i_old_wing   = 0;
+        p_sys->i_hist = 0;
+        p_sys->i_pos = 0;
         p_sys->b_first = false;
     }
 
-    size_t i_in_nb = p_in_buf->i_nb_samples;
-    size_t i_in, i_out = 0;
-    double d_factor, d_scale_factor, d_old_scale_factor;
-    size_t i_filter_wing;
-
-#if 0
-    msg_Err( p_filter, "old rate: %i, old factor: %f, old wing: %i, i_in: %i",
-             p_sys->i_old_rate, p_sys->d_old_factor,
-             p_sys->i_old_wing, i_in_nb );
-#endif
-
-    /* Same format in and out... */
-    assert( p_filter->fmt_in.audio.i_bytes_per_frame == i_bytes_per_frame );
-
-    /* Prepare the source buffer */
-    if( p_sys->i_old_wing )
-    {   /* Copy all our samples in p_in_buf */
-        /* Normally, there should be enough room for the old wing in the
-         * buffer head room. Otherwise, we need to copy memory anyway. */
-        p_in_buf = block_Realloc( p_in_buf,
-                                  p_sys->i_old_wing * 2 * i_bytes_per_frame,
-                                  p_in_buf->i_buffer );
-        if( unlikely(p_in_buf == NULL) )
-            return NULL;
-        memcpy( p_in_buf->p_buffer, p_sys->p_buf,
-                p_sys->i_old_wing * 2 * i_bytes_per_frame );
-    }
-    i_in_nb += (p_sys->i_old_wing * 2);
-    float *p_in = (float *)p_in_buf->p_buffer;
-    const float *p_in_orig = p_in;
-
-    /* Make sure the output buffer is reset */
-    memset( p_out_buf->p_buffer, 0, p_out_buf->i_buffer );
-
-    /* Calculate the new length of the filter wing */
-    d_factor = (double)i_out_rate / p_filter->fmt_in.audio.i_rate;
-    i_filter_wing = ((SMALL_FILTER_NMULT+1)/2.0) * __MAX(1.0,1.0/d_factor) + 1;
-
-    /* Account for increased filter gain when using factors less than 1 */
-    d_old_scale_factor = SMALL_FILTER_SCALE *
-        p_sys->d_old_factor + 0.5;
-    d_scale_factor = SMALL_FILTER_SCALE * d_factor + 0.5;
-
-    /* Apply the old rate until we have enough samples for the new one */
-    i_in = p_sys->i_old_wing;
-    p_in += p_sys->i_old_wing * i_nb_channels;
-
-    size_t i_old_in_end = 0;
-    if( p_sys->i_old_wing <= i_in_nb )
-        i_old_in_end = __MIN( i_filter_wing, i_in_nb - p_sys->i_old_wing );
-
-    ResampleFloat( p_filter,
-                   &p_out_buf, &i_out, &p_in,
-                   i_in, i_old_in_end,
-                   p_sys->d_old_factor, true,
-                   i_nb_channels, i_bytes_per_frame );
-    i_in = __MAX( i_in, i_old_in_end );
-
-    /* Apply the new rate for the rest of the samples */
-    if( i_in < i_in_nb - i_filter_wing )
+    /* Rebuild the bank when the cut-off moved noticeably */
+    const double d_factor = (double)i_out_rate / i_in_rate;
+    const float f_cutoff = GetCutoff( d_factor );
+    if( p_sys->p_bank == NULL ||
+        fabsf( f_cutoff / p_sys->f_cutoff - 1.f ) > .01f )
     {
-        p_sys->d_old_factor = d_factor;
-        p_sys->i_old_wing   = i_filter_wing;
+        if( BuildBank( p_sys, f_cutoff ) )
+            goto error;
+        msg_Dbg( p_filter, "filter bank: %u taps, cut-off %.3f",
+                 p_sys->i_taps, f_cutoff );
     }
-    if( p_out_buf )
+
+    if( PadHistory( p_sys, i_channels ) ||
+        ReserveHistory( p_sys, i_channels, p_in_buf->i_nb_samples +
+                                           p_sys->i_taps ) )
+        goto error;
+
+    AppendHistory( p_sys, i_channels, (const float *)p_in_buf->p_buffer,
+                   p_in_buf->i_nb_samples );
+
+    /* Pad the history with silence for the unused taps of the last row */
+    const size_t i_pad = p_sys->i_taps - 2 * p_sys->i_wing;
+    for( unsigned c = 0; c < i_channels; c++ )
+        memset( &p_sys->p_hist[c * p_sys->i_hist_max + p_sys->i_hist], 0,
+                i_pad * sizeof(float) );
+
+    /* Last integer position with its whole right wing available */
+    const uint64_t i_step = ((uint64_t)i_in_rate << 32) / i_out_rate;
+    size_t i_out_nb = 0;
+    if( p_sys->i_hist >= p_sys->i_wing + 1 )
     {
-        ResampleFloat( p_filter,
-                       &p_out_buf, &i_out, &p_in,
-                       i_in, i_in_nb - i_filter_wing,
-                       d_factor, false,
-                       i_nb_channels, i_bytes_per_frame );
-
-        /* Finalize aout buffer */
-        p_out_buf->i_nb_samples = i_out;
-        p_out_buf->i_dts =
-        p_out_buf->i_pts = date_Get( &p_sys->end_date );
-        p_out_buf->i_length = date_Increment( &p_sys->end_date,
-                                      p_out_buf->i_nb_samples ) - p_out_buf->i_pts;
-
-        p_out_buf->i_buffer = p_out_buf->i_nb_samples *
-            i_nb_channels * sizeof(int32_t);
+        const uint64_t i_last = (uint64_t)(p_sys->i_hist - p_sys->i_wing - 1) << 32;
+        if( p_sys->i_pos <= i_last )
+            i_out_nb = ( i_last - p_sys->i_pos ) / i_step + 1;
     }
 
-    /* Buffer i_filter_wing * 2 samples for next time */
-    if( p_sys->i_old_wing )
+    block_t *p_out_buf = block_Alloc( i_out_nb * i_channels * sizeof(float) );
+    if( unlikely(p_out_buf == NULL) )
+        goto error;
+    if( p_in_buf->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        p_out_buf->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+
+    float *p_out = (float *)p_out_buf->p_buffer;
+    const unsigned i_taps = p_sys->i_taps;
+    for( size_t i = 0; i < i_out_nb; i++ )
     {
-        size_t newsize = p_sys->i_old_wing * 2 * i_bytes_per_frame;
-        if( newsize > p_sys->i_buf_size )
+        const size_t i_first = (p_sys->i_pos >> 32) - (p_sys->i_wing - 1);
+        const uint64_t i_phase = (uint64_t)(uint32_t)p_sys->i_pos * PHASES;
+        const float *p_row = &p_sys->p_bank[(i_phase >> 32) * i_taps];
+        const float *p_coefs = p_row;
+
+        /* interpolate between the two nearest rows */
+        if( (uint32_t)i_phase != 0 )
         {
-            free( p_sys->p_buf );
-            p_sys->p_buf = malloc( newsize );
-            if( p_sys->p_buf != NULL )
-                p_sys->i_buf_size = newsize;
-            else
-            {
-                p_sys->i_buf_size = p_sys->i_old_wing = 0; /* oops! */
-                block_Release( p_in_buf );
-                return p_out_buf;
-            }
+            p_sys->pf_interp( p_sys->p_coefs, p_row, p_row + i_taps,
+                              (uint32_t)i_phase * 0x1.p-32f, i_taps );
+            p_coefs = p_sys->p_coefs;
         }
-        memcpy( p_sys->p_buf,
-                p_in_orig + (i_in_nb - 2 * p_sys->i_old_wing) *
-                i_nb_channels, (2 * p_sys->i_old_wing) *
-                p_filter->fmt_in.audio.i_bytes_per_frame );
+
+        for( unsigned c = 0; c < i_channels; c++ )
+            *(p_out++) = p_sys->pf_dot( &p_sys->p_hist[c * p_sys->i_hist_max
+                                                       + i_first],
+                                        p_coefs, i_taps );
+        p_sys->i_pos += i_step;
     }
 
-#if 0
-    msg_Err( p_filter, "p_out size: %i, nb bytes out: %i", p_out_buf->i_buffer,
-             i_out * p_filter->fmt_in.audio.i_bytes_per_frame );
-#endif
+    ShiftHistory( p_sys, i_channels );
+
+    p_out_buf->i_nb_samples = i_out_nb;
+    p_out_buf->i_dts =
+    p_out_buf->i_pts = date_Get( &p_sys->end_date );
+    p_out_buf->i_length = date_Increment( &p_sys->end_date,
+                                  p_out_buf->i_nb_samples ) - p_out_buf->i_pts;
 
     block_Release( p_in_buf );
     return p_out_buf;
+
+error:
+    p_sys->b_first = true;
+    block_Release( p_in_buf );
+    return NULL;
 }
 
 /*****************************************************************************
@@ -295,15 +551,35 @@ static int OpenFilter( filter_t *p_filter )
     }
 
     /* Allocate the memory needed to store the module's structure */
-    p_filter->p_sys = p_sys = malloc( sizeof(struct filter_sys_t) );
+    p_filter->p_sys = p_sys = calloc( 1, sizeof(filter_sys_t) );
     if( p_sys == NULL )
         return VLC_ENOMEM;
 
-    p_sys->p_buf = NULL;
-    p_sys->i_buf_size = 0;
-
-    p_sys->i_old_wing = 0;
     p_sys->b_first = true;
+    p_sys->pf_dot = DotC;
+    p_sys->pf_interp = InterpC;
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        p_sys->pf_dot = DotAVX2;
+        p_sys->pf_interp = InterpAVX2;
+    }
+    else
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+    {
+        p_sys->pf_dot = DotSSE2;
+        p_sys->pf_interp = InterpSSE2;
+    }
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+    if( vlc_CPU_ARM_NEON() )
+    {
+        p_sys->pf_dot = DotNEON;
+        p_sys->pf_interp = InterpNEON;
+    }
+#endif
     p_filter->pf_audio_filter = Resample;
 
     msg_Dbg( p_filter, "%4.4s/%ikHz/%i->%4.4s/%ikHz/%i",
@@ -325,218 +601,158 @@ static int OpenFilter( filter_t *p_filter )
  *****************************************************************************/
 static void CloseFilter( filter_t *p_filter )
 {
-    free( p_filter->p_sys->p_buf );
-    free( p_filter->p_sys );
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    free( p_sys->p_hist );
+    free( p_sys->p_coefs );
+    free( p_sys->p_bank );
+    free( p_sys );
 }
 
-static void FilterFloatUP( const float Imp[], const float ImpD[], uint16_t Nwing, float *p_in,
-                            float *p_out, uint32_t ui_remainder,
-                            uint32_t ui_output_rate, int16_t Inc, int i_nb_channels )
-{
-    const float *Hp, *Hdp, *End;
-    float t, temp;
-    uint32_t ui_linear_remainder;
-    int i;
-
-    Hp = &Imp[(ui_remainder<<Nhc)/ui_output_rate];
-    Hdp = &ImpD[(ui_remainder<<Nhc)/ui_output_rate];
-
-    End = &Imp[Nwing];
-
-    ui_linear_remainder = (ui_remainder<<Nhc) -
-                            (ui_remainder<<Nhc)/ui_output_rate*ui_output_rate;
-
-    if (Inc == 1)               /* If doing right wing...              */
-    {                           /* ...drop extra coeff, so when Ph is  */
-        End--;                  /*    0.5, we don't do too many mult's */
-        if (ui_remainder == 0)  /* If the phase is zero...           */
-        {                       /* ...then we've already skipped the */
-            Hp += Npc;          /*    first sample, so we must also  */
-            Hdp += Npc;         /*    skip ahead in Imp[] and ImpD[] */
-        }
-    }
+#ifdef BANDLIMITED_TEST
+#include <stdio.h>
 
-    while (Hp < End) {
-        t = *Hp;                /* Get filter coeff */
-                                /* t is now interp'd filter coeff */
-        t += *Hdp * ui_linear_remainder / ui_output_rate / Npc;
-        for( i = 0; i < i_nb_channels; i++ )
-        {
-            temp = t;
-            temp *= *(p_in+i);  /* Mult coeff by input sample */
-            *(p_out+i) += temp; /* The filter output */
-        }
-        Hdp += Npc;             /* Filter coeff differences step */
-        Hp += Npc;              /* Filter coeff step */
-        p_in += (Inc * i_nb_channels); /* Input signal step */
-    }
+static block_t *MakeBlock( unsigned i_channels, size_t i_frames,
+                           vlc_tick_t i_pts, size_t *pi_phase )
+{
+    block_t *p_block = block_Alloc( i_frames * i_channels * sizeof(float) );
+    assert( p_block != NULL );
+
+    float *p = (float *)p_block->p_buffer;
+    for( size_t i = 0; i < i_frames; i++, (*pi_phase)++ )
+        for( unsigned c = 0; c < i_channels; c++ )
+            *(p++) = sinf( *pi_phase * .05f );
+    p_block->i_nb_samples = i_frames;
+    p_block->i_pts = p_block->i_dts = i_pts;
+    return p_block;
 }
 
-static void FilterFloatUD( const float Imp[], const float ImpD[], uint16_t Nwing, float *p_in,
-                           float *p_out, uint32_t ui_remainder,
-                           uint32_t ui_output_rate, uint32_t ui_input_rate,
-                           int16_t Inc, int i_nb_channels )
+static filter_t *Create( unsigned i_in_rate, unsigned i_out_rate )
 {
-    const float *Hp, *Hdp, *End;
-    float t, temp;
-    uint32_t ui_linear_remainder;
-    int i, ui_counter = 0;
-
-    Hp = Imp + (ui_remainder<<Nhc) / ui_input_rate;
-    Hdp = ImpD  + (ui_remainder<<Nhc) / ui_input_rate;
-
-    End = &Imp[Nwing];
-
-    if (Inc == 1)               /* If doing right wing...              */
-    {                           /* ...drop extra coeff, so when Ph is  */
-        End--;                  /*    0.5, we don't do too many mult's */
-        if (ui_remainder == 0)  /* If the phase is zero...           */
-        {                       /* ...then we've already skipped the */
-            Hp = Imp +          /* first sample, so we must also  */
-                  (ui_output_rate << Nhc) / ui_input_rate;
-            Hdp = ImpD +        /* skip ahead in Imp[] and ImpD[] */
-                  (ui_output_rate << Nhc) / ui_input_rate;
-            ui_counter++;
-        }
-    }
-
-    while (Hp < End) {
-        t = *Hp;                /* Get filter coeff */
-                                /* t is now interp'd filter coeff */
-        ui_linear_remainder =
-          ((ui_output_rate * ui_counter + ui_remainder)<< Nhc) -
-          ((ui_output_rate * ui_counter + ui_remainder)<< Nhc) /
-          ui_input_rate * ui_input_rate;
-        t += *Hdp * ui_linear_remainder / ui_input_rate / Npc;
-        for( i = 0; i < i_nb_channels; i++ )
-        {
-            temp = t;
-            temp *= *(p_in+i);  /* Mult coeff by input sample */
-            *(p_out+i) += temp; /* The filter output */
-        }
-
-        ui_counter++;
+    filter_t *p_filter = (vlc_object_create)( NULL, sizeof (*p_filter) );
+    assert( p_filter != NULL );
+
+    audio_format_t fmt = {
+        .i_format = VLC_CODEC_FL32,
+        .i_rate = i_in_rate,
+        .i_physical_channels = AOUT_CHANS_STEREO,
+        .i_channels = 2,
+    };
+    es_format_Init( &p_filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32 );
+    p_filter->fmt_in.audio = fmt;
+    es_format_Init( &p_filter->fmt_out, AUDIO_ES, VLC_CODEC_FL32 );
+    p_filter->fmt_out.audio = fmt;
+    p_filter->fmt_out.audio.i_rate = i_out_rate;
 
-        /* Filter coeff step */
-        Hp = Imp + ((ui_output_rate * ui_counter + ui_remainder)<< Nhc)
-                    / ui_input_rate;
-        /* Filter coeff differences step */
-        Hdp = ImpD + ((ui_output_rate * ui_counter + ui_remainder)<< Nhc)
-                     / ui_input_rate;
+    int ret = OpenFilter( p_filter );
+    assert( ret == VLC_SUCCESS );
+    (void) ret;
+    return p_filter;
+}
 
-        p_in += (Inc * i_nb_channels); /* Input signal step */
-    }
+static void Destroy( filter_t *p_filter )
+{
+    CloseFilter( p_filter );
+    vlc_object_delete( p_filter );
 }
 
-static int ReallocBuffer( block_t **pp_out_buf,
-                          float **pp_out, size_t i_out,
-                          int i_nb_channels, int i_bytes_per_frame )
+/* Checks the number of frames and the timestamps of the output */
+static void TestRatio( unsigned i_in_rate, unsigned i_out_rate )
 {
-    if( i_out < (*pp_out_buf)->i_buffer/i_bytes_per_frame )
-        return VLC_SUCCESS;
+    filter_t *p_filter = Create( i_in_rate, i_out_rate );
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_tick_t i_start = VLC_TICK_FROM_SEC(1);
+    vlc_tick_t i_next = i_start;
+    size_t i_phase = 0, i_in = 0, i_out = 0;
 
-    /* It may happen when the wing size changes */
-    const unsigned i_extra_frame = 256;
-    *pp_out_buf = block_Realloc( *pp_out_buf, 0,
-                                 (*pp_out_buf)->i_buffer +
-                                    i_extra_frame * i_bytes_per_frame );
-    if( !*pp_out_buf )
-        return VLC_EGENERIC;
+    for( unsigned i = 0; i < 200; i++ )
+    {
+        const size_t i_frames = 480 + 97 * (i % 7);
+        block_t *p_in = MakeBlock( 2, i_frames,
+                           i_start + vlc_tick_from_samples( i_in, i_in_rate ),
+                           &i_phase );
+        i_in += i_frames;
+
+        block_t *p_out = Resample( p_filter, p_in );
+        assert( p_out != NULL );
+        assert( p_out->i_buffer == p_out->i_nb_samples * 2 * sizeof(float) );
+        assert( p_out->i_pts == i_next );
+        i_next += p_out->i_length;
+        i_out += p_out->i_nb_samples;
+
+        const float *p = (const float *)p_out->p_buffer;
+        for( size_t j = 0; j < 2 * p_out->i_nb_samples; j++ )
+            assert( isfinite( p[j] ) && fabsf( p[j] ) < 1.1f );
+        block_Release( p_out );
+    }
 
-    *pp_out = (float*)(*pp_out_buf)->p_buffer + i_out * i_nb_channels;
-    memset( *pp_out, 0, i_extra_frame * i_bytes_per_frame );
-    return VLC_SUCCESS;
+    /* Only the input frames waiting for their right wing are missing */
+    const double d_missing = i_in - (double)i_out * i_in_rate / i_out_rate;
+    printf( "%u -> %u Hz: %zu -> %zu frames\n",
+            i_in_rate, i_out_rate, i_in, i_out );
+    assert( d_missing >= -1. && d_missing <= p_sys->i_taps + 1 );
+
+    date_t date;
+    date_Init( &date, i_out_rate, 1 );
+    date_Set( &date, i_start );
+    assert( i_next == date_Increment( &date, i_out ) );
+    Destroy( p_filter );
 }
 
-static void ResampleFloat( filter_t *p_filter,
-                           block_t **pp_out_buf,  size_t *pi_out,
-                           float **pp_in,
-                           int i_in, int i_in_end,
-                           double d_factor, bool b_factor_old,
-                           int i_nb_channels, int i_bytes_per_frame )
+/* Checks that the filter goes back to pass-through at unity ratio after a
+ * drift correction */
+static void TestUnity( void )
 {
+    filter_t *p_filter = Create( 48000 + 37, 48000 );
     filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_tick_t i_start = VLC_TICK_FROM_SEC(1);
+    size_t i_phase = 0, i_in = 0, i_out = 0;
+    vlc_tick_t i_next = i_start;
 
-    float *p_in = *pp_in;
-    size_t i_out = *pi_out;
-    float *p_out = (float*)(*pp_out_buf)->p_buffer + i_out * i_nb_channels;
-
-    for( ; i_in < i_in_end; i_in++ )
+    for( unsigned i = 0; i < 20; i++ )
     {
-        if( b_factor_old && d_factor == 1 )
-        {
-            if( ReallocBuffer( pp_out_buf, &p_out,
-                               i_out, i_nb_channels, i_bytes_per_frame ) )
-                return;
-            /* Just copy the samples */
-            memcpy( p_out, p_in, i_bytes_per_frame );
-            p_in += i_nb_channels;
-            p_out += i_nb_channels;
-            i_out++;
-            continue;
-        }
-
-        while( p_sys->i_remainder < p_filter->fmt_out.audio.i_rate )
-        {
-            if( ReallocBuffer( pp_out_buf, &p_out,
-                               i_out, i_nb_channels, i_bytes_per_frame ) )
-                return;
-
-            if( d_factor >= 1 )
-            {
-                /* FilterFloatUP() is faster if we can use it */
-
-                /* Perform left-wing inner product */
-                FilterFloatUP( SMALL_FILTER_FLOAT_IMP, SMALL_FILTER_FLOAT_IMPD,
-                               SMALL_FILTER_NWING, p_in, p_out,
-                               p_sys->i_remainder,
-                               p_filter->fmt_out.audio.i_rate,
-                               -1, i_nb_channels );
-                /* Perform right-wing inner product */
-                FilterFloatUP( SMALL_FILTER_FLOAT_IMP, SMALL_FILTER_FLOAT_IMPD,
-                               SMALL_FILTER_NWING, p_in + i_nb_channels, p_out,
-                               p_filter->fmt_out.audio.i_rate -
-                               p_sys->i_remainder,
-                               p_filter->fmt_out.audio.i_rate,
-                               1, i_nb_channels );
-
-#if 0
-                /* Normalize for unity filter gain */
-                for( i = 0; i < i_nb_channels; i++ )
-                {
-                    *(p_out+i) *= d_old_scale_factor;
-                }
-#endif
-            }
-            else
-            {
-                /* Perform left-wing inner product */
-                FilterFloatUD( SMALL_FILTER_FLOAT_IMP, SMALL_FILTER_FLOAT_IMPD,
-                               SMALL_FILTER_NWING, p_in, p_out,
-                               p_sys->i_remainder,
-                               p_filter->fmt_out.audio.i_rate, p_filter->fmt_in.audio.i_rate,
-                               -1, i_nb_channels );
-                /* Perform right-wing inner product */
-                FilterFloatUD( SMALL_FILTER_FLOAT_IMP, SMALL_FILTER_FLOAT_IMPD,
-                               SMALL_FILTER_NWING, p_in + i_nb_channels, p_out,
-                               p_filter->fmt_out.audio.i_rate -
-                               p_sys->i_remainder,
-                               p_filter->fmt_out.audio.i_rate, p_filter->fmt_in.audio.i_rate,
-                               1, i_nb_channels );
-            }
-
-            p_out += i_nb_channels;
-            i_out++;
-
-            p_sys->i_remainder += p_filter->fmt_in.audio.i_rate;
+        /* drift correction, as the audio output does it */
+        p_filter->fmt_in.audio.i_rate = 48000 + ( i < 10 ? 37 : 0 );
+
+        block_t *p_in = MakeBlock( 2, 1024,
+                           i_start + vlc_tick_from_samples( i_in, 48000 ),
+                           &i_phase );
+        block_t *p_ref = p_in;
+        i_in += 1024;
+
+        block_t *p_out = Resample( p_filter, p_in );
+        assert( p_out != NULL );
+        if( i <= 10 )
+            assert( p_out->i_pts == i_next );
+        i_next += p_out->i_length;
+        i_out += p_out->i_nb_samples;
+
+        if( i > 10 )
+        {   /* pass-through */
+            assert( p_sys->b_first );
+            assert( p_out == p_ref );
+            assert( p_out->i_nb_samples == 1024 );
         }
-
-        p_in += i_nb_channels;
-        p_sys->i_remainder -= p_filter->fmt_out.audio.i_rate;
+        block_Release( p_out );
     }
 
-    *pp_in  = p_in;
-    *pi_out = i_out;
+    /* The history was drained when leaving the resampler */
+    assert( i_out <= i_in );
+    assert( i_in - i_out <= 10 * 1024 * 37 / 48037 + 3 );
+    Destroy( p_filter );
 }
 
-
+int main( void )
+{
+    static const unsigned rates[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 48000, 96000 },
+        { 96000, 48000 }, { 32000, 48000 }, { 48000, 48037 },
+        { 48037, 48000 }, { 8000, 192000 },
+    };
+
+    for( size_t i = 0; i < ARRAY_SIZE(rates); i++ )
+        TestRatio( rates[i][0], rates[i][1] );
+    TestUnity();
+    return 0;
+}
+#endif
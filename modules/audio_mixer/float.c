@@ -31,9 +31,21 @@
 #include <stddef.h>
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define HAVE_NEON_INTRINSICS 1
+#endif
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -49,6 +61,18 @@ vlc_plugin_begin ()
     //set_subcategory( SUBCAT_AUDIO_AFILTER )
 vlc_plugin_end ()
 
+static inline void AmplifyFL32( float *p, size_t i_samples, float f_multiplier )
+{
+    for( size_t i = i_samples; i > 0; i-- )
+        *(p++) *= f_multiplier;
+}
+
+static inline void AmplifyFL64( double *p, size_t i_samples, double f_multiplier )
+{
+    for( size_t i = i_samples; i > 0; i-- )
+        *(p++) *= f_multiplier;
+}
+
 /**
  * Mixes a new output buffer
  */
@@ -58,27 +82,138 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
     if( f_multiplier == 1.f )
         return; /* nothing to do */
 
-    float *p = (float *)p_buffer->p_buffer;
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= f_multiplier;
-
+    AmplifyFL32( (float *)p_buffer->p_buffer,
+                 p_buffer->i_buffer / sizeof(float), f_multiplier );
     (void) p_volume;
 }
 
 static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    AmplifyFL64( (double *)p_buffer->p_buffer,
+                 p_buffer->i_buffer / sizeof(double), f_multiplier );
+    (void) p_volume;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static void FilterFL32_SSE2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i_samples = p_buffer->i_buffer / sizeof(*p);
+    const __m128 mult = _mm_set1_ps( f_multiplier );
+
+    for( ; i_samples >= 8; i_samples -= 8, p += 8 )
+    {
+        __m128 a = _mm_loadu_ps( p );
+        __m128 b = _mm_loadu_ps( p + 4 );
+        _mm_storeu_ps( p, _mm_mul_ps( a, mult ) );
+        _mm_storeu_ps( p + 4, _mm_mul_ps( b, mult ) );
+    }
+    AmplifyFL32( p, i_samples, f_multiplier );
+    (void) p_volume;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void FilterFL64_SSE2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
     double *p = (double *)p_buffer->p_buffer;
-    double mult = f_multiplier;
-    if( mult == 1. )
+    size_t i_samples = p_buffer->i_buffer / sizeof(*p);
+    const __m128d mult = _mm_set1_pd( f_multiplier );
+
+    for( ; i_samples >= 4; i_samples -= 4, p += 4 )
+    {
+        __m128d a = _mm_loadu_pd( p );
+        __m128d b = _mm_loadu_pd( p + 2 );
+        _mm_storeu_pd( p, _mm_mul_pd( a, mult ) );
+        _mm_storeu_pd( p + 2, _mm_mul_pd( b, mult ) );
+    }
+    AmplifyFL64( p, i_samples, f_multiplier );
+    (void) p_volume;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx2")))
+static void FilterFL32_AVX2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    if( f_multiplier == 1.f )
         return; /* nothing to do */
 
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= mult;
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i_samples = p_buffer->i_buffer / sizeof(*p);
+    const __m256 mult = _mm256_set1_ps( f_multiplier );
 
+    for( ; i_samples >= 16; i_samples -= 16, p += 16 )
+    {
+        __m256 a = _mm256_loadu_ps( p );
+        __m256 b = _mm256_loadu_ps( p + 8 );
+        _mm256_storeu_ps( p, _mm256_mul_ps( a, mult ) );
+        _mm256_storeu_ps( p + 8, _mm256_mul_ps( b, mult ) );
+    }
+    _mm256_zeroupper();
+    AmplifyFL32( p, i_samples, f_multiplier );
     (void) p_volume;
 }
 
+__attribute__ ((__target__ ("avx2")))
+static void FilterFL64_AVX2( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    double *p = (double *)p_buffer->p_buffer;
+    size_t i_samples = p_buffer->i_buffer / sizeof(*p);
+    const __m256d mult = _mm256_set1_pd( f_multiplier );
+
+    for( ; i_samples >= 8; i_samples -= 8, p += 8 )
+    {
+        __m256d a = _mm256_loadu_pd( p );
+        __m256d b = _mm256_loadu_pd( p + 4 );
+        _mm256_storeu_pd( p, _mm256_mul_pd( a, mult ) );
+        _mm256_storeu_pd( p + 4, _mm256_mul_pd( b, mult ) );
+    }
+    _mm256_zeroupper();
+    AmplifyFL64( p, i_samples, f_multiplier );
+    (void) p_volume;
+}
+#endif
+
+#ifdef HAVE_NEON_INTRINSICS
+static void FilterFL32_NEON( audio_volume_t *p_volume, block_t *p_buffer,
+                             float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i_samples = p_buffer->i_buffer / sizeof(*p);
+
+    for( ; i_samples >= 8; i_samples -= 8, p += 8 )
+    {
+        float32x4_t a = vld1q_f32( p );
+        float32x4_t b = vld1q_f32( p + 4 );
+        vst1q_f32( p, vmulq_n_f32( a, f_multiplier ) );
+        vst1q_f32( p + 4, vmulq_n_f32( b, f_multiplier ) );
+    }
+    AmplifyFL32( p, i_samples, f_multiplier );
+    (void) p_volume;
+}
+#endif
+
 /**
  * Initializes the mixer
  */
@@ -88,12 +223,155 @@ static int Create( audio_volume_t *p_volume )
     {
         case VLC_CODEC_FL32:
             p_volume->amplify = FilterFL32;
+#ifdef HAVE_AVX2_INTRINSICS
+            if( vlc_CPU_AVX2() )
+                p_volume->amplify = FilterFL32_AVX2;
+            else
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+            if( vlc_CPU_SSE2() )
+                p_volume->amplify = FilterFL32_SSE2;
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+            if( vlc_CPU_ARM_NEON() )
+                p_volume->amplify = FilterFL32_NEON;
+#endif
             break;
         case VLC_CODEC_FL64:
             p_volume->amplify = FilterFL64;
+#ifdef HAVE_AVX2_INTRINSICS
+            if( vlc_CPU_AVX2() )
+                p_volume->amplify = FilterFL64_AVX2;
+            else
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+            if( vlc_CPU_SSE2() )
+                p_volume->amplify = FilterFL64_SSE2;
+#endif
             break;
         default:
             return -1;
     }
     return 0;
 }
+
+#ifdef FLOAT_MIXER_TEST
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Checks each kernel supported by the CPU against the scalar code, then
+ * times it on as many blocks as a wall of audio streams would produce.
+ * The iteration count can be given on the command line. */
+#define BENCH_STREAMS 64
+#define BENCH_SAMPLES (1024 * 2) /* 1024 stereo frames */
+
+struct kernel
+{
+    const char *name;
+    vlc_fourcc_t format;
+    void (*amplify)( audio_volume_t *, block_t *, float );
+    bool supported;
+};
+
+static block_t *MakeBlock( vlc_fourcc_t format, size_t i_samples )
+{
+    block_t *p_block = block_Alloc( i_samples * aout_BitsPerSample( format ) / 8 );
+    assert( p_block != NULL );
+
+    for( size_t i = 0; i < i_samples; i++ )
+    {
+        double f = rand() / (double)RAND_MAX * 2. - 1.;
+        if( format == VLC_CODEC_FL32 )
+            ((float *)p_block->p_buffer)[i] = f;
+        else
+            ((double *)p_block->p_buffer)[i] = f;
+    }
+    return p_block;
+}
+
+static void Check( const struct kernel *k, void (*ref)( audio_volume_t *,
+                   block_t *, float ) )
+{
+    static const float volumes[] = { 0.f, .25f, .5f, 1.f, 1.5f, 2.f, 8.f };
+
+    /* Odd lengths exercise the scalar tail of the vector loops */
+    for( size_t i_samples = 0; i_samples < 67; i_samples++ )
+        for( size_t v = 0; v < ARRAY_SIZE(volumes); v++ )
+        {
+            block_t *p_out = MakeBlock( k->format, i_samples );
+            block_t *p_ref = block_Duplicate( p_out );
+            assert( p_ref != NULL );
+
+            k->amplify( NULL, p_out, volumes[v] );
+            ref( NULL, p_ref, volumes[v] );
+            if( k->format == VLC_CODEC_FL32 )
+                assert( !memcmp( p_out->p_buffer, p_ref->p_buffer,
+                                 p_ref->i_buffer ) );
+            else /* x87 may round the scalar products twice */
+                for( size_t i = 0; i < i_samples; i++ )
+                {
+                    double a = ((double *)p_out->p_buffer)[i];
+                    double b = ((double *)p_ref->p_buffer)[i];
+                    assert( fabs( a - b ) <= fabs( b ) * DBL_EPSILON );
+                }
+            block_Release( p_ref );
+            block_Release( p_out );
+        }
+}
+
+static void Bench( const struct kernel *k, unsigned i_iterations )
+{
+    block_t *p_blocks[BENCH_STREAMS];
+
+    for( size_t i = 0; i < BENCH_STREAMS; i++ )
+        p_blocks[i] = MakeBlock( k->format, BENCH_SAMPLES );
+
+    vlc_tick_t i_start = vlc_tick_now();
+    for( unsigned n = 0; n < i_iterations; n++ )
+        for( size_t i = 0; i < BENCH_STREAMS; i++ ) /* stays within range */
+            k->amplify( NULL, p_blocks[i], (n & 1) ? 2.f : .5f );
+    vlc_tick_t i_time = vlc_tick_now() - i_start;
+
+    double samples = (double)i_iterations * BENCH_STREAMS * BENCH_SAMPLES;
+    printf( "%s %4.4s: %8.1f Msamples/s\n", k->name,
+            (const char *)&k->format,
+            i_time > 0 ? samples / i_time * CLOCK_FREQ / 1e6 : 0. );
+
+    for( size_t i = 0; i < BENCH_STREAMS; i++ )
+        block_Release( p_blocks[i] );
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned i_iterations = argc > 1 ? strtoul( argv[1], NULL, 0 ) : 100;
+    const struct kernel kernels[] = {
+        { "C   ", VLC_CODEC_FL32, FilterFL32, true },
+        { "C   ", VLC_CODEC_FL64, FilterFL64, true },
+#ifdef HAVE_SSE2_INTRINSICS
+        { "SSE2", VLC_CODEC_FL32, FilterFL32_SSE2, vlc_CPU_SSE2() },
+        { "SSE2", VLC_CODEC_FL64, FilterFL64_SSE2, vlc_CPU_SSE2() },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        { "AVX2", VLC_CODEC_FL32, FilterFL32_AVX2, vlc_CPU_AVX2() },
+        { "AVX2", VLC_CODEC_FL64, FilterFL64_AVX2, vlc_CPU_AVX2() },
+#endif
+#ifdef HAVE_NEON_INTRINSICS
+        { "NEON", VLC_CODEC_FL32, FilterFL32_NEON, vlc_CPU_ARM_NEON() },
+#endif
+    };
+
+    srand( 0 );
+    for( size_t i = 0; i < ARRAY_SIZE(kernels); i++ )
+    {
+        const struct kernel *k = &kernels[i];
+
+        if( !k->supported )
+            continue;
+        Check( k, k->format == VLC_CODEC_FL32 ? FilterFL32 : FilterFL64 );
+        Bench( k, i_iterations );
+    }
+    return 0;
+}
+#endif
@@ -27,9 +27,17 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+
 static int Activate (audio_volume_t *);
 
 vlc_plugin_begin ()
@@ -39,15 +47,9 @@ vlc_plugin_begin ()
     //set_subcategory (SUBCAT_AUDIO_AFILTER)
 vlc_plugin_end ()
 
-static void FilterS32N (audio_volume_t *vol, block_t *block, float volume)
+static inline void AmplifyS32N (int32_t *p, size_t n, int_fast32_t mult)
 {
-    int32_t *p = (int32_t *)block->p_buffer;
-
-    int_fast32_t mult = lroundf (volume * 0x1.p24f);
-    if (mult == (1 << 24))
-        return;
-
-    for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
+    for (; n > 0; n--)
     {
         int_fast64_t s = (*p * (int_fast64_t)mult) >> INT64_C(24);
         if (s > INT32_MAX)
@@ -57,18 +59,11 @@ static void FilterS32N (audio_volume_t *vol, block_t *block, float volume)
             s = INT32_MIN;
         *(p++) = s;
     }
-    (void) vol;
 }
 
-static void FilterS16N (audio_volume_t *vol, block_t *block, float volume)
+static inline void AmplifyS16N (int16_t *p, size_t n, int_fast16_t mult)
 {
-    int16_t *p = (int16_t *)block->p_buffer;
-
-    int_fast16_t mult = lroundf (volume * 0x1.p8f);
-    if (mult == (1 << 8))
-        return;
-
-    for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
+    for (; n > 0; n--)
     {
         int_fast32_t s = (*p * (int_fast32_t)mult) >> 8;
         if (s > INT16_MAX)
@@ -78,9 +73,129 @@ static void FilterS16N (audio_volume_t *vol, block_t *block, float volume)
             s = INT16_MIN;
         *(p++) = s;
     }
+}
+
+static void FilterS32N (audio_volume_t *vol, block_t *block, float volume)
+{
+    int_fast32_t mult = lroundf (volume * 0x1.p24f);
+    if (mult == (1 << 24))
+        return;
+
+    AmplifyS32N ((int32_t *)block->p_buffer, block->i_buffer / 4, mult);
+    (void) vol;
+}
+
+static void FilterS16N (audio_volume_t *vol, block_t *block, float volume)
+{
+    int_fast16_t mult = lroundf (volume * 0x1.p8f);
+    if (mult == (1 << 8))
+        return;
+
+    AmplifyS16N ((int16_t *)block->p_buffer, block->i_buffer / 2, mult);
+    (void) vol;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* The 16x16 bits products are computed exactly, then shifted and packed with
+ * signed saturation, so the output matches the scalar code bit for bit. */
+__attribute__ ((__target__ ("sse2")))
+static void FilterS16N_SSE2 (audio_volume_t *vol, block_t *block, float volume)
+{
+    int16_t *p = (int16_t *)block->p_buffer;
+    size_t n = block->i_buffer / sizeof (*p);
+
+    int_fast32_t mult = lroundf (volume * 0x1.p8f);
+    if (mult == (1 << 8))
+        return;
+    if (mult > INT16_MAX)
+        goto out;
+
+    const __m128i m = _mm_set1_epi16 (mult);
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        __m128i v = _mm_loadu_si128 ((const __m128i *)p);
+        __m128i lo = _mm_mullo_epi16 (v, m);
+        __m128i hi = _mm_mulhi_epi16 (v, m);
+        __m128i a = _mm_srai_epi32 (_mm_unpacklo_epi16 (lo, hi), 8);
+        __m128i b = _mm_srai_epi32 (_mm_unpackhi_epi16 (lo, hi), 8);
+        _mm_storeu_si128 ((__m128i *)p, _mm_packs_epi32 (a, b));
+    }
+out:
+    AmplifyS16N (p, n, mult);
+    (void) vol;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx2")))
+static void FilterS16N_AVX2 (audio_volume_t *vol, block_t *block, float volume)
+{
+    int16_t *p = (int16_t *)block->p_buffer;
+    size_t n = block->i_buffer / sizeof (*p);
+
+    int_fast32_t mult = lroundf (volume * 0x1.p8f);
+    if (mult == (1 << 8))
+        return;
+    if (mult > INT16_MAX)
+        goto out;
+
+    /* unpack and pack both work within 128-bits lanes: the order is kept */
+    const __m256i m = _mm256_set1_epi16 (mult);
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        __m256i v = _mm256_loadu_si256 ((const __m256i *)p);
+        __m256i lo = _mm256_mullo_epi16 (v, m);
+        __m256i hi = _mm256_mulhi_epi16 (v, m);
+        __m256i a = _mm256_srai_epi32 (_mm256_unpacklo_epi16 (lo, hi), 8);
+        __m256i b = _mm256_srai_epi32 (_mm256_unpackhi_epi16 (lo, hi), 8);
+        _mm256_storeu_si256 ((__m256i *)p, _mm256_packs_epi32 (a, b));
+    }
+    _mm256_zeroupper ();
+out:
+    AmplifyS16N (p, n, mult);
     (void) vol;
 }
 
+/* Even and odd samples are multiplied separately into 64-bits products.
+ * A result overflows if bits 55 to 63 of its product are not all equal. */
+__attribute__ ((__target__ ("avx2")))
+static void FilterS32N_AVX2 (audio_volume_t *vol, block_t *block, float volume)
+{
+    int32_t *p = (int32_t *)block->p_buffer;
+    size_t n = block->i_buffer / sizeof (*p);
+
+    int_fast32_t mult = lroundf (volume * 0x1.p24f);
+    if (mult == (1 << 24))
+        return;
+    if (mult > INT32_MAX)
+        goto out;
+
+    const __m256i m = _mm256_set1_epi32 (mult);
+    const __m256i max = _mm256_set1_epi32 (INT32_MAX);
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        __m256i v = _mm256_loadu_si256 ((const __m256i *)p);
+        __m256i even = _mm256_mul_epi32 (v, m);
+        __m256i odd = _mm256_mul_epi32 (_mm256_srli_epi64 (v, 32), m);
+
+        __m256i s = _mm256_blend_epi32 (_mm256_srli_epi64 (even, 24),
+                        _mm256_slli_epi64 (_mm256_srli_epi64 (odd, 24), 32),
+                        0xAA);
+        __m256i hi = _mm256_blend_epi32 (_mm256_srli_epi64 (even, 32), odd,
+                                         0xAA);
+        __m256i sign = _mm256_srai_epi32 (hi, 31);
+        __m256i over = _mm256_xor_si256 (_mm256_srai_epi32 (hi, 23), sign);
+        over = _mm256_cmpeq_epi32 (over, _mm256_setzero_si256 ());
+        s = _mm256_blendv_epi8 (_mm256_xor_si256 (sign, max), s, over);
+        _mm256_storeu_si256 ((__m256i *)p, s);
+    }
+    _mm256_zeroupper ();
+out:
+    AmplifyS32N (p, n, mult);
+    (void) vol;
+}
+#endif
+
 static void FilterU8 (audio_volume_t *vol, block_t *block, float volume)
 {
     uint8_t *p = (uint8_t *)block->p_buffer;
@@ -108,9 +223,22 @@ static int Activate (audio_volume_t *vol)
     {
         case VLC_CODEC_S32N:
             vol->amplify = FilterS32N;
+#ifdef HAVE_AVX2_INTRINSICS
+            if (vlc_CPU_AVX2 ())
+                vol->amplify = FilterS32N_AVX2;
+#endif
             break;
         case VLC_CODEC_S16N:
             vol->amplify = FilterS16N;
+#ifdef HAVE_AVX2_INTRINSICS
+            if (vlc_CPU_AVX2 ())
+                vol->amplify = FilterS16N_AVX2;
+            else
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+            if (vlc_CPU_SSE2 ())
+                vol->amplify = FilterS16N_SSE2;
+#endif
             break;
         case VLC_CODEC_U8:
             vol->amplify = FilterU8;
@@ -120,3 +248,115 @@ static int Activate (audio_volume_t *vol)
     }
     return 0;
 }
+
+#ifdef INTEGER_MIXER_TEST
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Checks each kernel supported by the CPU against the scalar code, then
+ * times it on as many blocks as a wall of audio streams would produce.
+ * The iteration count can be given on the command line. */
+#define BENCH_STREAMS 64
+#define BENCH_SAMPLES (1024 * 2) /* 1024 stereo frames */
+
+struct kernel
+{
+    const char *name;
+    vlc_fourcc_t format;
+    void (*amplify) (audio_volume_t *, block_t *, float);
+    bool supported;
+};
+
+static block_t *MakeBlock (vlc_fourcc_t format, size_t n)
+{
+    size_t size = n * aout_BitsPerSample (format) / 8;
+    block_t *block = block_Alloc (size);
+    assert (block != NULL);
+
+    /* full scale random samples, so that the saturation is exercised */
+    for (size_t i = 0; i < size; i++)
+        block->p_buffer[i] = rand ();
+    return block;
+}
+
+static void Check (const struct kernel *k,
+                   void (*ref) (audio_volume_t *, block_t *, float))
+{
+    static const float volumes[] = { 0.f, .25f, .5f, 1.f, 1.5f, 2.f, 8.f };
+
+    /* odd lengths exercise the scalar tail of the vector loops */
+    for (size_t n = 0; n < 67; n++)
+        for (size_t v = 0; v < ARRAY_SIZE(volumes); v++)
+        {
+            block_t *out = MakeBlock (k->format, n);
+            block_t *expected = block_Duplicate (out);
+            assert (expected != NULL);
+
+            k->amplify (NULL, out, volumes[v]);
+            ref (NULL, expected, volumes[v]);
+            assert (!memcmp (out->p_buffer, expected->p_buffer,
+                             expected->i_buffer));
+            block_Release (expected);
+            block_Release (out);
+        }
+}
+
+static void Bench (const struct kernel *k, unsigned iterations)
+{
+    block_t *blocks[BENCH_STREAMS];
+
+    for (size_t i = 0; i < BENCH_STREAMS; i++)
+        blocks[i] = MakeBlock (k->format, BENCH_SAMPLES);
+
+    vlc_tick_t start = vlc_tick_now ();
+    for (unsigned n = 0; n < iterations; n++)
+        for (size_t i = 0; i < BENCH_STREAMS; i++)
+            k->amplify (NULL, blocks[i], (n & 1) ? 2.f : .5f);
+    vlc_tick_t time = vlc_tick_now () - start;
+
+    double samples = (double)iterations * BENCH_STREAMS * BENCH_SAMPLES;
+    printf ("%s %4.4s: %8.1f Msamples/s\n", k->name,
+            (const char *)&k->format,
+            time > 0 ? samples / time * CLOCK_FREQ / 1e6 : 0.);
+
+    for (size_t i = 0; i < BENCH_STREAMS; i++)
+        block_Release (blocks[i]);
+}
+
+int main (int argc, char *argv[])
+{
+    unsigned iterations = (argc > 1) ? strtoul (argv[1], NULL, 0) : 100;
+    const struct kernel kernels[] = {
+        { "C   ", VLC_CODEC_S32N, FilterS32N, true },
+        { "C   ", VLC_CODEC_S16N, FilterS16N, true },
+        { "C   ", VLC_CODEC_U8, FilterU8, true },
+#ifdef HAVE_SSE2_INTRINSICS
+        { "SSE2", VLC_CODEC_S16N, FilterS16N_SSE2, vlc_CPU_SSE2 () },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+        { "AVX2", VLC_CODEC_S32N, FilterS32N_AVX2, vlc_CPU_AVX2 () },
+        { "AVX2", VLC_CODEC_S16N, FilterS16N_AVX2, vlc_CPU_AVX2 () },
+#endif
+    };
+
+    srand (0);
+    for (size_t i = 0; i < ARRAY_SIZE(kernels); i++)
+    {
+        const struct kernel *k = &kernels[i];
+
+        if (!k->supported)
+            continue;
+        switch (k->format)
+        {
+            case VLC_CODEC_S32N:
+                Check (k, FilterS32N);
+                break;
+            case VLC_CODEC_S16N:
+                Check (k, FilterS16N);
+                break;
+        }
+        Bench (k, iterations);
+    }
+    return 0;
+}
+#endif
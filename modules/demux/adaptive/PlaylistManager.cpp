@@ -113,6 +113,8 @@ bool PlaylistManager::setupPeriod()
     if(!logic && !(logic = createLogic(logicType, conManager)))
         return false;
 
+    const unsigned lookahead = var_InheritInteger(p_demux, "adaptive-lookahead");
+
     std::vector<BaseAdaptationSet*> sets = currentPeriod->getAdaptationSets();
     std::vector<BaseAdaptationSet*>::iterator it;
     for(it=sets.begin();it!=sets.end();++it)
@@ -120,7 +122,7 @@ bool PlaylistManager::setupPeriod()
         BaseAdaptationSet *set = *it;
         if(set && streamFactory)
         {
-            SegmentTracker *tracker = new SegmentTracker(resources, logic, set);
+            SegmentTracker *tracker = new SegmentTracker(resources, logic, set, lookahead);
             if(!tracker)
                 continue;
 
@@ -76,10 +76,20 @@ SegmentTrackerEvent::SegmentTrackerEvent(const ID &id, vlc_tick_t duration)
     u.segment.id = &id;
 }
 
+SegmentTracker::PrefetchedChunk::PrefetchedChunk(BaseRepresentation *rep_,
+                                                 uint64_t number_, SegmentChunk *chunk_)
+{
+    rep = rep_;
+    number = number_;
+    chunk = chunk_;
+}
+
 SegmentTracker::SegmentTracker(SharedResources *res,
-        AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
+        AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet,
+        unsigned lookahead_)
 {
     resources = res;
+    lookahead = lookahead_;
     first = true;
     curNumber = next = 0;
     initializing = true;
@@ -154,6 +164,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    resetPrefetch();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -269,7 +280,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(resources, connManager, next, rep);
+    SegmentChunk *chunk = getPrefetched(rep, next);
+    if(!chunk)
+        chunk = segment->toChunk(resources, connManager, next, rep);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -296,11 +309,61 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetch(rep, connManager);
     }
 
     return chunk;
 }
 
+SegmentChunk * SegmentTracker::getPrefetched(BaseRepresentation *rep, uint64_t number)
+{
+    if(prefetched.empty())
+        return NULL;
+
+    /* Anything else than the expected segment means we switched or seeked */
+    const PrefetchedChunk &front = prefetched.front();
+    if(front.rep != rep || front.number != number)
+    {
+        resetPrefetch();
+        return NULL;
+    }
+
+    SegmentChunk *chunk = front.chunk;
+    prefetched.pop_front();
+    return chunk;
+}
+
+void SegmentTracker::prefetch(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    uint64_t number = prefetched.empty() ? next : prefetched.back().number + 1;
+    while(prefetched.size() < lookahead)
+    {
+        bool b_gap;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &number, &b_gap);
+        if(!segment || b_gap)
+            break;
+
+        vlc_tick_t time, duration;
+        if(!rep->getPlaybackTimeDurationBySegmentNumber(number, &time, &duration))
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(resources, connManager, number, rep);
+        if(!chunk)
+            break;
+        prefetched.push_back(PrefetchedChunk(rep, number, chunk));
+        number++;
+    }
+}
+
+void SegmentTracker::resetPrefetch()
+{
+    std::list<PrefetchedChunk>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+        delete (*it).chunk;
+    prefetched.clear();
+}
+
 bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -335,6 +398,7 @@ void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
         index_sent = false;
         init_sent = false;
     }
+    resetPrefetch();
     curNumber = next = segnumber;
 }
 
@@ -115,7 +115,8 @@ namespace adaptive
     {
         public:
             SegmentTracker(SharedResources *,
-                           AbstractAdaptationLogic *, BaseAdaptationSet *);
+                           AbstractAdaptationLogic *, BaseAdaptationSet *,
+                           unsigned = 0);
             ~SegmentTracker();
 
             StreamFormat getCurrentFormat() const;
@@ -139,6 +140,19 @@ namespace adaptive
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            void prefetch(BaseRepresentation *, AbstractConnectionManager *);
+            SegmentChunk * getPrefetched(BaseRepresentation *, uint64_t);
+            void resetPrefetch();
+            class PrefetchedChunk
+            {
+                public:
+                    PrefetchedChunk(BaseRepresentation *, uint64_t, SegmentChunk *);
+                    BaseRepresentation *rep;
+                    uint64_t number;
+                    SegmentChunk *chunk;
+            };
+            std::list<PrefetchedChunk> prefetched;
+            unsigned lookahead;
             bool first;
             bool initializing;
             bool index_sent;
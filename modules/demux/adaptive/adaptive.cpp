@@ -77,6 +77,13 @@ static void Close   (demux_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_WORKERS_TEXT N_("Concurrent downloads")
+#define ADAPT_WORKERS_LONGTEXT N_("Number of segments downloaded in parallel")
+
+#define ADAPT_LOOKAHEAD_TEXT N_("Segments lookahead")
+#define ADAPT_LOOKAHEAD_LONGTEXT N_("Number of segments requested ahead of the " \
+                                    "current one for each stream")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -123,6 +130,10 @@ vlc_plugin_begin ()
                      ADAPT_HEIGHT_TEXT, NULL, false )
         add_integer_with_range( "adaptive-bw", 250, 0, INT_MAX, ADAPT_BW_TEXT, ADAPT_BW_LONGTEXT, false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-download-workers", 1, 1, 8,
+                     ADAPT_WORKERS_TEXT, ADAPT_WORKERS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-lookahead", 0, 0, 16,
+                     ADAPT_LOOKAHEAD_TEXT, ADAPT_LOOKAHEAD_LONGTEXT, true )
 vlc_plugin_end ()
 
 /*****************************************************************************
@@ -22,7 +22,6 @@
 #endif
 
 #include "AuthStorage.hpp"
-#include "ConnectionParams.hpp"
 
 using namespace adaptive::http;
 
@@ -39,26 +38,7 @@ AuthStorage::~AuthStorage()
 {
 }
 
-void AuthStorage::addCookie( const std::string &cookie, const ConnectionParams &params )
+vlc_http_cookie_jar_t *AuthStorage::getJar() const
 {
-    if( !p_cookies_jar )
-        return;
-    vlc_http_cookies_store( p_cookies_jar, cookie.c_str(),
-                            params.getHostname().c_str(), params.getPath().c_str() );
-}
-
-std::string AuthStorage::getCookie( const ConnectionParams &params, bool secure )
-{
-    if( !p_cookies_jar )
-        return std::string();
-    char *psz = vlc_http_cookies_fetch( p_cookies_jar, secure,
-                                        params.getHostname().c_str(),
-                                        params.getPath().c_str() );
-    std::string ret;
-    if( psz )
-    {
-        ret = std::string(psz);
-        free( psz );
-    }
-    return ret;
+    return p_cookies_jar;
 }
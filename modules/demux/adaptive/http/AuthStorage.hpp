@@ -29,15 +29,12 @@ namespace adaptive
 {
     namespace http
     {
-        class ConnectionParams;
-
         class AuthStorage
         {
             public:
                 AuthStorage(vlc_object_t *p_obj);
                 ~AuthStorage();
-                void addCookie( const std::string &cookie, const ConnectionParams & );
-                std::string getCookie( const ConnectionParams &, bool secure );
+                vlc_http_cookie_jar_t *getJar() const;
 
             private:
                 vlc_http_cookie_jar_t *p_cookies_jar;
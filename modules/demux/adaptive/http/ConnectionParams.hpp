@@ -27,8 +27,6 @@ namespace adaptive
 {
     namespace http
     {
-        class Transport;
-
         enum RequestStatus
         {
             Success,
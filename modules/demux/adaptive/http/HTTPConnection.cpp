@@ -24,12 +24,16 @@
 #include "HTTPConnection.hpp"
 #include "ConnectionParams.hpp"
 #include "AuthStorage.hpp"
-#include "Transport.hpp"
-#include "../tools/Helper.h"
 
-#include <cstdio>
-#include <sstream>
 #include <vlc_stream.h>
+#include <vlc_block.h>
+
+extern "C"
+{
+    #include "../../../access/http/resource.h"
+    #include "../../../access/http/message.h"
+    #include "../../../access/http/connmgr.h"
+}
 
 using namespace adaptive::http;
 
@@ -65,158 +69,94 @@ const std::string & AbstractConnection::getContentType() const
     return contentType;
 }
 
-HTTPConnection::HTTPConnection(vlc_object_t *p_object_, AuthStorage *auth,
-                               Transport *socket_, const ConnectionParams &proxy, bool persistent)
-    : AbstractConnection( p_object_ )
-{
-    transport = socket_;
-    char *psz_useragent = var_InheritString(p_object_, "http-user-agent");
-    useragent = psz_useragent ? std::string(psz_useragent) : std::string("");
-    free(psz_useragent);
-    for(std::string::iterator it = useragent.begin(); it != useragent.end(); ++it)
-        if(!std::isprint(*it))
-            *it = ' ';
-    queryOk = false;
-    retries = 0;
-    authStorage = auth;
-    connectionClose = !persistent;
-    chunked = false;
-    chunked_eof = false;
-    chunkLength = 0;
-    proxyparams = proxy;
-}
-
-HTTPConnection::~HTTPConnection()
-{
-    delete transport;
-}
-
-bool HTTPConnection::canReuse(const ConnectionParams &params_) const
+const ConnectionParams & AbstractConnection::getRedirection() const
 {
-    if( !available || params_.usesAccess() )
-        return false;
-
-    char *psz_proxy_url = vlc_getProxyUrl(params_.getUrl().c_str());
-    if(psz_proxy_url)
-    {
-        ConnectionParams proxy(psz_proxy_url);
-        free(psz_proxy_url);
-        return (proxyparams.getHostname() == proxy.getHostname() &&
-                proxyparams.getScheme() == proxy.getScheme() &&
-                proxyparams.getPort() == proxy.getPort());
-    }
-    else return (params.getHostname() == params_.getHostname() &&
-                 params.getScheme() == params_.getScheme() &&
-                 params.getPort() == params_.getPort());
+    return locationparams;
 }
 
-bool HTTPConnection::connect()
+StreamUrlConnection::StreamUrlConnection(vlc_object_t *p_object)
+    : AbstractConnection(p_object)
 {
-    if(proxyparams.getHostname().empty())
-        return transport->connect(p_object, params.getHostname().c_str(),
-                                         params.getPort());
-    else
-        return transport->connect(p_object, proxyparams.getHostname().c_str(),
-                                         proxyparams.getPort());
+    p_streamurl = NULL;
+    bytesRead = 0;
+    contentLength = 0;
 }
 
-bool HTTPConnection::connected() const
+StreamUrlConnection::~StreamUrlConnection()
 {
-    return transport->connected();
+    reset();
 }
 
-void HTTPConnection::disconnect()
+void StreamUrlConnection::reset()
 {
-    queryOk = false;
+    if(p_streamurl)
+        vlc_stream_Delete(p_streamurl);
+    p_streamurl = NULL;
     bytesRead = 0;
     contentLength = 0;
-    chunked = false;
-    chunkLength = 0;
-    bytesRange = BytesRange();
     contentType = std::string();
-    transport->disconnect();
+    bytesRange = BytesRange();
+}
+
+bool StreamUrlConnection::canReuse(const ConnectionParams &params) const
+{
+    return available && params.usesAccess();
 }
 
 enum RequestStatus
-    HTTPConnection::request(const std::string &path, const BytesRange &range)
+    StreamUrlConnection::request(const std::string &path, const BytesRange &range)
 {
-    queryOk = false;
-    chunked = false;
-    chunked_eof = false;
-    chunkLength = 0;
+    reset();
 
     /* Set new path for this query */
     params.setPath(path);
-    locationparams = ConnectionParams();
 
     msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
-                       range.isValid() ? range.getStartByte() : 0);
+                      range.isValid() ? range.getStartByte() : 0);
+
+    p_streamurl = vlc_stream_NewURL(p_object, params.getUrl().c_str());
+    if(!p_streamurl)
+        return RequestStatus::GenericError;
 
-    std::string querypath;
-    if(!proxyparams.getHostname().empty())
+    char *psz_type = stream_ContentType(p_streamurl);
+    if(psz_type)
     {
-        msg_Dbg(p_object, "Using proxy %s", proxyparams.getUrl().c_str());
-        querypath = params.getUrl();
+        contentType = std::string(psz_type);
+        free(psz_type);
     }
-    else querypath = path;
 
-    if(!connected() && ( params.getHostname().empty() || !connect() ))
-        return RequestStatus::GenericError;
+    stream_t *p_chain = vlc_stream_FilterNew( p_streamurl, "inflate" );
+    if( p_chain )
+        p_streamurl = p_chain;
 
-    bytesRange = range;
     if(range.isValid() && range.getEndByte() > 0)
-        contentLength = range.getEndByte() - range.getStartByte() + 1;
-
-    std::string header = buildRequestHeader(querypath);
-    if(connectionClose)
-        header.append("Connection: close\r\n");
-    header.append("\r\n");
-
-    if(!send( header ))
     {
-        transport->disconnect();
-        if(!connectionClose)
+        if(vlc_stream_Seek(p_streamurl, range.getStartByte()) != VLC_SUCCESS)
         {
-            /* server closed connection pipeline after last req. need new */
-            connectionClose = true;
-            return request(path, range);
+            vlc_stream_Delete(p_streamurl);
+            return RequestStatus::GenericError;
         }
-        return RequestStatus::GenericError;
+        bytesRange = range;
+        contentLength = range.getEndByte() - range.getStartByte() + 1;
     }
 
-    enum RequestStatus status = parseReply();
-    if(status == RequestStatus::Success)
-    {
-        queryOk = true;
-    }
-    else if(status == RequestStatus::Redirection)
-    {
-        transport->disconnect();
-    }
-    else if(status == RequestStatus::GenericError)
+    int64_t i_size = stream_Size(p_streamurl);
+    if(i_size > -1)
     {
-        transport->disconnect();
-        if(!connectionClose)
-        {
-            connectionClose = true;
-            return request(path, range);
-        }
+        if(!range.isValid() || contentLength > (size_t) i_size)
+            contentLength = (size_t) i_size;
     }
-
-    return status;
+    return RequestStatus::Success;
 }
 
-ssize_t HTTPConnection::read(void *p_buffer, size_t len)
+ssize_t StreamUrlConnection::read(void *p_buffer, size_t len)
 {
-    if( !connected() ||
-       (!queryOk && bytesRead == 0) )
+    if( !p_streamurl )
         return VLC_EGENERIC;
 
     if(len == 0)
         return VLC_SUCCESS;
 
-    queryOk = false;
-
     const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
     if (toRead == 0)
         return VLC_SUCCESS;
@@ -224,323 +164,205 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(len > toRead)
         len = toRead;
 
-    ssize_t ret = ( chunked ) ? readChunk(p_buffer, len)
-                              : transport->read(p_buffer, len);
+    ssize_t ret = vlc_stream_Read(p_streamurl, p_buffer, len);
     if(ret >= 0)
         bytesRead += ret;
 
     if(ret < 0 || (size_t)ret < len || /* set EOF */
-       (contentLength == bytesRead && connectionClose))
+       contentLength == bytesRead )
     {
-        transport->disconnect();
+        reset();
         return ret;
     }
 
     return ret;
 }
 
-bool HTTPConnection::send(const std::string &data)
+void StreamUrlConnection::setUsed( bool b )
 {
-    return send(data.c_str(), data.length());
+    available = !b;
+    if(available && contentLength == bytesRead)
+       reset();
 }
 
-bool HTTPConnection::send(const void *buf, size_t size)
+struct adaptive::http::LibVLCHTTPResource
 {
-    return transport->send(buf, size);
-}
+    struct vlc_http_resource resource;
+    bool ranged;
+    uintmax_t start;
+    uintmax_t end; /* 0 if open-ended */
+};
 
-enum RequestStatus
-    HTTPConnection::parseReply()
+static int LibVLCHTTPRequestFormat(const struct vlc_http_resource *res,
+                                   struct vlc_http_msg *req, void *)
 {
-    std::string statusline = readLine();
-
-    if(statusline.empty())
-        return RequestStatus::GenericError;
-
-    if (statusline.compare(0, 9, "HTTP/1.1 ")!=0)
-    {
-        if(statusline.compare(0, 9, "HTTP/1.0 ")!=0)
-            return RequestStatus::NotFound;
-        else
-            connectionClose = true;
-    }
-
-    std::istringstream ss(statusline.substr(9));
-    ss.imbue(std::locale("C"));
-    int replycode;
-    ss >> replycode;
-
-    std::string lines;
-    for( ;; )
-    {
-        std::string l = readLine();
-        if(l.empty())
-            break;
-        lines.append(l);
-
-        size_t split = lines.find_first_of(':');
-        if(split != std::string::npos)
-        {
-            size_t value = lines.find_first_not_of(' ', split + 1);
-            if(value == std::string::npos)
-                value = lines.length();
-            onHeader(lines.substr(0, split), lines.substr(value));
-            lines = std::string();
-        }
-    }
+    const LibVLCHTTPResource *src = reinterpret_cast<const LibVLCHTTPResource *>(res);
 
-    if((replycode == 301 || replycode == 302 || replycode == 307 || replycode == 308) &&
-       !locationparams.getUrl().empty())
-    {
-        msg_Info(p_object, "%d redirection to %s", replycode, locationparams.getUrl().c_str());
-        return RequestStatus::Redirection;
-    }
-    else if (replycode != 200 && replycode != 206)
-    {
-        msg_Err(p_object, "Failed reading %s: %s", params.getUrl().c_str(), statusline.c_str());
-        return RequestStatus::NotFound;
-    }
-
-    return RequestStatus::Success;
+    vlc_http_msg_add_header(req, "Cache-Control", "no-cache");
+    if(!src->ranged)
+        return 0;
+    if(src->end)
+        return vlc_http_msg_add_header(req, "Range", "bytes=%" PRIuMAX "-%" PRIuMAX,
+                                       src->start, src->end);
+    return vlc_http_msg_add_header(req, "Range", "bytes=%" PRIuMAX "-", src->start);
 }
 
-ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
+static int LibVLCHTTPResponseValidate(const struct vlc_http_resource *res,
+                                      const struct vlc_http_msg *resp, void *)
 {
-    size_t copied = 0;
+    const LibVLCHTTPResource *src = reinterpret_cast<const LibVLCHTTPResource *>(res);
 
-    for( ; copied < len && !chunked_eof; )
+    if(vlc_http_msg_get_status(resp) == 206)
     {
-        /* adapted from access/http/chunked.c */
-        if(chunkLength == 0)
-        {
-            std::string line = readLine();
-            int end;
-            if (std::sscanf(line.c_str(), "%zx%n", &chunkLength, &end) < 1
-                    || (line[end] != '\0' && line[end] != ';' /* ignore extension(s) */))
-                return -1;
-        }
-
-        if(chunkLength > 0)
-        {
-            size_t toread = len - copied;
-            if(toread > chunkLength)
-                toread = chunkLength;
-
-            ssize_t in = transport->read(&((uint8_t*)p_buffer)[copied], toread);
-            if(in < 0)
-            {
-                return (copied == 0) ? in : copied;
-            }
-            else if((size_t)in < toread)
-            {
-               return copied + in;
-            }
-            copied += in;
-            chunkLength -= in;
-        }
-        else chunked_eof = true;
-
-        if(chunkLength == 0)
-        {
-            char crlf[2];
-            ssize_t in = transport->read(&crlf, 2);
-            if(in < 2 || memcmp(crlf, "\r\n", 2))
-                return (copied == 0) ? -1 : copied;
-        }
+        /* multipart/byteranges or another range than requested */
+        const char *str = vlc_http_msg_get_header(resp, "Content-Range");
+        uintmax_t start, end;
+        if(str == NULL ||
+           std::sscanf(str, "bytes %" SCNuMAX "-%" SCNuMAX, &start, &end) != 2 ||
+           start != src->start)
+            return -1;
     }
-
-    return copied;
+    return 0;
 }
 
-std::string HTTPConnection::readLine()
+static const struct vlc_http_resource_cbs libvlchttp_callbacks =
 {
-    return transport->readline();
-}
-
-void HTTPConnection::setUsed( bool b )
-{
-    available = !b;
-    if(available)
-    {
-        if(!connectionClose && contentLength == bytesRead && (!chunked || chunked_eof))
-        {
-            queryOk = false;
-            bytesRead = 0;
-            contentLength = 0;
-            bytesRange = BytesRange();
-        }
-        else  /* We can't resend request if we haven't finished reading */
-            disconnect();
-    }
-}
+    LibVLCHTTPRequestFormat,
+    LibVLCHTTPResponseValidate,
+};
 
-void HTTPConnection::onHeader(const std::string &key,
-                              const std::string &value)
+LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object_,
+                                           struct vlc_http_mgr *mgr)
+    : AbstractConnection(p_object_)
 {
-    if(Helper::icaseEquals(key, "Content-Length"))
+    http_mgr = mgr;
+    source = NULL;
+    p_block = NULL;
+    char *psz = var_InheritString(p_object_, "http-user-agent");
+    if(psz)
     {
-        std::istringstream ss(value);
-        ss.imbue(std::locale("C"));
-        size_t length;
-        ss >> length;
-        contentLength = length;
+        useragent = std::string(psz);
+        free(psz);
     }
-    else if (Helper::icaseEquals(key, "Connection") &&
-             Helper::icaseEquals(value, "close"))
+    psz = var_InheritString(p_object_, "http-referrer");
+    if(psz)
     {
-        connectionClose = true;
-    }
-    else if (Helper::icaseEquals(key, "Transfer-Encoding") &&
-             Helper::icaseEquals(value, "chunked"))
-    {
-        chunked = true;
-    }
-    else if(Helper::icaseEquals(key, "Content-Type"))
-    {
-        contentType = value;
-    }
-    else if(Helper::icaseEquals(key, "Location"))
-    {
-        locationparams = ConnectionParams();
-        ConnectionParams loc = ConnectionParams( value );
-        if(loc.getScheme().empty())
-        {
-            locationparams = params;
-            locationparams.setPath(loc.getPath());
-        }
-        else locationparams = loc;
-    }
-    else if(Helper::icaseEquals(key, "Set-Cookie") && authStorage)
-    {
-        authStorage->addCookie( value, params );
+        referer = std::string(psz);
+        free(psz);
     }
 }
 
-std::string HTTPConnection::buildRequestHeader(const std::string &path) const
+LibVLCHTTPConnection::~LibVLCHTTPConnection()
 {
-    std::stringstream req;
-    req.imbue(std::locale("C"));
-    req << "GET " << path << " HTTP/1.1\r\n";
-    if((params.getScheme() == "http" && params.getPort() != 80) ||
-            (params.getScheme() == "https" && params.getPort() != 443))
-    {
-        req << "Host: " << params.getHostname() << ":" << params.getPort() << "\r\n";
-    }
-    else
-    {
-        req << "Host: " << params.getHostname() << "\r\n";
-    }
-    if(authStorage)
-    {
-        std::string cookie = authStorage->getCookie(params,
-                                                    params.getScheme() == "https" ||
-                                                    params.getPort() == 443);
-        if(!cookie.empty())
-            req << "Cookie: " << cookie << "\r\n";
-    }
-    req << "Cache-Control: no-cache" << "\r\n" <<
-           "User-Agent: " << useragent << "\r\n";
-    req << extraRequestHeaders();
-    return req.str();
+    reset();
 }
 
-std::string HTTPConnection::extraRequestHeaders() const
+void LibVLCHTTPConnection::reset()
 {
-    std::stringstream ss;
-    ss.imbue(std::locale("C"));
-    if(bytesRange.isValid())
+    if(p_block)
     {
-        ss << "Range: bytes=" << bytesRange.getStartByte() << "-";
-        if(bytesRange.getEndByte())
-            ss << bytesRange.getEndByte();
-        ss << "\r\n";
+        block_Release(p_block);
+        p_block = NULL;
+    }
+    if(source)
+    {
+        vlc_http_res_destroy(&source->resource);
+        source = NULL;
     }
-    return ss.str();
-}
-
-const ConnectionParams & HTTPConnection::getRedirection() const
-{
-    return locationparams;
-}
-
-StreamUrlConnection::StreamUrlConnection(vlc_object_t *p_object)
-    : AbstractConnection(p_object)
-{
-    p_streamurl = NULL;
-    bytesRead = 0;
-    contentLength = 0;
-}
-
-StreamUrlConnection::~StreamUrlConnection()
-{
-    reset();
-}
-
-void StreamUrlConnection::reset()
-{
-    if(p_streamurl)
-        vlc_stream_Delete(p_streamurl);
-    p_streamurl = NULL;
     bytesRead = 0;
     contentLength = 0;
     contentType = std::string();
     bytesRange = BytesRange();
 }
 
-bool StreamUrlConnection::canReuse(const ConnectionParams &params) const
+bool LibVLCHTTPConnection::canReuse(const ConnectionParams &params_) const
 {
-    return available && params.usesAccess();
+    return available && !params_.usesAccess() &&
+           (params_.getScheme() == "http" || params_.getScheme() == "https");
 }
 
 enum RequestStatus
-    StreamUrlConnection::request(const std::string &path, const BytesRange &range)
+    LibVLCHTTPConnection::request(const std::string &path, const BytesRange &range)
 {
     reset();
 
     /* Set new path for this query */
     params.setPath(path);
+    locationparams = ConnectionParams();
 
     msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
-                      range.isValid() ? range.getStartByte() : 0);
+                       range.isValid() ? range.getStartByte() : 0);
 
-    p_streamurl = vlc_stream_NewURL(p_object, params.getUrl().c_str());
-    if(!p_streamurl)
+    source = static_cast<LibVLCHTTPResource *>(malloc(sizeof(*source)));
+    if(unlikely(!source))
         return RequestStatus::GenericError;
 
-    char *psz_type = stream_ContentType(p_streamurl);
-    if(psz_type)
+    if(vlc_http_res_init(&source->resource, &libvlchttp_callbacks, http_mgr,
+                         params.getUrl().c_str(),
+                         useragent.empty() ? NULL : useragent.c_str(),
+                         referer.empty() ? NULL : referer.c_str()))
     {
-        contentType = std::string(psz_type);
-        free(psz_type);
+        free(source);
+        source = NULL;
+        return RequestStatus::GenericError;
     }
 
-    stream_t *p_chain = vlc_stream_FilterNew( p_streamurl, "inflate" );
-    if( p_chain )
-        p_streamurl = p_chain;
+    source->ranged = range.isValid();
+    source->start = source->ranged ? range.getStartByte() : 0;
+    source->end = source->ranged ? range.getEndByte() : 0;
 
-    if(range.isValid() && range.getEndByte() > 0)
+    /* Blocks until the response header is received. The connection, and
+     * the HTTP/2 session if any, are shared with the other requests. */
+    int status = vlc_http_res_get_status(&source->resource);
+    if(status < 0)
     {
-        if(vlc_stream_Seek(p_streamurl, range.getStartByte()) != VLC_SUCCESS)
-        {
-            vlc_stream_Delete(p_streamurl);
-            return RequestStatus::GenericError;
-        }
-        bytesRange = range;
-        contentLength = range.getEndByte() - range.getStartByte() + 1;
+        reset();
+        return RequestStatus::GenericError;
     }
 
-    int64_t i_size = stream_Size(p_streamurl);
-    if(i_size > -1)
+    if(status / 100 == 3)
     {
-        if(!range.isValid() || contentLength > (size_t) i_size)
-            contentLength = (size_t) i_size;
+        char *psz_location = vlc_http_res_get_redirect(&source->resource);
+        reset();
+        if(!psz_location)
+            return RequestStatus::NotFound;
+        msg_Info(p_object, "%d redirection to %s", status, psz_location);
+        locationparams = ConnectionParams(psz_location);
+        free(psz_location);
+        return RequestStatus::Redirection;
+    }
+    else if(status == 401)
+    {
+        reset();
+        return RequestStatus::Unauthorized;
+    }
+    else if(status != 200 && status != 206)
+    {
+        msg_Err(p_object, "Failed reading %s: %d", params.getUrl().c_str(), status);
+        reset();
+        return RequestStatus::NotFound;
+    }
+
+    char *psz_type = vlc_http_res_get_type(&source->resource);
+    if(psz_type)
+    {
+        contentType = std::string(psz_type);
+        free(psz_type);
     }
+
+    bytesRange = range;
+    uintmax_t size = vlc_http_msg_get_size(source->resource.response);
+    if(size != UINTMAX_MAX)
+        contentLength = size;
+    else if(range.isValid() && range.getEndByte() > 0)
+        contentLength = range.getEndByte() - range.getStartByte() + 1;
+
     return RequestStatus::Success;
 }
 
-ssize_t StreamUrlConnection::read(void *p_buffer, size_t len)
+ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
 {
-    if( !p_streamurl )
+    if(!source)
         return VLC_EGENERIC;
 
     if(len == 0)
@@ -553,70 +375,74 @@ ssize_t StreamUrlConnection::read(void *p_buffer, size_t len)
     if(len > toRead)
         len = toRead;
 
-    ssize_t ret = vlc_stream_Read(p_streamurl, p_buffer, len);
-    if(ret >= 0)
-        bytesRead += ret;
-
-    if(ret < 0 || (size_t)ret < len || /* set EOF */
-       contentLength == bytesRead )
+    size_t copied = 0;
+    while(copied < len)
     {
-        reset();
-        return ret;
+        if(!p_block)
+        {
+            p_block = vlc_http_res_read(&source->resource);
+            if(p_block == vlc_http_error)
+            {
+                p_block = NULL;
+                if(copied == 0)
+                    return VLC_EGENERIC;
+                break;
+            }
+            if(!p_block) /* end of stream */
+                break;
+        }
+
+        size_t size = __MIN(len - copied, p_block->i_buffer);
+        memcpy(&static_cast<uint8_t *>(p_buffer)[copied], p_block->p_buffer, size);
+        copied += size;
+        p_block->p_buffer += size;
+        p_block->i_buffer -= size;
+        if(p_block->i_buffer == 0)
+        {
+            block_Release(p_block);
+            p_block = NULL;
+        }
     }
 
-    return ret;
+    bytesRead += copied;
+    return copied;
 }
 
-void StreamUrlConnection::setUsed( bool b )
+void LibVLCHTTPConnection::setUsed( bool b )
 {
     available = !b;
-    if(available && contentLength == bytesRead)
-       reset();
+    /* Unread data is discarded: on HTTP/2, only that stream is reset */
+    if(available)
+        reset();
 }
 
-NativeConnectionFactory::NativeConnectionFactory( AuthStorage *auth )
+LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory( AuthStorage *auth )
     : AbstractConnectionFactory()
 {
     authStorage = auth;
+    http_mgr = NULL;
 }
 
-NativeConnectionFactory::~NativeConnectionFactory()
+LibVLCHTTPConnectionFactory::~LibVLCHTTPConnectionFactory()
 {
+    if(http_mgr)
+        vlc_http_mgr_destroy(http_mgr);
 }
 
-AbstractConnection * NativeConnectionFactory::createConnection(vlc_object_t *p_object,
-                                                         const ConnectionParams &params)
+AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t *p_object,
+                                                                   const ConnectionParams &params)
 {
     if((params.getScheme() != "http" && params.getScheme() != "https") || params.getHostname().empty())
         return NULL;
 
-    ConnectionParams proxy;
-
-    std::string scheme;
-    char *psz_proxy_url = vlc_getProxyUrl(params.getUrl().c_str());
-    if(psz_proxy_url)
-    {
-        proxy = ConnectionParams(psz_proxy_url);
-        free(psz_proxy_url);
-        scheme = proxy.getScheme();
-    }
-    else scheme = params.getScheme();
-
-    const bool b_secure = (params.getScheme() == "https");
-    Transport *socket = new (std::nothrow) Transport(b_secure);
-    if(!socket)
-        return NULL;
-
-    /* disable pipelined tls until we have ticket/resume session support */
-    HTTPConnection *conn = new (std::nothrow)
-            HTTPConnection(p_object, authStorage, socket, proxy, !b_secure);
-    if(!conn)
+    if(!http_mgr)
     {
-        delete socket;
-        return NULL;
+        http_mgr = vlc_http_mgr_create(p_object, authStorage ? authStorage->getJar() : NULL);
+        if(!http_mgr)
+            return NULL;
     }
 
-    return conn;
+    return new (std::nothrow) LibVLCHTTPConnection(p_object, http_mgr);
 }
 
 StreamUrlConnectionFactory::StreamUrlConnectionFactory()
@@ -633,13 +459,13 @@ AbstractConnection * StreamUrlConnectionFactory::createConnection(vlc_object_t *
 
 ConnectionFactory::ConnectionFactory( AuthStorage *authstorage )
 {
-    native = new NativeConnectionFactory( authstorage );
+    libvlchttp = new LibVLCHTTPConnectionFactory( authstorage );
     streamurl = new StreamUrlConnectionFactory();
 }
 
 ConnectionFactory::~ConnectionFactory()
 {
-    delete native;
+    delete libvlchttp;
     delete streamurl;
 }
 
@@ -649,7 +475,7 @@ AbstractConnection * ConnectionFactory::createConnection(vlc_object_t *p_object,
     bool b_streamurl = var_InheritBool(p_object, "adaptive-use-access");
     if(!b_streamurl && !params.usesAccess())
     {
-        return native->createConnection(p_object, params);
+        return libvlchttp->createConnection(p_object, params);
     }
     else
     {
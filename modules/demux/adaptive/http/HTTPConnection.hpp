@@ -30,11 +30,12 @@
 #include <vlc_common.h>
 #include <string>
 
+struct vlc_http_mgr;
+
 namespace adaptive
 {
     namespace http
     {
-        class Transport;
         class AuthStorage;
 
         class AbstractConnection
@@ -53,10 +54,13 @@ namespace adaptive
                 virtual size_t  getContentLength() const;
                 virtual const std::string & getContentType() const;
                 virtual void    setUsed( bool ) = 0;
+                const ConnectionParams &getRedirection() const;
+                static const unsigned MAX_REDIRECTS = 3;
 
             protected:
                 vlc_object_t      *p_object;
                 ConnectionParams   params;
+                ConnectionParams   locationparams;
                 bool               available;
                 size_t             contentLength;
                 std::string        contentType;
@@ -64,59 +68,35 @@ namespace adaptive
                 size_t             bytesRead;
         };
 
-        class HTTPConnection : public AbstractConnection
-        {
+       class StreamUrlConnection : public AbstractConnection
+       {
             public:
-                HTTPConnection(vlc_object_t *, AuthStorage *,  Transport *,
-                               const ConnectionParams &, bool = false);
-                virtual ~HTTPConnection();
+                StreamUrlConnection(vlc_object_t *);
+                virtual ~StreamUrlConnection();
 
                 virtual bool    canReuse     (const ConnectionParams &) const;
+
                 virtual enum RequestStatus
                                 request     (const std::string& path, const BytesRange & = BytesRange());
                 virtual ssize_t read        (void *p_buffer, size_t len);
 
-                void setUsed( bool );
-                const ConnectionParams &getRedirection() const;
-                static const unsigned MAX_REDIRECTS = 3;
+                virtual void    setUsed( bool );
 
             protected:
-                virtual bool    connected   () const;
-                virtual bool    connect     ();
-                virtual void    disconnect  ();
-                virtual bool    send        (const void *buf, size_t size);
-                virtual bool    send        (const std::string &data);
-
-                virtual void    onHeader    (const std::string &line,
-                                             const std::string &value);
-                virtual std::string extraRequestHeaders() const;
-                virtual std::string buildRequestHeader(const std::string &path) const;
-
-                ssize_t         readChunk   (void *p_buffer, size_t len);
-                enum RequestStatus parseReply();
-                std::string readLine();
-                std::string useragent;
-
-                AuthStorage        *authStorage;
-                ConnectionParams    locationparams;
-                ConnectionParams    proxyparams;
-                bool                connectionClose;
-                bool                chunked;
-                bool                chunked_eof;
-                size_t              chunkLength;
-                bool                queryOk;
-                int                 retries;
-                static const int    retryCount = 5;
-
-            private:
-                Transport *transport;
+                void reset();
+                stream_t *p_streamurl;
        };
 
-       class StreamUrlConnection : public AbstractConnection
+       struct LibVLCHTTPResource;
+
+       /* Uses the HTTP stack of the http access module: requests to the same
+        * origin share its connections, and are multiplexed over HTTP/2 when
+        * the server supports it */
+       class LibVLCHTTPConnection : public AbstractConnection
        {
             public:
-                StreamUrlConnection(vlc_object_t *);
-                virtual ~StreamUrlConnection();
+                LibVLCHTTPConnection(vlc_object_t *, struct vlc_http_mgr *);
+                virtual ~LibVLCHTTPConnection();
 
                 virtual bool    canReuse     (const ConnectionParams &) const;
 
@@ -128,7 +108,11 @@ namespace adaptive
 
             protected:
                 void reset();
-                stream_t *p_streamurl;
+                struct vlc_http_mgr *http_mgr;
+                LibVLCHTTPResource *source;
+                block_t *p_block;
+                std::string useragent;
+                std::string referer;
        };
 
        class AbstractConnectionFactory
@@ -139,14 +123,15 @@ namespace adaptive
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &) = 0;
        };
 
-       class NativeConnectionFactory : public AbstractConnectionFactory
+       class LibVLCHTTPConnectionFactory : public AbstractConnectionFactory
        {
            public:
-               NativeConnectionFactory( AuthStorage * );
-               virtual ~NativeConnectionFactory();
+               LibVLCHTTPConnectionFactory( AuthStorage * );
+               virtual ~LibVLCHTTPConnectionFactory();
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
            private:
                AuthStorage *authStorage;
+               struct vlc_http_mgr *http_mgr; /* shared by all the connections */
        };
 
        class StreamUrlConnectionFactory : public AbstractConnectionFactory
@@ -164,7 +149,7 @@ namespace adaptive
                virtual ~ConnectionFactory();
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
            private:
-               NativeConnectionFactory *native;
+               LibVLCHTTPConnectionFactory *libvlchttp;
                StreamUrlConnectionFactory *streamurl;
        };
     }
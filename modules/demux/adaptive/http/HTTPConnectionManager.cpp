@@ -28,7 +28,6 @@
 #include "HTTPConnectionManager.h"
 #include "HTTPConnection.hpp"
 #include "ConnectionParams.hpp"
-#include "Transport.hpp"
 #include "Downloader.hpp"
 #include <vlc_url.h>
 #include <vlc_http.h>
@@ -63,8 +62,10 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthSt
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    unsigned workers = var_InheritInteger(p_object, "adaptive-download-workers");
+    downloader = new (std::nothrow) Downloader(workers);
+    if(downloader)
+        downloader->start();
     factory = new ConnectionFactory(storage);
 }
 
@@ -31,7 +31,54 @@
 
 using namespace adaptive::logic;
 
-AbstractAdaptationLogic::AbstractAdaptationLogic    (vlc_object_t *obj)
+DownloadRateMeter::DownloadRateMeter(vlc_tick_t window_)
+{
+    window = window_;
+    dlsize = 0;
+    dllength = 0;
+    dlend = 0;
+    vlc_mutex_init(&lock);
+}
+
+DownloadRateMeter::~DownloadRateMeter()
+{
+    vlc_mutex_destroy(&lock);
+}
+
+size_t DownloadRateMeter::push(size_t size, vlc_tick_t time, vlc_tick_t now)
+{
+    size_t bps = 0;
+
+    if(unlikely(time <= 0))
+        return 0;
+
+    vlc_mutex_lock(&lock);
+
+    /* Only account the part of this download period not already covered
+     * by a previous one */
+    const vlc_tick_t start = now - time;
+    if(start >= dlend)
+        dllength += time;
+    else if(now > dlend)
+        dllength += now - dlend;
+    if(now > dlend)
+        dlend = now;
+
+    /* Accumulate up to observation window */
+    dlsize += size;
+
+    if(dllength > 0 && dllength >= window)
+    {
+        bps = CLOCK_FREQ * dlsize * 8 / dllength;
+        dlsize = dllength = 0;
+    }
+
+    vlc_mutex_unlock(&lock);
+    return bps;
+}
+
+AbstractAdaptationLogic::AbstractAdaptationLogic    (vlc_object_t *obj) :
+                         rateMeter(VLC_TICK_FROM_MS(250))
 {
     p_obj = obj;
     maxwidth = std::numeric_limits<int>::max();
@@ -46,6 +93,11 @@ void AbstractAdaptationLogic::updateDownloadRate    (const adaptive::ID &, size_
 {
 }
 
+size_t AbstractAdaptationLogic::measureDownloadRate(size_t size, vlc_tick_t time)
+{
+    return rateMeter.push(size, time, vlc_tick_now());
+}
+
 void AbstractAdaptationLogic::setMaxDeviceResolution (int w, int h)
 {
     maxwidth = (w > 0) ? w : std::numeric_limits<int>::max();
@@ -40,6 +40,27 @@ namespace adaptive
     {
         using namespace playlist;
 
+        /* Measures the link bandwidth over the union of the download
+         * periods: with several download workers, chunks overlap and share
+         * the link, so their individual rates would be too low. */
+        class DownloadRateMeter
+        {
+            public:
+                DownloadRateMeter(vlc_tick_t);
+                ~DownloadRateMeter();
+                /* Accounts size bytes downloaded in time, ending at now.
+                 * Returns the bandwidth in bps once the active periods cover
+                 * the observation window, 0 otherwise. */
+                size_t push(size_t size, vlc_tick_t time, vlc_tick_t now);
+
+            private:
+                vlc_tick_t  window;
+                size_t      dlsize;
+                vlc_tick_t  dllength;
+                vlc_tick_t  dlend;
+                vlc_mutex_t lock;
+        };
+
         class AbstractAdaptationLogic : public IDownloadRateObserver,
                                         public SegmentTrackerListenerInterface
         {
@@ -64,9 +85,14 @@ namespace adaptive
                 };
 
             protected:
+                size_t measureDownloadRate(size_t, vlc_tick_t);
+
                 vlc_object_t *p_obj;
                 int maxwidth;
                 int maxheight;
+
+            private:
+                DownloadRateMeter rateMeter;
         };
     }
 }
@@ -179,12 +179,16 @@ unsigned NearOptimalAdaptationLogic::getMaxCurrentBw() const
 
 void NearOptimalAdaptationLogic::updateDownloadRate(const ID &id, size_t dlsize, vlc_tick_t time)
 {
+    const unsigned bps = measureDownloadRate(dlsize, time);
+    if(bps == 0)
+        return;
+
     vlc_mutex_lock(&lock);
     std::map<ID, NearOptimalContext>::iterator it = streams.find(id);
     if(it != streams.end())
     {
         NearOptimalContext &ctx = (*it).second;
-        ctx.last_download_rate = ctx.average.push(CLOCK_FREQ * dlsize * 8 / time);
+        ctx.last_download_rate = ctx.average.push(bps);
     }
     currentBps = getMaxCurrentBw();
     vlc_mutex_unlock(&lock);
@@ -154,12 +154,16 @@ BaseRepresentation *PredictiveAdaptationLogic::getNextRepresentation(BaseAdaptat
 
 void PredictiveAdaptationLogic::updateDownloadRate(const ID &id, size_t dlsize, vlc_tick_t time)
 {
+    const unsigned bps = measureDownloadRate(dlsize, time);
+    if(bps == 0)
+        return;
+
     vlc_mutex_lock(&lock);
     std::map<ID, PredictiveStats>::iterator it = streams.find(id);
     if(it != streams.end())
     {
         PredictiveStats &stats = (*it).second;
-        stats.last_download_rate = stats.average.push(CLOCK_FREQ * dlsize * 8 / time);
+        stats.last_download_rate = stats.average.push(bps);
     }
     vlc_mutex_unlock(&lock);
 }
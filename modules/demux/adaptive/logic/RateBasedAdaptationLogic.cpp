@@ -42,8 +42,6 @@ RateBasedAdaptationLogic::RateBasedAdaptationLogic  (vlc_object_t *obj) :
                           currentBps(0)
 {
     usedBps = 0;
-    dllength = 0;
-    dlsize = 0;
     vlc_mutex_init(&lock);
 }
 
@@ -79,16 +77,9 @@ BaseRepresentation *RateBasedAdaptationLogic::getNextRepresentation(BaseAdaptati
 
 void RateBasedAdaptationLogic::updateDownloadRate(const ID &, size_t size, vlc_tick_t time)
 {
-    if(unlikely(time == 0))
+    const size_t bps = measureDownloadRate(size, time);
+    if(bps == 0)
         return;
-    /* Accumulate up to observation window */
-    dllength += time;
-    dlsize += size;
-
-    if(dllength < VLC_TICK_FROM_MS(250))
-        return;
-
-    const size_t bps = CLOCK_FREQ * dlsize * 8 / dllength;
 
     vlc_mutex_lock(&lock);
     bpsAvg = average.push(bps);
@@ -99,7 +90,6 @@ void RateBasedAdaptationLogic::updateDownloadRate(const ID &, size_t size, vlc_t
                             bps / 8000, bpsAvg / 8000));
 
     currentBps = bpsAvg * 3/4;
-    dlsize = dllength = 0;
 
     BwDebug(msg_Info(p_obj, "Current bandwidth %zu KiB/s using %u%%",
                     (bpsAvg / 8000), (bpsAvg) ? (unsigned)(usedBps * 100.0 / bpsAvg) : 0));
@@ -50,9 +50,6 @@ namespace adaptive
 
                 MovingAverage<size_t>   average;
 
-                size_t                  dlsize;
-                vlc_tick_t              dllength;
-
                 mutable vlc_mutex_t     lock;
         };
 
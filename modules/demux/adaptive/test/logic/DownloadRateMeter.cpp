@@ -0,0 +1,119 @@
+/*****************************************************************************
+ * DownloadRateMeter.cpp: adaptive bandwidth measurement test
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include "../../logic/AbstractAdaptationLogic.h"
+
+#include <vlc_threads.h>
+
+#include <cassert>
+
+using namespace adaptive::logic;
+
+#define MBIT (1000000 / 8)
+
+/* Sequential downloads: the rate of each one */
+static void TestSequential()
+{
+    DownloadRateMeter meter(0);
+
+    for(vlc_tick_t now = VLC_TICK_FROM_SEC(1); now <= VLC_TICK_FROM_SEC(10);
+        now += VLC_TICK_FROM_SEC(1))
+        assert(meter.push(2 * MBIT, VLC_TICK_FROM_SEC(1), now) == 2000000);
+
+    /* with idle time in between */
+    assert(meter.push(MBIT, VLC_TICK_FROM_MS(500),
+                      VLC_TICK_FROM_SEC(20)) == 2000000);
+}
+
+/* Downloads sharing the link: the total over the union of their periods */
+static void TestOverlapping()
+{
+    DownloadRateMeter meter(VLC_TICK_FROM_SEC(2));
+
+    /* 3 workers downloading 1 Mbit each over [0, 1] s */
+    for(int i = 0; i < 3; i++)
+        assert(meter.push(MBIT, VLC_TICK_FROM_SEC(1),
+                          VLC_TICK_FROM_SEC(1)) == 0);
+    /* then staggered downloads over [0.5, 1.5], [1.0, 1.9] and [1.4, 2.0] */
+    assert(meter.push(MBIT, VLC_TICK_FROM_SEC(1),
+                      VLC_TICK_FROM_MS(1500)) == 0);
+    assert(meter.push(MBIT, VLC_TICK_FROM_MS(900),
+                      VLC_TICK_FROM_MS(1900)) == 0);
+    /* 6 Mbit over 2 s, not over the 4.5 s of the summed periods */
+    assert(meter.push(MBIT, VLC_TICK_FROM_MS(600),
+                      VLC_TICK_FROM_SEC(2)) == 3000000);
+
+    /* the next window starts afresh */
+    assert(meter.push(MBIT, VLC_TICK_FROM_SEC(2),
+                      VLC_TICK_FROM_SEC(4)) == 500000);
+}
+
+struct worker
+{
+    DownloadRateMeter *meter;
+    size_t result;
+};
+
+static void *Run(void *data)
+{
+    struct worker *w = static_cast<struct worker *>(data);
+    w->result = w->meter->push(MBIT, VLC_TICK_FROM_SEC(1),
+                               VLC_TICK_FROM_SEC(1));
+    return NULL;
+}
+
+/* Concurrent reports from download threads, in any order */
+static void TestConcurrent()
+{
+    DownloadRateMeter meter(VLC_TICK_FROM_SEC(2));
+    struct worker workers[4];
+    vlc_thread_t threads[4];
+
+    /* each worker downloads 1 Mbit over [0, 1] s */
+    for(int i = 0; i < 4; i++)
+    {
+        workers[i].meter = &meter;
+        workers[i].result = 0;
+        assert(vlc_clone(&threads[i], Run, &workers[i],
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+    }
+    for(int i = 0; i < 4; i++)
+    {
+        vlc_join(threads[i], NULL);
+        assert(workers[i].result == 0);
+    }
+
+    /* 1 more Mbit over [1, 2] s: 5 Mbit over 2 s */
+    assert(meter.push(MBIT, VLC_TICK_FROM_SEC(1),
+                      VLC_TICK_FROM_SEC(2)) == 2500000);
+}
+
+int main()
+{
+    TestSequential();
+    TestOverlapping();
+    TestConcurrent();
+    return 0;
+}
@@ -27,6 +27,7 @@
 #include "util.hpp"
 #include "Ebml_parser.hpp"
 #include "Ebml_dispatcher.hpp"
+#include "stream_io_callback.hpp"
 
 #include <new>
 #include <iterator>
@@ -62,11 +63,14 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep( EbmlParser(&estream, p_seg, &demuxer.demuxer ))
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,p_indexer(NULL)
 {
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    delete p_indexer;
+
     free( psz_writing_application );
     free( psz_muxing_application );
     free( psz_segment_filename );
@@ -686,11 +690,43 @@ bool matroska_segment_c::Preload( )
     b_preloaded = true;
 
     if( cluster )
+    {
         EnsureDuration();
+        StartIndexer();
+    }
 
     return true;
 }
 
+void matroska_segment_c::StartIndexer()
+{
+    if( !sys.b_fastseekable || sys.demuxer.b_preparsing ||
+        !var_InheritBool( &sys.demuxer, "mkv-background-index" ) )
+        return;
+
+    // Cues are enough as long as they point at least every 10s
+    if( b_cues )
+    {
+        if( priority_tracks.empty() || i_duration <= 0 )
+            return;
+
+        SegmentSeeker::tracks_seekpoints_t::const_iterator it =
+            _seeker._tracks_seekpoints.find( priority_tracks[0] );
+        if( it != _seeker._tracks_seekpoints.end() &&
+            vlc_tick_t( it->second.size() ) * VLC_TICK_FROM_SEC(10) >= i_duration )
+            return;
+    }
+
+    stream_t *s = static_cast<vlc_stream_io_callback &>( es.I_O() ).GetStream();
+
+    p_indexer = new (std::nothrow) SegmentIndexer( *this, s, cluster->GetElementPosition() );
+    if( p_indexer && !p_indexer->Start() )
+    {
+        delete p_indexer;
+        p_indexer = NULL;
+    }
+}
+
 /* Here we try to load elements that were found in Seek Heads, but not yet parsed */
 bool matroska_segment_c::LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int64_t i_element_position )
 {
@@ -836,6 +872,9 @@ bool matroska_segment_c::Seek( demux_t &demuxer, vlc_tick_t i_absolute_mk_date,
 
     // find appropriate seekpoints //
 
+    if( p_indexer )
+        p_indexer->Merge( _seeker );
+
     try {
         seekpoints = _seeker.get_seekpoints( *this, i_mk_date, priority, selected_tracks );
     }
@@ -27,6 +27,7 @@
 #include "demux.hpp"
 #include "mkv.hpp"
 #include "matroska_segment_seeker.hpp"
+#include "matroska_segment_indexer.hpp"
 #include <vector>
 #include <string>
 
@@ -172,8 +173,10 @@ private:
     bool TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
     void EnsureDuration();
+    void StartIndexer();
 
     SegmentSeeker _seeker;
+    SegmentIndexer *p_indexer;
 
     friend SegmentSeeker;
 };
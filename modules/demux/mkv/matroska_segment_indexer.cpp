@@ -0,0 +1,457 @@
+/*****************************************************************************
+ * matroska_segment_indexer.cpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "matroska_segment_indexer.hpp"
+#include "matroska_segment.hpp"
+#include "demux.hpp"
+#include "stream_io_callback.hpp"
+
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_url.h>
+#include <vlc_configuration.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <sys/stat.h>
+
+/* keyframes of a track closer than this are not worth an index entry */
+#define INDEX_MIN_DISTANCE  VLC_TICK_FROM_MS(500)
+
+#define INDEX_MAGIC         "VLCMKIDX"
+#define INDEX_VERSION       1
+#define INDEX_HEADER_SIZE   (8 + 4 + 8 * 4 + 4 + 4)
+#define INDEX_CLUSTER_SIZE  (8 * 4)
+#define INDEX_SEEKPOINT_SIZE (4 + 8 + 8)
+
+namespace mkv {
+
+SegmentIndexer::SegmentIndexer( matroska_segment_c & ms, stream_t *s, fptr_t i_first_cluster_ )
+    : demuxer( ms.sys.demuxer )
+    , url( s->psz_url ? s->psz_url : "" )
+    , i_stream_size( stream_Size( s ) )
+    , i_segment_pos( ms.segment->GetElementPosition() )
+    , i_first_cluster( i_first_cluster_ )
+    , i_timescale( ms.i_timescale )
+    , b_thread( false )
+    , b_abort( false )
+    , i_indexed_end( i_first_cluster_ )
+    , i_merged_clusters( 0 )
+    , i_merged_seekpoints( 0 )
+    , i_merged_end( i_first_cluster_ )
+{
+    vlc_mutex_init( &lock );
+
+    for( matroska_segment_c::tracks_map_t::const_iterator it = ms.tracks.begin();
+         it != ms.tracks.end(); ++it )
+        tracks.push_back( it->first );
+
+    if( url.empty() || !var_InheritBool( &demuxer, "mkv-index-cache" ) )
+        return;
+
+    /* the file identity: where it is, its size and last modification */
+    struct md5_s md5;
+    uint8_t identity[24];
+    time_t i_mtime = 0;
+
+    char *psz_path = vlc_uri2path( url.c_str() );
+    struct stat st;
+    if( psz_path && vlc_stat( psz_path, &st ) == 0 )
+        i_mtime = st.st_mtime;
+    free( psz_path );
+
+    SetQWBE( &identity[0], i_stream_size );
+    SetQWBE( &identity[8], i_segment_pos );
+    SetQWBE( &identity[16], i_mtime );
+
+    InitMD5( &md5 );
+    AddMD5( &md5, url.c_str(), url.length() );
+    AddMD5( &md5, identity, sizeof(identity) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_hash && psz_cachedir )
+        cache_path = std::string( psz_cachedir ) + DIR_SEP "mkv" DIR_SEP + psz_hash;
+    free( psz_cachedir );
+    free( psz_hash );
+}
+
+SegmentIndexer::~SegmentIndexer()
+{
+    if( b_thread )
+    {
+        b_abort = true;
+        vlc_join( thread, NULL );
+    }
+    vlc_mutex_destroy( &lock );
+}
+
+bool SegmentIndexer::Start()
+{
+    if( !cache_path.empty() && Load() )
+        return true;
+
+    if( vlc_clone( &thread, Run, this, VLC_THREAD_PRIORITY_LOW ) )
+        return false;
+    b_thread = true;
+    return true;
+}
+
+void SegmentIndexer::Merge( SegmentSeeker & seeker )
+{
+    vlc_mutex_lock( &lock );
+
+    for( ; i_merged_clusters < clusters.size(); i_merged_clusters++ )
+        seeker.add_cluster( clusters[i_merged_clusters] );
+
+    for( ; i_merged_seekpoints < seekpoints.size(); i_merged_seekpoints++ )
+    {
+        TrackSeekpoint const& tsp = seekpoints[i_merged_seekpoints];
+        seeker.add_seekpoint( tsp.track_id, tsp.seekpoint );
+    }
+
+    /* nothing left to discover there, do not scan it again */
+    if( i_indexed_end > i_merged_end )
+    {
+        seeker.mark_range_as_searched( SegmentSeeker::Range( i_first_cluster, i_indexed_end ) );
+        i_merged_end = i_indexed_end;
+    }
+
+    vlc_mutex_unlock( &lock );
+}
+
+void *SegmentIndexer::Run( void *data )
+{
+    SegmentIndexer *p_indexer = static_cast<SegmentIndexer *>( data );
+
+    stream_t *s = vlc_stream_NewURL( &p_indexer->demuxer, p_indexer->url.c_str() );
+    if( s == NULL )
+        return NULL;
+
+    vlc_tick_t i_start = vlc_tick_now();
+    bool b_done = p_indexer->Index( s );
+    vlc_stream_Delete( s );
+
+    if( !b_done )
+        return NULL;
+
+    msg_Dbg( &p_indexer->demuxer, "indexed %zu clusters, %zu seekpoints in %" PRId64 " ms",
+             p_indexer->clusters.size(), p_indexer->seekpoints.size(),
+             MS_FROM_VLC_TICK( vlc_tick_now() - i_start ) );
+
+    if( !p_indexer->cache_path.empty() )
+        p_indexer->Save();
+    return NULL;
+}
+
+bool SegmentIndexer::Index( stream_t *s )
+{
+    vlc_stream_io_callback io( s, false );
+    EbmlStream es( io );
+    bool b_eof = false;
+
+    io.setFilePointer( i_segment_pos );
+    EbmlElement *el = es.FindNextID( EBML_INFO(KaxSegment), UINT64_MAX );
+    MKV_CHECKED_PTR_DECL( segment, KaxSegment, el );
+    if( segment == NULL )
+    {
+        delete el;
+        return false;
+    }
+
+    try
+    {
+        io.setFilePointer( i_first_cluster );
+        EbmlParser ep( &es, segment, &demuxer );
+
+        while( !b_abort )
+        {
+            if( ( el = ep.Get() ) == NULL )
+            {
+                Publish( io.getFilePointer() );
+                b_eof = true;
+                break;
+            }
+
+            /* everything up to there was indexed */
+            Publish( el->GetElementPosition() );
+
+            MKV_CHECKED_PTR_DECL( cluster, KaxCluster, el );
+            if( cluster && !IndexCluster( es, ep, *cluster ) )
+                break;
+        }
+    }
+    catch(...)
+    {
+        msg_Warn( &demuxer, "error while indexing the segment, stopping" );
+        b_eof = false;
+    }
+
+    delete segment;
+    return b_eof;
+}
+
+bool SegmentIndexer::IndexCluster( EbmlStream & es, EbmlParser & ep, KaxCluster & cluster )
+{
+    bool b_timecode = false;
+    EbmlElement *el;
+
+    ep.Down();
+
+    while( !b_abort && ( el = ep.Get() ) != NULL )
+    {
+        if( MKV_CHECKED_PTR_DECL( p_tc, KaxClusterTimecode, el ) )
+        {
+            p_tc->ReadData( es.I_O(), SCOPE_ALL_DATA );
+            cluster.InitTimecode( static_cast<uint64>( *p_tc ), i_timescale );
+
+            SegmentSeeker::Cluster cinfo = {
+                /* fpos     */ cluster.GetElementPosition(),
+                /* pts      */ vlc_tick_t( VLC_TICK_FROM_NS( cluster.GlobalTimecode() ) ),
+                /* duration */ vlc_tick_t( -1 ),
+                /* size     */ cluster.IsFiniteSize()
+                    ? cluster.GetEndPosition() - cluster.GetElementPosition()
+                    : UINT64_MAX
+            };
+            pending_clusters.push_back( cinfo );
+            b_timecode = true;
+        }
+        else if( !b_timecode )
+        {
+            /* blocks cannot be placed without the mandatory timecode */
+            continue;
+        }
+        else if( MKV_CHECKED_PTR_DECL( p_sblock, KaxSimpleBlock, el ) )
+        {
+            p_sblock->ReadData( es.I_O(), SCOPE_PARTIAL_DATA );
+            p_sblock->SetParent( cluster );
+
+            if( p_sblock->IsKeyframe() )
+                AddSeekpoint( p_sblock->TrackNum(), p_sblock->GetElementPosition(),
+                              VLC_TICK_FROM_NS( p_sblock->GlobalTimecode() ) );
+        }
+        else if( MKV_IS_ID( el, KaxBlockGroup ) )
+        {
+            bool b_block = false;
+            bool b_reference = false;
+            track_id_t i_track = 0;
+            fptr_t i_block_pos = 0;
+            vlc_tick_t i_block_pts = 0;
+
+            ep.Down();
+            while( ( el = ep.Get() ) != NULL )
+            {
+                if( MKV_CHECKED_PTR_DECL( p_block, KaxBlock, el ) )
+                {
+                    p_block->ReadData( es.I_O(), SCOPE_PARTIAL_DATA );
+                    p_block->SetParent( cluster );
+
+                    i_track     = p_block->TrackNum();
+                    i_block_pos = p_block->GetElementPosition();
+                    i_block_pts = VLC_TICK_FROM_NS( p_block->GlobalTimecode() );
+                    b_block     = true;
+                }
+                else if( MKV_IS_ID( el, KaxReferenceBlock ) )
+                    b_reference = true;
+            }
+            ep.Up();
+
+            /* a block without references can be decoded on its own */
+            if( b_block && !b_reference )
+                AddSeekpoint( i_track, i_block_pos, i_block_pts );
+        }
+    }
+
+    ep.Up();
+
+    return !b_abort;
+}
+
+void SegmentIndexer::AddSeekpoint( track_id_t track_id, fptr_t fpos, vlc_tick_t pts )
+{
+    if( !std::binary_search( tracks.begin(), tracks.end(), track_id ) )
+        return;
+
+    /* every audio frame is a keyframe, keep the index small */
+    std::map<track_id_t, vlc_tick_t>::iterator it = last_pts.find( track_id );
+    if( it != last_pts.end() && pts >= it->second &&
+        pts - it->second < INDEX_MIN_DISTANCE )
+        return;
+    last_pts[ track_id ] = pts;
+
+    TrackSeekpoint tsp = { track_id, SegmentSeeker::Seekpoint( fpos, pts ) };
+    pending_seekpoints.push_back( tsp );
+}
+
+void SegmentIndexer::Publish( fptr_t i_end )
+{
+    vlc_mutex_lock( &lock );
+    clusters.insert( clusters.end(), pending_clusters.begin(), pending_clusters.end() );
+    seekpoints.insert( seekpoints.end(), pending_seekpoints.begin(), pending_seekpoints.end() );
+    if( i_end > i_indexed_end )
+        i_indexed_end = i_end;
+    vlc_mutex_unlock( &lock );
+
+    pending_clusters.clear();
+    pending_seekpoints.clear();
+}
+
+/*****************************************************************************
+ * Cache
+ *****************************************************************************/
+bool SegmentIndexer::Load()
+{
+    uint8_t header[INDEX_HEADER_SIZE];
+    std::vector<SegmentSeeker::Cluster> loaded_clusters;
+    std::vector<TrackSeekpoint> loaded_seekpoints;
+    bool b_ok = false;
+
+    FILE *p_file = vlc_fopen( cache_path.c_str(), "rb" );
+    if( p_file == NULL )
+        return false;
+
+    if( fread( header, 1, INDEX_HEADER_SIZE, p_file ) != INDEX_HEADER_SIZE ||
+        memcmp( header, INDEX_MAGIC, 8 ) ||
+        GetDWBE( &header[8] ) != INDEX_VERSION ||
+        GetQWBE( &header[12] ) != i_stream_size ||
+        GetQWBE( &header[20] ) != i_segment_pos ||
+        GetQWBE( &header[28] ) != i_first_cluster )
+    {
+        msg_Dbg( &demuxer, "discarding outdated index %s", cache_path.c_str() );
+        goto end;
+    }
+
+    {
+        const fptr_t i_end = GetQWBE( &header[36] );
+        const uint32_t i_clusters = GetDWBE( &header[44] );
+        const uint32_t i_seekpoints = GetDWBE( &header[48] );
+
+        for( uint32_t i = 0; i < i_clusters; i++ )
+        {
+            uint8_t entry[INDEX_CLUSTER_SIZE];
+            if( fread( entry, 1, INDEX_CLUSTER_SIZE, p_file ) != INDEX_CLUSTER_SIZE )
+                goto end;
+
+            SegmentSeeker::Cluster cinfo = {
+                /* fpos     */ GetQWBE( &entry[0] ),
+                /* pts      */ vlc_tick_t( GetQWBE( &entry[8] ) ),
+                /* duration */ vlc_tick_t( GetQWBE( &entry[16] ) ),
+                /* size     */ GetQWBE( &entry[24] )
+            };
+            if( cinfo.fpos >= i_stream_size )
+                goto end;
+            loaded_clusters.push_back( cinfo );
+        }
+
+        for( uint32_t i = 0; i < i_seekpoints; i++ )
+        {
+            uint8_t entry[INDEX_SEEKPOINT_SIZE];
+            if( fread( entry, 1, INDEX_SEEKPOINT_SIZE, p_file ) != INDEX_SEEKPOINT_SIZE )
+                goto end;
+
+            TrackSeekpoint tsp = {
+                GetDWBE( &entry[0] ),
+                SegmentSeeker::Seekpoint( GetQWBE( &entry[4] ), vlc_tick_t( GetQWBE( &entry[12] ) ) )
+            };
+            if( tsp.seekpoint.fpos >= i_stream_size )
+                goto end;
+            loaded_seekpoints.push_back( tsp );
+        }
+
+        vlc_mutex_lock( &lock );
+        clusters.swap( loaded_clusters );
+        seekpoints.swap( loaded_seekpoints );
+        i_indexed_end = i_end;
+        vlc_mutex_unlock( &lock );
+
+        msg_Dbg( &demuxer, "loaded index %s with %zu clusters, %zu seekpoints",
+                 cache_path.c_str(), clusters.size(), seekpoints.size() );
+        b_ok = true;
+    }
+
+end:
+    fclose( p_file );
+    return b_ok;
+}
+
+void SegmentIndexer::Save() const
+{
+    uint8_t header[INDEX_HEADER_SIZE];
+
+    if( clusters.size() > UINT32_MAX || seekpoints.size() > UINT32_MAX )
+        return;
+
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_cachedir == NULL )
+        return;
+    vlc_mkdir( psz_cachedir, 0700 );
+    vlc_mkdir( ( std::string( psz_cachedir ) + DIR_SEP "mkv" ).c_str(), 0700 );
+    free( psz_cachedir );
+
+    FILE *p_file = vlc_fopen( cache_path.c_str(), "wb" );
+    if( p_file == NULL )
+    {
+        msg_Warn( &demuxer, "cannot write index %s: %s", cache_path.c_str(),
+                  vlc_strerror_c(errno) );
+        return;
+    }
+
+    memcpy( header, INDEX_MAGIC, 8 );
+    SetDWBE( &header[8], INDEX_VERSION );
+    SetQWBE( &header[12], i_stream_size );
+    SetQWBE( &header[20], i_segment_pos );
+    SetQWBE( &header[28], i_first_cluster );
+    SetQWBE( &header[36], i_indexed_end );
+    SetDWBE( &header[44], clusters.size() );
+    SetDWBE( &header[48], seekpoints.size() );
+
+    bool b_error = fwrite( header, 1, INDEX_HEADER_SIZE, p_file ) != INDEX_HEADER_SIZE;
+
+    for( size_t i = 0; i < clusters.size() && !b_error; i++ )
+    {
+        uint8_t entry[INDEX_CLUSTER_SIZE];
+        SetQWBE( &entry[0], clusters[i].fpos );
+        SetQWBE( &entry[8], clusters[i].pts );
+        SetQWBE( &entry[16], clusters[i].duration );
+        SetQWBE( &entry[24], clusters[i].size );
+        b_error = fwrite( entry, 1, INDEX_CLUSTER_SIZE, p_file ) != INDEX_CLUSTER_SIZE;
+    }
+
+    for( size_t i = 0; i < seekpoints.size() && !b_error; i++ )
+    {
+        uint8_t entry[INDEX_SEEKPOINT_SIZE];
+        SetDWBE( &entry[0], seekpoints[i].track_id );
+        SetQWBE( &entry[4], seekpoints[i].seekpoint.fpos );
+        SetQWBE( &entry[12], seekpoints[i].seekpoint.pts );
+        b_error = fwrite( entry, 1, INDEX_SEEKPOINT_SIZE, p_file ) != INDEX_SEEKPOINT_SIZE;
+    }
+
+    if( fclose( p_file ) )
+        b_error = true;
+
+    if( b_error )
+    {
+        msg_Warn( &demuxer, "cannot write index %s", cache_path.c_str() );
+        vlc_unlink( cache_path.c_str() );
+    }
+}
+
+} // namespace
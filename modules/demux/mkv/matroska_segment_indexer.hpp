@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * matroska_segment_indexer.hpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef MKV_MATROSKA_SEGMENT_INDEXER_HPP_
+#define MKV_MATROSKA_SEGMENT_INDEXER_HPP_
+
+#include "mkv.hpp"
+#include "matroska_segment_seeker.hpp"
+#include "Ebml_parser.hpp"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mkv {
+
+class matroska_segment_c;
+
+/* Walks all the clusters of a segment on its own stream, in the background,
+ * so that seeking does not have to scan the file when Cues are missing or
+ * sparse. The result can be kept in the cache directory, keyed by the file
+ * identity, and reloaded the next time the file is opened. */
+class SegmentIndexer
+{
+    public:
+        typedef SegmentSeeker::fptr_t fptr_t;
+        typedef SegmentSeeker::track_id_t track_id_t;
+
+        SegmentIndexer( matroska_segment_c &, stream_t *, fptr_t i_first_cluster );
+        ~SegmentIndexer();
+
+        /* reload a cached index or start indexing */
+        bool Start();
+
+        /* hand what was indexed since the last call over to the seeker */
+        void Merge( SegmentSeeker & );
+
+    private:
+        struct TrackSeekpoint
+        {
+            track_id_t track_id;
+            SegmentSeeker::Seekpoint seekpoint;
+        };
+
+        static void *Run( void * );
+        bool Index( stream_t * );
+        bool IndexCluster( EbmlStream &, EbmlParser &, KaxCluster & );
+        void AddSeekpoint( track_id_t, fptr_t, vlc_tick_t );
+        void Publish( fptr_t i_end );
+
+        bool Load();
+        void Save() const;
+
+        demux_t              & demuxer;
+        std::string          url;
+        std::string          cache_path;
+        uint64_t             i_stream_size;
+        fptr_t               i_segment_pos;
+        fptr_t               i_first_cluster;
+        uint64_t             i_timescale;
+        std::vector<track_id_t> tracks;
+
+        vlc_thread_t         thread;
+        bool                 b_thread;
+        std::atomic<bool>    b_abort;
+
+        /* protected by lock, filled by the indexing thread */
+        vlc_mutex_t          lock;
+        std::vector<SegmentSeeker::Cluster> clusters;
+        std::vector<TrackSeekpoint> seekpoints;
+        fptr_t               i_indexed_end;
+
+        /* only used by the indexing thread */
+        std::vector<SegmentSeeker::Cluster> pending_clusters;
+        std::vector<TrackSeekpoint> pending_seekpoints;
+        std::map<track_id_t, vlc_tick_t> last_pts;
+
+        /* only used by the demuxer */
+        size_t               i_merged_clusters;
+        size_t               i_merged_seekpoints;
+        fptr_t               i_merged_end;
+};
+
+} // namespace
+
+#endif /* include-guard */
@@ -80,6 +80,16 @@ vlc_plugin_begin ()
     add_bool( "mkv-preload-clusters", false,
             N_("Preload clusters"),
             N_("Find all cluster positions by jumping cluster-to-cluster before playback"), true );
+
+    add_bool( "mkv-background-index", true,
+            N_("Index in the background"),
+            N_("Find all keyframes of segments with missing or sparse Cues in the background, "
+               "so that seeking does not have to scan the file."), true );
+
+    add_bool( "mkv-index-cache", false,
+            N_("Keep background indexes"),
+            N_("Store background indexes in the cache directory and reuse them "
+               "when the same file is opened again."), true );
 vlc_plugin_end ()
 
 namespace mkv {
@@ -35,6 +35,8 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_url.h>
+#include <vlc_fs.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -46,6 +48,7 @@
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
 #include "ts_metadata.h"
+#include "ts_index.h"
 #include "sections.h"
 #include "pes.h"
 #include "timestamps.h"
@@ -61,6 +64,7 @@
 #endif
 
 #include <assert.h>
+#include <sys/stat.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -119,6 +123,16 @@ static void Close ( demux_t * );
 #define TS_SKIP_GHOST_PROGRAM_TEXT "Only create ES on program sending data"
 #define TS_OFFSETFIX_TEXT   "Try to fix too early PCR (or late DTS)"
 
+#define SEEK_INDEX_TEXT N_("Index seek points")
+#define SEEK_INDEX_LONGTEXT N_( \
+    "Remember PCR and random access positions while playing, so that " \
+    "seeking back to already played parts does not need to probe the file." )
+
+#define SEEK_INDEX_FILE_TEXT N_("Keep seek index next to the recording")
+#define SEEK_INDEX_FILE_LONGTEXT N_( \
+    "Load and save the seek index in a .tsidx file next to local recordings, " \
+    "making seeks and length queries a single lookup." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -155,6 +169,8 @@ vlc_plugin_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_bool( "ts-seek-index", true, SEEK_INDEX_TEXT, SEEK_INDEX_LONGTEXT, true )
+    add_bool( "ts-seek-index-file", false, SEEK_INDEX_FILE_TEXT, SEEK_INDEX_FILE_LONGTEXT, true )
     add_bool( "ts-cc-check", true, CC_CHECK_TEXT, CC_CHECK_LONGTEXT, true )
     add_bool( "ts-pmtfix-waitdata", true, TS_SKIP_GHOST_PROGRAM_TEXT, NULL, true )
     add_bool( "ts-patfix", true, TS_PATFIX_TEXT, NULL, true )
@@ -189,6 +205,7 @@ static block_t* ReadTSPacket( demux_t *p_demux );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
+static void IndexPCR( demux_t *, const ts_pid_t *, const block_t *, stime_t, uint64_t );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 
 #define TS_PACKET_SIZE_188 188
@@ -349,6 +366,18 @@ static int DetectPVRHeadersAndHeaderSize( demux_t *p_demux, unsigned *pi_header_
     return DetectPacketSize( p_demux, pi_header_size, 0 );
 }
 
+/* modification time of the recording, -1 if unknown */
+static int64_t GetIndexedMTime( demux_t *p_demux )
+{
+    struct stat st;
+    int64_t i_mtime = -1;
+    char *psz_path = vlc_uri2path( p_demux->psz_url );
+    if( psz_path && vlc_stat( psz_path, &st ) == 0 )
+        i_mtime = st.st_mtime;
+    free( psz_path );
+    return i_mtime;
+}
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -395,8 +424,11 @@ static int Open( demux_t *p_demux )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->p_bulk = malloc( p_sys->i_ts_read * i_packet_size );
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
+    p_sys->p_index = NULL;
+    p_sys->psz_index_path = NULL;
 
     vlc_dictionary_init( &p_sys->attachments, 0 );
 
@@ -409,6 +441,7 @@ static int Open( demux_t *p_demux )
     if ( !PIDSetup( p_demux, TYPE_PAT, patpid, NULL ) )
     {
         vlc_mutex_destroy( &p_sys->csa_lock );
+        free( p_sys->p_bulk );
         free( p_sys );
         return VLC_ENOMEM;
     }
@@ -416,6 +449,7 @@ static int Open( demux_t *p_demux )
     {
         PIDRelease( p_demux, patpid );
         vlc_mutex_destroy( &p_sys->csa_lock );
+        free( p_sys->p_bulk );
         free( p_sys );
         return VLC_EGENERIC;
     }
@@ -521,6 +555,30 @@ static int Open( demux_t *p_demux )
     vlc_stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK,
                         &p_sys->b_canfastseek );
 
+    /* Peeking waits for the whole batch: on live streams, do not wait for
+     * more than a single datagram (7 packets) */
+    p_sys->i_bulk_max = p_sys->b_canseek ? p_sys->i_ts_read : 7;
+
+    if( p_sys->b_canfastseek && var_InheritBool( p_demux, "ts-seek-index" ) )
+    {
+        const int64_t i_size = stream_Size( p_demux->s );
+        if( !p_demux->b_preparsing && i_size > 0 &&
+            var_InheritBool( p_demux, "ts-seek-index-file" ) )
+        {
+            char *psz_path = vlc_uri2path( p_demux->psz_url );
+            if( psz_path &&
+                asprintf( &p_sys->psz_index_path, "%s.tsidx", psz_path ) == -1 )
+                p_sys->psz_index_path = NULL;
+            free( psz_path );
+        }
+        if( p_sys->psz_index_path )
+            p_sys->p_index = ts_index_Load( VLC_OBJECT(p_demux), p_sys->psz_index_path,
+                                            i_size, GetIndexedMTime( p_demux ),
+                                            p_sys->i_packet_size );
+        if( !p_sys->p_index )
+            p_sys->p_index = ts_index_New();
+    }
+
     if( !p_sys->b_access_control && var_CreateGetBool( p_demux, "ts-pmtfix-waitdata" ) )
         p_sys->es_creation = DELAY_ES;
     else
@@ -552,6 +610,16 @@ static void Close( demux_t *p_demux )
 
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
+    if( p_sys->p_index )
+    {
+        if( p_sys->psz_index_path && p_sys->p_index->b_dirty )
+            ts_index_Save( VLC_OBJECT(p_demux), p_sys->p_index, p_sys->psz_index_path,
+                           stream_Size( p_demux->s ), GetIndexedMTime( p_demux ),
+                           p_sys->i_packet_size );
+        ts_index_Delete( p_sys->p_index );
+    }
+    free( p_sys->psz_index_path );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -582,6 +650,7 @@ static void Close( demux_t *p_demux )
     /* Clear up attachments */
     vlc_dictionary_clear( &p_sys->attachments, FreeDictAttachment, NULL );
 
+    free( p_sys->p_bulk );
     free( p_sys );
 }
 
@@ -607,155 +676,264 @@ static int ChangeKeyCallback( vlc_object_t *p_this, char const *psz_cmd,
     return i_tmp;
 }
 
+static void BulkPacketRelease( block_t *p_pkt )
+{
+    VLC_UNUSED(p_pkt);
+}
+
+static const struct vlc_block_callbacks bulk_packet_cbs =
+{
+    BulkPacketRelease,
+};
+
+static block_t * DetachTSPacket( block_t *p_pkt )
+{
+    if( p_pkt->cbs != &bulk_packet_cbs )
+        return p_pkt;
+
+    block_t *p_copy = block_Alloc( p_pkt->i_buffer );
+    if( likely(p_copy) )
+    {
+        memcpy( p_copy->p_buffer, p_pkt->p_buffer, p_pkt->i_buffer );
+        p_copy->i_flags = p_pkt->i_flags;
+    }
+    return p_copy;
+}
+
 /*****************************************************************************
- * Demux:
+ * DemuxTSPacket: handles one packet, returns true once a frame is completed
  *****************************************************************************/
-static int Demux( demux_t *p_demux )
+static bool DemuxTSPacket( demux_t *p_demux, block_t *p_pkt, uint64_t i_pos )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    bool b_wait_es = p_sys->i_pmt_es <= 0;
+    bool         b_frame = false;
+    int          i_header = 0;
 
-    /* If we had no PAT within MIN_PAT_INTERVAL, create PAT/PMT from probed streams */
-    if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.status == PAT_MISSING )
+    /* Early reject truncated packets from hw devices */
+    if( unlikely(p_pkt->i_buffer < TS_PACKET_SIZE_188) )
     {
-        MissingPATPMTFixup( p_demux );
-        p_sys->patfix.status = PAT_FIXTRIED;
-        GetPID(p_sys, 0)->u.p_pat->b_generated = true;
+        block_Release( p_pkt );
+        return false;
     }
 
-    /* We read at most 100 TS packet or until a frame is completed */
-    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
+    /* Reject any fully uncorrected packet. Even PID can be incorrect */
+    if( p_pkt->p_buffer[1]&0x80 )
     {
-        bool         b_frame = false;
-        int          i_header = 0;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
-        {
-            return VLC_DEMUXER_EOF;
-        }
+        msg_Dbg( p_demux, "transport_error_indicator set (pid=%d)",
+                 PIDGet( p_pkt ) );
+        block_Release( p_pkt );
+        return false;
+    }
 
-        if( p_sys->b_start_record )
+    /* Parse the TS packet */
+    ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
+    if( !SEEN(p_pid) )
+    {
+        if( p_pid->type == TYPE_FREE )
+            msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
+        p_pid->i_flags |= FLAG_SEEN;
+        if( p_pid->i_pid == 0x01 )
+            p_sys->b_valid_scrambling = true;
+    }
+
+    /* Drop duplicates and invalid (DOES NOT drop corrupted) */
+    p_pkt = ProcessTSPacket( p_demux, p_pid, p_pkt, &i_header );
+    if( !p_pkt )
+        return false;
+
+    if( !SCRAMBLED(*p_pid) != !(p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) )
+    {
+        UpdatePIDScrambledState( p_demux, p_pid, p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED );
+    }
+
+    /* Adaptation field cannot be scrambled */
+    stime_t i_pcr = GetPCR( p_pkt );
+    if( i_pcr >= 0 )
+    {
+        PCRHandle( p_demux, p_pid, i_pcr );
+        if( p_sys->p_index )
+            IndexPCR( p_demux, p_pid, p_pkt, i_pcr, i_pos );
+    }
+
+    /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
+    if( !SEEN( GetPID( p_sys, 0 ) ) &&
+        (p_pid->probed.i_fourcc == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
+        (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
+        (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
+    {
+        ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
+                  p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
+    }
+
+    switch( p_pid->type )
+    {
+    case TYPE_PAT:
+    case TYPE_PMT:
+        /* PAT and PMT are not allowed to be scrambled */
+        ts_psi_Packet_Push( p_pid, p_pkt->p_buffer );
+        block_Release( p_pkt );
+        break;
+
+    case TYPE_STREAM:
+        p_sys->b_end_preparse = true;
+
+        if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
         {
-            /* Enable recording once synchronized */
-            vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true,
-                                "ts" );
-            p_sys->b_start_record = false;
+            msg_Dbg( p_demux, "Creating delayed ES" );
+            AddAndCreateES( p_demux, p_pid, true );
+            UpdatePESFilters( p_demux, p_sys->seltype == PROGRAM_ALL );
         }
 
-        /* Early reject truncated packets from hw devices */
-        if( unlikely(p_pkt->i_buffer < TS_PACKET_SIZE_188) )
+        /* Emulate HW filter */
+        if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
         {
+            /* That packet is for an unselected ES, don't waste time/memory gathering its data */
             block_Release( p_pkt );
-            continue;
+            return false;
         }
 
-        /* Reject any fully uncorrected packet. Even PID can be incorrect */
-        if( p_pkt->p_buffer[1]&0x80 )
+        if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
         {
-            msg_Dbg( p_demux, "transport_error_indicator set (pid=%d)",
-                     PIDGet( p_pkt ) );
-            block_Release( p_pkt );
-            continue;
+            if( (p_pkt = DetachTSPacket( p_pkt )) )
+                b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header );
         }
-
-        /* Parse the TS packet */
-        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
-        if( !SEEN(p_pid) )
+        else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
         {
-            if( p_pid->type == TYPE_FREE )
-                msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
-            p_pid->i_flags |= FLAG_SEEN;
-            if( p_pid->i_pid == 0x01 )
-                p_sys->b_valid_scrambling = true;
+            if( (p_pkt = DetachTSPacket( p_pkt )) )
+                b_frame = GatherSectionsData( p_demux, p_pid, p_pkt, i_header );
         }
-
-        /* Drop duplicates and invalid (DOES NOT drop corrupted) */
-        p_pkt = ProcessTSPacket( p_demux, p_pid, p_pkt, &i_header );
-        if( !p_pkt )
-            continue;
-
-        if( !SCRAMBLED(*p_pid) != !(p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) )
+        else // pid->u.p_pes->transport == TS_TRANSPORT_IGNORE
         {
-            UpdatePIDScrambledState( p_demux, p_pid, p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED );
+            block_Release( p_pkt );
         }
 
-        /* Adaptation field cannot be scrambled */
-        stime_t i_pcr = GetPCR( p_pkt );
-        if( i_pcr >= 0 )
-            PCRHandle( p_demux, p_pid, i_pcr );
+        break;
 
-        /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
-        if( !SEEN( GetPID( p_sys, 0 ) ) &&
-            (p_pid->probed.i_fourcc == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
-            (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-            (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
-        {
-            ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
-                      p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
-        }
+    case TYPE_SI:
+        if( (p_pkt->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
+            ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
+        block_Release( p_pkt );
+        break;
 
-        switch( p_pid->type )
-        {
-        case TYPE_PAT:
-        case TYPE_PMT:
-            /* PAT and PMT are not allowed to be scrambled */
-            ts_psi_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+    case TYPE_PSIP:
+        if( (p_pkt->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
+            ts_psip_Packet_Push( p_pid, p_pkt->p_buffer );
+        block_Release( p_pkt );
+        break;
 
-        case TYPE_STREAM:
-            p_sys->b_end_preparse = true;
+    case TYPE_CAT:
+    default:
+        /* We have to handle PCR if present */
+        block_Release( p_pkt );
+        break;
+    }
 
-            if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
-            {
-                msg_Dbg( p_demux, "Creating delayed ES" );
-                AddAndCreateES( p_demux, p_pid, true );
-                UpdatePESFilters( p_demux, p_sys->seltype == PROGRAM_ALL );
-            }
+    return b_frame;
+}
 
-            /* Emulate HW filter */
-            if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
-            {
-                /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
-                continue;
-            }
+/*****************************************************************************
+ * DemuxBulk: handles up to i_max packets read at once in a single buffer.
+ * Packets are wrapped in stack blocks and only copied to real blocks when
+ * their payload is kept (see DetachTSPacket).
+ *****************************************************************************/
+static unsigned DemuxBulk( demux_t *p_demux, unsigned i_max, bool b_wait_es,
+                           bool *pb_stop )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    stream_t *stream = p_sys->stream;
+    const uint8_t *p_peek;
 
-            if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
-            {
-                b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header );
-            }
-            else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
-            {
-                b_frame = GatherSectionsData( p_demux, p_pid, p_pkt, i_header );
-            }
-            else // pid->u.p_pes->transport == TS_TRANSPORT_IGNORE
-            {
-                block_Release( p_pkt );
-            }
+    *pb_stop = false;
 
-            break;
+    /* Peek then copy, as PSI handling can seek the stream (ProbeStart/End) */
+    const uint64_t i_pos = vlc_stream_Tell( stream );
+    ssize_t i_peek = vlc_stream_Peek( stream, &p_peek, i_max * p_sys->i_packet_size );
+    if( i_peek < (ssize_t) p_sys->i_packet_size )
+        return 0;
+    const unsigned i_count = i_peek / p_sys->i_packet_size;
+    memcpy( p_sys->p_bulk, p_peek, i_count * p_sys->i_packet_size );
+
+    unsigned i_done = 0;
+    while( i_done < i_count && !*pb_stop )
+    {
+        uint8_t *p = &p_sys->p_bulk[i_done * p_sys->i_packet_size];
+        p += p_sys->i_packet_header_size;
+        if( p[0] != 0x47 )
+            break; /* let ReadTSPacket() resync */
+
+        block_t pkt;
+        block_Init( &pkt, &bulk_packet_cbs, p,
+                    p_sys->i_packet_size - p_sys->i_packet_header_size );
+        /* The stream position is the batch start until the batch is read */
+        p_sys->i_bulk_offset = ( i_done + 1 ) * p_sys->i_packet_size;
+        *pb_stop = DemuxTSPacket( p_demux, &pkt,
+                                  i_pos + i_done * p_sys->i_packet_size ) ||
+                   ( b_wait_es && p_sys->i_pmt_es > 0 ) ||
+                   stream != p_sys->stream;
+        i_done++;
+    }
+    p_sys->i_bulk_offset = 0;
+
+    if( i_done > 0 &&
+        vlc_stream_Read( stream, NULL, i_done * p_sys->i_packet_size ) !=
+            (ssize_t)( i_done * p_sys->i_packet_size ) )
+        *pb_stop = true;
+
+    return i_done;
+}
 
-        case TYPE_SI:
-            if( (p_pkt->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
-                ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+/*****************************************************************************
+ * Demux:
+ *****************************************************************************/
+static int Demux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_wait_es = p_sys->i_pmt_es <= 0;
 
-        case TYPE_PSIP:
-            if( (p_pkt->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_CORRUPTED)) == 0 )
-                ts_psip_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+    /* If we had no PAT within MIN_PAT_INTERVAL, create PAT/PMT from probed streams */
+    if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.status == PAT_MISSING )
+    {
+        MissingPATPMTFixup( p_demux );
+        p_sys->patfix.status = PAT_FIXTRIED;
+        GetPID(p_sys, 0)->u.p_pat->b_generated = true;
+    }
 
-        case TYPE_CAT:
-        default:
-            /* We have to handle PCR if present */
-            block_Release( p_pkt );
-            break;
+    /* We read at most i_ts_read TS packets or until a frame is completed */
+    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; )
+    {
+        bool b_stop = false;
+
+        if( p_sys->p_bulk && !p_sys->b_start_record )
+        {
+            unsigned i_done = DemuxBulk( p_demux,
+                                         __MIN( p_sys->i_ts_read - i_pkt,
+                                                p_sys->i_bulk_max ),
+                                         b_wait_es, &b_stop );
+            i_pkt += i_done;
+            if( b_stop )
+                break;
+            if( i_done > 0 )
+                continue;
+            /* else lost sync or EOF, handled below */
+        }
+
+        block_t *p_pkt;
+        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        {
+            return VLC_DEMUXER_EOF;
+        }
+        i_pkt++;
+
+        if( p_sys->b_start_record )
+        {
+            /* Enable recording once synchronized */
+            vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true,
+                                "ts" );
+            p_sys->b_start_record = false;
         }
 
-        if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
+        const uint64_t i_pos = vlc_stream_Tell( p_sys->stream ) - p_sys->i_packet_size;
+        if( DemuxTSPacket( p_demux, p_pkt, i_pos ) || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
             break;
     }
 
@@ -1922,6 +2100,14 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
+    /* Already indexed part */
+    uint64_t i_index_pos;
+    if( p_sys->p_index && p_sys->p_index->i_program == p_pmt->i_number &&
+        p_sys->p_index->i_first_pcr == p_pmt->pcr.i_first &&
+        ts_index_Find( p_sys->p_index, i_scaledtime - p_pmt->pcr.i_first, &i_index_pos ) &&
+        vlc_stream_Seek( p_sys->stream, i_index_pos ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+
     const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
 
     /* Find the time position by using binary search algorithm. */
@@ -2224,15 +2410,17 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, stime_t i_pcr )
     {
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
+        const uint64_t i_pos = vlc_stream_Tell( p_sys->stream ) +
+                               p_sys->i_bulk_offset;
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            i_pos > p_pmt->i_last_dts_byte )
         {
             if( p_pmt->i_last_dts_byte == 0 ) /* first run */
                 p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
             else
             {
                 p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                p_pmt->i_last_dts_byte = i_pos;
             }
         }
     }
@@ -2366,6 +2554,37 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, stime_t i_pcr )
     }
 }
 
+static void IndexPCR( demux_t *p_demux, const ts_pid_t *pid, const block_t *p_pkt,
+                      stime_t i_pcr, uint64_t i_pos )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_index_t *p_index = p_sys->p_index;
+
+    if( p_index->i_program == 0 || GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        const ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_pmt->i_number != p_index->i_program ||
+            p_pmt->i_pid_pcr != pid->i_pid || p_pmt->pcr.i_first == -1 )
+            continue;
+
+        /* boundaries probing failed, start from the first seen PCR */
+        if( p_index->i_first_pcr == -1 )
+            p_index->i_first_pcr = p_pmt->pcr.i_first;
+        else if( p_index->i_first_pcr != p_pmt->pcr.i_first )
+            continue;
+
+        const uint8_t *p = p_pkt->p_buffer;
+        const bool b_random_access = p[4] > 0 && (p[5] & 0x40);
+        ts_index_Add( p_index,
+                      TimeStampWrapAround( p_pmt->pcr.i_first, i_pcr ) - p_pmt->pcr.i_first,
+                      i_pos, b_random_access );
+    }
+}
+
 int FindPCRCandidate( ts_pmt_t *p_pmt )
 {
     ts_pid_t *p_cand = NULL;
@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_index_t ts_index_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -69,6 +70,9 @@ struct demux_sys_t
 
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
+    uint8_t    *p_bulk; /* i_ts_read packets read buffer */
+    unsigned    i_bulk_max; /* packets peeked at once, fewer for live streams */
+    uint64_t    i_bulk_offset; /* end of the current packet within p_bulk */
 
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
@@ -140,6 +144,10 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+
+    /* PCR/random access points, optionally kept next to the recording */
+    ts_index_t *p_index;
+    char       *psz_index_path;
 };
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
@@ -0,0 +1,550 @@
+/*****************************************************************************
+ * ts_index.c : TS demuxer seek index
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_util.h>
+#include <vlc_fs.h>
+
+#include "ts_pid.h"
+#include "ts_streams_private.h"
+#include "ts_index.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+/* one point per interval, 90kHz */
+#define INDEX_INTERVAL      (90000 / 2)
+/* how far back we look for a random access point */
+#define INDEX_RA_DISTANCE   (90000 * 5)
+/* targets farther than this from an indexed point are not covered */
+#define INDEX_MAX_GAP       (90000 * 2)
+
+#define INDEX_MAGIC         "VLCTSIDX"
+#define INDEX_VERSION       2
+#define INDEX_HEADER_SIZE   (8 + 4 + 4 + 8 + 8 + 4 + 8 * 4 + 4)
+#define INDEX_ENTRY_SIZE    (8 + 8 + 1)
+
+ts_index_t * ts_index_New( void )
+{
+    ts_index_t *p_index = calloc( 1, sizeof(*p_index) );
+    if( !p_index )
+        return NULL;
+    p_index->i_first_pcr = -1;
+    p_index->i_first_dts = -1;
+    p_index->i_last_dts = -1;
+    return p_index;
+}
+
+void ts_index_Delete( ts_index_t *p_index )
+{
+    free( p_index->p_entries );
+    free( p_index );
+}
+
+/* first entry with time > i_time */
+static size_t ts_index_UpperBound( const ts_index_t *p_index, stime_t i_time )
+{
+    size_t i_low = 0, i_high = p_index->i_entries;
+    while( i_low < i_high )
+    {
+        size_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_index->p_entries[i_mid].i_time <= i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+static bool ts_index_Merge( ts_index_entry_t *p_entry, stime_t i_time,
+                            uint64_t i_pos, bool b_random_access )
+{
+    stime_t i_diff = i_time - p_entry->i_time;
+    if( i_diff < 0 )
+        i_diff = -i_diff;
+    if( i_diff >= INDEX_INTERVAL )
+        return false;
+
+    /* too close, only upgrade to a random access point */
+    if( b_random_access && !p_entry->b_random_access )
+    {
+        p_entry->i_time = i_time;
+        p_entry->i_pos = i_pos;
+        p_entry->b_random_access = true;
+    }
+    return true;
+}
+
+void ts_index_Add( ts_index_t *p_index, stime_t i_time, uint64_t i_pos,
+                   bool b_random_access )
+{
+    if( i_time < 0 )
+        return;
+
+    size_t i_index = ts_index_UpperBound( p_index, i_time );
+
+    if( i_index > 0 &&
+        ts_index_Merge( &p_index->p_entries[i_index - 1], i_time, i_pos, b_random_access ) )
+        return;
+    if( i_index < p_index->i_entries &&
+        ts_index_Merge( &p_index->p_entries[i_index], i_time, i_pos, b_random_access ) )
+        return;
+
+    if( p_index->i_entries == p_index->i_alloc )
+    {
+        size_t i_alloc = p_index->i_alloc ? p_index->i_alloc * 2 : 256;
+        ts_index_entry_t *p_realloc = vlc_reallocarray( p_index->p_entries, i_alloc,
+                                                        sizeof(*p_realloc) );
+        if( !p_realloc )
+            return;
+        p_index->p_entries = p_realloc;
+        p_index->i_alloc = i_alloc;
+    }
+
+    memmove( &p_index->p_entries[i_index + 1], &p_index->p_entries[i_index],
+             (p_index->i_entries - i_index) * sizeof(ts_index_entry_t) );
+    p_index->p_entries[i_index].i_time = i_time;
+    p_index->p_entries[i_index].i_pos = i_pos;
+    p_index->p_entries[i_index].b_random_access = b_random_access;
+    p_index->i_entries++;
+    p_index->b_dirty = true;
+}
+
+bool ts_index_Find( const ts_index_t *p_index, stime_t i_time, uint64_t *pi_pos )
+{
+    size_t i_index = ts_index_UpperBound( p_index, i_time );
+    if( i_index == 0 )
+        return false;
+
+    const ts_index_entry_t *p_entry = &p_index->p_entries[i_index - 1];
+    /* that part of the file was never indexed */
+    if( i_time - p_entry->i_time > INDEX_MAX_GAP )
+        return false;
+
+    /* prefer starting decoding from a random access point */
+    for( size_t i = i_index; i > 0; i-- )
+    {
+        const ts_index_entry_t *p_ra = &p_index->p_entries[i - 1];
+        if( p_entry->i_time - p_ra->i_time > INDEX_RA_DISTANCE )
+            break;
+        if( p_ra->b_random_access )
+        {
+            p_entry = p_ra;
+            break;
+        }
+    }
+
+    *pi_pos = p_entry->i_pos;
+    return true;
+}
+
+bool ts_index_GetBoundaries( const ts_index_t *p_index, ts_pmt_t *p_pmt )
+{
+    if( p_index->i_program != p_pmt->i_number ||
+        p_index->i_first_pcr == -1 || p_index->i_last_dts == -1 )
+        return false;
+
+    p_pmt->pcr.i_first = p_index->i_first_pcr;
+    p_pmt->pcr.i_first_dts = p_index->i_first_dts;
+    p_pmt->i_last_dts = p_index->i_last_dts;
+    p_pmt->i_last_dts_byte = p_index->i_last_dts_byte;
+    return true;
+}
+
+void ts_index_SetBoundaries( ts_index_t *p_index, const ts_pmt_t *p_pmt )
+{
+    if( p_index->i_program == 0 )
+        p_index->i_program = p_pmt->i_number;
+    else if( p_index->i_program != p_pmt->i_number )
+        return;
+
+    /* entries are relative to the first PCR: drop them if it moved */
+    if( p_index->i_first_pcr != p_pmt->pcr.i_first )
+    {
+        p_index->i_entries = 0;
+        p_index->i_first_pcr = p_pmt->pcr.i_first;
+    }
+    p_index->i_first_dts = p_pmt->pcr.i_first_dts;
+    p_index->i_last_dts = p_pmt->i_last_dts;
+    p_index->i_last_dts_byte = p_pmt->i_last_dts_byte;
+    p_index->b_dirty = true;
+}
+
+/*****************************************************************************
+ * Sidecar file
+ *****************************************************************************/
+ts_index_t * ts_index_Load( vlc_object_t *p_obj, const char *psz_path,
+                            uint64_t i_size, int64_t i_mtime,
+                            unsigned i_packet_size )
+{
+    uint8_t header[INDEX_HEADER_SIZE];
+    ts_index_t *p_index = NULL;
+    struct stat st;
+
+    FILE *p_file = vlc_fopen( psz_path, "rb" );
+    if( !p_file )
+        return NULL;
+
+    if( fstat( fileno( p_file ), &st ) ||
+        fread( header, 1, INDEX_HEADER_SIZE, p_file ) != INDEX_HEADER_SIZE ||
+        memcmp( header, INDEX_MAGIC, 8 ) ||
+        GetDWBE( &header[8] ) != INDEX_VERSION )
+    {
+        msg_Warn( p_obj, "invalid seek index %s", psz_path );
+        goto end;
+    }
+
+    /* the recording has changed since */
+    if( GetDWBE( &header[12] ) != i_packet_size ||
+        GetQWBE( &header[16] ) != i_size ||
+        (int64_t)GetQWBE( &header[24] ) != i_mtime )
+    {
+        msg_Dbg( p_obj, "discarding outdated seek index %s", psz_path );
+        goto end;
+    }
+
+    /* never trust the count beyond what the file actually holds */
+    const uint32_t i_entries = GetDWBE( &header[68] );
+    if( i_entries > i_size / i_packet_size ||
+        i_entries > (st.st_size - INDEX_HEADER_SIZE) / INDEX_ENTRY_SIZE )
+    {
+        msg_Warn( p_obj, "invalid seek index %s", psz_path );
+        goto end;
+    }
+
+    if( !(p_index = ts_index_New()) )
+        goto end;
+
+    p_index->i_program = GetDWBE( &header[32] );
+    p_index->i_first_pcr = GetQWBE( &header[36] );
+    p_index->i_first_dts = GetQWBE( &header[44] );
+    p_index->i_last_dts = GetQWBE( &header[52] );
+    p_index->i_last_dts_byte = GetQWBE( &header[60] );
+
+    if( i_entries )
+    {
+        p_index->p_entries = vlc_alloc( i_entries, sizeof(ts_index_entry_t) );
+        if( !p_index->p_entries )
+        {
+            ts_index_Delete( p_index );
+            p_index = NULL;
+            goto end;
+        }
+        p_index->i_alloc = i_entries;
+    }
+
+    for( uint32_t i = 0; i < i_entries; i++ )
+    {
+        uint8_t entry[INDEX_ENTRY_SIZE];
+        if( fread( entry, 1, INDEX_ENTRY_SIZE, p_file ) != INDEX_ENTRY_SIZE )
+            break;
+        ts_index_entry_t *p_entry = &p_index->p_entries[p_index->i_entries];
+        p_entry->i_time = GetQWBE( &entry[0] );
+        p_entry->i_pos = GetQWBE( &entry[8] );
+        p_entry->b_random_access = entry[16] & 0x01;
+        /* must stay sorted */
+        if( p_entry->i_time < 0 || p_entry->i_pos >= i_size ||
+            ( p_index->i_entries && p_entry->i_time <= p_entry[-1].i_time ) )
+            break;
+        p_index->i_entries++;
+    }
+
+    msg_Dbg( p_obj, "loaded seek index %s with %zu entries", psz_path,
+             p_index->i_entries );
+
+end:
+    fclose( p_file );
+    return p_index;
+}
+
+int ts_index_Save( vlc_object_t *p_obj, const ts_index_t *p_index,
+                   const char *psz_path, uint64_t i_size, int64_t i_mtime,
+                   unsigned i_packet_size )
+{
+    uint8_t header[INDEX_HEADER_SIZE];
+
+    if( p_index->i_entries > UINT32_MAX )
+        return VLC_EGENERIC;
+
+    FILE *p_file = vlc_fopen( psz_path, "wb" );
+    if( !p_file )
+    {
+        msg_Warn( p_obj, "cannot write seek index %s: %s", psz_path,
+                  vlc_strerror_c(errno) );
+        return VLC_EGENERIC;
+    }
+
+    memcpy( header, INDEX_MAGIC, 8 );
+    SetDWBE( &header[8], INDEX_VERSION );
+    SetDWBE( &header[12], i_packet_size );
+    SetQWBE( &header[16], i_size );
+    SetQWBE( &header[24], i_mtime );
+    SetDWBE( &header[32], p_index->i_program );
+    SetQWBE( &header[36], p_index->i_first_pcr );
+    SetQWBE( &header[44], p_index->i_first_dts );
+    SetQWBE( &header[52], p_index->i_last_dts );
+    SetQWBE( &header[60], p_index->i_last_dts_byte );
+    SetDWBE( &header[68], p_index->i_entries );
+
+    bool b_error = fwrite( header, 1, INDEX_HEADER_SIZE, p_file ) != INDEX_HEADER_SIZE;
+    for( size_t i = 0; i < p_index->i_entries && !b_error; i++ )
+    {
+        const ts_index_entry_t *p_entry = &p_index->p_entries[i];
+        uint8_t entry[INDEX_ENTRY_SIZE];
+        SetQWBE( &entry[0], p_entry->i_time );
+        SetQWBE( &entry[8], p_entry->i_pos );
+        entry[16] = p_entry->b_random_access ? 0x01 : 0x00;
+        b_error = fwrite( entry, 1, INDEX_ENTRY_SIZE, p_file ) != INDEX_ENTRY_SIZE;
+    }
+
+    if( fclose( p_file ) )
+        b_error = true;
+
+    if( b_error )
+    {
+        msg_Warn( p_obj, "cannot write seek index %s", psz_path );
+        vlc_unlink( psz_path );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+#ifdef TS_INDEX_TEST
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const char vlc_plugin_name[] = "ts_index_test";
+
+#define TEST_SIZE   (UINT64_C(188) * 100000)
+#define TEST_MTIME  INT64_C(1700000000)
+
+/* rewrites the sidecar, truncated to i_length, with an optional patched
+ * 32 bits value */
+static void Rewrite( const char *psz_path, long i_length,
+                     long i_patch, uint32_t i_value )
+{
+    uint8_t buf[4096];
+    FILE *p_file = fopen( psz_path, "rb" );
+    assert( p_file != NULL );
+    size_t i_read = fread( buf, 1, sizeof(buf), p_file );
+    fclose( p_file );
+    assert( i_read >= (size_t)i_length );
+
+    if( i_patch >= 0 )
+        SetDWBE( &buf[i_patch], i_value );
+
+    p_file = fopen( psz_path, "wb" );
+    assert( p_file != NULL );
+    assert( fwrite( buf, 1, i_length, p_file ) == (size_t)i_length );
+    fclose( p_file );
+}
+
+static void TestAddFind( void )
+{
+    ts_index_t *p_index = ts_index_New();
+    uint64_t i_pos;
+    assert( p_index != NULL );
+
+    assert( !ts_index_Find( p_index, 0, &i_pos ) );
+
+    ts_index_Add( p_index, 90000, 2000, false );
+    ts_index_Add( p_index, 0, 0, true );
+    ts_index_Add( p_index, 45000, 1000, false );
+    ts_index_Add( p_index, -1, 500, true );
+    assert( p_index->i_entries == 3 );
+    assert( p_index->p_entries[0].i_time == 0 );
+    assert( p_index->p_entries[1].i_time == 45000 );
+    assert( p_index->p_entries[2].i_time == 90000 );
+
+    /* too close: merged, only upgrading to a random access point */
+    ts_index_Add( p_index, 100, 5, false );
+    assert( p_index->i_entries == 3 && p_index->p_entries[0].i_pos == 0 );
+
+    /* decoding starts from the previous random access point */
+    assert( ts_index_Find( p_index, 100000, &i_pos ) && i_pos == 0 );
+    ts_index_Add( p_index, 45100, 1500, true );
+    assert( p_index->i_entries == 3 );
+    assert( ts_index_Find( p_index, 100000, &i_pos ) && i_pos == 1500 );
+    assert( ts_index_Find( p_index, 45099, &i_pos ) && i_pos == 0 );
+
+    /* before the first entry, or past the indexed part */
+    assert( !ts_index_Find( p_index, -1, &i_pos ) );
+    assert( !ts_index_Find( p_index, 90000 + INDEX_MAX_GAP + 1, &i_pos ) );
+
+    /* random access points farther than INDEX_RA_DISTANCE are ignored */
+    for( stime_t i_time = 135000; i_time <= 90000 * 10; i_time += INDEX_INTERVAL )
+        ts_index_Add( p_index, i_time, i_time, false );
+    assert( ts_index_Find( p_index, 90000 * 10, &i_pos ) && i_pos == 90000 * 10 );
+
+    /* the array grows past its first allocation */
+    for( stime_t i_time = 90000 * 11; p_index->i_entries < 1000;
+         i_time += INDEX_INTERVAL )
+        ts_index_Add( p_index, i_time, i_time, false );
+    for( size_t i = 1; i < p_index->i_entries; i++ )
+        assert( p_index->p_entries[i].i_time > p_index->p_entries[i - 1].i_time );
+
+    ts_index_Delete( p_index );
+}
+
+static void TestSaveLoad( vlc_object_t *p_obj, const char *psz_path )
+{
+    ts_index_t *p_index = ts_index_New(), *p_loaded;
+    assert( p_index != NULL );
+
+    p_index->i_program = 3;
+    p_index->i_first_pcr = 1234;
+    p_index->i_first_dts = 5678;
+    p_index->i_last_dts = 90000 * 100;
+    p_index->i_last_dts_byte = TEST_SIZE - 188;
+    for( unsigned i = 0; i < 200; i++ )
+        ts_index_Add( p_index, i * INDEX_INTERVAL, i * 188 * 100, i % 10 == 0 );
+    assert( p_index->i_entries == 200 );
+
+    assert( ts_index_Save( p_obj, p_index, psz_path, TEST_SIZE, TEST_MTIME,
+                           188 ) == VLC_SUCCESS );
+
+    p_loaded = ts_index_Load( p_obj, psz_path, TEST_SIZE, TEST_MTIME, 188 );
+    assert( p_loaded != NULL );
+    assert( !p_loaded->b_dirty );
+    assert( p_loaded->i_program == 3 );
+    assert( p_loaded->i_first_pcr == 1234 );
+    assert( p_loaded->i_first_dts == 5678 );
+    assert( p_loaded->i_last_dts == 90000 * 100 );
+    assert( p_loaded->i_last_dts_byte == TEST_SIZE - 188 );
+    assert( p_loaded->i_entries == p_index->i_entries );
+    for( size_t i = 0; i < p_index->i_entries; i++ )
+    {
+        assert( p_loaded->p_entries[i].i_time == p_index->p_entries[i].i_time );
+        assert( p_loaded->p_entries[i].i_pos == p_index->p_entries[i].i_pos );
+        assert( p_loaded->p_entries[i].b_random_access ==
+                p_index->p_entries[i].b_random_access );
+    }
+    /* a loaded index keeps growing */
+    ts_index_Add( p_loaded, 200 * INDEX_INTERVAL, 188, false );
+    assert( p_loaded->i_entries == 201 && p_loaded->b_dirty );
+    ts_index_Delete( p_loaded );
+
+    /* outdated: the recording was modified or rewritten */
+    assert( !ts_index_Load( p_obj, psz_path, TEST_SIZE + 188, TEST_MTIME, 188 ) );
+    assert( !ts_index_Load( p_obj, psz_path, TEST_SIZE, TEST_MTIME + 1, 188 ) );
+    assert( !ts_index_Load( p_obj, psz_path, TEST_SIZE, TEST_MTIME, 192 ) );
+
+    /* empty index */
+    ts_index_t *p_empty = ts_index_New();
+    assert( ts_index_Save( p_obj, p_empty, psz_path, TEST_SIZE, TEST_MTIME,
+                           188 ) == VLC_SUCCESS );
+    ts_index_Delete( p_empty );
+    p_loaded = ts_index_Load( p_obj, psz_path, TEST_SIZE, TEST_MTIME, 188 );
+    assert( p_loaded != NULL && p_loaded->i_entries == 0 );
+    ts_index_Delete( p_loaded );
+
+    ts_index_Delete( p_index );
+}
+
+static void TestCorrupt( vlc_object_t *p_obj, const char *psz_path )
+{
+    const long i_full = INDEX_HEADER_SIZE + 10 * INDEX_ENTRY_SIZE;
+    ts_index_t *p_index = ts_index_New(), *p_loaded;
+    assert( p_index != NULL );
+    for( unsigned i = 0; i < 10; i++ )
+        ts_index_Add( p_index, i * INDEX_INTERVAL, i * 188, false );
+
+#define RESAVE() \
+    assert( ts_index_Save( p_obj, p_index, psz_path, TEST_SIZE, TEST_MTIME, \
+                           188 ) == VLC_SUCCESS )
+#define LOAD() ts_index_Load( p_obj, psz_path, TEST_SIZE, TEST_MTIME, 188 )
+
+    /* truncated header, or entries */
+    RESAVE();
+    Rewrite( psz_path, INDEX_HEADER_SIZE - 1, -1, 0 );
+    assert( !LOAD() );
+    RESAVE();
+    Rewrite( psz_path, i_full - 1, -1, 0 );
+    assert( !LOAD() );
+    RESAVE();
+    Rewrite( psz_path, INDEX_HEADER_SIZE, -1, 0 );
+    assert( !LOAD() );
+
+    /* bad magic, unknown version */
+    RESAVE();
+    Rewrite( psz_path, i_full, 0, 0x12345678 );
+    assert( !LOAD() );
+    RESAVE();
+    Rewrite( psz_path, i_full, 8, INDEX_VERSION + 1 );
+    assert( !LOAD() );
+
+    /* entry count larger than the file: must fail, not allocate it */
+    RESAVE();
+    Rewrite( psz_path, i_full, 68, 11 );
+    assert( !LOAD() );
+    RESAVE();
+    Rewrite( psz_path, i_full, 16, 0x100 );
+    Rewrite( psz_path, i_full, 68, UINT32_MAX );
+    assert( !ts_index_Load( p_obj, psz_path, (UINT64_C(0x100) << 32) | TEST_SIZE,
+                            TEST_MTIME, 1 ) );
+
+    /* a smaller count only loads the first entries */
+    RESAVE();
+    Rewrite( psz_path, i_full, 68, 4 );
+    p_loaded = LOAD();
+    assert( p_loaded != NULL && p_loaded->i_entries == 4 );
+    ts_index_Delete( p_loaded );
+
+    /* unsorted, or out of file entries: only the valid prefix is kept */
+    RESAVE();
+    Rewrite( psz_path, i_full, INDEX_HEADER_SIZE + 5 * INDEX_ENTRY_SIZE + 4, 0 );
+    p_loaded = LOAD();
+    assert( p_loaded != NULL && p_loaded->i_entries == 5 );
+    ts_index_Delete( p_loaded );
+    RESAVE();
+    Rewrite( psz_path, i_full, INDEX_HEADER_SIZE + 7 * INDEX_ENTRY_SIZE + 8,
+             UINT32_MAX );
+    p_loaded = LOAD();
+    assert( p_loaded != NULL && p_loaded->i_entries == 7 );
+    ts_index_Delete( p_loaded );
+
+#undef LOAD
+#undef RESAVE
+    ts_index_Delete( p_index );
+}
+
+int main( void )
+{
+    char psz_path[] = "/tmp/vlc-ts-index-XXXXXX";
+    int fd = mkstemp( psz_path );
+    assert( fd != -1 );
+    close( fd );
+
+    vlc_object_t *p_obj = (vlc_object_create)( NULL, sizeof(*p_obj) );
+    assert( p_obj != NULL );
+
+    TestAddFind();
+    TestSaveLoad( p_obj, psz_path );
+    TestCorrupt( p_obj, psz_path );
+
+    vlc_object_delete( p_obj );
+    unlink( psz_path );
+    return 0;
+}
+#endif
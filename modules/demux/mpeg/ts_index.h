@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * ts_index.h : TS demuxer seek index
+ *****************************************************************************
+ * Copyright (C) 2024 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifndef VLC_TS_INDEX_H
+#define VLC_TS_INDEX_H
+
+#include "timestamps.h"
+
+typedef struct ts_index_t ts_index_t;
+
+typedef struct
+{
+    stime_t  i_time; /* relative to the program first PCR */
+    uint64_t i_pos;
+    bool     b_random_access;
+} ts_index_entry_t;
+
+struct ts_index_t
+{
+    int      i_program; /* 0 until the indexed program is known */
+
+    /* probed boundaries of the indexed program */
+    stime_t  i_first_pcr;
+    stime_t  i_first_dts;
+    stime_t  i_last_dts;
+    uint64_t i_last_dts_byte;
+
+    /* sorted by time */
+    ts_index_entry_t *p_entries;
+    size_t   i_entries;
+    size_t   i_alloc;
+
+    bool     b_dirty; /* changed since loaded */
+};
+
+ts_index_t * ts_index_New( void );
+void ts_index_Delete( ts_index_t * );
+
+void ts_index_Add( ts_index_t *, stime_t i_time, uint64_t i_pos, bool b_random_access );
+bool ts_index_Find( const ts_index_t *, stime_t i_time, uint64_t *pi_pos );
+
+bool ts_index_GetBoundaries( const ts_index_t *, ts_pmt_t * );
+void ts_index_SetBoundaries( ts_index_t *, const ts_pmt_t * );
+
+/* i_size and i_mtime identify the indexed recording: a sidecar saved for
+ * different values is outdated and is not loaded */
+ts_index_t * ts_index_Load( vlc_object_t *, const char *psz_path,
+                            uint64_t i_size, int64_t i_mtime,
+                            unsigned i_packet_size );
+int ts_index_Save( vlc_object_t *, const ts_index_t *, const char *psz_path,
+                   uint64_t i_size, int64_t i_mtime, unsigned i_packet_size );
+
+#endif
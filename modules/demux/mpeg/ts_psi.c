@@ -56,6 +56,7 @@
 #include "ts_si.h"
 #include "ts_metadata.h"
 #include "ts_descriptions.h"
+#include "ts_index.h"
 
 #include "../access/dtv/en50221_capmt.h"
 
@@ -2147,8 +2148,13 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
     if( p_sys->b_canfastseek && p_pmt->i_last_dts == TS_TICK_UNKNOWN )
     {
         p_pmt->i_last_dts = 0;
-        ProbeStart( p_demux, p_pmt->i_number );
-        ProbeEnd( p_demux, p_pmt->i_number );
+        if( !p_sys->p_index || !ts_index_GetBoundaries( p_sys->p_index, p_pmt ) )
+        {
+            ProbeStart( p_demux, p_pmt->i_number );
+            ProbeEnd( p_demux, p_pmt->i_number );
+            if( p_sys->p_index )
+                ts_index_SetBoundaries( p_sys->p_index, p_pmt );
+        }
     }
 
     dvbpsi_pmt_delete( p_dvbpsipmt );
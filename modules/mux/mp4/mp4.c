@@ -53,6 +53,20 @@
     "Create \"Fast Start\" files. " \
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
+#define RESERVE_TEXT N_("Expected duration for the index reservation")
+#define RESERVE_LONGTEXT N_(\
+    "Expected duration of the recording in seconds. When set, room for the " \
+    "index of a file of that duration is reserved at the start of \"Fast " \
+    "Start\" files, so that the media data does not have to be moved when " \
+    "closing. 0 disables the reservation.")
+#define CHUNK_TEXT N_("CMAF chunk duration (ms)")
+#define CHUNK_LONGTEXT N_(\
+    "Fragmented output only. Write CMAF chunks of at most this duration, " \
+    "each with its own moof and mdat, instead of whole fragments, so that " \
+    "they can be forwarded as soon as they are encoded. Segments still " \
+    "start on keyframes. A duration shorter than a frame writes one chunk " \
+    "per frame. The output is only CMAF compliant with a single track. " \
+    "0 disables chunking.")
 
 static int  Open   (sout_mux_t *);
 static void Close  (sout_mux_t *);
@@ -76,13 +90,19 @@ add_submodule ()
     add_bool(SOUT_CFG_PREFIX "faststart", true,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true)
+    add_integer(SOUT_CFG_PREFIX "reserve-duration", 0,
+                RESERVE_TEXT, RESERVE_LONGTEXT, true)
+        change_integer_range(0, 7 * 24 * 3600)
+    add_integer(SOUT_CFG_PREFIX "chunk-duration", 0,
+                CHUNK_TEXT, CHUNK_LONGTEXT, true)
+        change_integer_range(0, 10000)
 vlc_plugin_end ()
 
 /*****************************************************************************
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "reserve-duration", "chunk-duration", NULL
 };
 
 static int Control(sout_mux_t *, int, va_list);
@@ -158,6 +178,7 @@ typedef struct
 
     uint64_t i_mdat_pos;
     uint64_t i_pos;
+    uint64_t i_moov_reserve; /* free box before the mdat, 0 if none */
     vlc_tick_t  i_read_duration;
     vlc_tick_t  i_start_dts;
 
@@ -168,6 +189,10 @@ typedef struct
     /* mp4frag */
     vlc_tick_t     i_written_duration;
     uint32_t       i_mfhd_sequence;
+    vlc_tick_t     i_chunk_duration; /* 0 if not chunked */
+    bool           b_cmaf; /* chunked single track output */
+    vlc_tick_t     i_segment_start;
+    bool           b_segment_started;
 } sout_mux_sys_t;
 
 static void mp4_stream_Delete(mp4_stream_t *p_stream)
@@ -218,6 +243,74 @@ static block_t *ConvertSUBT(block_t *);
 static bool CreateCurrentEdit(mp4_stream_t *, vlc_tick_t, bool);
 static int MuxStream(sout_mux_t *p_mux, sout_input_t *p_input, mp4_stream_t *p_stream);
 
+/* Upper bound of the moov size for the given duration at the nominal sample
+ * rates, assuming every sample gets its own chunk, stsc and timing entries */
+static uint64_t EstimateMoovSize(sout_mux_t *p_mux, vlc_tick_t i_duration)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const double f_duration = secf_from_vlc_tick(i_duration);
+    uint64_t i_size = 1024; /* mvhd, udta */
+
+    for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+    {
+        const es_format_t *p_fmt = mp4mux_track_GetFmt(p_sys->pp_streams[i]->tinfo);
+        double f_rate = 1.0;
+        unsigned i_entry = 4 /* stsz */ + 8 /* co64 */ + 12 /* stsc */
+                         + 8 /* stts */;
+
+        switch (p_fmt->i_cat)
+        {
+            case VIDEO_ES:
+                if (p_fmt->video.i_frame_rate && p_fmt->video.i_frame_rate_base)
+                    f_rate = (double) p_fmt->video.i_frame_rate /
+                             p_fmt->video.i_frame_rate_base;
+                else
+                    f_rate = 120.0; /* unknown, assume a high one */
+                i_entry += 8 /* ctts */ + 4 /* stss */;
+                break;
+            case AUDIO_ES:
+                f_rate = (double) p_fmt->audio.i_rate /
+                         (p_fmt->audio.i_frame_length ? p_fmt->audio.i_frame_length
+                                                      : 1024);
+                break;
+            default:
+                break;
+        }
+        i_size += 4096 + p_fmt->i_extra;
+        i_size += (uint64_t)(f_duration * f_rate + 1) * i_entry;
+    }
+
+    /* stay within a 32 bits box */
+    return __MIN((i_size + 4095) & ~UINT64_C(4095), UINT64_C(256) << 20);
+}
+
+static int WriteMoovReserve(sout_mux_t *p_mux)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    bo_t *box = box_new("free");
+    if (!box)
+        return VLC_ENOMEM;
+    box_fix(box, p_sys->i_moov_reserve);
+    box_send(p_mux, box);
+
+    /* Pad the box in chunks, the reserve may be large */
+    for (uint64_t i_left = p_sys->i_moov_reserve - 8; i_left > 0;)
+    {
+        size_t i_chunk = __MIN(32768, i_left);
+        block_t *p_pad = block_Alloc(i_chunk);
+        if (!p_pad)
+            return VLC_ENOMEM;
+        memset(p_pad->p_buffer, 0, i_chunk);
+        sout_AccessOutWrite(p_mux->p_access, p_pad);
+        i_left -= i_chunk;
+    }
+
+    p_sys->i_pos += p_sys->i_moov_reserve;
+    p_sys->i_mdat_pos = p_sys->i_pos;
+    return VLC_SUCCESS;
+}
+
 static int WriteSlowStartHeader(sout_mux_t *p_mux)
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
@@ -235,6 +328,18 @@ static int WriteSlowStartHeader(sout_mux_t *p_mux)
         box_send(p_mux, box);
     }
 
+    /* Reserve room for the moov, so that it can be written in place */
+    const vlc_tick_t i_reserve_duration =
+        vlc_tick_from_sec(var_GetInteger(p_mux, SOUT_CFG_PREFIX "reserve-duration"));
+    if (i_reserve_duration > 0 && var_GetBool(p_mux, SOUT_CFG_PREFIX "faststart"))
+    {
+        p_sys->i_moov_reserve = EstimateMoovSize(p_mux, i_reserve_duration);
+        msg_Dbg(p_mux, "reserving %"PRIu64" bytes for the moov",
+                p_sys->i_moov_reserve);
+        if (WriteMoovReserve(p_mux) != VLC_SUCCESS)
+            return VLC_ENOMEM;
+    }
+
     /* Now add mdat header */
     box = box_new("mdat");
     if(!box)
@@ -279,12 +384,17 @@ static int Open(sout_mux_t *p_mux)
     p_sys->i_nb_streams = 0;
     p_sys->pp_streams   = NULL;
     p_sys->i_mdat_pos   = 0;
+    p_sys->i_moov_reserve = 0;
     p_sys->b_header_sent = false;
 
     p_sys->i_read_duration   = 0;
     p_sys->i_written_duration= 0;
     p_sys->i_start_dts = VLC_TICK_INVALID;
     p_sys->i_mfhd_sequence = 1;
+    p_sys->i_chunk_duration = 0;
+    p_sys->b_cmaf = false;
+    p_sys->i_segment_start = 0;
+    p_sys->b_segment_started = false;
 
     p_mux->p_sys        = p_sys;
     p_mux->pf_control   = Control;
@@ -302,9 +412,27 @@ static int Open(sout_mux_t *p_mux)
         mp4mux_SetBrand(p_sys->muxh, BRAND_isom, 0x0);
     }
 
+    if (options & FRAGMENTED)
+    {
+        int64_t i_chunk = var_GetInteger(p_mux, SOUT_CFG_PREFIX "chunk-duration");
+        if (i_chunk > 0)
+            p_sys->i_chunk_duration = VLC_TICK_FROM_MS(i_chunk);
+    }
+
     return VLC_SUCCESS;
 }
 
+/* How far the media data must be moved for the moov to fit before it.
+ * The room left after the moov must be able to hold a free box. */
+static uint64_t GetMoovShift(uint64_t i_moov_size, uint64_t i_reserved)
+{
+    if (i_moov_size == i_reserved || i_moov_size + 8 <= i_reserved)
+        return 0;
+    if (i_moov_size > i_reserved)
+        return i_moov_size - i_reserved;
+    return i_moov_size + 8 - i_reserved;
+}
+
 /*****************************************************************************
  * Close:
  *****************************************************************************/
@@ -339,6 +467,7 @@ static void Close(sout_mux_t *p_mux)
         mp4mux_Set64BitExt(p_sys->muxh);
 
     uint64_t i_moov_pos = p_sys->i_pos;
+    uint64_t i_free_size = 0;
     bo_t *moov = mp4mux_GetMoov(p_sys->muxh, VLC_OBJECT(p_mux), 0);
 
     /* Check we need to create "fast start" files */
@@ -348,9 +477,10 @@ static void Close(sout_mux_t *p_mux)
         /* Move data to the end of the file so we can fit the moov header
          * at the start */
         uint64_t i_mdatsize = p_sys->i_pos - p_sys->i_mdat_pos;
+        uint64_t i_shift = GetMoovShift(bo_size(moov), p_sys->i_moov_reserve);
 
         /* moving samples will need new moov with 64bit atoms ? */
-        if(!b_64bitext && p_sys->i_pos + bo_size(moov) > UINT32_MAX)
+        if(i_shift > 0 && !b_64bitext && p_sys->i_pos + i_shift > UINT32_MAX)
         {
             mp4mux_Set64BitExt(p_sys->muxh);
             b_64bitext = true;
@@ -361,25 +491,32 @@ static void Close(sout_mux_t *p_mux)
                 bo_free(moov);
                 moov = moov64;
             }
+            i_shift = GetMoovShift(bo_size(moov), p_sys->i_moov_reserve);
         }
         /* We now know our final MOOV size */
 
-        /* Fix-up samples to chunks table in MOOV header to they point to next MDAT location */
-        mp4mux_ShiftSamples(p_sys->muxh, bo_size(moov));
-        msg_Dbg(p_mux,"Moving data by %"PRIu64, (uint64_t)bo_size(moov));
-        bo_t *shifted = mp4mux_GetMoov(p_sys->muxh, VLC_OBJECT(p_mux), 0);
-        if(!shifted)
+        if (i_shift == 0)
+            msg_Dbg(p_mux, "moov fits in the reserved %"PRIu64" bytes",
+                    p_sys->i_moov_reserve);
+        else
         {
-            /* fail */
-            p_sys->b_fast_start = false;
-            continue;
+            /* Fix-up samples to chunks table in MOOV header to they point to next MDAT location */
+            mp4mux_ShiftSamples(p_sys->muxh, i_shift);
+            msg_Dbg(p_mux,"Moving data by %"PRIu64, i_shift);
+            bo_t *shifted = mp4mux_GetMoov(p_sys->muxh, VLC_OBJECT(p_mux), 0);
+            if(!shifted)
+            {
+                /* fail */
+                p_sys->b_fast_start = false;
+                continue;
+            }
+            assert(bo_size(shifted) == bo_size(moov));
+            bo_free(moov);
+            moov = shifted;
         }
-        assert(bo_size(shifted) == bo_size(moov));
-        bo_free(moov);
-        moov = shifted;
 
-        /* Make space, move MDAT data by moov size towards the end */
-        while (i_mdatsize > 0)
+        /* Make space, move MDAT data by the missing room towards the end */
+        while (i_shift > 0 && i_mdatsize > 0)
         {
             size_t i_chunk = __MIN(32768, i_mdatsize);
             block_t *p_buf = block_Alloc(i_chunk);
@@ -394,7 +531,7 @@ static void Close(sout_mux_t *p_mux)
                 break;
             }
             sout_AccessOutSeek(p_mux->p_access, p_sys->i_mdat_pos + i_mdatsize +
-                               bo_size(moov) - i_chunk);
+                               i_shift - i_chunk);
             sout_AccessOutWrite(p_mux->p_access, p_buf);
             i_mdatsize -= i_chunk;
         }
@@ -403,8 +540,9 @@ static void Close(sout_mux_t *p_mux)
             continue;
 
         /* Update pos pointers */
-        i_moov_pos = p_sys->i_mdat_pos;
-        p_sys->i_mdat_pos += bo_size(moov);
+        i_moov_pos = p_sys->i_mdat_pos - p_sys->i_moov_reserve;
+        p_sys->i_mdat_pos += i_shift;
+        i_free_size = p_sys->i_moov_reserve + i_shift - bo_size(moov);
 
         p_sys->b_fast_start = false;
     }
@@ -414,6 +552,17 @@ static void Close(sout_mux_t *p_mux)
     if (moov != NULL)
         box_send(p_mux, moov);
 
+    /* Mark the unused reserved room as free space */
+    if (i_free_size > 0)
+    {
+        bo_t *freebox = box_new("free");
+        if (freebox)
+        {
+            box_fix(freebox, i_free_size);
+            box_send(p_mux, freebox);
+        }
+    }
+
 cleanup:
     /* Clean-up */
     for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++)
@@ -1017,6 +1166,10 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
             i_tfhd_flags |= MP4_TFHD_DURATION_IS_EMPTY;
         }
 
+        /* CMAF: offsets are relative to the moof (single traf) */
+        if (p_sys->b_cmaf)
+            i_tfhd_flags |= MP4_TFHD_DEFAULT_BASE_IS_MOOF;
+
         /* *** add /moof/traf/tfhd *** */
         bo_t *tfhd = box_full_new("tfhd", 0, i_tfhd_flags);
         if(!tfhd)
@@ -1251,6 +1404,20 @@ static void FlushHeader(sout_mux_t *p_mux)
     if(p_sys->i_pos >= (((uint64_t)0x1) << 32))
         mp4mux_Set64BitExt(p_sys->muxh);
 
+    /* CMAF fragments carry a single track */
+    if (p_sys->i_chunk_duration)
+    {
+        p_sys->b_cmaf = p_sys->i_nb_streams == 1;
+        if (p_sys->b_cmaf)
+        {
+            mp4mux_AddExtraBrand(p_sys->muxh, BRAND_iso6);
+            mp4mux_AddExtraBrand(p_sys->muxh, BRAND_cmfc);
+        }
+        else
+            msg_Warn(p_mux, "%u tracks, not writing CMAF brands",
+                     p_sys->i_nb_streams);
+    }
+
     /* Now add ftyp header */
     bo_t *ftyp = mp4mux_GetFtyp(p_sys->muxh);
     if(!ftyp)
@@ -1268,6 +1435,138 @@ static void FlushHeader(sout_mux_t *p_mux)
     p_sys->b_header_sent = true;
 }
 
+/* Finds the first queued keyframe starting at or after i_time */
+static bool GetQueuedKeyframeTime(const mp4_stream_t *p_stream, vlc_tick_t i_time,
+                                  vlc_tick_t *pi_keyframe)
+{
+    vlc_tick_t i_entry_time = p_stream->i_written_duration;
+    for (const mp4_fragentry_t *p_entry = p_stream->read.p_first;
+         p_entry; p_entry = p_entry->p_next)
+    {
+        if (i_entry_time >= i_time && (p_entry->p_block->i_flags & BLOCK_FLAG_TYPE_I))
+        {
+            *pi_keyframe = i_entry_time;
+            return true;
+        }
+        i_entry_time += p_entry->p_block->i_length;
+    }
+    return false;
+}
+
+/* Sets the end of the next CMAF chunk. A new segment starts on the first
+ * keyframe once the segment has lasted FRAGMENT_LENGTH, or right after it
+ * if no track has keyframes. */
+static bool GetChunkBarrier(sout_mux_t *p_mux, vlc_tick_t *pi_barrier_time)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const vlc_tick_t i_segment_end = p_sys->i_segment_start + FRAGMENT_LENGTH;
+    vlc_tick_t i_barrier_time = p_sys->i_written_duration + p_sys->i_chunk_duration;
+    vlc_tick_t i_min_sample_end = INT64_MAX;
+    bool b_segment_start = !p_sys->b_segment_started;
+    bool b_keyframes = false;
+
+    for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+    {
+        const mp4_stream_t *p_stream = p_sys->pp_streams[i];
+        if (!p_stream->read.p_first)
+            continue;
+
+        i_min_sample_end = __MIN(i_min_sample_end, p_stream->i_written_duration +
+                                 p_stream->read.p_first->p_block->i_length);
+
+        if (!p_stream->b_hasiframes ||
+            mp4mux_track_GetFmt(p_stream->tinfo)->i_cat != VIDEO_ES)
+            continue;
+        b_keyframes = true;
+
+        vlc_tick_t i_keyframe;
+        if (GetQueuedKeyframeTime(p_stream, i_segment_end, &i_keyframe))
+        {
+            if (i_keyframe == p_stream->i_written_duration)
+                b_segment_start = true;
+            else
+                i_barrier_time = __MIN(i_barrier_time, i_keyframe);
+        }
+    }
+
+    if (!b_keyframes)
+    {
+        if (p_sys->i_written_duration >= i_segment_end)
+            b_segment_start = true;
+        else
+            i_barrier_time = __MIN(i_barrier_time, i_segment_end);
+    }
+
+    /* always make progress, even with chunks shorter than a sample */
+    if (i_min_sample_end != INT64_MAX)
+        i_barrier_time = __MAX(i_barrier_time, i_min_sample_end);
+
+    *pi_barrier_time = i_barrier_time;
+    return b_segment_start;
+}
+
+/* Creates the styp (CMAF only) and prft boxes written before each chunk */
+static bo_t *GetChunkHeader(sout_mux_t *p_mux, bool b_segment_start)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    bo_t *styp = NULL;
+
+    if (p_sys->b_cmaf)
+    {
+        styp = box_new("styp");
+        if (!styp)
+            return NULL;
+        const vlc_fourcc_t i_brand = b_segment_start ? BRAND_cmfs : BRAND_cmfl;
+        const vlc_fourcc_t i_cmfc = BRAND_cmfc;
+        bo_add_fourcc(styp, &i_brand);
+        bo_add_32be  (styp, 0);
+        bo_add_fourcc(styp, &i_brand);
+        bo_add_fourcc(styp, &i_cmfc);
+        if (!styp->b)
+        {
+            bo_free(styp);
+            return NULL;
+        }
+        box_fix(styp, bo_size(styp));
+    }
+
+    /* reference the first video track, which drives the segmentation */
+    const mp4_stream_t *p_ref = NULL;
+    for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+    {
+        const mp4_stream_t *p_stream = p_sys->pp_streams[i];
+        if (!p_stream->read.p_first)
+            continue;
+        if (p_ref == NULL ||
+            mp4mux_track_GetFmt(p_stream->tinfo)->i_cat == VIDEO_ES)
+            p_ref = p_stream;
+        if (mp4mux_track_GetFmt(p_ref->tinfo)->i_cat == VIDEO_ES)
+            break;
+    }
+
+    /* wallclock of the moof creation (flags 0x4) for the decode time of the
+     * first sample of the reference track, as in its tfdt */
+    bo_t *prft = p_ref ? box_full_new("prft", 1, 0x4) : NULL;
+    if (prft)
+    {
+        bo_add_32be(prft, mp4mux_track_GetID(p_ref->tinfo));
+        bo_add_64be(prft, NTPtime64());
+        bo_add_64be(prft, samples_from_vlc_tick(p_ref->i_written_duration,
+                                                mp4mux_track_GetTimescale(p_ref->tinfo)));
+        if (styp)
+            box_gather(styp, prft);
+        else if (prft->b)
+        {
+            box_fix(prft, bo_size(prft));
+            return prft;
+        }
+        else
+            bo_free(prft);
+    }
+
+    return styp;
+}
+
 static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
@@ -1294,7 +1593,7 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
             b_has_samples = true;
 
             /* set a barrier so we try to align to keyframe */
-            if (p_stream->b_hasiframes &&
+            if (!p_sys->i_chunk_duration && p_stream->b_hasiframes &&
                     p_stream->i_last_iframe_time > p_stream->i_written_duration &&
                     (mp4mux_track_GetFmt(p_stream->tinfo)->i_cat == VIDEO_ES ||
                      mp4mux_track_GetFmt(p_stream->tinfo)->i_cat == AUDIO_ES) )
@@ -1307,8 +1606,22 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
     if (!p_sys->b_header_sent)
         FlushHeader(p_mux);
 
+    /* chunks are prefixed with styp (CMAF) and prft */
+    bo_t *chunk = NULL;
+    bool b_segment_start = false;
+    if (b_has_samples && p_sys->i_chunk_duration)
+    {
+        b_segment_start = GetChunkBarrier(p_mux, &i_barrier_time);
+        chunk = GetChunkHeader(p_mux, b_segment_start);
+    }
+
+    /* chunks never exceed their duration, even when flushing */
+    if (b_flush && !p_sys->i_chunk_duration)
+        i_barrier_time = 0;
+
     if (b_has_samples)
-        moof = GetMoofBox(p_mux, &i_mdat_size, (b_flush)?0:i_barrier_time, p_sys->i_pos);
+        moof = GetMoofBox(p_mux, &i_mdat_size, i_barrier_time,
+                          p_sys->i_pos + (chunk ? bo_size(chunk) : 0));
 
     if (moof && i_mdat_size == 0)
     {
@@ -1316,11 +1629,36 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
         FREENULL(moof);
     }
 
+    if (chunk)
+    {
+        if (moof)
+        {
+            box_gather(chunk, moof);
+            moof = chunk;
+        }
+        else
+            bo_free(chunk);
+    }
+
+    if (moof && moof->b && p_sys->i_chunk_duration)
+    {
+        /* the streaming server must only start from segments */
+        if (b_segment_start)
+        {
+            msg_Dbg(p_mux, "starting segment @ %"PRId64, p_sys->i_written_duration);
+            moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
+            p_sys->i_segment_start = p_sys->i_written_duration;
+            p_sys->b_segment_started = true;
+        }
+        else
+            moof->b->i_flags &= ~BLOCK_FLAG_TYPE_I;
+    }
+
     if (moof)
     {
         msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
         p_sys->i_pos += bo_size(moof);
-        assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
+        assert(p_sys->i_chunk_duration || (moof->b->i_flags & BLOCK_FLAG_TYPE_I)); /* http sout */
         box_send(p_mux, moof);
         msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
         WriteFragmentMDAT(p_mux, i_mdat_size);
@@ -1384,8 +1722,15 @@ static void CloseFrag(sout_mux_t *p_mux)
         }
     }
 
-    /* and force creating a fragment from it */
-    WriteFragments(p_mux, true);
+    /* and force creating a fragment from it, or as many chunks as needed */
+    bool b_queued;
+    do
+    {
+        WriteFragments(p_mux, true);
+        b_queued = false;
+        for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+            b_queued |= p_sys->pp_streams[i]->read.p_first != NULL;
+    } while (p_sys->i_chunk_duration && b_queued);
 
     /* Write indexes, but only for non streamed content
        as they refer to moof by absolute position */
@@ -1512,7 +1857,9 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    const vlc_tick_t i_fragment_length = p_sys->i_chunk_duration ? p_sys->i_chunk_duration
+                                                                 : FRAGMENT_LENGTH;
+    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
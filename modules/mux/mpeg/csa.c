@@ -26,10 +26,20 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "csa.h"
 
+/* Maximum number of cypher stream bytes needed by one packet */
+#define CSA_STREAM_MAX 184
+/* Maximum number of packets processed by one bitsliced stream cypher run */
+#define CSA_LANES_MAX  256
+/* Below this many packets, the bitsliced stream cypher is slower */
+#define CSA_BATCH_MIN  8
+
 struct csa_t
 {
     /* odd and even keys */
@@ -47,6 +57,9 @@ struct csa_t
     int     p, q, r;
 
     bool    use_odd;
+
+    /* cypher streams of the batch functions */
+    uint8_t (*stream)[CSA_STREAM_MAX];
 };
 
 static void csa_ComputeKey( uint8_t kk[57], uint8_t ck[8] );
@@ -61,7 +74,17 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
  *****************************************************************************/
 csa_t *csa_New( void )
 {
-    return calloc( 1, sizeof( csa_t ) );
+    csa_t *c = calloc( 1, sizeof( csa_t ) );
+    if( !c )
+        return NULL;
+
+    c->stream = malloc( CSA_LANES_MAX * sizeof( *c->stream ) );
+    if( !c->stream )
+    {
+        free( c );
+        return NULL;
+    }
+    return c;
 }
 
 /*****************************************************************************
@@ -69,6 +92,7 @@ csa_t *csa_New( void )
  *****************************************************************************/
 void csa_Delete( csa_t *c )
 {
+    free( c->stream );
     free( c );
 }
 
@@ -307,6 +331,284 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * Bitsliced stream cypher
+ *****************************************************************************/
+
+/* Transposes the 8x8 bit matrix whose row i is byte i of x */
+static inline uint64_t csa_Transpose8x8( uint64_t x )
+{
+    uint64_t t;
+
+    t = ( x ^ ( x >> 7 ) ) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ ( t << 7 );
+    t = ( x ^ ( x >> 14 ) ) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ ( t << 14 );
+    t = ( x ^ ( x >> 28 ) ) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ ( t << 28 );
+    return x;
+}
+
+#define W uint64_t
+#define CSA_BS_LANES 64
+#define CSA_BS(name) csa_bs64_##name
+#define CSA_BS_TARGET
+#include "csa_bitslice.h"
+#undef CSA_BS_TARGET
+#undef CSA_BS
+#undef CSA_BS_LANES
+#undef W
+
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+typedef uint64_t csa_bs128_t __attribute__ ((__vector_size__ (16)));
+# define W csa_bs128_t
+# define CSA_BS_LANES 128
+# define CSA_BS(name) csa_bs128_##name
+# define CSA_BS_TARGET __attribute__ ((__target__ ("sse2")))
+# include "csa_bitslice.h"
+# undef CSA_BS_TARGET
+# undef CSA_BS
+# undef CSA_BS_LANES
+# undef W
+#endif
+
+#if defined(CAN_COMPILE_AVX2) || defined(HAVE_AVX2_INTRINSICS)
+typedef uint64_t csa_bs256_t __attribute__ ((__vector_size__ (32)));
+# define W csa_bs256_t
+# define CSA_BS_LANES 256
+# define CSA_BS(name) csa_bs256_##name
+# define CSA_BS_TARGET __attribute__ ((__target__ ("avx2")))
+# include "csa_bitslice.h"
+# undef CSA_BS_TARGET
+# undef CSA_BS
+# undef CSA_BS_LANES
+# undef W
+#endif
+
+typedef void (*csa_bs_stream_t)( const uint8_t *, const uint8_t *,
+                                  const uint64_t *, const uint8_t *const *,
+                                  unsigned, unsigned,
+                                  uint8_t (*)[CSA_STREAM_MAX] );
+
+/* Picks the widest stream cypher supported by the CPU */
+static unsigned csa_BitsliceGet( csa_bs_stream_t *pf_stream )
+{
+#if defined(CAN_COMPILE_AVX2) || defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+    {
+        *pf_stream = csa_bs256_StreamCypher;
+        return 256;
+    }
+#endif
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+    {
+        *pf_stream = csa_bs128_StreamCypher;
+        return 128;
+    }
+#endif
+    *pf_stream = csa_bs64_StreamCypher;
+    return 64;
+}
+
+static void csa_DecryptLanes( csa_t *c, csa_bs_stream_t pf_stream,
+                              uint8_t *const *pkts, unsigned i_pkts,
+                              int i_pkt_size )
+{
+    const uint8_t *iv[CSA_LANES_MAX];
+    uint8_t *pkt[CSA_LANES_MAX];
+    int hdr[CSA_LANES_MAX];
+    uint64_t odd[CSA_LANES_MAX / 64] = { 0 };
+    unsigned i_lanes = 0, i_blocks = 0;
+
+    for( unsigned l = 0; l < i_pkts; l++ )
+    {
+        uint8_t *p = pkts[l];
+        int i_hdr, n, i_residue;
+
+        /* transport scrambling control */
+        if( (p[3]&0x80) == 0 )
+            continue;
+        const bool b_odd = p[3]&0x40;
+
+        /* clear transport scrambling control */
+        p[3] &= 0x3f;
+
+        i_hdr = 4;
+        if( p[3]&0x20 )
+            i_hdr += p[4] + 1;
+        if( 188 - i_hdr < 8 )
+            continue;
+
+        n = (i_pkt_size - i_hdr) / 8;
+        if( n < 0 )
+            continue;
+        i_residue = (i_pkt_size - i_hdr) % 8;
+
+        /* blocks 2..n, then the residue */
+        unsigned i_needed = (n > 1 ? n - 1 : 0) + (i_residue > 0 ? 1 : 0);
+        if( i_needed > i_blocks )
+            i_blocks = i_needed;
+
+        if( b_odd )
+            odd[i_lanes / 64] |= UINT64_C(1) << (i_lanes % 64);
+        iv[i_lanes] = &p[i_hdr];
+        pkt[i_lanes] = p;
+        hdr[i_lanes] = i_hdr;
+        i_lanes++;
+    }
+
+    if( i_lanes == 0 )
+        return;
+    if( i_blocks > 0 )
+        pf_stream( c->e_ck, c->o_ck, odd, iv, i_lanes, i_blocks, c->stream );
+
+    for( unsigned l = 0; l < i_lanes; l++ )
+    {
+        const uint8_t *stream = c->stream[l];
+        uint8_t *kk = ( odd[l / 64] >> (l % 64) ) & 1 ? c->o_kk : c->e_kk;
+        uint8_t *p = pkt[l];
+        const int i_hdr = hdr[l];
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+        uint8_t ib[8], block[8];
+
+        memcpy( ib, &p[i_hdr], 8 );
+        for( int i = 1; i < n + 1; i++ )
+        {
+            csa_BlockDecypher( kk, ib, block );
+            for( int j = 0; j < 8; j++ )
+                ib[j] = ( i != n ) ? p[i_hdr+8*i+j] ^ stream[8*(i-1)+j] : 0;
+            for( int j = 0; j < 8; j++ )
+                p[i_hdr+8*(i-1)+j] = ib[j] ^ block[j];
+        }
+
+        if( i_residue > 0 )
+        {
+            stream += 8 * ( n > 1 ? n - 1 : 0 );
+            for( int j = 0; j < i_residue; j++ )
+                p[i_pkt_size - i_residue + j] ^= stream[j];
+        }
+    }
+}
+
+static void csa_EncryptLanes( csa_t *c, csa_bs_stream_t pf_stream,
+                              uint8_t *const *pkts, unsigned i_pkts,
+                              int i_pkt_size )
+{
+    const uint8_t *iv[CSA_LANES_MAX];
+    uint8_t *pkt[CSA_LANES_MAX];
+    int hdr[CSA_LANES_MAX];
+    uint64_t odd[CSA_LANES_MAX / 64];
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+    unsigned i_lanes = 0, i_blocks = 0;
+
+    /* all the packets use the same key */
+    memset( odd, c->use_odd ? 0xff : 0x00, sizeof( odd ) );
+
+    for( unsigned l = 0; l < i_pkts; l++ )
+    {
+        uint8_t *p = pkts[l];
+        uint8_t ib[8], block[8];
+        int i_hdr, n, i_residue;
+
+        /* set transport scrambling control */
+        p[3] |= c->use_odd ? 0xc0 : 0x80;
+
+        i_hdr = 4;
+        if( p[3]&0x20 )
+            i_hdr += p[4] + 1;
+        n = (i_pkt_size - i_hdr) / 8;
+        i_residue = (i_pkt_size - i_hdr) % 8;
+
+        if( n <= 0 )
+        {
+            p[3] &= 0x3f;
+            continue;
+        }
+
+        /* block cypher, chained from the last block, done in place */
+        memset( ib, 0, sizeof( ib ) );
+        for( int i = n; i > 0; i-- )
+        {
+            for( int j = 0; j < 8; j++ )
+                block[j] = p[i_hdr+8*(i-1)+j] ^ ib[j];
+            csa_BlockCypher( kk, block, ib );
+            memcpy( &p[i_hdr+8*(i-1)], ib, 8 );
+        }
+
+        /* blocks 2..n, then the residue */
+        unsigned i_needed = n - 1 + (i_residue > 0 ? 1 : 0);
+        if( i_needed > i_blocks )
+            i_blocks = i_needed;
+
+        iv[i_lanes] = &p[i_hdr];
+        pkt[i_lanes] = p;
+        hdr[i_lanes] = i_hdr;
+        i_lanes++;
+    }
+
+    if( i_lanes == 0 || i_blocks == 0 )
+        return;
+    pf_stream( c->e_ck, c->o_ck, odd, iv, i_lanes, i_blocks, c->stream );
+
+    for( unsigned l = 0; l < i_lanes; l++ )
+    {
+        const uint8_t *stream = c->stream[l];
+        uint8_t *p = pkt[l];
+        const int i_hdr = hdr[l];
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+
+        for( int i = 8; i < 8 * n; i++ )
+            p[i_hdr+i] ^= stream[i-8];
+        for( int j = 0; j < i_residue; j++ )
+            p[i_pkt_size - i_residue + j] ^= stream[8*(n-1)+j];
+    }
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t *const *pkts, int i_pkts,
+                       int i_pkt_size )
+{
+    csa_bs_stream_t pf_stream;
+    const unsigned i_max = csa_BitsliceGet( &pf_stream );
+
+    while( i_pkts >= CSA_BATCH_MIN )
+    {
+        const unsigned i_count = __MIN( (unsigned)i_pkts, i_max );
+
+        csa_DecryptLanes( c, pf_stream, pkts, i_count, i_pkt_size );
+        pkts += i_count;
+        i_pkts -= i_count;
+    }
+    for( int i = 0; i < i_pkts; i++ )
+        csa_Decrypt( c, pkts[i], i_pkt_size );
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t *const *pkts, int i_pkts,
+                       int i_pkt_size )
+{
+    csa_bs_stream_t pf_stream;
+    const unsigned i_max = csa_BitsliceGet( &pf_stream );
+
+    while( i_pkts >= CSA_BATCH_MIN )
+    {
+        const unsigned i_count = __MIN( (unsigned)i_pkts, i_max );
+
+        csa_EncryptLanes( c, pf_stream, pkts, i_count, i_pkt_size );
+        pkts += i_count;
+        i_pkts -= i_count;
+    }
+    for( int i = 0; i < i_pkts; i++ )
+        csa_Encrypt( c, pkts[i], i_pkt_size );
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
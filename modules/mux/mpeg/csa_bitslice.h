@@ -0,0 +1,437 @@
+/*****************************************************************************
+ * csa_bitslice.h: bitsliced CSA stream cypher
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is a template included by csa.c once per word type:
+ *  - W is the word type; it must support the C bitwise operators,
+ *  - CSA_BS_LANES is the number of bits in a word,
+ *  - CSA_BS(name) decorates the function and type names,
+ *  - CSA_BS_TARGET gives the function attributes (instruction set).
+ *
+ * Bit n of every word of the cypher state belongs to the n-th packet, so
+ * that one run of the stream cypher processes CSA_BS_LANES packets. */
+
+#define CSA_BS_U64 (CSA_BS_LANES / 64)
+
+/* The S-boxes of the stream cypher, in algebraic normal form: each output
+ * bit is the exclusive or of the products (monomials) of input bits selected
+ * by the Moebius transform of the sbox1..sbox7 tables in csa.c. */
+CSA_BS_TARGET
+static inline void CSA_BS(sbox1)(W i4, W i3, W i2, W i1, W i0, W *o1, W *o0)
+{
+    const W m3 = i0 & i1;
+    const W m5 = i0 & i2;
+    const W m6 = i1 & i2;
+    const W m9 = i0 & i3;
+    const W m10 = i1 & i3;
+    const W m11 = m3 & i3;
+    const W m12 = i2 & i3;
+    const W m13 = m5 & i3;
+    const W m14 = m6 & i3;
+    const W m17 = i0 & i4;
+    const W m19 = m3 & i4;
+    const W m20 = i2 & i4;
+    const W m22 = m6 & i4;
+    const W m24 = i3 & i4;
+    const W m26 = m10 & i4;
+    const W m27 = m11 & i4;
+    const W m28 = m12 & i4;
+    const W m29 = m13 & i4;
+    const W m30 = m14 & i4;
+    *o1 = ~(i0 ^ i1 ^ m3 ^ m5 ^ m6 ^ m9 ^ m10 ^ m12 ^ m13 ^ m14 ^ i4 ^ m19
+             ^ m20 ^ m22 ^ m24 ^ m26 ^ m27 ^ m28 ^ m30);
+    *o0 = i1 ^ m5 ^ i3 ^ m9 ^ m11 ^ m17 ^ m24 ^ m26 ^ m28 ^ m29;
+}
+
+CSA_BS_TARGET
+static inline void CSA_BS(sbox2)(W i4, W i3, W i2, W i1, W i0, W *o1, W *o0)
+{
+    const W m3 = i0 & i1;
+    const W m5 = i0 & i2;
+    const W m6 = i1 & i2;
+    const W m7 = m3 & i2;
+    const W m9 = i0 & i3;
+    const W m10 = i1 & i3;
+    const W m11 = m3 & i3;
+    const W m12 = i2 & i3;
+    const W m13 = m5 & i3;
+    const W m19 = m3 & i4;
+    const W m20 = i2 & i4;
+    const W m22 = m6 & i4;
+    const W m24 = i3 & i4;
+    const W m25 = m9 & i4;
+    const W m26 = m10 & i4;
+    const W m27 = m11 & i4;
+    const W m28 = m12 & i4;
+    const W m29 = m13 & i4;
+    *o1 = ~(i0 ^ i1 ^ m5 ^ m6 ^ m7 ^ i3 ^ m22 ^ m25 ^ m26 ^ m27 ^ m28);
+    *o0 = ~(i1 ^ i2 ^ m5 ^ m11 ^ m13 ^ m19 ^ m20 ^ m24 ^ m27 ^ m29);
+}
+
+CSA_BS_TARGET
+static inline void CSA_BS(sbox3)(W i4, W i3, W i2, W i1, W i0, W *o1, W *o0)
+{
+    const W m3 = i0 & i1;
+    const W m5 = i0 & i2;
+    const W m6 = i1 & i2;
+    const W m7 = m3 & i2;
+    const W m9 = i0 & i3;
+    const W m10 = i1 & i3;
+    const W m11 = m3 & i3;
+    const W m12 = i2 & i3;
+    const W m14 = m6 & i3;
+    const W m18 = i1 & i4;
+    const W m19 = m3 & i4;
+    const W m20 = i2 & i4;
+    const W m21 = m5 & i4;
+    const W m22 = m6 & i4;
+    const W m23 = m7 & i4;
+    const W m25 = m9 & i4;
+    const W m28 = m12 & i4;
+    const W m30 = m14 & i4;
+    *o1 = ~(i0 ^ i1 ^ m5 ^ m6 ^ m7 ^ i3 ^ m9 ^ m10 ^ m11 ^ m12 ^ m14 ^ i4
+             ^ m18 ^ m19 ^ m20 ^ m21 ^ m22 ^ m23 ^ m25 ^ m28 ^ m30);
+    *o0 = i1 ^ m3 ^ m5 ^ i3 ^ i4;
+}
+
+CSA_BS_TARGET
+static inline void CSA_BS(sbox4)(W i4, W i3, W i2, W i1, W i0, W *o1, W *o0)
+{
+    const W m3 = i0 & i1;
+    const W m6 = i1 & i2;
+    const W m7 = m3 & i2;
+    const W m9 = i0 & i3;
+    const W m11 = m3 & i3;
+    const W m12 = i2 & i3;
+    const W m14 = m6 & i3;
+    const W m17 = i0 & i4;
+    const W m18 = i1 & i4;
+    const W m23 = m7 & i4;
+    const W m24 = i3 & i4;
+    const W m25 = m9 & i4;
+    const W m27 = m11 & i4;
+    const W m28 = m12 & i4;
+    const W m30 = m14 & i4;
+    *o1 = ~(i0 ^ m3 ^ i2 ^ m7 ^ i3 ^ m14 ^ i4 ^ m17 ^ m18 ^ m23 ^ m24 ^ m25
+             ^ m27 ^ m28 ^ m30);
+    *o0 = ~(i1 ^ m3 ^ i2 ^ m9 ^ m11 ^ m12 ^ m17 ^ m18 ^ m23 ^ m24 ^ m25
+             ^ m27 ^ m28 ^ m30);
+}
+
+CSA_BS_TARGET
+static inline void CSA_BS(sbox5)(W i4, W i3, W i2, W i1, W i0, W *o1, W *o0)
+{
+    const W m3 = i0 & i1;
+    const W m5 = i0 & i2;
+    const W m6 = i1 & i2;
+    const W m7 = m3 & i2;
+    const W m9 = i0 & i3;
+    const W m10 = i1 & i3;
+    const W m11 = m3 & i3;
+    const W m13 = m5 & i3;
+    const W m14 = m6 & i3;
+    const W m17 = i0 & i4;
+    const W m18 = i1 & i4;
+    const W m20 = i2 & i4;
+    const W m21 = m5 & i4;
+    const W m22 = m6 & i4;
+    const W m23 = m7 & i4;
+    const W m24 = i3 & i4;
+    const W m25 = m9 & i4;
+    const W m26 = m10 & i4;
+    const W m27 = m11 & i4;
+    const W m29 = m13 & i4;
+    const W m30 = m14 & i4;
+    *o1 = ~(i0 ^ i1 ^ m3 ^ m5 ^ m6 ^ m7 ^ i3 ^ m9 ^ m11 ^ m13 ^ m14 ^ m17
+             ^ m18 ^ m20 ^ m22 ^ m23 ^ m25 ^ m26 ^ m29 ^ m30);
+    *o0 = m3 ^ i2 ^ m5 ^ m7 ^ m9 ^ m10 ^ m13 ^ m17 ^ m20 ^ m21 ^ m22 ^ m23
+           ^ m24 ^ m25 ^ m26 ^ m27;
+}
+
+CSA_BS_TARGET
+static inline void CSA_BS(sbox6)(W i4, W i3, W i2, W i1, W i0, W *o1, W *o0)
+{
+    const W m3 = i0 & i1;
+    const W m5 = i0 & i2;
+    const W m6 = i1 & i2;
+    const W m7 = m3 & i2;
+    const W m9 = i0 & i3;
+    const W m10 = i1 & i3;
+    const W m11 = m3 & i3;
+    const W m12 = i2 & i3;
+    const W m13 = m5 & i3;
+    const W m14 = m6 & i3;
+    const W m19 = m3 & i4;
+    const W m22 = m6 & i4;
+    const W m23 = m7 & i4;
+    const W m25 = m9 & i4;
+    const W m27 = m11 & i4;
+    const W m30 = m14 & i4;
+    *o1 = i1 ^ m5 ^ m11 ^ m12 ^ m13 ^ i4 ^ m19 ^ m25;
+    *o0 = i0 ^ i2 ^ m6 ^ m7 ^ m10 ^ m12 ^ m14 ^ m19 ^ m22 ^ m23 ^ m27 ^ m30;
+}
+
+CSA_BS_TARGET
+static inline void CSA_BS(sbox7)(W i4, W i3, W i2, W i1, W i0, W *o1, W *o0)
+{
+    const W m3 = i0 & i1;
+    const W m6 = i1 & i2;
+    const W m7 = m3 & i2;
+    const W m10 = i1 & i3;
+    const W m11 = m3 & i3;
+    const W m12 = i2 & i3;
+    const W m14 = m6 & i3;
+    const W m17 = i0 & i4;
+    const W m19 = m3 & i4;
+    const W m20 = i2 & i4;
+    const W m22 = m6 & i4;
+    const W m23 = m7 & i4;
+    const W m26 = m10 & i4;
+    const W m27 = m11 & i4;
+    const W m30 = m14 & i4;
+    *o1 = i0 ^ i1 ^ m3 ^ i2 ^ i3 ^ m11 ^ m17 ^ m19 ^ m20 ^ m22 ^ m23 ^ m27
+           ^ m30;
+    *o0 = i0 ^ m3 ^ i2 ^ m6 ^ m7 ^ i3 ^ m12 ^ i4 ^ m26 ^ m27;
+}
+
+
+/* Selects b in the lanes of sel, a in the other lanes */
+CSA_BS_TARGET
+static inline W CSA_BS(mux)(W a, W b, W sel)
+{
+    return a ^ ((a ^ b) & sel);
+}
+
+struct CSA_BS(state)
+{
+    /* Registers A[1..10] and B[1..10] are 4 bits each; index 0 is unused */
+    W A[11][4];
+    W B[11][4];
+    W X[4], Y[4], Z[4];
+    W D[4], E[4], F[4];
+    W p, q, r;
+};
+
+/* One iteration of the stream cypher, giving out 2 bits per packet.
+ * During initialisation, in_a and in_b are the nibbles fed to A and B. */
+CSA_BS_TARGET
+static inline void CSA_BS(Clock)(struct CSA_BS(state) *restrict s, bool init,
+                                 const W *in_a, const W *in_b,
+                                 W *restrict hi, W *restrict lo)
+{
+    W s1[2], s2[2], s3[2], s4[2], s5[2], s6[2], s7[2];
+
+    /* From A[1]..A[10], 35 bits are selected as inputs to 7 s-boxes */
+    CSA_BS(sbox1)(s->A[4][0], s->A[1][2], s->A[6][1], s->A[7][3], s->A[9][0],
+                  &s1[1], &s1[0]);
+    CSA_BS(sbox2)(s->A[2][1], s->A[3][2], s->A[6][3], s->A[7][0], s->A[9][1],
+                  &s2[1], &s2[0]);
+    CSA_BS(sbox3)(s->A[1][3], s->A[2][0], s->A[5][1], s->A[5][3], s->A[6][2],
+                  &s3[1], &s3[0]);
+    CSA_BS(sbox4)(s->A[3][3], s->A[1][1], s->A[2][3], s->A[4][2], s->A[8][0],
+                  &s4[1], &s4[0]);
+    CSA_BS(sbox5)(s->A[5][2], s->A[4][3], s->A[6][0], s->A[8][1], s->A[9][2],
+                  &s5[1], &s5[0]);
+    CSA_BS(sbox6)(s->A[3][1], s->A[4][1], s->A[5][0], s->A[7][2], s->A[9][3],
+                  &s6[1], &s6[0]);
+    CSA_BS(sbox7)(s->A[2][2], s->A[3][0], s->A[7][1], s->A[8][2], s->A[8][3],
+                  &s7[1], &s7[0]);
+
+    /* 4x4 xor to produce the extra nibble for T3 */
+    W extra_B[4];
+    extra_B[3] = s->B[3][0] ^ s->B[6][1] ^ s->B[7][2] ^ s->B[9][3];
+    extra_B[2] = s->B[6][0] ^ s->B[8][1] ^ s->B[3][3] ^ s->B[4][2];
+    extra_B[1] = s->B[5][3] ^ s->B[8][2] ^ s->B[4][0] ^ s->B[5][1];
+    extra_B[0] = s->B[9][2] ^ s->B[6][3] ^ s->B[3][1] ^ s->B[8][0];
+
+    /* T1 and T2 */
+    W next_A1[4], next_B1[4];
+    for (unsigned k = 0; k < 4; k++)
+    {
+        next_A1[k] = s->A[10][k] ^ s->X[k];
+        next_B1[k] = s->B[7][k] ^ s->B[10][k] ^ s->Y[k];
+        if (init)
+        {
+            next_A1[k] ^= s->D[k] ^ in_a[k];
+            next_B1[k] ^= in_b[k];
+        }
+    }
+
+    /* If p=1, rotate T2 left */
+    const W b3 = next_B1[3];
+    next_B1[3] = CSA_BS(mux)(next_B1[3], next_B1[2], s->p);
+    next_B1[2] = CSA_BS(mux)(next_B1[2], next_B1[1], s->p);
+    next_B1[1] = CSA_BS(mux)(next_B1[1], next_B1[0], s->p);
+    next_B1[0] = CSA_BS(mux)(next_B1[0], b3, s->p);
+
+    /* T3 */
+    for (unsigned k = 0; k < 4; k++)
+        s->D[k] = s->E[k] ^ s->Z[k] ^ extra_B[k];
+
+    /* T4: F = Z + E + r if q=1, with carry in r; F = E otherwise */
+    W carry = s->r;
+    for (unsigned k = 0; k < 4; k++)
+    {
+        const W half = s->Z[k] ^ s->E[k];
+        const W sum = half ^ carry;
+        const W next_E = s->F[k];
+
+        carry = (s->Z[k] & s->E[k]) | (carry & half);
+        s->F[k] = CSA_BS(mux)(s->E[k], sum, s->q);
+        s->E[k] = next_E;
+    }
+    s->r = CSA_BS(mux)(s->r, carry, s->q);
+
+    memmove(&s->A[2], &s->A[1], 9 * sizeof (s->A[1]));
+    memmove(&s->B[2], &s->B[1], 9 * sizeof (s->B[1]));
+    memcpy(s->A[1], next_A1, sizeof (next_A1));
+    memcpy(s->B[1], next_B1, sizeof (next_B1));
+
+    s->X[0] = s1[1]; s->X[1] = s2[1]; s->X[2] = s3[0]; s->X[3] = s4[0];
+    s->Y[0] = s3[1]; s->Y[1] = s4[1]; s->Y[2] = s5[0]; s->Y[3] = s6[0];
+    s->Z[0] = s5[1]; s->Z[1] = s6[1]; s->Z[2] = s1[0]; s->Z[3] = s2[0];
+    s->p = s7[1];
+    s->q = s7[0];
+
+    /* 2 output bits are a function of the 4 bits of D, xor 2 by 2 */
+    *hi = s->D[2] ^ s->D[3];
+    *lo = s->D[0] ^ s->D[1];
+}
+
+/* Gathers byte i of each lane into 8 bit planes */
+CSA_BS_TARGET
+static void CSA_BS(Gather)(const uint8_t *const *bytes, unsigned i,
+                           unsigned lanes, W plane[8])
+{
+    uint64_t u[8][CSA_BS_U64];
+
+    memset(u, 0, sizeof (u));
+    for (unsigned l = 0; l < lanes; l += 8)
+    {
+        uint64_t x = 0;
+
+        for (unsigned g = 0; g < 8 && l + g < lanes; g++)
+            x |= (uint64_t)bytes[l + g][i] << (8 * g);
+        x = csa_Transpose8x8(x);
+        for (unsigned k = 0; k < 8; k++)
+            u[k][l / 64] |= ((x >> (8 * k)) & 0xff) << (l % 64);
+    }
+    for (unsigned k = 0; k < 8; k++)
+        memcpy(&plane[k], u[k], sizeof (plane[k]));
+}
+
+/* Scatters 8 bit planes to byte i of each lane */
+CSA_BS_TARGET
+static void CSA_BS(Scatter)(const W plane[8], unsigned lanes,
+                            uint8_t (*bytes)[CSA_STREAM_MAX], unsigned i)
+{
+    uint64_t u[8][CSA_BS_U64];
+
+    for (unsigned k = 0; k < 8; k++)
+        memcpy(u[k], &plane[k], sizeof (u[k]));
+    for (unsigned l = 0; l < lanes; l += 8)
+    {
+        uint64_t x = 0;
+
+        for (unsigned k = 0; k < 8; k++)
+            x |= ((u[k][l / 64] >> (l % 64)) & 0xff) << (8 * k);
+        x = csa_Transpose8x8(x);
+        for (unsigned g = 0; g < 8 && l + g < lanes; g++)
+            bytes[l + g][i] = x >> (8 * g);
+    }
+}
+
+/**
+ * Runs the stream cypher for up to CSA_BS_LANES packets at once.
+ *
+ * \param e_ck even control word
+ * \param o_ck odd control word
+ * \param odd bit mask of the lanes using the odd control word
+ * \param iv 8 bytes initialisation vector of each lane
+ * \param lanes number of lanes
+ * \param blocks number of 8 bytes blocks to produce for each lane
+ * \param out cypher stream of each lane
+ */
+CSA_BS_TARGET
+static void CSA_BS(StreamCypher)(const uint8_t e_ck[8], const uint8_t o_ck[8],
+                                 const uint64_t *odd,
+                                 const uint8_t *const *iv, unsigned lanes,
+                                 unsigned blocks,
+                                 uint8_t (*out)[CSA_STREAM_MAX])
+{
+    struct CSA_BS(state) s;
+    W kodd, zero;
+
+    assert(lanes <= CSA_BS_LANES);
+    assert(blocks * 8 <= CSA_STREAM_MAX);
+
+    memcpy(&kodd, odd, sizeof (kodd));
+    zero = kodd ^ kodd;
+
+    /* Load the first 32 bits of CK into A[1]..A[8],
+     * the last 32 bits of CK into B[1]..B[8], all other registers = 0 */
+    for (unsigned i = 0; i < 8; i++)
+    {
+        const unsigned shift = (i & 1) ? 0 : 4;
+        const unsigned e_a = (e_ck[i / 2] >> shift) & 0xf;
+        const unsigned o_a = (o_ck[i / 2] >> shift) & 0xf;
+        const unsigned e_b = (e_ck[4 + i / 2] >> shift) & 0xf;
+        const unsigned o_b = (o_ck[4 + i / 2] >> shift) & 0xf;
+
+        for (unsigned k = 0; k < 4; k++)
+        {
+            s.A[1 + i][k] = (((e_a >> k) & 1) ? ~kodd : zero)
+                          | (((o_a >> k) & 1) ? kodd : zero);
+            s.B[1 + i][k] = (((e_b >> k) & 1) ? ~kodd : zero)
+                          | (((o_b >> k) & 1) ? kodd : zero);
+        }
+    }
+    for (unsigned k = 0; k < 4; k++)
+    {
+        s.A[9][k] = s.A[10][k] = zero;
+        s.B[9][k] = s.B[10][k] = zero;
+        s.X[k] = s.Y[k] = s.Z[k] = zero;
+        s.D[k] = s.E[k] = s.F[k] = zero;
+    }
+    s.p = s.q = s.r = zero;
+
+    /* Initialisation with the first 8 bytes; the output is discarded */
+    for (unsigned i = 0; i < 8; i++)
+    {
+        W in[8], hi, lo;
+
+        CSA_BS(Gather)(iv, i, lanes, in);
+        /* in1 (high nibble) and in2 (low nibble) alternate */
+        for (unsigned j = 0; j < 4; j++)
+            CSA_BS(Clock)(&s, true, (j & 1) ? &in[0] : &in[4],
+                          (j & 1) ? &in[4] : &in[0], &hi, &lo);
+    }
+
+    for (unsigned i = 0; i < 8 * blocks; i++)
+    {
+        W op[8];
+
+        /* 4 iterations per output byte, most significant bits first */
+        for (unsigned j = 0; j < 4; j++)
+            CSA_BS(Clock)(&s, false, NULL, NULL, &op[7 - 2 * j], &op[6 - 2 * j]);
+        CSA_BS(Scatter)(op, lanes, out, i);
+    }
+}
+
+#undef CSA_BS_U64
@@ -190,6 +190,7 @@ static const char *const ts_standards_list_text[] =
 #endif
 
 #define BLOCK_FLAG_NO_KEYFRAME (1 << BLOCK_FLAG_PRIVATE_SHIFT) /* This is not a key frame for bitrate shaping */
+#define CSA_BATCH 256    /* Maximum packets scrambled by one csa_EncryptBatch() call */
 
 vlc_plugin_begin ()
     set_description( "TS (libdvbpsi)" )
@@ -1730,6 +1731,31 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+/* Scrambles all the flagged packets of the chain at once: the bitsliced
+ * stream cypher is much faster on many packets than on a single one. */
+static void TSScramble( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    uint8_t *pkts[CSA_BATCH];
+    int i_pkts = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( block_t *p_ts = p_chain_ts->p_first; p_ts != NULL; p_ts = p_ts->p_next )
+    {
+        if( !(p_ts->i_flags & BLOCK_FLAG_SCRAMBLED) )
+            continue;
+        pkts[i_pkts++] = p_ts->p_buffer;
+        if( i_pkts == CSA_BATCH )
+        {
+            csa_EncryptBatch( p_sys->csa, pkts, i_pkts, p_sys->i_csa_pkt_size );
+            i_pkts = 0;
+        }
+    }
+    if( i_pkts > 0 )
+        csa_EncryptBatch( p_sys->csa, pkts, i_pkts, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
@@ -1743,6 +1769,11 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    /* The PCR written below lies in the adaptation field, which is
+     * never scrambled, so the whole chain can be scrambled first. */
+    if( p_sys->csa != NULL )
+        TSScramble( p_mux, p_chain_ts );
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
@@ -1757,13 +1788,6 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
-
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
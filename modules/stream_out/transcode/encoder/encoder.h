@@ -23,6 +23,61 @@
 
 typedef struct transcode_encoder_t transcode_encoder_t;
 
+/* Statistics of a pipeline stage: depth of its input queue, and latency
+ * between queuing a picture and starting to process it. They are
+ * logged periodically, and when the stage stops. */
+#define TRANSCODE_STATS_PERIOD VLC_TICK_FROM_SEC(10)
+
+typedef struct
+{
+    const char *psz_name;
+    vlc_tick_t  i_since;       /* start of the reporting period */
+    unsigned    i_count;       /* pictures processed during the period */
+    size_t      i_depth_sum;
+    size_t      i_depth_max;
+    vlc_tick_t  i_latency_sum;
+    vlc_tick_t  i_latency_max;
+} transcode_stage_stats_t;
+
+static inline void transcode_stage_stats_init( transcode_stage_stats_t *p_stats,
+                                               const char *psz_name )
+{
+    memset( p_stats, 0, sizeof(*p_stats) );
+    p_stats->psz_name = psz_name;
+    p_stats->i_since = vlc_tick_now();
+}
+
+static inline void transcode_stage_stats_report( vlc_object_t *p_obj,
+                                                 transcode_stage_stats_t *p_stats )
+{
+    if( p_stats->i_count > 0 )
+        msg_Dbg( p_obj, "%s stage: %u pictures, queue depth %.1f (max %zu), "
+                 "latency %"PRId64" ms (max %"PRId64" ms)",
+                 p_stats->psz_name, p_stats->i_count,
+                 (double)p_stats->i_depth_sum / p_stats->i_count,
+                 p_stats->i_depth_max,
+                 MS_FROM_VLC_TICK( p_stats->i_latency_sum / p_stats->i_count ),
+                 MS_FROM_VLC_TICK( p_stats->i_latency_max ) );
+    transcode_stage_stats_init( p_stats, p_stats->psz_name );
+}
+
+/* Accounts for a picture leaving the queue of the stage */
+static inline void transcode_stage_stats_add( vlc_object_t *p_obj,
+                                              transcode_stage_stats_t *p_stats,
+                                              size_t i_depth, vlc_tick_t i_queued )
+{
+    const vlc_tick_t now = vlc_tick_now();
+
+    p_stats->i_count++;
+    p_stats->i_depth_sum += i_depth;
+    p_stats->i_depth_max = __MAX( p_stats->i_depth_max, i_depth );
+    p_stats->i_latency_sum += now - i_queued;
+    p_stats->i_latency_max = __MAX( p_stats->i_latency_max, now - i_queued );
+
+    if( now - p_stats->i_since >= TRANSCODE_STATS_PERIOD )
+        transcode_stage_stats_report( p_obj, p_stats );
+}
+
 typedef struct
 {
     vlc_fourcc_t i_codec; /* (0 if not transcode) */
@@ -44,6 +99,7 @@ typedef struct
                 unsigned int i_count;
                 int          i_priority;
                 uint32_t     pool_size;
+                bool         b_pipeline; /* filter on its own thread */
             } threads;
         } video;
         struct
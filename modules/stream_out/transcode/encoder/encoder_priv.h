@@ -28,6 +28,13 @@ struct transcode_encoder_t
     vlc_sem_t       picture_pool_has_room;
     vlc_cond_t      cond;
 
+    /* queuing dates of the pictures in pp_pics, for the statistics */
+    vlc_tick_t      *p_dates;
+    unsigned        i_dates_size;
+    unsigned        i_dates_first;
+    unsigned        i_depth;
+    transcode_stage_stats_t stats;
+
     /* output buffers */
     block_t         *p_buffers;
     bool b_threaded;
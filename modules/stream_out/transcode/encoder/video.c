@@ -344,6 +344,12 @@ static void* EncoderThread( void *obj )
 
         if( p_pic )
         {
+            transcode_stage_stats_add( VLC_OBJECT(p_enc->p_encoder), &p_enc->stats,
+                                       p_enc->i_depth,
+                                       p_enc->p_dates[p_enc->i_dates_first] );
+            p_enc->i_dates_first = (p_enc->i_dates_first + 1) % p_enc->i_dates_size;
+            p_enc->i_depth--;
+
             /* release lock while encoding */
             vlc_mutex_unlock( &p_enc->lock_out );
             p_block = p_enc->p_encoder->pf_encode_video( p_enc->p_encoder, p_pic );
@@ -372,6 +378,8 @@ static void* EncoderThread( void *obj )
         block_ChainAppend( &p_enc->p_buffers, p_block );
     } while( p_block );
 
+    transcode_stage_stats_report( VLC_OBJECT(p_enc->p_encoder), &p_enc->stats );
+
     vlc_mutex_unlock( &p_enc->lock_out );
 
     vlc_restorecancel (canc);
@@ -421,6 +429,8 @@ void transcode_encoder_video_close( transcode_encoder_t *p_enc )
 
     vlc_cond_destroy( &p_enc->cond );
     vlc_sem_destroy( &p_enc->picture_pool_has_room );
+    free( p_enc->p_dates );
+    p_enc->p_dates = NULL;
 }
 
 int transcode_encoder_video_open( transcode_encoder_t *p_enc,
@@ -445,10 +455,20 @@ int transcode_encoder_video_open( transcode_encoder_t *p_enc,
     p_enc->p_buffers = NULL;
     p_enc->b_abort = false;
 
-    if( p_cfg->video.threads.i_count > 0 )
+    if( p_cfg->video.threads.i_count > 0 || p_cfg->video.threads.b_pipeline )
     {
-        if( vlc_clone( &p_enc->thread, EncoderThread, p_enc, p_cfg->video.threads.i_priority ) )
+        /* The semaphore bounds the queue to pool_size pictures */
+        p_enc->i_dates_size = p_cfg->video.threads.pool_size;
+        p_enc->i_dates_first = 0;
+        p_enc->i_depth = 0;
+        p_enc->p_dates = vlc_alloc( p_enc->i_dates_size, sizeof(*p_enc->p_dates) );
+        transcode_stage_stats_init( &p_enc->stats, "encoder" );
+
+        if( !p_enc->p_dates ||
+            vlc_clone( &p_enc->thread, EncoderThread, p_enc, p_cfg->video.threads.i_priority ) )
         {
+            free( p_enc->p_dates );
+            p_enc->p_dates = NULL;
             vlc_cond_destroy( &p_enc->cond );
             vlc_sem_destroy( &p_enc->picture_pool_has_room );
             module_unneed( p_enc->p_encoder, p_enc->p_encoder->p_module );
@@ -473,6 +493,8 @@ block_t * transcode_encoder_video_encode( transcode_encoder_t *p_enc, picture_t
         vlc_mutex_lock( &p_enc->lock_out );
         picture_Hold( p_pic );
         picture_fifo_Push( p_enc->pp_pics, p_pic );
+        p_enc->p_dates[(p_enc->i_dates_first + p_enc->i_depth++) % p_enc->i_dates_size] =
+            vlc_tick_now();
         vlc_cond_signal( &p_enc->cond );
         vlc_mutex_unlock( &p_enc->lock_out );
         return NULL;
@@ -32,6 +32,7 @@
 #endif
 
 #include <vlc_common.h>
+#include <vlc_util.h>
 #include <vlc_plugin.h>
 #include <vlc_sout.h>
 #include <vlc_spu.h>
@@ -75,6 +76,12 @@
 #define MAXHEIGHT_TEXT N_("Maximum height")
 #define MAXHEIGHT_LONGTEXT N_( \
     "Maximum output video height." )
+#define RENDITIONS_TEXT N_("Renditions")
+#define RENDITIONS_LONGTEXT N_( \
+    "Semicolon-separated list of WIDTHxHEIGHT@KBPS renditions, encoded from " \
+    "the same decoded video. The first one is the main output, the others " \
+    "are added as separate video streams. A null height keeps the aspect " \
+    "ratio, and a missing bitrate defaults to vb." )
 #define VFILTER_TEXT N_("Filters")
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
@@ -131,6 +138,10 @@
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
+#define PIPELINE_TEXT N_("Pipelined video transcoding")
+#define PIPELINE_LONGTEXT N_( \
+    "Decodes, filters and encodes the video on separate threads, with at " \
+    "most pool-size pictures queued between each stage." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -174,6 +185,8 @@ vlc_plugin_begin ()
                  MAXWIDTH_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "maxheight", 0, MAXHEIGHT_TEXT,
                  MAXHEIGHT_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "renditions", NULL, RENDITIONS_TEXT,
+                RENDITIONS_LONGTEXT, true )
     add_module_list(SOUT_CFG_PREFIX "vfilter", VLC_CAP_VIDEO_FILTER, NULL,
                     VFILTER_TEXT, VFILTER_LONGTEXT)
 
@@ -212,6 +225,8 @@ vlc_plugin_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "pipeline", false, PIPELINE_TEXT,
+              PIPELINE_LONGTEXT, true )
 
 vlc_plugin_end ()
 
@@ -221,7 +236,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "pipeline", "renditions", NULL
 };
 
 /*****************************************************************************
@@ -322,6 +337,7 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
 
     p_cfg->video.threads.i_count = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_cfg->video.threads.pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
+    p_cfg->video.threads.b_pipeline = var_GetBool( p_stream, SOUT_CFG_PREFIX "pipeline" );
 
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" ) )
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_OUTPUT;
@@ -329,6 +345,61 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_VIDEO;
 }
 
+/* Parses the ABR ladder: the first rung overrides the main video encoder
+ * config, the other ones are copies of it */
+static void SetVideoRenditions( sout_stream_t *p_stream, sout_stream_sys_t *p_sys )
+{
+    char *psz_string = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "renditions" );
+    if( !psz_string )
+        return;
+
+    size_t i_count = 1;
+    for( const char *p = psz_string; (p = strchr( p, ';' )) != NULL; p++ )
+        i_count++;
+
+    if( i_count > 1 )
+    {
+        p_sys->p_vrenditions = vlc_alloc( i_count - 1, sizeof(*p_sys->p_vrenditions) );
+        if( !p_sys->p_vrenditions )
+        {
+            free( psz_string );
+            return;
+        }
+    }
+
+    char *psz_save, *psz_rung = strtok_r( psz_string, ";", &psz_save );
+    for( size_t i = 0; psz_rung; psz_rung = strtok_r( NULL, ";", &psz_save ) )
+    {
+        unsigned i_width, i_height, i_bitrate = 0;
+
+        if( sscanf( psz_rung, "%ux%u@%u", &i_width, &i_height, &i_bitrate ) < 2 )
+        {
+            msg_Warn( p_stream, "invalid rendition `%s'", psz_rung );
+            continue;
+        }
+        if( i_bitrate > 0 && i_bitrate < 16000 )
+            i_bitrate *= 1000;
+
+        transcode_encoder_config_t *p_cfg = &p_sys->venc_cfg;
+        if( i > 0 )
+        {
+            if( i >= i_count )
+                break;
+            p_cfg = &p_sys->p_vrenditions[p_sys->i_vrenditions++];
+            *p_cfg = p_sys->venc_cfg;
+        }
+        i++;
+
+        p_cfg->video.i_width = i_width;
+        p_cfg->video.i_height = i_height;
+        if( i_bitrate > 0 )
+            p_cfg->video.i_bitrate = i_bitrate;
+        msg_Dbg( p_stream, "rendition %zu: %ux%u %ukb/s", i, i_width,
+                 i_height, p_cfg->video.i_bitrate / 1000 );
+    }
+    free( psz_string );
+}
+
 static void SetSPUEncoderConfig( sout_stream_t *p_stream, transcode_encoder_config_t *p_cfg )
 {
     char *psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "senc" );
@@ -411,6 +482,7 @@ static int Open( sout_stream_t *p_stream )
     transcode_encoder_config_init( &p_sys->venc_cfg );
 
     SetVideoEncoderConfig( p_stream, &p_sys->venc_cfg );
+    SetVideoRenditions( p_stream, p_sys );
     p_sys->b_master_sync = (p_sys->venc_cfg.video.fps.num > 0);
     if( p_sys->venc_cfg.i_codec )
     {
@@ -476,6 +548,8 @@ static void Close( sout_stream_t *p_stream )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
 
+    /* the renditions share the strings of venc_cfg */
+    free( p_sys->p_vrenditions );
     transcode_encoder_config_clean( &p_sys->venc_cfg );
     sout_filters_config_clean( &p_sys->vfilters_cfg );
 
@@ -39,6 +39,7 @@ void sout_filters_config_clean( sout_filters_config_t *p_cfg )
 }
 
 typedef struct sout_stream_id_sys_t sout_stream_id_sys_t;
+struct transcode_video_pipeline;
 
 typedef struct
 {
@@ -53,6 +54,10 @@ typedef struct
     /* Video */
     transcode_encoder_config_t venc_cfg;
     sout_filters_config_t vfilters_cfg;
+    /* Other renditions encoded from the same decoded pictures; they share
+     * the strings and the config chain of venc_cfg */
+    transcode_encoder_config_t *p_vrenditions;
+    size_t                      i_vrenditions;
 
     /* SPU */
     transcode_encoder_config_t senc_cfg;
@@ -123,6 +128,9 @@ struct sout_stream_id_sys_t
              filter_t        *p_spu_blender;
              spu_t           *p_spu;
              video_format_t  fmt_input_video;
+             struct transcode_video_pipeline *p_pipeline; /**< Filter thread */
+             sout_stream_id_sys_t **pp_renditions; /**< Other rungs of the ladder */
+             size_t          i_renditions;
          };
          struct
          {
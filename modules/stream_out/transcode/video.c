@@ -31,6 +31,7 @@
 #endif
 
 #include <vlc_common.h>
+#include <vlc_util.h>
 #include <vlc_meta.h>
 #include <vlc_spu.h>
 #include <vlc_modules.h>
@@ -129,6 +130,79 @@ static picture_t *transcode_dequeue_all_pics( sout_stream_id_sys_t *id )
     return p_pics;
 }
 
+static struct transcode_video_pipeline *
+PipelineNew( sout_stream_t *, sout_stream_id_sys_t * );
+static void PipelineDelete( struct transcode_video_pipeline * );
+static void PipelineWait( struct transcode_video_pipeline * );
+
+static void *transcode_rendition_downstream_add( sout_stream_t *p_stream,
+                                                 const es_format_t *fmt_orig,
+                                                 const es_format_t *fmt )
+{
+    es_format_t tmp;
+    es_format_Init( &tmp, fmt->i_cat, fmt->i_codec );
+    es_format_Copy( &tmp, fmt );
+
+    if( !tmp.psz_language && fmt_orig->psz_language )
+        tmp.psz_language = strdup( fmt_orig->psz_language );
+
+    /* Same program, but the ES id is left to the downstream modules, as it
+     * must differ from the id of the main rendition */
+    tmp.i_group = fmt_orig->i_group;
+    tmp.i_id = -1;
+
+    void *downstream = sout_StreamIdAdd( p_stream->p_next, &tmp );
+    es_format_Clean( &tmp );
+    return downstream;
+}
+
+/* Creates a rendition fed with the pictures decoded by id */
+static sout_stream_id_sys_t *
+transcode_video_rendition_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                               const transcode_encoder_config_t *p_cfg,
+                               const es_format_t *p_enc_fmt_in )
+{
+    sout_stream_id_sys_t *rung = calloc( 1, sizeof(*rung) );
+    if( !rung )
+        return NULL;
+
+    rung->encoder = transcode_encoder_new( VLC_OBJECT(p_stream), p_enc_fmt_in );
+    if( !rung->encoder )
+    {
+        free( rung );
+        return NULL;
+    }
+    transcode_encoder_update_format_in( rung->encoder, p_enc_fmt_in );
+
+    vlc_mutex_init( &rung->fifo.lock );
+    rung->b_transcode = true;
+    rung->p_decoder = id->p_decoder; /* owned by id */
+    rung->pf_transcode_downstream_add = transcode_rendition_downstream_add;
+    rung->p_filterscfg = id->p_filterscfg;
+    rung->p_enccfg = p_cfg;
+    es_format_Init( &rung->decoder_out, VIDEO_ES, 0 );
+    es_format_Copy( &rung->decoder_out, &id->decoder_out );
+    video_format_Init( &rung->fmt_input_video, 0 );
+
+    if( p_cfg->video.threads.b_pipeline )
+    {
+        rung->p_pipeline = PipelineNew( p_stream, rung );
+        if( !rung->p_pipeline )
+            msg_Warn( p_stream, "cannot start the filter thread" );
+    }
+    return rung;
+}
+
+static void transcode_video_rendition_delete( sout_stream_t *p_stream,
+                                              sout_stream_id_sys_t *rung )
+{
+    transcode_video_clean( p_stream, rung );
+    if( rung->downstream_id )
+        sout_StreamIdDel( p_stream->p_next, rung->downstream_id );
+    vlc_mutex_destroy( &rung->fifo.lock );
+    free( rung );
+}
+
 int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
                           sout_stream_id_sys_t *id )
 {
@@ -212,8 +286,37 @@ int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
     /* Will use this format as encoder input for now */
     transcode_encoder_update_format_in( id->encoder, &encoder_tested_fmt_in );
 
+    /* Other renditions: the decoded pictures are shared, each rung has its
+     * own scaler and encoder */
+    const sout_stream_sys_t *p_sys = p_stream->p_sys;
+    id->pp_renditions = NULL;
+    id->i_renditions = 0;
+    if( p_sys->i_vrenditions > 0 )
+        id->pp_renditions = vlc_alloc( p_sys->i_vrenditions,
+                                       sizeof(*id->pp_renditions) );
+    for( size_t i = 0; id->pp_renditions && i < p_sys->i_vrenditions; i++ )
+    {
+        sout_stream_id_sys_t *rung =
+            transcode_video_rendition_new( p_stream, id, &p_sys->p_vrenditions[i],
+                                           &encoder_tested_fmt_in );
+        if( !rung )
+        {
+            msg_Err( p_stream, "cannot create rendition %zu", i + 1 );
+            continue;
+        }
+        id->pp_renditions[id->i_renditions++] = rung;
+    }
+
     es_format_Clean( &encoder_tested_fmt_in );
 
+    id->p_pipeline = NULL;
+    if( id->p_enccfg->video.threads.b_pipeline )
+    {
+        id->p_pipeline = PipelineNew( p_stream, id );
+        if( !id->p_pipeline )
+            msg_Warn( p_stream, "cannot start the filter thread" );
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -302,7 +405,13 @@ static int conversion_video_filter_append( sout_stream_id_sys_t *id,
 void transcode_video_clean( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    VLC_UNUSED(p_stream);
+    for( size_t i = 0; i < id->i_renditions; i++ )
+        transcode_video_rendition_delete( p_stream, id->pp_renditions[i] );
+    free( id->pp_renditions );
+
+    /* Stop the filter thread */
+    if( id->p_pipeline )
+        PipelineDelete( id->p_pipeline );
 
     /* Close encoder */
     transcode_encoder_close( id->encoder );
@@ -326,7 +435,12 @@ void transcode_video_push_spu( sout_stream_t *p_stream, sout_stream_id_sys_t *id
                                subpicture_t *p_subpicture )
 {
     if( !id->p_spu )
+    {
+        /* The filter thread blends with the SPU unit */
+        if( id->p_pipeline )
+            PipelineWait( id->p_pipeline );
         id->p_spu = spu_Create( p_stream, NULL );
+    }
     if( !id->p_spu )
         subpicture_Delete( p_subpicture );
     else
@@ -413,166 +527,354 @@ static void tag_last_block_with_flag( block_t **out, int i_flag )
     }
 }
 
-int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
-                                    block_t *in, block_t **out )
+static void transcode_video_filter_encode( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id,
+                                           picture_t *p_pic, block_t **out )
 {
-    *out = NULL;
-
-    const bool b_eos = in && (in->i_flags & BLOCK_FLAG_END_OF_SEQUENCE);
-
-    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
-    if( ret != VLCDEC_SUCCESS )
-        return VLC_EGENERIC;
+    /* Run the filter and output chains; first with the picture,
+     * and then with NULL as many times as we need until they
+     * stop outputting frames.
+     */
+    for ( picture_t *p_in = p_pic; ; p_in = NULL /* drain second time */ )
+    {
+        /* Run filter chain */
+        if( id->p_f_chain )
+            p_in = filter_chain_VideoFilter( id->p_f_chain, p_in );
 
-    picture_t *p_pics = transcode_dequeue_all_pics( id );
+        if( !p_in )
+            break;
 
-    do
-    {
-        picture_t *p_pic = p_pics;
-        if( p_pic )
+        for ( ;; p_in = NULL /* drain second time */ )
         {
-            p_pics = p_pic->p_next;
-            p_pic->p_next = NULL;
-        }
+            /* Run user specified filter chain */
+            if( id->p_uf_chain )
+                p_in = filter_chain_VideoFilter( id->p_uf_chain, p_in );
 
-        if( id->b_error && p_pic )
-        {
-            picture_Release( p_pic );
-            continue;
-        }
+            if( !p_in )
+                break;
 
-        if( p_pic && ( unlikely(!transcode_encoder_opened(id->encoder)) ||
-              !video_format_IsSimilar( &id->fmt_input_video, &p_pic->format ) ) )
-        {
-            if( !transcode_encoder_opened(id->encoder) ) /* Configure Encoder input/output */
-            {
-                transcode_encoder_video_configure( VLC_OBJECT(p_stream),
-                                                   &id->p_decoder->fmt_in.video,
-                                                   &id->p_decoder->fmt_out.video,
-                                                   id->p_enccfg,
-                                                   filtered_video_format( id, p_pic ),
-                                                   id->encoder );
-                /* will be opened below */
-            }
-            else /* picture format has changed */
+            /* Blend subpictures */
+            p_in = RenderSubpictures( p_stream, id, p_in );
+
+            if( p_in )
             {
-                msg_Info( p_stream, "aspect-ratio changed, reiniting. %i -> %i : %i -> %i.",
-                            id->fmt_input_video.i_sar_num, p_pic->format.i_sar_num,
-                            id->fmt_input_video.i_sar_den, p_pic->format.i_sar_den
-                        );
-                /* Close filters, encoder format input can't change */
-                if( id->p_f_chain )
-                    filter_chain_Delete( id->p_f_chain );
-                id->p_f_chain = NULL;
-                if( id->p_uf_chain )
-                    filter_chain_Delete( id->p_uf_chain );
-                id->p_uf_chain = NULL;
-                if( id->p_spu_blender )
-                    filter_DeleteBlend( id->p_spu_blender );
-                id->p_spu_blender = NULL;
-
-                video_format_Clean( &id->fmt_input_video );
+                block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
+                if( p_encoded )
+                    block_ChainAppend( out, p_encoded );
+                picture_Release( p_in );
             }
+        }
+    }
+}
 
-            video_format_Copy( &id->fmt_input_video, &p_pic->format );
+/*
+ * Filter stage of the video pipeline: runs the filter chains, the
+ * subpicture blending and the encoder submission on its own thread, while
+ * the stream output thread decodes and the encoder thread encodes.
+ * At most pool-size pictures are queued between the decoder and the filters.
+ */
+struct transcode_video_pipeline
+{
+    sout_stream_t        *p_stream;
+    sout_stream_id_sys_t *id;
+    vlc_thread_t          thread;
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait_input; /* a picture was queued, or abort */
+    vlc_cond_t  wait_idle;  /* the queue is empty and nothing is filtered */
+    vlc_sem_t   room;       /* free slots of the queue */
+
+    picture_t  *first;
+    picture_t **last;
+    vlc_tick_t *p_dates;    /* queuing dates of the pictures */
+    unsigned    i_dates_size;
+    unsigned    i_dates_first;
+    unsigned    i_depth;
+    bool        b_busy;
+    bool        b_abort;
+
+    block_t    *p_out;      /* output of a synchronous encoder */
+    transcode_stage_stats_t stats;
+};
 
-            if( !id->p_f_chain && !id->p_uf_chain )
-            {
-                transcode_video_filter_init( p_stream, id->p_filterscfg,
-                                             (id->p_enccfg->video.fps.num > 0), id );
-                if( conversion_video_filter_append( id, p_pic ) != VLC_SUCCESS )
-                    goto error;
-            }
+static void *PipelineThread( void *data )
+{
+    struct transcode_video_pipeline *p_pipe = data;
 
-            /* Start missing encoder */
-            if( !transcode_encoder_opened( id->encoder ) &&
-                transcode_encoder_open( id->encoder, id->p_enccfg ) != VLC_SUCCESS )
-            {
-                msg_Err( p_stream, "cannot find audio encoder (module:%s fourcc:%4.4s). "
-                                   "Take a look few lines earlier to see possible reason.",
-                                   id->p_enccfg->psz_name ? id->p_enccfg->psz_name : "any",
-                                   (char *)&id->p_enccfg->i_codec );
-                goto error;
-            }
+    vlc_mutex_lock( &p_pipe->lock );
+    for( ;; )
+    {
+        while( !p_pipe->b_abort && p_pipe->first == NULL )
+            vlc_cond_wait( &p_pipe->wait_input, &p_pipe->lock );
+        if( p_pipe->first == NULL )
+            break;
+
+        picture_t *p_pic = p_pipe->first;
+        p_pipe->first = p_pic->p_next;
+        if( p_pipe->first == NULL )
+            p_pipe->last = &p_pipe->first;
+        p_pic->p_next = NULL;
+
+        transcode_stage_stats_add( VLC_OBJECT(p_pipe->p_stream), &p_pipe->stats,
+                                   p_pipe->i_depth,
+                                   p_pipe->p_dates[p_pipe->i_dates_first] );
+        p_pipe->i_dates_first = (p_pipe->i_dates_first + 1) % p_pipe->i_dates_size;
+        p_pipe->i_depth--;
+        p_pipe->b_busy = true;
+        vlc_mutex_unlock( &p_pipe->lock );
+        vlc_sem_post( &p_pipe->room );
+
+        block_t *p_out = NULL;
+        transcode_video_filter_encode( p_pipe->p_stream, p_pipe->id, p_pic, &p_out );
+
+        vlc_mutex_lock( &p_pipe->lock );
+        block_ChainAppend( &p_pipe->p_out, p_out );
+        p_pipe->b_busy = false;
+        if( p_pipe->first == NULL )
+            vlc_cond_broadcast( &p_pipe->wait_idle );
+    }
+    vlc_mutex_unlock( &p_pipe->lock );
 
-            msg_Dbg( p_stream, "destination (after video filters) %ux%u",
-                               transcode_encoder_format_in( id->encoder )->video.i_width,
-                               transcode_encoder_format_in( id->encoder )->video.i_height );
+    transcode_stage_stats_report( VLC_OBJECT(p_pipe->p_stream), &p_pipe->stats );
+    return NULL;
+}
 
-            if( !id->downstream_id )
-                id->downstream_id =
-                    id->pf_transcode_downstream_add( p_stream,
-                                                     &id->p_decoder->fmt_in,
-                                                     transcode_encoder_format_out( id->encoder ) );
-            if( !id->downstream_id )
-            {
-                msg_Err( p_stream, "cannot output transcoded stream %4.4s",
-                                   (char *) &id->p_enccfg->i_codec );
+static struct transcode_video_pipeline *
+PipelineNew( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    struct transcode_video_pipeline *p_pipe = malloc( sizeof(*p_pipe) );
+    if( !p_pipe )
+        return NULL;
+
+    p_pipe->i_dates_size = id->p_enccfg->video.threads.pool_size;
+    p_pipe->p_dates = vlc_alloc( p_pipe->i_dates_size, sizeof(*p_pipe->p_dates) );
+    if( !p_pipe->p_dates )
+    {
+        free( p_pipe );
+        return NULL;
+    }
+
+    p_pipe->p_stream = p_stream;
+    p_pipe->id = id;
+    vlc_mutex_init( &p_pipe->lock );
+    vlc_cond_init( &p_pipe->wait_input );
+    vlc_cond_init( &p_pipe->wait_idle );
+    vlc_sem_init( &p_pipe->room, p_pipe->i_dates_size );
+    p_pipe->first = NULL;
+    p_pipe->last = &p_pipe->first;
+    p_pipe->i_dates_first = 0;
+    p_pipe->i_depth = 0;
+    p_pipe->b_busy = false;
+    p_pipe->b_abort = false;
+    p_pipe->p_out = NULL;
+    transcode_stage_stats_init( &p_pipe->stats, "filter" );
+
+    if( vlc_clone( &p_pipe->thread, PipelineThread, p_pipe,
+                   id->p_enccfg->video.threads.i_priority ) )
+    {
+        vlc_sem_destroy( &p_pipe->room );
+        vlc_cond_destroy( &p_pipe->wait_idle );
+        vlc_cond_destroy( &p_pipe->wait_input );
+        vlc_mutex_destroy( &p_pipe->lock );
+        free( p_pipe->p_dates );
+        free( p_pipe );
+        return NULL;
+    }
+    return p_pipe;
+}
+
+static void PipelineDelete( struct transcode_video_pipeline *p_pipe )
+{
+    vlc_mutex_lock( &p_pipe->lock );
+    p_pipe->b_abort = true;
+    vlc_cond_signal( &p_pipe->wait_input );
+    vlc_mutex_unlock( &p_pipe->lock );
+    vlc_join( p_pipe->thread, NULL );
+
+    block_ChainRelease( p_pipe->p_out );
+    vlc_sem_destroy( &p_pipe->room );
+    vlc_cond_destroy( &p_pipe->wait_idle );
+    vlc_cond_destroy( &p_pipe->wait_input );
+    vlc_mutex_destroy( &p_pipe->lock );
+    free( p_pipe->p_dates );
+    free( p_pipe );
+}
+
+static void PipelinePush( struct transcode_video_pipeline *p_pipe,
+                          picture_t *p_pic )
+{
+    vlc_sem_wait( &p_pipe->room );
+
+    vlc_mutex_lock( &p_pipe->lock );
+    *p_pipe->last = p_pic;
+    p_pipe->last = &p_pic->p_next;
+    p_pipe->p_dates[(p_pipe->i_dates_first + p_pipe->i_depth++) % p_pipe->i_dates_size] =
+        vlc_tick_now();
+    vlc_cond_signal( &p_pipe->wait_input );
+    vlc_mutex_unlock( &p_pipe->lock );
+}
+
+/* Waits until all the queued pictures are filtered, so that the filters
+ * and the encoder can be reconfigured */
+static void PipelineWait( struct transcode_video_pipeline *p_pipe )
+{
+    vlc_mutex_lock( &p_pipe->lock );
+    while( p_pipe->first != NULL || p_pipe->b_busy )
+        vlc_cond_wait( &p_pipe->wait_idle, &p_pipe->lock );
+    vlc_mutex_unlock( &p_pipe->lock );
+}
+
+static block_t *PipelineGetOutput( struct transcode_video_pipeline *p_pipe )
+{
+    vlc_mutex_lock( &p_pipe->lock );
+    block_t *p_out = p_pipe->p_out;
+    p_pipe->p_out = NULL;
+    vlc_mutex_unlock( &p_pipe->lock );
+    return p_out;
+}
+
+static void transcode_video_encode_pic( sout_stream_t *p_stream,
+                                       sout_stream_id_sys_t *id,
+                                       picture_t *p_pic, bool b_eos,
+                                       block_t **out )
+{
+    if( id->b_error && p_pic )
+    {
+        picture_Release( p_pic );
+        return;
+    }
+
+    if( p_pic && ( unlikely(!transcode_encoder_opened(id->encoder)) ||
+          !video_format_IsSimilar( &id->fmt_input_video, &p_pic->format ) ) )
+    {
+        /* The filter thread must not use the filters nor the encoder
+         * while they are reconfigured */
+        if( id->p_pipeline )
+            PipelineWait( id->p_pipeline );
+
+        if( !transcode_encoder_opened(id->encoder) ) /* Configure Encoder input/output */
+        {
+            transcode_encoder_video_configure( VLC_OBJECT(p_stream),
+                                               &id->p_decoder->fmt_in.video,
+                                               &id->p_decoder->fmt_out.video,
+                                               id->p_enccfg,
+                                               filtered_video_format( id, p_pic ),
+                                               id->encoder );
+            /* will be opened below */
+        }
+        else /* picture format has changed */
+        {
+            msg_Info( p_stream, "aspect-ratio changed, reiniting. %i -> %i : %i -> %i.",
+                        id->fmt_input_video.i_sar_num, p_pic->format.i_sar_num,
+                        id->fmt_input_video.i_sar_den, p_pic->format.i_sar_den
+                    );
+            /* Close filters, encoder format input can't change */
+            if( id->p_f_chain )
+                filter_chain_Delete( id->p_f_chain );
+            id->p_f_chain = NULL;
+            if( id->p_uf_chain )
+                filter_chain_Delete( id->p_uf_chain );
+            id->p_uf_chain = NULL;
+            if( id->p_spu_blender )
+                filter_DeleteBlend( id->p_spu_blender );
+            id->p_spu_blender = NULL;
+
+            video_format_Clean( &id->fmt_input_video );
+        }
+
+        video_format_Copy( &id->fmt_input_video, &p_pic->format );
+
+        if( !id->p_f_chain && !id->p_uf_chain )
+        {
+            transcode_video_filter_init( p_stream, id->p_filterscfg,
+                                         (id->p_enccfg->video.fps.num > 0), id );
+            if( conversion_video_filter_append( id, p_pic ) != VLC_SUCCESS )
                 goto error;
-            }
         }
 
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
-        for ( picture_t *p_in = p_pic; ; p_in = NULL /* drain second time */ )
+        /* Start missing encoder */
+        if( !transcode_encoder_opened( id->encoder ) &&
+            transcode_encoder_open( id->encoder, id->p_enccfg ) != VLC_SUCCESS )
         {
-            /* Run filter chain */
-            if( id->p_f_chain )
-                p_in = filter_chain_VideoFilter( id->p_f_chain, p_in );
+            msg_Err( p_stream, "cannot find audio encoder (module:%s fourcc:%4.4s). "
+                               "Take a look few lines earlier to see possible reason.",
+                               id->p_enccfg->psz_name ? id->p_enccfg->psz_name : "any",
+                               (char *)&id->p_enccfg->i_codec );
+            goto error;
+        }
 
-            if( !p_in )
-                break;
+        msg_Dbg( p_stream, "destination (after video filters) %ux%u",
+                           transcode_encoder_format_in( id->encoder )->video.i_width,
+                           transcode_encoder_format_in( id->encoder )->video.i_height );
 
-            for ( ;; p_in = NULL /* drain second time */ )
-            {
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_in = filter_chain_VideoFilter( id->p_uf_chain, p_in );
-
-                if( !p_in )
-                    break;
-
-                /* Blend subpictures */
-                p_in = RenderSubpictures( p_stream, id, p_in );
-
-                if( p_in )
-                {
-                    block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
-                    if( p_encoded )
-                        block_ChainAppend( out, p_encoded );
-                    picture_Release( p_in );
-                }
-            }
+        if( !id->downstream_id )
+            id->downstream_id =
+                id->pf_transcode_downstream_add( p_stream,
+                                                 &id->p_decoder->fmt_in,
+                                                 transcode_encoder_format_out( id->encoder ) );
+        if( !id->downstream_id )
+        {
+            msg_Err( p_stream, "cannot output transcoded stream %4.4s",
+                               (char *) &id->p_enccfg->i_codec );
+            goto error;
         }
+    }
 
-        if( b_eos )
+    if( id->p_pipeline )
+    {
+        if( p_pic )
+            PipelinePush( id->p_pipeline, p_pic );
+    }
+    else
+        transcode_video_filter_encode( p_stream, id, p_pic, out );
+
+    if( b_eos )
+    {
+        if( id->p_pipeline )
         {
-            msg_Info( p_stream, "Drain/restart on EOS" );
-            if( transcode_encoder_drain( id->encoder, out ) != VLC_SUCCESS )
-                goto error;
-            transcode_encoder_close( id->encoder );
-            if( b_eos )
-                tag_last_block_with_flag( out, BLOCK_FLAG_END_OF_SEQUENCE );
+            PipelineWait( id->p_pipeline );
+            block_ChainAppend( out, PipelineGetOutput( id->p_pipeline ) );
         }
+        msg_Info( p_stream, "Drain/restart on EOS" );
+        if( transcode_encoder_drain( id->encoder, out ) != VLC_SUCCESS )
+            goto error;
+        transcode_encoder_close( id->encoder );
+        if( b_eos )
+            tag_last_block_with_flag( out, BLOCK_FLAG_END_OF_SEQUENCE );
+    }
 
-        continue;
+    return;
 error:
-        if( p_pic )
-            picture_Release( p_pic );
-        id->b_error = true;
-    } while( p_pics );
+    if( p_pic )
+        picture_Release( p_pic );
+    id->b_error = true;
+}
 
-    if( id->p_enccfg->video.threads.i_count >= 1 )
+/* Collects the output of the threads, and drains the encoder at the end of
+ * the stream */
+static void transcode_video_get_output( sout_stream_t *p_stream,
+                                        sout_stream_id_sys_t *id,
+                                        bool b_drain, bool b_eos,
+                                        block_t **out )
+{
+    if( id->p_pipeline )
+        block_ChainAppend( out, PipelineGetOutput( id->p_pipeline ) );
+
+    if( id->p_enccfg->video.threads.i_count >= 1 ||
+        id->p_enccfg->video.threads.b_pipeline )
     {
         /* Pick up any return data the encoder thread wants to output. */
         block_ChainAppend( out, transcode_encoder_get_output_async( id->encoder ) );
     }
 
     /* Drain encoder */
-    if( unlikely( !id->b_error && in == NULL ) && transcode_encoder_opened( id->encoder ) )
+    if( unlikely( !id->b_error && b_drain ) && transcode_encoder_opened( id->encoder ) )
     {
+        if( id->p_pipeline )
+        {
+            PipelineWait( id->p_pipeline );
+            block_ChainAppend( out, PipelineGetOutput( id->p_pipeline ) );
+        }
         msg_Dbg( p_stream, "Flushing thread and waiting that");
         if( transcode_encoder_drain( id->encoder, out ) == VLC_SUCCESS )
             msg_Dbg( p_stream, "Flushing done");
@@ -582,6 +884,71 @@ error:
 
     if( b_eos )
         tag_last_block_with_flag( out, BLOCK_FLAG_END_OF_SEQUENCE );
+}
+
+/* Feeds a decoded picture to the other renditions. They get clones sharing
+ * the planes of the decoded picture, so that each branch can queue and
+ * timestamp it independently without copying pixels. */
+static void transcode_video_fan_out( sout_stream_t *p_stream,
+                                     sout_stream_id_sys_t *id,
+                                     picture_t *p_pic, bool b_eos )
+{
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        sout_stream_id_sys_t *rung = id->pp_renditions[i];
+        picture_t *p_clone = NULL;
+        block_t *p_out = NULL;
+
+        if( p_pic )
+        {
+            p_clone = picture_Clone( p_pic );
+            if( unlikely(p_clone == NULL) )
+                continue;
+            picture_CopyProperties( p_clone, p_pic );
+        }
+
+        transcode_video_encode_pic( p_stream, rung, p_clone, b_eos, &p_out );
+        if( p_out )
+            sout_StreamIdSend( p_stream->p_next, rung->downstream_id, p_out );
+    }
+}
+
+int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                                    block_t *in, block_t **out )
+{
+    *out = NULL;
+
+    const bool b_eos = in && (in->i_flags & BLOCK_FLAG_END_OF_SEQUENCE);
+
+    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
+    if( ret != VLCDEC_SUCCESS )
+        return VLC_EGENERIC;
+
+    picture_t *p_pics = transcode_dequeue_all_pics( id );
+
+    do
+    {
+        picture_t *p_pic = p_pics;
+        if( p_pic )
+        {
+            p_pics = p_pic->p_next;
+            p_pic->p_next = NULL;
+        }
+
+        transcode_video_fan_out( p_stream, id, p_pic, b_eos );
+        transcode_video_encode_pic( p_stream, id, p_pic, b_eos, out );
+    } while( p_pics );
+
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        sout_stream_id_sys_t *rung = id->pp_renditions[i];
+        block_t *p_out = NULL;
+
+        transcode_video_get_output( p_stream, rung, in == NULL, b_eos, &p_out );
+        if( p_out )
+            sout_StreamIdSend( p_stream->p_next, rung->downstream_id, p_out );
+    }
+    transcode_video_get_output( p_stream, id, in == NULL, b_eos, out );
 
     return id->b_error ? VLC_EGENERIC : VLC_SUCCESS;
 }
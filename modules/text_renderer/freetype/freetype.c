@@ -70,6 +70,7 @@
 #include "platform_fonts.h"
 #include "freetype.h"
 #include "text_layout.h"
+#include "text_cache.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -113,6 +114,11 @@ static void Destroy( filter_t * );
 #define TEXT_DIRECTION_LONGTEXT N_("Paragraph base direction for the Unicode bi-directional algorithm.")
 
 
+#define CACHE_SIZE_TEXT N_("Glyph cache size")
+#define CACHE_SIZE_LONGTEXT N_("Memory used to keep the rendered glyphs " \
+    "and the shaped text, in kilobytes. Repeated text is rendered from " \
+    "this cache instead of being shaped and rasterized again." )
+
 #define YUVP_TEXT N_("Use YUVP renderer")
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
@@ -210,6 +216,9 @@ vlc_plugin_begin ()
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
 
+    add_integer_with_range( "freetype-cache-size", 4096, 0, 1048576,
+                            CACHE_SIZE_TEXT, CACHE_SIZE_LONGTEXT, true )
+
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
                             TEXT_DIRECTION_LONGTEXT, false )
@@ -1386,6 +1395,7 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
     }
 
     FreeLines( text_block.p_laid );
+    TextCacheTrim( p_sys->p_cache );
 
     free( text_block.p_uchars );
     FreeStylesArray( text_block.pp_styles, text_block.i_count );
@@ -1438,6 +1448,11 @@ static int Create( filter_t *p_filter )
 
     p_sys->i_scale = 100;
 
+    p_sys->p_cache =
+        TextCacheNew( var_InheritInteger( p_filter, "freetype-cache-size" ) * 1024 );
+    if( !p_sys->p_cache )
+        goto error;
+
     /* default style to apply to uncomplete segmeents styles */
     p_sys->p_default_style = text_style_Create( STYLE_FULLY_SET );
     if(unlikely(!p_sys->p_default_style))
@@ -1555,6 +1570,10 @@ static void Destroy( filter_t *p_filter )
     DumpDictionary( p_filter, &p_sys->fallback_map, true, -1 );
 #endif
 
+    /* Glyphs and shaped runs, before the faces they refer to */
+    if( p_sys->p_cache )
+        TextCacheDelete( VLC_OBJECT( p_filter ), p_sys->p_cache );
+
     /* Text styles */
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
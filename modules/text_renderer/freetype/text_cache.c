@@ -0,0 +1,471 @@
+/*****************************************************************************
+ * text_cache.c : Glyph and shaped run caches
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph and shaped run caches
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_list.h>
+#include <vlc_util.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_GLYPH_H
+
+#include "text_cache.h"
+
+#include <assert.h>
+
+#define GLYPH_BUCKETS       1024
+#define RUN_BUCKETS         256
+/* bitmaps kept per glyph, one per kind and subpixel position */
+#define GLYPH_BITMAPS       4
+
+typedef struct glyph_bitmap_t
+{
+    FT_Glyph            p_bitmap;
+    enum glyph_cache_kind kind;
+    FT_Pos              i_x;    /* subpixel origin */
+    FT_Pos              i_y;
+} glyph_bitmap_t;
+
+typedef struct glyph_node_t
+{
+    glyph_cache_entry_t entry;
+    glyph_cache_key_t   key;
+    glyph_bitmap_t      bitmaps[GLYPH_BITMAPS];
+    unsigned            i_next_bitmap;
+    size_t              i_size;
+
+    struct glyph_node_t *p_next;    /* bucket chain */
+    struct vlc_list     node;       /* LRU order */
+} glyph_node_t;
+
+struct shaped_run_t
+{
+    FT_Face             p_face;
+    unsigned            i_script;
+    unsigned            i_direction;
+    uni_char_t         *p_text;
+    size_t              i_length;
+    uint32_t            i_hash;
+    size_t              i_size;
+
+    struct shaped_run_t *p_next;
+    struct vlc_list     node;
+
+    unsigned            i_count;
+    shaped_glyph_t      glyphs[];
+};
+
+typedef struct
+{
+    uint64_t i_hits;
+    uint64_t i_misses;
+} text_cache_stats_t;
+
+struct text_cache_t
+{
+    glyph_node_t       *glyph_buckets[GLYPH_BUCKETS];
+    struct vlc_list     glyphs;
+    size_t              i_glyphs_size;
+    size_t              i_glyphs_max;
+
+    shaped_run_t       *run_buckets[RUN_BUCKETS];
+    struct vlc_list     runs;
+    size_t              i_runs_size;
+    size_t              i_runs_max;
+
+    text_cache_stats_t  glyph_stats;
+    text_cache_stats_t  bitmap_stats;
+    text_cache_stats_t  run_stats;
+};
+
+/* FNV-1a */
+static inline uint32_t Hash( uint32_t i_hash, const void *p_data, size_t i_size )
+{
+    const uint8_t *p = p_data;
+    for( size_t i = 0; i < i_size; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619;
+    return i_hash;
+}
+
+#define HASH_INIT 2166136261u
+
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)p_glyph)->bitmap;
+        return sizeof( FT_BitmapGlyphRec ) + abs( p_bitmap->pitch ) * p_bitmap->rows;
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &((FT_OutlineGlyph)p_glyph)->outline;
+        return sizeof( FT_OutlineGlyphRec )
+             + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+             + p_outline->n_contours * sizeof( short );
+    }
+    return sizeof( FT_GlyphRec );
+}
+
+text_cache_t * TextCacheNew( size_t i_max_size )
+{
+    text_cache_t *p_cache = calloc( 1, sizeof( *p_cache ) );
+    if( !p_cache )
+        return NULL;
+
+    vlc_list_init( &p_cache->glyphs );
+    vlc_list_init( &p_cache->runs );
+
+    /* shaping output is a lot smaller than the glyphs */
+    p_cache->i_runs_max = i_max_size / 8;
+    p_cache->i_glyphs_max = i_max_size - p_cache->i_runs_max;
+    return p_cache;
+}
+
+/*****************************************************************************
+ * Glyphs
+ *****************************************************************************/
+static uint32_t GlyphHash( const glyph_cache_key_t *p_key )
+{
+    uint32_t i_hash = HASH_INIT;
+    i_hash = Hash( i_hash, &p_key->p_face, sizeof( p_key->p_face ) );
+    i_hash = Hash( i_hash, &p_key->i_glyph_index, sizeof( p_key->i_glyph_index ) );
+    i_hash = Hash( i_hash, &p_key->i_flags, sizeof( p_key->i_flags ) );
+    i_hash = Hash( i_hash, &p_key->i_outline_radius, sizeof( p_key->i_outline_radius ) );
+    return i_hash % GLYPH_BUCKETS;
+}
+
+static bool GlyphKeyEquals( const glyph_cache_key_t *a, const glyph_cache_key_t *b )
+{
+    return a->p_face == b->p_face
+        && a->i_glyph_index == b->i_glyph_index
+        && a->i_flags == b->i_flags
+        && a->i_outline_radius == b->i_outline_radius;
+}
+
+static glyph_node_t * GlyphFind( text_cache_t *p_cache, const glyph_cache_key_t *p_key )
+{
+    for( glyph_node_t *p_node = p_cache->glyph_buckets[GlyphHash( p_key )];
+         p_node != NULL; p_node = p_node->p_next )
+    {
+        if( GlyphKeyEquals( &p_node->key, p_key ) )
+        {
+            /* most recently used first */
+            vlc_list_remove( &p_node->node );
+            vlc_list_prepend( &p_node->node, &p_cache->glyphs );
+            return p_node;
+        }
+    }
+    return NULL;
+}
+
+static void GlyphFree( glyph_node_t *p_node )
+{
+    FT_Done_Glyph( p_node->entry.p_glyph );
+    if( p_node->entry.p_outline )
+        FT_Done_Glyph( p_node->entry.p_outline );
+    for( unsigned i = 0; i < GLYPH_BITMAPS; i++ )
+        if( p_node->bitmaps[i].p_bitmap )
+            FT_Done_Glyph( p_node->bitmaps[i].p_bitmap );
+    free( p_node );
+}
+
+static void GlyphEvict( text_cache_t *p_cache, glyph_node_t *p_node )
+{
+    glyph_node_t **pp = &p_cache->glyph_buckets[GlyphHash( &p_node->key )];
+    while( *pp != p_node )
+        pp = &(*pp)->p_next;
+    *pp = p_node->p_next;
+
+    vlc_list_remove( &p_node->node );
+    p_cache->i_glyphs_size -= p_node->i_size;
+    GlyphFree( p_node );
+}
+
+const glyph_cache_entry_t * TextCacheGetGlyph( text_cache_t *p_cache,
+                                               const glyph_cache_key_t *p_key )
+{
+    glyph_node_t *p_node = GlyphFind( p_cache, p_key );
+    if( !p_node )
+    {
+        p_cache->glyph_stats.i_misses++;
+        return NULL;
+    }
+    p_cache->glyph_stats.i_hits++;
+    return &p_node->entry;
+}
+
+const glyph_cache_entry_t * TextCacheAddGlyph( text_cache_t *p_cache,
+                                               const glyph_cache_key_t *p_key,
+                                               FT_Glyph p_glyph,
+                                               FT_Glyph p_outline,
+                                               FT_Vector advance )
+{
+    assert( p_key->p_face != NULL );
+
+    glyph_node_t *p_node = calloc( 1, sizeof( *p_node ) );
+    if( unlikely( !p_node ) )
+    {
+        FT_Done_Glyph( p_glyph );
+        if( p_outline )
+            FT_Done_Glyph( p_outline );
+        return NULL;
+    }
+
+    p_node->key = *p_key;
+    p_node->entry.p_glyph = p_glyph;
+    p_node->entry.p_outline = p_outline;
+    p_node->entry.advance = advance;
+    p_node->i_size = sizeof( *p_node ) + GlyphSize( p_glyph ) + GlyphSize( p_outline );
+
+    glyph_node_t **pp_bucket = &p_cache->glyph_buckets[GlyphHash( p_key )];
+    p_node->p_next = *pp_bucket;
+    *pp_bucket = p_node;
+    vlc_list_prepend( &p_node->node, &p_cache->glyphs );
+    p_cache->i_glyphs_size += p_node->i_size;
+
+    return &p_node->entry;
+}
+
+FT_Error TextCacheToBitmap( text_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                            enum glyph_cache_kind kind, FT_Glyph *pp_glyph,
+                            const FT_Vector *p_origin, FT_Bool b_destroy )
+{
+    /* embedded bitmaps are not positioned by FreeType */
+    glyph_node_t *p_node = NULL;
+    if( p_key->p_face && (*pp_glyph)->format != FT_GLYPH_FORMAT_BITMAP )
+        p_node = GlyphFind( p_cache, p_key );
+    if( !p_node )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   (FT_Vector *)p_origin, b_destroy );
+
+    /* Rendering is invariant by whole pixel translations */
+    const FT_Vector subpixel = { .x = p_origin->x & 63, .y = p_origin->y & 63 };
+    glyph_bitmap_t *p_cached = NULL;
+
+    for( unsigned i = 0; i < GLYPH_BITMAPS; i++ )
+    {
+        glyph_bitmap_t *p_bitmap = &p_node->bitmaps[i];
+        if( p_bitmap->p_bitmap && p_bitmap->kind == kind &&
+            p_bitmap->i_x == subpixel.x && p_bitmap->i_y == subpixel.y )
+        {
+            p_cached = p_bitmap;
+            break;
+        }
+    }
+
+    if( p_cached )
+        p_cache->bitmap_stats.i_hits++;
+    else
+    {
+        FT_Glyph p_rendered = *pp_glyph;
+        FT_Error i_error = FT_Glyph_To_Bitmap( &p_rendered, FT_RENDER_MODE_NORMAL,
+                                               (FT_Vector *)&subpixel, 0 );
+        if( i_error )
+            return i_error;
+
+        p_cache->bitmap_stats.i_misses++;
+
+        p_cached = &p_node->bitmaps[p_node->i_next_bitmap];
+        p_node->i_next_bitmap = ( p_node->i_next_bitmap + 1 ) % GLYPH_BITMAPS;
+        if( p_cached->p_bitmap )
+        {
+            const size_t i_size = GlyphSize( p_cached->p_bitmap );
+            p_node->i_size -= i_size;
+            p_cache->i_glyphs_size -= i_size;
+            FT_Done_Glyph( p_cached->p_bitmap );
+        }
+
+        p_cached->p_bitmap = p_rendered;
+        p_cached->kind = kind;
+        p_cached->i_x = subpixel.x;
+        p_cached->i_y = subpixel.y;
+
+        const size_t i_size = GlyphSize( p_rendered );
+        p_node->i_size += i_size;
+        p_cache->i_glyphs_size += i_size;
+    }
+
+    FT_Glyph p_copy;
+    FT_Error i_error = FT_Glyph_Copy( p_cached->p_bitmap, &p_copy );
+    if( i_error )
+        return i_error;
+
+    FT_BitmapGlyph p_bitmap = (FT_BitmapGlyph)p_copy;
+    p_bitmap->left += ( p_origin->x - subpixel.x ) >> 6;
+    p_bitmap->top  += ( p_origin->y - subpixel.y ) >> 6;
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    *pp_glyph = p_copy;
+    return 0;
+}
+
+/*****************************************************************************
+ * Shaped runs
+ *****************************************************************************/
+static uint32_t RunHash( FT_Face p_face, unsigned i_script, unsigned i_direction,
+                         const uni_char_t *p_text, size_t i_length )
+{
+    uint32_t i_hash = HASH_INIT;
+    i_hash = Hash( i_hash, &p_face, sizeof( p_face ) );
+    i_hash = Hash( i_hash, &i_script, sizeof( i_script ) );
+    i_hash = Hash( i_hash, &i_direction, sizeof( i_direction ) );
+    return Hash( i_hash, p_text, i_length * sizeof( *p_text ) );
+}
+
+static void RunEvict( text_cache_t *p_cache, shaped_run_t *p_run )
+{
+    shaped_run_t **pp = &p_cache->run_buckets[p_run->i_hash % RUN_BUCKETS];
+    while( *pp != p_run )
+        pp = &(*pp)->p_next;
+    *pp = p_run->p_next;
+
+    vlc_list_remove( &p_run->node );
+    p_cache->i_runs_size -= p_run->i_size;
+    free( p_run );
+}
+
+const shaped_glyph_t * TextCacheGetRun( text_cache_t *p_cache, FT_Face p_face,
+                                        unsigned i_script, unsigned i_direction,
+                                        const uni_char_t *p_text, size_t i_length,
+                                        unsigned *pi_count )
+{
+    const uint32_t i_hash = RunHash( p_face, i_script, i_direction,
+                                     p_text, i_length );
+
+    for( shaped_run_t *p_run = p_cache->run_buckets[i_hash % RUN_BUCKETS];
+         p_run != NULL; p_run = p_run->p_next )
+    {
+        if( p_run->i_hash == i_hash && p_run->p_face == p_face &&
+            p_run->i_script == i_script && p_run->i_direction == i_direction &&
+            p_run->i_length == i_length &&
+            !memcmp( p_run->p_text, p_text, i_length * sizeof( *p_text ) ) )
+        {
+            vlc_list_remove( &p_run->node );
+            vlc_list_prepend( &p_run->node, &p_cache->runs );
+
+            p_cache->run_stats.i_hits++;
+            *pi_count = p_run->i_count;
+            return p_run->glyphs;
+        }
+    }
+
+    p_cache->run_stats.i_misses++;
+    return NULL;
+}
+
+shaped_glyph_t * TextCacheAddRun( text_cache_t *p_cache, FT_Face p_face,
+                                  unsigned i_script, unsigned i_direction,
+                                  const uni_char_t *p_text, size_t i_length,
+                                  unsigned i_count )
+{
+    size_t i_size;
+    if( mul_overflow( (size_t)i_count, sizeof( shaped_glyph_t ), &i_size ) ||
+        add_overflow( i_size, sizeof( shaped_run_t ), &i_size ) ||
+        add_overflow( i_size, i_length * sizeof( *p_text ), &i_size ) )
+        return NULL;
+
+    shaped_run_t *p_run = malloc( i_size );
+    if( unlikely( !p_run ) )
+        return NULL;
+
+    p_run->p_face = p_face;
+    p_run->i_script = i_script;
+    p_run->i_direction = i_direction;
+    p_run->p_text = (uni_char_t *)&p_run->glyphs[i_count];
+    memcpy( p_run->p_text, p_text, i_length * sizeof( *p_text ) );
+    p_run->i_length = i_length;
+    p_run->i_hash = RunHash( p_face, i_script, i_direction, p_text, i_length );
+    p_run->i_size = i_size;
+    p_run->i_count = i_count;
+
+    shaped_run_t **pp_bucket = &p_cache->run_buckets[p_run->i_hash % RUN_BUCKETS];
+    p_run->p_next = *pp_bucket;
+    *pp_bucket = p_run;
+    vlc_list_prepend( &p_run->node, &p_cache->runs );
+    p_cache->i_runs_size += i_size;
+
+    return p_run->glyphs;
+}
+
+/*****************************************************************************
+ * Eviction
+ *****************************************************************************/
+void TextCacheTrim( text_cache_t *p_cache )
+{
+    while( p_cache->i_glyphs_size > p_cache->i_glyphs_max )
+    {
+        glyph_node_t *p_node =
+            vlc_list_last_entry_or_null( &p_cache->glyphs, glyph_node_t, node );
+        assert( p_node );
+        GlyphEvict( p_cache, p_node );
+    }
+
+    while( p_cache->i_runs_size > p_cache->i_runs_max )
+    {
+        shaped_run_t *p_run =
+            vlc_list_last_entry_or_null( &p_cache->runs, shaped_run_t, node );
+        assert( p_run );
+        RunEvict( p_cache, p_run );
+    }
+}
+
+static void LogStats( vlc_object_t *p_obj, const char *psz_name,
+                      const text_cache_stats_t *p_stats )
+{
+    const uint64_t i_total = p_stats->i_hits + p_stats->i_misses;
+    if( i_total == 0 )
+        return;
+    msg_Dbg( p_obj, "%s cache: %"PRIu64" hits, %"PRIu64" misses (%.1f%% hit rate)",
+             psz_name, p_stats->i_hits, p_stats->i_misses,
+             100. * p_stats->i_hits / i_total );
+}
+
+void TextCacheDelete( vlc_object_t *p_obj, text_cache_t *p_cache )
+{
+    LogStats( p_obj, "glyph", &p_cache->glyph_stats );
+    LogStats( p_obj, "glyph bitmap", &p_cache->bitmap_stats );
+    LogStats( p_obj, "shaped run", &p_cache->run_stats );
+
+    glyph_node_t *p_node;
+    vlc_list_foreach( p_node, &p_cache->glyphs, node )
+        GlyphFree( p_node );
+
+    shaped_run_t *p_run;
+    vlc_list_foreach( p_run, &p_cache->runs, node )
+        free( p_run );
+
+    free( p_cache );
+}
+
+/** @} */
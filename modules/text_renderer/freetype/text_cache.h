@@ -0,0 +1,144 @@
+/*****************************************************************************
+ * text_cache.h : Glyph and shaped run caches
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_TEXT_CACHE_H
+#define VLC_FREETYPE_TEXT_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph and shaped run caches
+ *
+ * Subtitles tend to repeat the same text for many frames. These caches keep
+ * the loaded (and stroked) glyph outlines, their rendered bitmaps and the
+ * output of the shaper, so that re-rendering the same text does not go
+ * through FreeType and HarfBuzz again.
+ *
+ * Entries are least recently used first evicted. Eviction only happens in
+ * TextCacheTrim(), so that pointers returned while laying out a text block
+ * stay valid until the layout is done.
+ */
+
+#include "freetype.h"
+
+typedef struct text_cache_t text_cache_t;
+
+#define GLYPH_CACHE_EMBOLDEN    0x01
+#define GLYPH_CACHE_OBLIQUE     0x02
+#define GLYPH_CACHE_OUTLINE     0x04
+
+/**
+ * Identifies a loaded glyph. Faces are loaded once per size, so the face
+ * handle also identifies the size.
+ */
+typedef struct
+{
+    FT_Face  p_face;            /*!< NULL if the glyph is not cacheable */
+    unsigned i_glyph_index;
+    unsigned i_flags;           /*!< GLYPH_CACHE_* flags */
+    int      i_outline_radius;  /*!< stroker radius with GLYPH_CACHE_OUTLINE */
+} glyph_cache_key_t;
+
+/**
+ * A loaded glyph. The glyphs belong to the cache and must be copied.
+ */
+typedef struct
+{
+    FT_Glyph  p_glyph;
+    FT_Glyph  p_outline;        /*!< stroked glyph or NULL */
+    FT_Vector advance;          /*!< 26.6 advance of the glyph slot */
+} glyph_cache_entry_t;
+
+enum glyph_cache_kind
+{
+    GLYPH_BITMAP_GLYPH,
+    GLYPH_BITMAP_OUTLINE,
+};
+
+/**
+ * A glyph as output by the shaper. Values are 26.6.
+ */
+typedef struct
+{
+    unsigned i_glyph_index;
+    unsigned i_cluster;         /*!< offset of the source character in the run */
+    int      i_x_offset;
+    int      i_y_offset;
+    int      i_x_advance;
+    int      i_y_advance;
+} shaped_glyph_t;
+
+typedef struct shaped_run_t shaped_run_t;
+
+text_cache_t * TextCacheNew( size_t i_max_size );
+void TextCacheDelete( vlc_object_t *, text_cache_t * );
+
+/**
+ * Evicts the least recently used entries until the cache fits its size.
+ */
+void TextCacheTrim( text_cache_t * );
+
+const glyph_cache_entry_t * TextCacheGetGlyph( text_cache_t *,
+                                               const glyph_cache_key_t * );
+/**
+ * Adds a loaded glyph. The cache takes ownership of the glyphs, even on
+ * error.
+ */
+const glyph_cache_entry_t * TextCacheAddGlyph( text_cache_t *,
+                                               const glyph_cache_key_t *,
+                                               FT_Glyph p_glyph,
+                                               FT_Glyph p_outline,
+                                               FT_Vector advance );
+
+/**
+ * Same as FT_Glyph_To_Bitmap() with FT_RENDER_MODE_NORMAL, reusing the
+ * bitmap of the cached glyph if it was already rendered at the same
+ * subpixel position.
+ *
+ * \param p_key the glyph \p pp_glyph was copied from [IN]
+ * \param kind whether \p pp_glyph is the glyph or the outline [IN]
+ */
+FT_Error TextCacheToBitmap( text_cache_t *, const glyph_cache_key_t *p_key,
+                            enum glyph_cache_kind kind, FT_Glyph *pp_glyph,
+                            const FT_Vector *p_origin, FT_Bool b_destroy );
+
+/**
+ * Looks up the shaped glyphs of a run of code points.
+ *
+ * \param i_script the script of the run (hb_script_t) [IN]
+ * \param i_direction the direction of the run (hb_direction_t) [IN]
+ * \param pi_count number of shaped glyphs [OUT]
+ */
+const shaped_glyph_t * TextCacheGetRun( text_cache_t *, FT_Face,
+                                        unsigned i_script, unsigned i_direction,
+                                        const uni_char_t *p_text, size_t i_length,
+                                        unsigned *pi_count );
+/**
+ * Allocates room for \p i_count shaped glyphs of a run. The glyphs must be
+ * filled in before the next call on the cache.
+ */
+shaped_glyph_t * TextCacheAddRun( text_cache_t *, FT_Face,
+                                  unsigned i_script, unsigned i_direction,
+                                  const uni_char_t *p_text, size_t i_length,
+                                  unsigned i_count );
+
+/** @} */
+
+#endif
@@ -64,6 +64,7 @@
 
 #include "freetype.h"
 #include "text_layout.h"
+#include "text_cache.h"
 #include "platform_fonts.h"
 
 #include <stdlib.h>
@@ -110,8 +111,7 @@ typedef struct run_desc_t
     hb_direction_t              direction;
     hb_font_t                  *p_hb_font;
     hb_buffer_t                *p_buffer;
-    hb_glyph_info_t            *p_glyph_infos;
-    hb_glyph_position_t        *p_glyph_positions;
+    const shaped_glyph_t       *p_shaped_glyphs; /* owned by the cache */
     unsigned int                i_glyph_count;
 #endif
 
@@ -132,6 +132,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t cache_key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -786,6 +787,18 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        const uni_char_t *p_text = p_paragraph->p_code_points + p_run->i_start_offset;
+        const int i_length = p_run->i_end_offset - p_run->i_start_offset;
+
+        p_run->p_shaped_glyphs =
+            TextCacheGetRun( p_sys->p_cache, p_face, p_run->script, p_run->direction,
+                             p_text, i_length, &p_run->i_glyph_count );
+        if( p_run->p_shaped_glyphs )
+        {
+            i_total_glyphs += p_run->i_glyph_count;
+            continue;
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
@@ -805,20 +818,14 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         hb_buffer_set_direction( p_run->p_buffer, p_run->direction );
         hb_buffer_set_script( p_run->p_buffer, p_run->script );
 #ifdef __OS2__
-        hb_buffer_add_utf16( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
+        hb_buffer_add_utf16( p_run->p_buffer, p_text, i_length, 0, i_length );
 #else
-        hb_buffer_add_utf32( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
+        hb_buffer_add_utf32( p_run->p_buffer, p_text, i_length, 0, i_length );
 #endif
         hb_shape( p_run->p_hb_font, p_run->p_buffer, 0, 0 );
-        p_run->p_glyph_infos =
+        const hb_glyph_info_t *p_infos =
             hb_buffer_get_glyph_infos( p_run->p_buffer, &p_run->i_glyph_count );
-        p_run->p_glyph_positions =
+        const hb_glyph_position_t *p_positions =
             hb_buffer_get_glyph_positions( p_run->p_buffer, &p_run->i_glyph_count );
 
         if( p_run->i_glyph_count <= 0 )
@@ -828,6 +835,30 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             goto error;
         }
 
+        shaped_glyph_t *p_glyphs =
+            TextCacheAddRun( p_sys->p_cache, p_face, p_run->script, p_run->direction,
+                             p_text, i_length, p_run->i_glyph_count );
+        if( !p_glyphs )
+        {
+            i_ret = VLC_ENOMEM;
+            goto error;
+        }
+        for( unsigned int j = 0; j < p_run->i_glyph_count; ++j )
+        {
+            p_glyphs[ j ].i_glyph_index = p_infos[ j ].codepoint;
+            p_glyphs[ j ].i_cluster = p_infos[ j ].cluster;
+            p_glyphs[ j ].i_x_offset = p_positions[ j ].x_offset;
+            p_glyphs[ j ].i_y_offset = p_positions[ j ].y_offset;
+            p_glyphs[ j ].i_x_advance = p_positions[ j ].x_advance;
+            p_glyphs[ j ].i_y_advance = p_positions[ j ].y_advance;
+        }
+        p_run->p_shaped_glyphs = p_glyphs;
+
+        hb_font_destroy( p_run->p_hb_font );
+        hb_buffer_destroy( p_run->p_buffer );
+        p_run->p_hb_font = NULL;
+        p_run->p_buffer = NULL;
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -851,8 +882,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
         run_desc_t *p_run = p_paragraph->p_runs + i;
-        hb_glyph_info_t *p_infos = p_run->p_glyph_infos;
-        hb_glyph_position_t *p_positions = p_run->p_glyph_positions;
+        const shaped_glyph_t *p_glyphs = p_run->p_shaped_glyphs;
         for( unsigned int j = 0; j < p_run->i_glyph_count; ++j )
         {
             /*
@@ -865,11 +895,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             int i_run_index = p_run->direction == HB_DIRECTION_LTR ?
                     j : p_run->i_glyph_count - 1 - j;
             int i_source_index =
-                    p_infos[ i_run_index ].cluster + p_run->i_start_offset;
+                    p_glyphs[ i_run_index ].i_cluster + p_run->i_start_offset;
 
             p_new_paragraph->p_code_points[ i_index ] = 0;
             p_new_paragraph->pi_glyph_indices[ i_index ] =
-                p_infos[ i_run_index ].codepoint;
+                p_glyphs[ i_run_index ].i_glyph_index;
             p_new_paragraph->p_scripts[ i_index ] =
                 p_paragraph->p_scripts[ i_source_index ];
             p_new_paragraph->p_types[ i_index ] =
@@ -884,13 +914,13 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             p_new_paragraph->pi_karaoke_bar[ i_index ] =
                 p_paragraph->pi_karaoke_bar[ i_source_index ];
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_offset =
-                p_positions[ i_run_index ].x_offset;
+                p_glyphs[ i_run_index ].i_x_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_offset =
-                p_positions[ i_run_index ].y_offset;
+                p_glyphs[ i_run_index ].i_y_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_advance =
-                p_positions[ i_run_index ].x_advance;
+                p_glyphs[ i_run_index ].i_x_advance;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_advance =
-                p_positions[ i_run_index ].y_advance;
+                p_glyphs[ i_run_index ].i_y_advance;
 
             ++i_index;
         }
@@ -899,11 +929,6 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             goto error;
     }
 
-    for( int i = 0; i < p_paragraph->i_runs_count; ++i )
-    {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
-    }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
 
@@ -1015,6 +1040,40 @@ static int ZeroNsmAdvance( paragraph_t *p_paragraph )
 #endif
 #endif
 
+/**
+ * Load a glyph with its synthesized styles and outline into the cache
+ */
+static const glyph_cache_entry_t *LoadCachedGlyph( filter_t *p_filter,
+                                                   const glyph_cache_key_t *p_key )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    FT_Face p_face = p_key->p_face;
+
+    if( FT_Load_Glyph( p_face, p_key->i_glyph_index,
+                       FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+     && FT_Load_Glyph( p_face, p_key->i_glyph_index, FT_LOAD_DEFAULT ) )
+        return NULL;
+
+    if( p_key->i_flags & GLYPH_CACHE_EMBOLDEN )
+        FT_GlyphSlot_Embolden( p_face->glyph );
+    if( p_key->i_flags & GLYPH_CACHE_OBLIQUE )
+        FT_GlyphSlot_Oblique( p_face->glyph );
+
+    FT_Glyph p_glyph, p_outline = NULL;
+    if( FT_Get_Glyph( p_face->glyph, &p_glyph ) )
+        return NULL;
+
+    if( p_key->i_flags & GLYPH_CACHE_OUTLINE )
+    {
+        p_outline = p_glyph;
+        if( FT_Glyph_StrokeBorder( &p_outline, p_sys->p_stroker, 0, 0 ) )
+            p_outline = NULL;
+    }
+
+    return TextCacheAddGlyph( p_sys->p_cache, p_key, p_glyph, p_outline,
+                              p_face->glyph->advance );
+}
+
 /**
  * Load the glyphs of a paragraph. When shaping with HarfBuzz the glyph indices
  * have already been determined at this point, as well as the advance values.
@@ -1057,17 +1116,26 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        unsigned i_cache_flags = 0;
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
+            i_cache_flags |= GLYPH_CACHE_OUTLINE;
         }
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            i_cache_flags |= GLYPH_CACHE_EMBOLDEN;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            i_cache_flags |= GLYPH_CACHE_OBLIQUE;
 
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
         {
@@ -1119,30 +1187,28 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+            glyph_cache_key_t *p_key = &p_bitmaps->cache_key;
+            p_key->p_face = p_face;
+            p_key->i_glyph_index = i_glyph_index;
+            p_key->i_flags = i_cache_flags;
+            p_key->i_outline_radius = i_radius;
+
+            const glyph_cache_entry_t *p_cached =
+                TextCacheGetGlyph( p_sys->p_cache, p_key );
+            if( !p_cached )
+                p_cached = LoadCachedGlyph( p_filter, p_key );
+            if( !p_cached )
                 SKIP_GLYPH( p_bitmaps )
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
-
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+            if( FT_Glyph_Copy( p_cached->p_glyph, &p_bitmaps->p_glyph ) )
                 SKIP_GLYPH( p_bitmaps )
 
 #undef SKIP_GLYPH
 
-            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
-            }
+            p_bitmaps->p_outline = 0;
+            if( p_cached->p_outline &&
+                FT_Glyph_Copy( p_cached->p_outline, &p_bitmaps->p_outline ) )
+                p_bitmaps->p_outline = 0;
 
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
@@ -1150,8 +1216,8 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = p_cached->advance.x;
+                p_bitmaps->i_y_advance = p_cached->advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1258,8 +1324,11 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            const enum glyph_cache_kind kind =
+                p_bitmaps->p_shadow == p_bitmaps->p_outline ? GLYPH_BITMAP_OUTLINE
+                                                            : GLYPH_BITMAP_GLYPH;
+            if( TextCacheToBitmap( p_sys->p_cache, &p_bitmaps->cache_key, kind,
+                                   &p_bitmaps->p_shadow, &pen_shadow, 0 ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1267,8 +1336,9 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( TextCacheToBitmap( p_sys->p_cache, &p_bitmaps->cache_key,
+                                   GLYPH_BITMAP_GLYPH, &p_bitmaps->p_glyph,
+                                   &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1283,8 +1353,9 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( TextCacheToBitmap( p_sys->p_cache, &p_bitmaps->cache_key,
+                                   GLYPH_BITMAP_OUTLINE, &p_bitmaps->p_outline,
+                                   &pen_new, 1 ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
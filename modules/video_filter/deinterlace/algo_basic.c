@@ -125,62 +125,59 @@ int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
     return VLC_SUCCESS;
 }
 
+/* Arguments of the slice-parallel algorithms below */
+struct basic_slice
+{
+    filter_sys_t *p_sys;
+    picture_t *p_outpic;
+    picture_t *p_pic;
+    int i_field;
+};
+
 /*****************************************************************************
  * RenderLinear: BOB with linear interpolation
  *****************************************************************************/
 
-int RenderLinear( filter_t *p_filter,
-                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+static void RenderLinearSlice( void *opaque, unsigned i_slice, unsigned i_slices )
 {
-    VLC_UNUSED(order);
-    int i_plane;
+    const struct basic_slice *args = opaque;
+    filter_sys_t *p_sys = args->p_sys;
 
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < args->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
+        const plane_t *p_in = &args->p_pic->p[i_plane];
+        const plane_t *p_out = &args->p_outpic->p[i_plane];
+        const int i_lines = p_out->i_visible_lines;
+        const int i_first = DeintSliceStart( 0, i_lines, i_slice, i_slices );
+        const int i_end   = DeintSliceStart( 0, i_lines, i_slice + 1, i_slices );
 
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
+        for( int y = i_first ; y < i_end ; y++ )
         {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
-
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
-        {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+            uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+            const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+            /* Lines of the other field, except the first and last lines:
+             * mean value of the lines above and below */
+            if( (y & 1) != args->i_field && y > 0 && y < i_lines - 1 )
+                Merge( p_dst, p_src - p_in->i_pitch, p_src + p_in->i_pitch,
+                       p_in->i_pitch );
+            else
+                memcpy( p_dst, p_src, p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderLinear( filter_t *p_filter,
+                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+{
+    VLC_UNUSED(order);
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    struct basic_slice args = {
+        .p_sys = p_sys, .p_outpic = p_outpic, .p_pic = p_pic, .i_field = i_field,
+    };
+    DeintSlicesRun( p_sys->slices, RenderLinearSlice, &args );
     return VLC_SUCCESS;
 }
 
@@ -188,34 +185,39 @@ int RenderLinear( filter_t *p_filter,
  * RenderMean: Half-resolution blender
  *****************************************************************************/
 
-int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void RenderMeanSlice( void *opaque, unsigned i_slice, unsigned i_slices )
 {
-    int i_plane;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
+    const struct basic_slice *args = opaque;
+    filter_sys_t *p_sys = args->p_sys;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < args->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        const plane_t *p_in = &args->p_pic->p[i_plane];
+        const plane_t *p_out = &args->p_outpic->p[i_plane];
+        const int i_lines = p_out->i_visible_lines;
+        const int i_first = DeintSliceStart( 0, i_lines, i_slice, i_slices );
+        const int i_end   = DeintSliceStart( 0, i_lines, i_slice + 1, i_slices );
 
         /* All lines: mean value */
-        for( ; p_out < p_out_end ; )
+        for( int y = i_first ; y < i_end ; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+            const uint8_t *p_src = &p_in->p_pixels[2 * y * p_in->i_pitch];
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
+            Merge( &p_out->p_pixels[y * p_out->i_pitch],
+                   p_src, p_src + p_in->i_pitch, p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    struct basic_slice args = {
+        .p_sys = p_sys, .p_outpic = p_outpic, .p_pic = p_pic,
+    };
+    DeintSlicesRun( p_sys->slices, RenderMeanSlice, &args );
     return VLC_SUCCESS;
 }
 
@@ -223,37 +225,42 @@ int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
  * RenderBlend: Full-resolution blender
  *****************************************************************************/
 
-int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void RenderBlendSlice( void *opaque, unsigned i_slice, unsigned i_slices )
 {
-    int i_plane;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
+    const struct basic_slice *args = opaque;
+    filter_sys_t *p_sys = args->p_sys;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < args->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* First line: simple copy */
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        p_out += p_outpic->p[i_plane].i_pitch;
+        const plane_t *p_in = &args->p_pic->p[i_plane];
+        const plane_t *p_out = &args->p_outpic->p[i_plane];
+        const int i_lines = p_out->i_visible_lines;
+        const int i_first = DeintSliceStart( 0, i_lines, i_slice, i_slices );
+        const int i_end   = DeintSliceStart( 0, i_lines, i_slice + 1, i_slices );
 
-        /* Remaining lines: mean value */
-        for( ; p_out < p_out_end ; )
+        for( int y = i_first ; y < i_end ; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in  += p_pic->p[i_plane].i_pitch;
+            uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+            const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+            if( y == 0 )
+                /* First line: simple copy */
+                memcpy( p_dst, p_src, p_in->i_pitch );
+            else
+                /* Remaining lines: mean value */
+                Merge( p_dst, p_src - p_in->i_pitch, p_src, p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    struct basic_slice args = {
+        .p_sys = p_sys, .p_outpic = p_outpic, .p_pic = p_pic,
+    };
+    DeintSlicesRun( p_sys->slices, RenderBlendSlice, &args );
     return VLC_SUCCESS;
 }
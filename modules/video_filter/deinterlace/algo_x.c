@@ -543,19 +543,23 @@ static inline void XDeintBand8x8SSE( uint8_t *dst, int i_dst,
 }
 #endif
 
-/*****************************************************************************
- * Public functions
- *****************************************************************************/
+struct x_slice
+{
+    picture_t *p_outpic;
+    picture_t *p_pic;
+};
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+/* Renders the 8 lines bands of a slice of each plane */
+static void RenderXSlice( void *opaque, unsigned i_slice, unsigned i_slices )
 {
-    VLC_UNUSED(p_filter);
+    const struct x_slice *args = opaque;
+    picture_t *p_outpic = args->p_outpic;
+    picture_t *p_pic = args->p_pic;
     int i_plane;
 #if defined (CAN_COMPILE_SSE)
     const bool sse = vlc_CPU_SSE2();
 #endif
 
-    /* Copy image and skip lines */
     for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
         const int i_mby = ( p_outpic->p[i_plane].i_visible_lines + 7 )/8 - 1;
@@ -567,9 +571,12 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         const int i_dst = p_outpic->p[i_plane].i_pitch;
         const int i_src = p_pic->p[i_plane].i_pitch;
 
+        const int i_first = DeintSliceStart( 0, i_mby, i_slice, i_slices );
+        const int i_end   = DeintSliceStart( 0, i_mby, i_slice + 1, i_slices );
+
         int y, x;
 
-        for( y = 0; y < i_mby; y++ )
+        for( y = i_first; y < i_end; y++ )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -582,8 +589,8 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
                 XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
         }
 
-        /* Last line (C only)*/
-        if( i_mody )
+        /* Last line (C only), rendered by the last slice */
+        if( i_mody && i_slice == i_slices - 1 )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -600,6 +607,18 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
                 XDeintNxN( dst, i_dst, src, i_src, i_modx, i_mody );
         }
     }
+}
+
+/*****************************************************************************
+ * Public functions
+ *****************************************************************************/
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    struct x_slice args = { .p_outpic = p_outpic, .p_pic = p_pic };
+    DeintSlicesRun( p_sys->slices, RenderXSlice, &args );
 
     return VLC_SUCCESS;
 }
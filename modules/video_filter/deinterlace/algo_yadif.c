@@ -47,6 +47,76 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+typedef void (*yadif_filter_line)( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                   uint8_t *next, int w, int prefs, int mrefs,
+                                   int parity, int mode );
+
+struct yadif_slice
+{
+    picture_t *p_dst;
+    picture_t *p_prev;
+    picture_t *p_cur;
+    picture_t *p_next;
+    yadif_filter_line filter;
+    int i_field;
+    int i_parity;
+};
+
+/* Renders the lines of a slice of each plane */
+static void RenderYadifSlice( void *opaque, unsigned i_slice, unsigned i_slices )
+{
+    const struct yadif_slice *args = opaque;
+
+    for( int n = 0; n < args->p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &args->p_prev->p[n];
+        const plane_t *curp  = &args->p_cur->p[n];
+        const plane_t *nextp = &args->p_next->p[n];
+        plane_t *dstp        = &args->p_dst->p[n];
+
+        const int i_first = DeintSliceStart( 1, dstp->i_visible_lines - 1,
+                                             i_slice, i_slices );
+        const int i_end   = DeintSliceStart( 1, dstp->i_visible_lines - 1,
+                                             i_slice + 1, i_slices );
+
+        for( int y = i_first; y < i_end; y++ )
+        {
+            if( (y % 2) == args->i_field  ||  args->i_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                args->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                              &prevp->p_pixels[y * prevp->i_pitch],
+                              &curp->p_pixels[y * curp->i_pitch],
+                              &nextp->p_pixels[y * nextp->i_pitch],
+                              dstp->i_visible_pitch,
+                              y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                              y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                              args->i_parity,
+                              mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -110,8 +180,7 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     if( p_prev && p_cur && p_next )
     {
         /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        yadif_filter_line filter;
 
 #if defined(HAVE_X86ASM)
         if( vlc_CPU_SSSE3() )
@@ -126,49 +195,11 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         if( p_sys->chroma->pixel_size == 2 )
             filter = yadif_filter_line_c_16bit;
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        struct yadif_slice args = {
+            .p_dst = p_dst, .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .filter = filter, .i_field = i_field, .i_parity = yadif_parity,
+        };
+        DeintSlicesRun( p_sys->slices, RenderYadifSlice, &args );
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
@@ -294,6 +294,11 @@ static void Close( filter_t * );
                                     "in the Phosphor framerate doubler. "\
                                     "Default: Low.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads rendering slices of each " \
+                            "picture in the Linear, Mean, Blend, X and " \
+                            "Yadif modes, 0 meaning auto.")
+
 vlc_plugin_begin ()
     set_shortname( N_("Deinterlace") )
     set_capability( VLC_CAP_VIDEO_FILTER, 0, Open, Close )
@@ -311,6 +316,8 @@ vlc_plugin_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "threads", 0, 0, 32,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 vlc_plugin_end ()
 
 /*****************************************************************************
@@ -324,7 +331,7 @@ vlc_plugin_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -343,6 +350,7 @@ struct filter_mode_t
     deinterlace_algo     settings;
     bool                 can_pack;         /**< can handle packed pixel */
     bool                 b_high_bit_depth; /**< can handle high bit depth */
+    bool                 b_sliced;         /**< can render slices in parallel */
 };
 static struct filter_mode_t filter_mode [] = {
     { "discard", .pf_render_single_pic = RenderDiscard,
@@ -352,23 +360,41 @@ static struct filter_mode_t filter_mode [] = {
     { "progressive-scan", .pf_render_ordered = RenderBob,
                  { true, false, false, false }, true, true },
     { "linear", .pf_render_ordered = RenderLinear,
-                 { true, false, false, false }, true, true },
+                 { true, false, false, false }, true, true, true },
     { "mean", .pf_render_single_pic = RenderMean,
-                 { false, false, false, true }, true, true },
+                 { false, false, false, true }, true, true, true },
     { "blend", .pf_render_single_pic = RenderBlend,
-                 { false, false, false, false }, true, true },
+                 { false, false, false, false }, true, true, true },
     { "yadif", .pf_render_single_pic = RenderYadifSingle,
-                 { false, true, false, false }, false, true },
+                 { false, true, false, false }, false, true, true },
     { "yadif2x", .pf_render_ordered = RenderYadif,
-                 { true, true, false, false }, false, true },
+                 { true, true, false, false }, false, true, true },
     { "x", .pf_render_single_pic = RenderX,
-                 { false, false, false, false }, false, false },
+                 { false, false, false, false }, false, false, true },
     { "phosphor", .pf_render_ordered = RenderPhosphor,
                  { true, true, false, false }, false, false },
     { "ivtc", .pf_render_single_pic = RenderIVTC,
                  { false, true, true, false }, false, false },
 };
 
+/**
+ * Starts the worker pool of the slice-parallel algorithms.
+ *
+ * @param p_filter The filter instance.
+ */
+static void StartSlices( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    int i_threads = var_InheritInteger( p_filter, FILTER_CFG_PREFIX "threads" );
+    if( i_threads <= 0 )
+        i_threads = __MIN( vlc_GetCPUCount(), 8 );
+
+    p_sys->slices = DeintSlicesNew( i_threads );
+    if( p_sys->slices != NULL )
+        msg_Dbg( p_filter, "rendering %d slices in parallel", i_threads );
+}
+
 /**
  * Setup the deinterlace method to use.
  *
@@ -407,6 +433,8 @@ static void SetFilterMethod( filter_t *p_filter, const char *mode, bool pack )
             msg_Dbg( p_filter, "using %s deinterlace method", mode );
             p_sys->context.settings = filter_mode[i].settings;
             p_sys->context.pf_render_ordered = filter_mode[i].pf_render_ordered;
+            if( filter_mode[i].b_sliced )
+                StartSlices( p_filter );
             return;
         }
     }
@@ -522,6 +550,7 @@ notsupp:
         return VLC_ENOMEM;
 
     p_sys->chroma = chroma;
+    p_sys->slices = NULL;
 
     InitDeinterlacingContext( &p_sys->context );
 
@@ -639,6 +668,9 @@ notsupp:
 
 void Close( filter_t *p_filter )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
+
     Flush( p_filter );
-    free( p_filter->p_sys );
+    DeintSlicesDelete( p_sys->slices );
+    free( p_sys );
 }
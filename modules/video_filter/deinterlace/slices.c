@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * slices.c : Slice-parallel rendering for the VLC deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#include "slices.h"
+
+struct deint_slice_worker
+{
+    deint_slices_t *p_slices;
+    vlc_thread_t    thread;
+    unsigned        i_slice;
+};
+
+struct deint_slices_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait_work;
+    vlc_cond_t  wait_done;
+
+    /* Current job, protected by lock */
+    deint_slice_cb pf_render;
+    void          *opaque;
+    uint64_t       i_generation; /**< Incremented for each picture */
+    unsigned       i_pending;    /**< Workers still rendering the picture */
+    bool           b_quit;
+
+    unsigned                  i_slices;
+    struct deint_slice_worker workers[];
+};
+
+static void *Worker( void *data )
+{
+    struct deint_slice_worker *p_worker = data;
+    deint_slices_t *p_slices = p_worker->p_slices;
+    uint64_t i_generation = 0;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        while( !p_slices->b_quit && p_slices->i_generation == i_generation )
+            vlc_cond_wait( &p_slices->wait_work, &p_slices->lock );
+        if( p_slices->b_quit )
+            break;
+
+        i_generation = p_slices->i_generation;
+        deint_slice_cb pf_render = p_slices->pf_render;
+        void *opaque = p_slices->opaque;
+        vlc_mutex_unlock( &p_slices->lock );
+
+        pf_render( opaque, p_worker->i_slice, p_slices->i_slices );
+
+        vlc_mutex_lock( &p_slices->lock );
+        if( --p_slices->i_pending == 0 )
+            vlc_cond_signal( &p_slices->wait_done );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+    return NULL;
+}
+
+static void Stop( deint_slices_t *p_slices, unsigned i_workers )
+{
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->b_quit = true;
+    vlc_cond_broadcast( &p_slices->wait_work );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 0; i < i_workers; i++ )
+        vlc_join( p_slices->workers[i].thread, NULL );
+
+    vlc_cond_destroy( &p_slices->wait_done );
+    vlc_cond_destroy( &p_slices->wait_work );
+    vlc_mutex_destroy( &p_slices->lock );
+}
+
+deint_slices_t *DeintSlicesNew( unsigned i_threads )
+{
+    if( i_threads <= 1 )
+        return NULL;
+
+    /* The calling thread renders the first slice */
+    const unsigned i_workers = i_threads - 1;
+    deint_slices_t *p_slices =
+        malloc( sizeof( *p_slices ) + i_workers * sizeof( p_slices->workers[0] ) );
+    if( !p_slices )
+        return NULL;
+
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait_work );
+    vlc_cond_init( &p_slices->wait_done );
+    p_slices->pf_render = NULL;
+    p_slices->opaque = NULL;
+    p_slices->i_generation = 0;
+    p_slices->i_pending = 0;
+    p_slices->b_quit = false;
+    p_slices->i_slices = i_threads;
+
+    for( unsigned i = 0; i < i_workers; i++ )
+    {
+        struct deint_slice_worker *p_worker = &p_slices->workers[i];
+
+        p_worker->p_slices = p_slices;
+        p_worker->i_slice = i + 1;
+        if( vlc_clone( &p_worker->thread, Worker, p_worker,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            Stop( p_slices, i );
+            free( p_slices );
+            return NULL;
+        }
+    }
+    return p_slices;
+}
+
+void DeintSlicesDelete( deint_slices_t *p_slices )
+{
+    if( !p_slices )
+        return;
+
+    Stop( p_slices, p_slices->i_slices - 1 );
+    free( p_slices );
+}
+
+void DeintSlicesRun( deint_slices_t *p_slices, deint_slice_cb pf_render,
+                     void *opaque )
+{
+    if( !p_slices )
+    {
+        pf_render( opaque, 0, 1 );
+        return;
+    }
+
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->pf_render = pf_render;
+    p_slices->opaque = opaque;
+    p_slices->i_pending = p_slices->i_slices - 1;
+    p_slices->i_generation++;
+    vlc_cond_broadcast( &p_slices->wait_work );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    pf_render( opaque, 0, p_slices->i_slices );
+
+    vlc_mutex_lock( &p_slices->lock );
+    while( p_slices->i_pending > 0 )
+        vlc_cond_wait( &p_slices->wait_done, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+}
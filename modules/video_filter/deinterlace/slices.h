@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * slices.h : Slice-parallel rendering for the VLC deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEINTERLACE_SLICES_H
+#define VLC_DEINTERLACE_SLICES_H 1
+
+/**
+ * \file
+ * Worker pool running the per-line deinterlace algorithms on horizontal
+ * slices of the picture.
+ */
+
+/*****************************************************************************
+ * Data structures
+ *****************************************************************************/
+
+typedef struct deint_slices_t deint_slices_t;
+
+/**
+ * Renders one slice.
+ *
+ * @param opaque Algorithm-specific arguments.
+ * @param i_slice Index of the slice to render, in [0, i_slices).
+ * @param i_slices Total number of slices.
+ */
+typedef void (*deint_slice_cb)( void *opaque, unsigned i_slice,
+                                unsigned i_slices );
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * Starts a worker pool.
+ *
+ * @param i_threads Number of slices per picture, the calling thread
+ *                  rendering one of them.
+ * @return The pool, or NULL if i_threads <= 1 or on error.
+ */
+deint_slices_t *DeintSlicesNew( unsigned i_threads );
+
+/**
+ * Stops a worker pool.
+ *
+ * @param p_slices The pool, may be NULL.
+ */
+void DeintSlicesDelete( deint_slices_t *p_slices );
+
+/**
+ * Renders all the slices of a picture and waits for their completion.
+ *
+ * Without a pool, the whole picture is rendered as a single slice
+ * by the calling thread.
+ *
+ * @param p_slices The pool, may be NULL.
+ * @param pf_render Slice rendering callback.
+ * @param opaque Data for pf_render.
+ */
+void DeintSlicesRun( deint_slices_t *p_slices, deint_slice_cb pf_render,
+                     void *opaque );
+
+/**
+ * Returns the first line of a slice.
+ *
+ * Slice i_slice covers the lines [SliceStart(i_slice), SliceStart(i_slice+1)).
+ *
+ * @param i_first First line to render.
+ * @param i_end Line after the last line to render.
+ */
+static inline int DeintSliceStart( int i_first, int i_end,
+                                   unsigned i_slice, unsigned i_slices )
+{
+    return i_first + (int)( (int64_t)( i_end - i_first ) * i_slice / i_slices );
+}
+
+#endif
@@ -366,14 +366,28 @@ do { \
 void aout_Interleave( void *restrict dst, const void *const *srcv,
                       unsigned samples, unsigned chans, vlc_fourcc_t fourcc )
 {
+/* Frame by frame, so that the destination is written sequentially; the
+ * common layouts get loops with a constant stride the compiler vectorizes. */
 #define INTERLEAVE_TYPE(type) \
 do { \
-    type *d = dst; \
-    for( size_t i = 0; i < chans; i++ ) { \
-        const type *s = srcv[i]; \
-        for( size_t j = 0, k = 0; j < samples; j++, k += chans ) \
-            d[k] = *(s++); \
-        d++; \
+    type *restrict d = dst; \
+    const type *const *s = (const type *const *)srcv; \
+    switch( chans ) { \
+        case 1: \
+            memcpy( d, s[0], samples * sizeof(type) ); \
+            break; \
+        case 2: { \
+            const type *restrict l = s[0], *restrict r = s[1]; \
+            for( size_t j = 0; j < samples; j++ ) { \
+                d[2 * j] = l[j]; \
+                d[2 * j + 1] = r[j]; \
+            } \
+            break; \
+        } \
+        default: \
+            for( size_t j = 0; j < samples; j++ ) \
+                for( size_t i = 0; i < chans; i++ ) \
+                    *(d++) = s[i][j]; \
     } \
 } while(0)
 
@@ -404,12 +418,24 @@ void aout_Deinterleave( void *restrict dst, const void *restrict src,
 {
 #define DEINTERLEAVE_TYPE(type) \
 do { \
-    type *d = dst; \
-    const type *s = src; \
-    for( size_t i = 0; i < chans; i++ ) { \
-        for( size_t j = 0, k = 0; j < samples; j++, k += chans ) \
-            *(d++) = s[k]; \
-        s++; \
+    type *restrict d = dst; \
+    const type *restrict s = src; \
+    switch( chans ) { \
+        case 1: \
+            memcpy( d, s, samples * sizeof(type) ); \
+            break; \
+        case 2: { \
+            type *restrict l = d, *restrict r = d + samples; \
+            for( size_t j = 0; j < samples; j++ ) { \
+                l[j] = s[2 * j]; \
+                r[j] = s[2 * j + 1]; \
+            } \
+            break; \
+        } \
+        default: \
+            for( size_t j = 0; j < samples; j++ ) \
+                for( size_t i = 0; i < chans; i++ ) \
+                    d[i * samples + j] = *(s++); \
     } \
 } while(0)
 
@@ -25,13 +25,24 @@
 #endif
 
 #include <vlc_thumbnailer.h>
+#include <vlc_codec.h>
+#include <vlc_es_out.h>
+#include <vlc_interrupt.h>
+#include <vlc_modules.h>
 #include "input_internal.h"
+#include "demux.h"
+#include "stream.h"
 #include "misc/background_worker.h"
 
+struct thumbnailer_source;
+
 struct vlc_thumbnailer_t
 {
     vlc_object_t* parent;
     struct background_worker* worker;
+    /* Demuxer and decoder of the last item, kept for the next request. Only
+     * used by the request thread: requests are processed one at a time. */
+    struct thumbnailer_source* source;
 };
 
 typedef struct vlc_thumbnailer_params_t
@@ -61,6 +72,8 @@ struct vlc_thumbnailer_request_t
 {
     vlc_thumbnailer_t *thumbnailer;
     input_thread_t *input_thread;
+    vlc_thread_t thread;
+    vlc_interrupt_t *interrupt;
 
     vlc_thumbnailer_params_t params;
 
@@ -68,28 +81,516 @@ struct vlc_thumbnailer_request_t
     bool done;
 };
 
-static void
-on_thumbnailer_input_event( input_thread_t *input,
-                            const struct vlc_input_event *event, void *userdata )
+/*****************************************************************************
+ * Direct extraction
+ *
+ * Running a complete input thread (es_out, clock, decoder threads) for each
+ * thumbnail is expensive when many thumbnails of the same item are requested
+ * in a row. Instead, the item is demuxed and its first video track decoded
+ * synchronously, and the demuxer and decoder are kept for the next request
+ * on the same item.
+ *****************************************************************************/
+struct es_out_id_t
 {
-    VLC_UNUSED(input);
-    if ( event->type != INPUT_EVENT_THUMBNAIL_READY &&
-         ( event->type != INPUT_EVENT_STATE || ( event->state != ERROR_S &&
-                                                 event->state != END_S ) ) )
-         return;
+    struct es_out_id_t *next;
+    enum es_format_category_e i_cat;
+};
 
-    vlc_thumbnailer_request_t* request = userdata;
-    picture_t *pic = NULL;
+struct thumbnailer_source
+{
+    es_out_t out;
+    vlc_object_t *parent;
+    char *psz_uri;
+    demux_t *demux;
+    bool b_can_seek;
 
-    if ( event->type == INPUT_EVENT_THUMBNAIL_READY )
+    es_out_id_t *ids;
+    es_out_id_t *video;     /* decoded ES, or NULL */
+    es_format_t fmt;        /* format of the decoded ES */
+    decoder_t *packetizer;
+    decoder_t *decoder;
+
+    vlc_tick_t i_preroll_end;
+    picture_t *pic;
+};
+
+struct thumbnailer_decoder
+{
+    decoder_t dec;
+    struct thumbnailer_source *source;
+};
+
+static int thumbnailer_source_UpdateFormat( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return 0;
+}
+
+static void thumbnailer_source_QueueVideo( decoder_t *p_dec, picture_t *p_pic )
+{
+    struct thumbnailer_source *source =
+        container_of( p_dec, struct thumbnailer_decoder, dec )->source;
+
+    /* Keep the first picture which is not part of the preroll */
+    if ( source->pic == NULL && ( p_pic->date == VLC_TICK_INVALID ||
+                                  p_pic->date >= source->i_preroll_end ) )
+        source->pic = p_pic;
+    else
+        picture_Release( p_pic );
+}
+
+static int thumbnailer_source_LoadDecoder( decoder_t *p_dec, bool b_packetizer,
+                                           const es_format_t *restrict p_fmt )
+{
+    decoder_Init( p_dec, p_fmt );
+
+    if ( !b_packetizer )
+        p_dec->p_module = vlc_module_need_var( p_dec, VLC_CAP_VIDEO_DECODER,
+                                               "codec" );
+    else
+        p_dec->p_module = vlc_module_need_var( p_dec, VLC_CAP_PACKETIZER,
+                                               "packetizer" );
+    if ( p_dec->p_module == NULL )
     {
-        /*
-         * Stop the input thread ASAP, delegate its release to
-         * thumbnailer_request_Release
-         */
-        input_Stop( request->input_thread );
-        pic = event->thumbnail;
+        decoder_Clean( p_dec );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void thumbnailer_source_StopDecoder( struct thumbnailer_source *source )
+{
+    if ( source->video == NULL )
+        return;
+    if ( source->decoder != NULL )
+    {
+        decoder_Destroy( source->decoder );
+        source->decoder = NULL;
+    }
+    if ( source->packetizer != NULL )
+    {
+        decoder_Destroy( source->packetizer );
+        source->packetizer = NULL;
+    }
+    es_format_Clean( &source->fmt );
+    source->video = NULL;
+}
+
+static int thumbnailer_source_StartDecoder( struct thumbnailer_source *source,
+                                            es_out_id_t *id,
+                                            const es_format_t *p_fmt )
+{
+    static const struct decoder_owner_callbacks dec_cbs =
+    {
+        .video = {
+            .format_update = thumbnailer_source_UpdateFormat,
+            .queue = thumbnailer_source_QueueVideo,
+        },
+    };
+
+    if ( es_format_Copy( &source->fmt, p_fmt ) != VLC_SUCCESS )
+        return VLC_ENOMEM;
+    source->video = id;
+
+    /* Load a packetizer module if the input is not already packetized */
+    if ( !p_fmt->b_packetized )
+    {
+        decoder_t *packetizer = vlc_custom_create( source->parent,
+                                        sizeof( *packetizer ), "packetizer" );
+        if ( packetizer != NULL )
+        {
+            if ( thumbnailer_source_LoadDecoder( packetizer, true, p_fmt ) )
+                vlc_object_delete( packetizer );
+            else
+            {
+                packetizer->fmt_out.b_packetized = true;
+                p_fmt = &packetizer->fmt_out;
+                source->packetizer = packetizer;
+            }
+        }
+    }
+
+    struct thumbnailer_decoder *owner =
+        vlc_custom_create( source->parent, sizeof( *owner ), "decoder" );
+    if ( unlikely( owner == NULL ) )
+        goto error;
+    owner->source = source;
+    owner->dec.cbs = &dec_cbs;
+
+    if ( thumbnailer_source_LoadDecoder( &owner->dec, false, p_fmt ) )
+    {
+        msg_Err( source->parent, "no suitable decoder module for fourcc `%4.4s'",
+                 (const char *)&p_fmt->i_codec );
+        vlc_object_delete( &owner->dec );
+        goto error;
+    }
+    source->decoder = &owner->dec;
+    return VLC_SUCCESS;
+
+error:
+    thumbnailer_source_StopDecoder( source );
+    return VLC_EGENERIC;
+}
+
+static void thumbnailer_source_Decode( struct thumbnailer_source *source,
+                                       block_t *p_block )
+{
+    decoder_t *decoder = source->decoder;
+    decoder_t *packetizer = source->packetizer;
+
+    if ( packetizer == NULL )
+    {
+        decoder->pf_decode( decoder, p_block );
+        return;
+    }
+
+    block_t **pp_block = p_block != NULL ? &p_block : NULL;
+    block_t *p_packetized;
+    while ( ( p_packetized = packetizer->pf_packetize( packetizer, pp_block ) ) )
+    {
+        if ( !es_format_IsSimilar( &decoder->fmt_in, &packetizer->fmt_out ) )
+        {
+            /* Drain and reload the decoder on format changes */
+            decoder->pf_decode( decoder, NULL );
+            decoder_Clean( decoder );
+            if ( thumbnailer_source_LoadDecoder( decoder, false,
+                                                 &packetizer->fmt_out ) )
+            {
+                block_ChainRelease( p_packetized );
+                thumbnailer_source_StopDecoder( source );
+                return;
+            }
+        }
+
+        while ( p_packetized != NULL )
+        {
+            block_t *p_next = p_packetized->p_next;
+            p_packetized->p_next = NULL;
+
+            if ( decoder->pf_decode( decoder, p_packetized ) == VLCDEC_ECRITICAL )
+            {
+                block_ChainRelease( p_next );
+                thumbnailer_source_StopDecoder( source );
+                return;
+            }
+            p_packetized = p_next;
+        }
+    }
+    if ( p_block == NULL )
+        decoder->pf_decode( decoder, NULL );
+}
+
+static es_out_id_t *thumbnailer_source_EsOutAdd( es_out_t *out,
+                                                 const es_format_t *p_fmt )
+{
+    struct thumbnailer_source *source =
+        container_of( out, struct thumbnailer_source, out );
+
+    es_out_id_t *id = malloc( sizeof( *id ) );
+    if ( unlikely( id == NULL ) )
+        return NULL;
+    id->i_cat = p_fmt->i_cat;
+    id->next = source->ids;
+    source->ids = id;
+
+    /* Only the first video track is decoded */
+    if ( p_fmt->i_cat == VIDEO_ES && source->video == NULL )
+        thumbnailer_source_StartDecoder( source, id, p_fmt );
+    return id;
+}
+
+static int thumbnailer_source_EsOutSend( es_out_t *out, es_out_id_t *id,
+                                         block_t *p_block )
+{
+    struct thumbnailer_source *source =
+        container_of( out, struct thumbnailer_source, out );
+
+    if ( id != source->video || source->pic != NULL )
+    {
+        block_Release( p_block );
+        return VLC_SUCCESS;
+    }
+
+    /* Mark preroll blocks */
+    if ( source->i_preroll_end >= 0 )
+    {
+        vlc_tick_t i_date = p_block->i_pts;
+        if ( p_block->i_pts == VLC_TICK_INVALID )
+            i_date = p_block->i_dts;
+
+        if ( i_date + p_block->i_length < source->i_preroll_end )
+            p_block->i_flags |= BLOCK_FLAG_PREROLL;
+    }
+
+    thumbnailer_source_Decode( source, p_block );
+    return VLC_SUCCESS;
+}
+
+static void thumbnailer_source_EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    struct thumbnailer_source *source =
+        container_of( out, struct thumbnailer_source, out );
+
+    if ( id == source->video )
+        thumbnailer_source_StopDecoder( source );
+
+    for ( es_out_id_t **pp = &source->ids; *pp != NULL; pp = &(*pp)->next )
+    {
+        if ( *pp == id )
+        {
+            *pp = id->next;
+            break;
+        }
+    }
+    free( id );
+}
+
+static int thumbnailer_source_EsOutControl( es_out_t *out, int query,
+                                            va_list args )
+{
+    struct thumbnailer_source *source =
+        container_of( out, struct thumbnailer_source, out );
+
+    switch ( query )
+    {
+        case ES_OUT_SET_ES_FMT:
+        case ES_OUT_RESTART_ES:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            if ( id != source->video )
+                break;
+
+            es_format_t fmt;
+            const es_format_t *p_fmt = query == ES_OUT_SET_ES_FMT ?
+                va_arg( args, const es_format_t * ) : &source->fmt;
+            if ( es_format_Copy( &fmt, p_fmt ) != VLC_SUCCESS )
+                return VLC_ENOMEM;
+            thumbnailer_source_StopDecoder( source );
+            thumbnailer_source_StartDecoder( source, id, &fmt );
+            es_format_Clean( &fmt );
+            break;
+        }
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            *va_arg( args, bool * ) = id == source->video;
+            break;
+        }
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+            source->i_preroll_end = va_arg( args, vlc_tick_t );
+            break;
+        case ES_OUT_GET_EMPTY:
+            *va_arg( args, bool * ) = true;
+            break;
+        case ES_OUT_SET_ES:
+        case ES_OUT_SET_ES_LIST:
+        case ES_OUT_UNSET_ES:
+        case ES_OUT_SET_ES_DEFAULT:
+        case ES_OUT_SET_ES_STATE:
+        case ES_OUT_SET_ES_CAT_POLICY:
+        case ES_OUT_SET_GROUP:
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_GROUP_META:
+        case ES_OUT_SET_GROUP_EPG:
+        case ES_OUT_SET_GROUP_EPG_EVENT:
+        case ES_OUT_SET_EPG_TIME:
+        case ES_OUT_DEL_GROUP:
+        case ES_OUT_SET_ES_SCRAMBLED_STATE:
+        case ES_OUT_SET_META:
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void thumbnailer_source_EsOutDestroy( es_out_t *out )
+{
+    VLC_UNUSED(out);
+}
+
+static const struct es_out_callbacks thumbnailer_source_es_out_cbs =
+{
+    .add = thumbnailer_source_EsOutAdd,
+    .send = thumbnailer_source_EsOutSend,
+    .del = thumbnailer_source_EsOutDel,
+    .control = thumbnailer_source_EsOutControl,
+    .destroy = thumbnailer_source_EsOutDestroy,
+};
+
+static void thumbnailer_source_Delete( struct thumbnailer_source *source )
+{
+    if ( source->demux != NULL )
+        demux_Delete( source->demux );
+    thumbnailer_source_StopDecoder( source );
+    while ( source->ids != NULL )
+    {
+        es_out_id_t *id = source->ids;
+        source->ids = id->next;
+        free( id );
+    }
+    if ( source->pic != NULL )
+        picture_Release( source->pic );
+    free( source->psz_uri );
+    free( source );
+}
+
+static struct thumbnailer_source *
+thumbnailer_source_New( vlc_object_t *parent, const char *psz_uri )
+{
+    struct thumbnailer_source *source = calloc( 1, sizeof( *source ) );
+    if ( unlikely( source == NULL ) )
+        return NULL;
+    source->out.cbs = &thumbnailer_source_es_out_cbs;
+    source->parent = parent;
+    source->i_preroll_end = -1;
+    source->psz_uri = strdup( psz_uri );
+    if ( unlikely( source->psz_uri == NULL ) )
+        goto error;
+
+    stream_t *p_stream = stream_AccessNew( parent, NULL, &source->out,
+                                           false, psz_uri );
+    if ( p_stream == NULL )
+        goto error;
+
+    p_stream = stream_FilterAutoNew( p_stream );
+
+    if ( p_stream->pf_read == NULL && p_stream->pf_block == NULL
+      && p_stream->pf_readdir == NULL )
+        source->demux = p_stream; /* Combined access/demux */
+    else
+    {
+        source->demux = demux_NewAdvanced( parent, NULL, "any", psz_uri,
+                                           p_stream, &source->out, false );
+        if ( source->demux == NULL )
+        {
+            vlc_stream_Delete( p_stream );
+            goto error;
+        }
+    }
+
+    /* Directories and playlists have no frames: demux_Demux() would
+     * succeed forever without producing any */
+    if ( source->demux->pf_demux == NULL )
+        goto error;
+
+    if ( demux_Control( source->demux, DEMUX_CAN_SEEK, &source->b_can_seek ) )
+        source->b_can_seek = false;
+    return source;
+
+error:
+    thumbnailer_source_Delete( source );
+    return NULL;
+}
+
+static void thumbnailer_source_Flush( struct thumbnailer_source *source )
+{
+    if ( source->packetizer != NULL && source->packetizer->pf_flush != NULL )
+        source->packetizer->pf_flush( source->packetizer );
+    if ( source->decoder != NULL && source->decoder->pf_flush != NULL )
+        source->decoder->pf_flush( source->decoder );
+    if ( source->pic != NULL )
+    {
+        picture_Release( source->pic );
+        source->pic = NULL;
     }
+    source->i_preroll_end = -1;
+}
+
+/**
+ * Seeks and demuxes until the video decoder outputs a picture.
+ * \return the picture, or NULL on error, end of stream or interruption
+ */
+static picture_t *
+thumbnailer_source_Extract( struct thumbnailer_source *source,
+                            const vlc_thumbnailer_params_t *params )
+{
+    demux_t *demux = source->demux;
+    int i_ret;
+
+    thumbnailer_source_Flush( source );
+
+    if ( params->type == VLC_THUMBNAILER_SEEK_TIME )
+    {
+        i_ret = demux_SetTime( demux, params->time, !params->fast_seek, true );
+        if ( i_ret )
+        {
+            vlc_tick_t i_length;
+
+            /* Emulate it with a SET_POS */
+            if ( !demux_Control( demux, DEMUX_GET_LENGTH, &i_length )
+              && i_length > 0 )
+                i_ret = demux_SetPosition( demux,
+                                    (double)params->time / (double)i_length,
+                                    !params->fast_seek, true );
+        }
+    }
+    else
+    {
+        assert( params->type == VLC_THUMBNAILER_SEEK_POS );
+        i_ret = demux_SetPosition( demux, params->pos, !params->fast_seek,
+                                   true );
+    }
+    if ( i_ret )
+        msg_Warn( source->parent, "thumbnailer seek failed or not possible" );
+
+    while ( source->pic == NULL && !vlc_killed() )
+    {
+        if ( demux_Demux( demux ) != VLC_DEMUXER_SUCCESS )
+        {
+            /* Drain the decoder, the last frames may still be pending */
+            if ( source->decoder != NULL )
+                thumbnailer_source_Decode( source, NULL );
+            break;
+        }
+    }
+
+    picture_t *pic = source->pic;
+    source->pic = NULL;
+    return pic;
+}
+
+/**
+ * Returns the URI of the item if it can be thumbnailed directly, NULL if
+ * it needs an input thread.
+ */
+static char *thumbnailer_GetDirectUri( input_item_t *item )
+{
+    char *psz_uri = NULL;
+
+    vlc_mutex_lock( &item->lock );
+    /* Item options are input variables, and anchors are handled by the
+     * input thread */
+    if ( item->i_options == 0 && item->psz_uri != NULL
+      && strchr( item->psz_uri, '#' ) == NULL )
+        psz_uri = strdup( item->psz_uri );
+    vlc_mutex_unlock( &item->lock );
+    return psz_uri;
+}
+
+static struct thumbnailer_source *
+thumbnailer_GetSource( vlc_thumbnailer_t *thumbnailer, const char *psz_uri )
+{
+    struct thumbnailer_source *source = thumbnailer->source;
+    if ( source != NULL )
+    {
+        if ( !strcmp( source->psz_uri, psz_uri ) )
+            return source;
+        thumbnailer_source_Delete( source );
+    }
+    thumbnailer->source = thumbnailer_source_New( thumbnailer->parent, psz_uri );
+    return thumbnailer->source;
+}
+
+/*****************************************************************************
+ * Requests
+ *****************************************************************************/
+static void
+thumbnailer_request_Complete( vlc_thumbnailer_request_t *request,
+                              picture_t *pic )
+{
     vlc_mutex_lock( &request->lock );
     request->done = true;
     /*
@@ -105,34 +606,42 @@ on_thumbnailer_input_event( input_thread_t *input,
     background_worker_RequestProbe( request->thumbnailer->worker );
 }
 
-static void thumbnailer_request_Hold( void* data )
+static void
+on_thumbnailer_input_event( input_thread_t *input,
+                            const struct vlc_input_event *event, void *userdata )
 {
-    VLC_UNUSED(data);
-}
+    VLC_UNUSED(input);
+    if ( event->type != INPUT_EVENT_THUMBNAIL_READY &&
+         ( event->type != INPUT_EVENT_STATE || ( event->state != ERROR_S &&
+                                                 event->state != END_S ) ) )
+         return;
 
-static void thumbnailer_request_Release( void* data )
-{
-    vlc_thumbnailer_request_t* request = data;
-    if ( request->input_thread )
-        input_Close( request->input_thread );
+    vlc_thumbnailer_request_t* request = userdata;
+    picture_t *pic = NULL;
 
-    input_item_Release( request->params.input_item );
-    vlc_mutex_destroy( &request->lock );
-    free( request );
+    if ( event->type == INPUT_EVENT_THUMBNAIL_READY )
+    {
+        /*
+         * Stop the input thread ASAP, delegate its release to
+         * thumbnailer_request_Release
+         */
+        input_Stop( request->input_thread );
+        pic = event->thumbnail;
+    }
+    thumbnailer_request_Complete( request, pic );
 }
 
-static int thumbnailer_request_Start( void* owner, void* entity, void** out )
+static void thumbnailer_request_StartInput( vlc_thumbnailer_request_t *request )
 {
-    vlc_thumbnailer_t* thumbnailer = owner;
-    vlc_thumbnailer_request_t* request = entity;
+    vlc_thumbnailer_t* thumbnailer = request->thumbnailer;
     input_thread_t* input = request->input_thread =
             input_CreateThumbnailer( thumbnailer->parent,
                                      on_thumbnailer_input_event, request,
                                      request->params.input_item );
     if ( unlikely( input == NULL ) )
     {
-        request->params.cb( request->params.user_data, NULL );
-        return VLC_EGENERIC;
+        thumbnailer_request_Complete( request, NULL );
+        return;
     }
     if ( request->params.type == VLC_THUMBNAILER_SEEK_TIME )
     {
@@ -146,12 +655,86 @@ static int thumbnailer_request_Start( void* owner, void* entity, void** out )
                        request->params.fast_seek );
     }
     if ( input_Start( input ) != VLC_SUCCESS )
+        thumbnailer_request_Complete( request, NULL );
+}
+
+static void* thumbnailer_request_Run( void* data )
+{
+    vlc_thumbnailer_request_t* request = data;
+    vlc_thumbnailer_t* thumbnailer = request->thumbnailer;
+
+    vlc_interrupt_set( request->interrupt );
+
+    char *psz_uri = thumbnailer_GetDirectUri( request->params.input_item );
+    struct thumbnailer_source *source = NULL;
+    if ( psz_uri != NULL )
     {
-        request->params.cb( request->params.user_data, NULL );
-        return VLC_EGENERIC;
+        source = thumbnailer_GetSource( thumbnailer, psz_uri );
+        free( psz_uri );
+    }
+
+    if ( source == NULL )
+    {
+        /* Let the input thread handle what can't be opened directly */
+        if ( !vlc_killed() )
+            thumbnailer_request_StartInput( request );
+        return NULL;
+    }
+
+    picture_t *pic = thumbnailer_source_Extract( source, &request->params );
+    thumbnailer_request_Complete( request, pic );
+    if ( pic != NULL )
+        picture_Release( pic );
+
+    /* Don't keep the source if it can't be reused: it is at an unknown
+     * position, or its state is unknown after an error or an interruption */
+    if ( pic == NULL || !source->b_can_seek )
+    {
+        thumbnailer_source_Delete( source );
+        thumbnailer->source = NULL;
+    }
+    return NULL;
+}
+
+static void thumbnailer_request_Hold( void* data )
+{
+    VLC_UNUSED(data);
+}
+
+static void thumbnailer_request_Release( void* data )
+{
+    vlc_thumbnailer_request_t* request = data;
+    if ( request->input_thread )
+        input_Close( request->input_thread );
+    if ( request->interrupt )
+        vlc_interrupt_destroy( request->interrupt );
+
+    input_item_Release( request->params.input_item );
+    vlc_mutex_destroy( &request->lock );
+    free( request );
+}
+
+static int thumbnailer_request_Start( void* owner, void* entity, void** out )
+{
+    VLC_UNUSED(owner);
+    vlc_thumbnailer_request_t* request = entity;
+
+    request->interrupt = vlc_interrupt_create();
+    if ( unlikely( request->interrupt == NULL ) )
+        goto error;
+    if ( vlc_clone( &request->thread, thumbnailer_request_Run, request,
+                    VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_interrupt_destroy( request->interrupt );
+        request->interrupt = NULL;
+        goto error;
     }
     *out = request;
     return VLC_SUCCESS;
+
+error:
+    thumbnailer_request_Complete( request, NULL );
+    return VLC_EGENERIC;
 }
 
 static void thumbnailer_request_Stop( void* owner, void* handle )
@@ -170,8 +753,10 @@ static void thumbnailer_request_Stop( void* owner, void* handle )
         request->params.cb = NULL;
     }
     vlc_mutex_unlock( &request->lock );
-    assert( request->input_thread != NULL );
-    input_Stop( request->input_thread );
+    vlc_interrupt_kill( request->interrupt );
+    vlc_join( request->thread, NULL );
+    if ( request->input_thread != NULL )
+        input_Stop( request->input_thread );
 }
 
 static int thumbnailer_request_Probe( void* owner, void* handle )
@@ -193,6 +778,7 @@ thumbnailer_RequestCommon( vlc_thumbnailer_t* thumbnailer,
         return NULL;
     request->thumbnailer = thumbnailer;
     request->input_thread = NULL;
+    request->interrupt = NULL;
     request->params = *(vlc_thumbnailer_params_t*)params;
     request->done = false;
     input_item_Hold( request->params.input_item );
@@ -262,6 +848,7 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
     if ( unlikely( thumbnailer == NULL ) )
         return NULL;
     thumbnailer->parent = parent;
+    thumbnailer->source = NULL;
     struct background_worker_config cfg = {
         .default_timeout = -1,
         .max_threads = 1,
@@ -283,5 +870,7 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
 void vlc_thumbnailer_Release( vlc_thumbnailer_t *thumbnailer )
 {
     background_worker_Delete( thumbnailer->worker );
+    if ( thumbnailer->source != NULL )
+        thumbnailer_source_Delete( thumbnailer->source );
     free( thumbnailer );
 }
@@ -717,6 +717,11 @@ static const char *const ppsz_prefres[] = {
 #define TEXTRENDERER_LONGTEXT N_( \
     "VLC normally uses Freetype for rendering, but this allows you to use svg for instance.")
 
+#define SPU_THREADS_TEXT N_("Subpictures rendering threads")
+#define SPU_THREADS_LONGTEXT N_( \
+    "Number of threads used to render and scale the subpicture regions " \
+    "(0 means automatic, 1 disables the threading).")
+
 #define SUB_SOURCE_TEXT N_("Subpictures source module")
 #define SUB_SOURCE_LONGTEXT N_( \
     "This adds so-called \"subpicture sources\". These filters overlay " \
@@ -1091,7 +1096,18 @@ static const char *const ppsz_prefres[] = {
 
 #define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
 #define PREPARSE_THREADS_LONGTEXT N_( \
-    "Maximum number of threads used to preparse items" )
+    "Maximum number of threads used to preparse local items " \
+    "(0 to use one thread per CPU)." )
+
+#define PREPARSE_HOST_THREADS_TEXT N_( "Preparsing threads per host" )
+#define PREPARSE_HOST_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to preparse the items of a given " \
+    "remote host." )
+
+#define PREPARSE_CACHE_TEXT N_( "Preparsing cache" )
+#define PREPARSE_CACHE_LONGTEXT N_( \
+    "Store the meta data and tracks of preparsed local files in the " \
+    "cache directory, and reuse them until the files are modified." )
 
 #define FETCH_ART_THREADS_TEXT N_( "Fetch-art threads" )
 #define FETCH_ART_THREADS_LONGTEXT N_( \
@@ -1630,6 +1646,8 @@ vlc_plugin_begin ()
     add_bool( "osd", true, OSD_TEXT, OSD_LONGTEXT, false )
     add_module("text-renderer", VLC_CAP_TEXT_RENDERER, NULL,
                TEXTRENDERER_TEXT, TEXTRENDERER_LONGTEXT)
+    add_integer("spu-render-threads", 0, SPU_THREADS_TEXT,
+                SPU_THREADS_LONGTEXT, true)
 
     set_section( N_("Subtitles") , NULL )
     add_float( "sub-fps", 0.0, SUB_FPS_TEXT, SUB_FPS_LONGTEXT, false )
@@ -2028,9 +2046,15 @@ vlc_plugin_begin ()
     add_integer_with_range( "preparse-timeout", 5000, 0, INT_MAX, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
 
-    add_integer_with_range( "preparse-threads", 1, 0, INT_MAX, PREPARSE_THREADS_TEXT,
+    add_integer_with_range( "preparse-threads", 0, 0, INT_MAX, PREPARSE_THREADS_TEXT,
                  PREPARSE_THREADS_LONGTEXT, false )
 
+    add_integer_with_range( "preparse-host-threads", 1, 1, INT_MAX,
+                 PREPARSE_HOST_THREADS_TEXT, PREPARSE_HOST_THREADS_LONGTEXT, true )
+
+    add_bool( "preparse-cache", true, PREPARSE_CACHE_TEXT,
+              PREPARSE_CACHE_LONGTEXT, true )
+
     add_integer_with_range( "fetch-art-threads", 1, 0, INT_MAX, FETCH_ART_THREADS_TEXT,
                  FETCH_ART_THREADS_LONGTEXT, false )
 
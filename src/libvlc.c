@@ -462,6 +462,7 @@ void libvlc_InternalDestroy( libvlc_int_t *p_libvlc )
 
     vlc_mutex_destroy(&priv->lock);
     vlc_object_delete(p_libvlc);
+    block_PoolDrain();
 }
 
 /*****************************************************************************
@@ -80,6 +80,18 @@ typedef struct vlc_logger vlc_logger_t;
 int vlc_LogPreinit(libvlc_int_t *) VLC_USED;
 void vlc_LogInit(libvlc_int_t *);
 
+/*
+ * Data blocks
+ */
+
+/**
+ * Frees the blocks cached by the block allocator.
+ *
+ * This empties the shared free lists and destroys the calling thread cache.
+ * Other threads keep their caches until they exit.
+ */
+void block_PoolDrain(void);
+
 /*
  * LibVLC exit event handling
  */
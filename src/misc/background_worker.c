@@ -347,6 +347,20 @@ void background_worker_RequestProbe( struct background_worker* worker )
     vlc_mutex_unlock(&worker->lock);
 }
 
+bool background_worker_IsIdle( struct background_worker* worker )
+{
+    vlc_mutex_lock(&worker->lock);
+
+    bool idle = vlc_list_is_empty(&worker->queue);
+    struct background_thread *thread;
+    vlc_list_foreach(thread, &worker->threads, node)
+        if (thread->task)
+            idle = false;
+
+    vlc_mutex_unlock(&worker->lock);
+    return idle;
+}
+
 void background_worker_Delete( struct background_worker* worker )
 {
     vlc_mutex_lock(&worker->lock);
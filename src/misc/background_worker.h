@@ -187,6 +187,14 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
+/**
+ * Check whether a background-worker is idle
+ *
+ * \param worker the background-worker
+ * \return true if no entity is queued nor being processed
+ **/
+bool background_worker_IsIdle( struct background_worker* worker );
+
 /**
  * Delete a background-worker
  *
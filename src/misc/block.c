@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -35,6 +36,8 @@
 #include <vlc_block.h>
 #include <vlc_fs.h>
 
+#include "libvlc.h"
+
 #ifndef NDEBUG
 static void block_Check (block_t *block)
 {
@@ -105,6 +108,338 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Block pool
+ *
+ * Small and medium blocks are recycled through size-classed free lists
+ * instead of going back to the heap. Each thread keeps its own lists, so
+ * that the common allocate/release cycles do not touch any shared state.
+ * Threads spill half of a full list to (and refill an empty list from) a
+ * shared, locked pool. Anything in excess of the shared pool limit is
+ * returned to the heap.
+ */
+#if defined (__has_feature)
+# if __has_feature (address_sanitizer)
+#  define BLOCK_POOL_ASAN 1
+# endif
+#endif
+#if !defined (__SANITIZE_ADDRESS__) && !defined (BLOCK_POOL_ASAN)
+# define BLOCK_POOL 1
+#endif
+
+#ifdef BLOCK_POOL
+/** Allocation sizes (including the block_t header) of the pooled classes */
+static const size_t block_pool_sizes[] = {
+    512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288,
+    16384, 24576, 32768, 49152, 65536,
+};
+#define BLOCK_POOL_CLASSES ARRAY_SIZE(block_pool_sizes)
+
+/** Bytes cached per class by each thread */
+#define BLOCK_POOL_THREAD_BYTES  (256 << 10)
+/** Bytes cached per class in the shared pool */
+#define BLOCK_POOL_SHARED_BYTES  (4 << 20)
+/** Operations between statistics updates */
+#define BLOCK_POOL_STATS_PERIOD  256
+
+struct block_pool_list
+{
+    block_t *head;
+    size_t count;
+};
+
+struct block_pool_cache
+{
+    struct block_pool_list lists[BLOCK_POOL_CLASSES];
+    size_t bytes; /**< Bytes held in the lists */
+    size_t bytes_published;
+    unsigned hits;
+    unsigned misses;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct block_pool_list lists[BLOCK_POOL_CLASSES];
+
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+    atomic_size_t resident;
+} block_pool = {
+    .lock = VLC_STATIC_MUTEX,
+};
+
+static thread_local struct block_pool_cache *block_pool_cache;
+static vlc_threadvar_t block_pool_key;
+
+static size_t block_pool_limit(size_t index)
+{
+    size_t count = BLOCK_POOL_THREAD_BYTES / block_pool_sizes[index];
+    return (count < 4) ? 4 : count;
+}
+
+static void block_pool_Publish(struct block_pool_cache *cache)
+{
+    atomic_fetch_add_explicit(&block_pool.hits, cache->hits,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_pool.misses, cache->misses,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_pool.resident,
+                              cache->bytes - cache->bytes_published,
+                              memory_order_relaxed);
+    cache->hits = cache->misses = 0;
+    cache->bytes_published = cache->bytes;
+}
+
+/** Moves up to count blocks from the cache list to the shared pool. */
+static void block_pool_Spill(struct block_pool_cache *cache, size_t index,
+                             size_t count)
+{
+    struct block_pool_list *local = &cache->lists[index];
+    struct block_pool_list *shared = &block_pool.lists[index];
+    const size_t size = block_pool_sizes[index];
+    const size_t limit = BLOCK_POOL_SHARED_BYTES / size;
+    block_t *excess = NULL;
+
+    vlc_mutex_lock(&block_pool.lock);
+    while (count > 0 && local->head != NULL)
+    {
+        block_t *b = local->head;
+
+        local->head = b->p_next;
+        local->count--;
+        cache->bytes -= size;
+        count--;
+
+        if (shared->count < limit)
+        {
+            b->p_next = shared->head;
+            shared->head = b;
+            shared->count++;
+            atomic_fetch_add_explicit(&block_pool.resident, size,
+                                      memory_order_relaxed);
+        }
+        else
+        {
+            b->p_next = excess;
+            excess = b;
+        }
+    }
+    vlc_mutex_unlock(&block_pool.lock);
+
+    while (excess != NULL)
+    {
+        block_t *next = excess->p_next;
+
+        free(excess);
+        excess = next;
+    }
+}
+
+/** Moves up to count blocks from the shared pool to the cache list. */
+static void block_pool_Refill(struct block_pool_cache *cache, size_t index,
+                              size_t count)
+{
+    struct block_pool_list *local = &cache->lists[index];
+    struct block_pool_list *shared = &block_pool.lists[index];
+    const size_t size = block_pool_sizes[index];
+
+    vlc_mutex_lock(&block_pool.lock);
+    while (count > 0 && shared->head != NULL)
+    {
+        block_t *b = shared->head;
+
+        shared->head = b->p_next;
+        shared->count--;
+        b->p_next = local->head;
+        local->head = b;
+        local->count++;
+        cache->bytes += size;
+        count--;
+        atomic_fetch_sub_explicit(&block_pool.resident, size,
+                                  memory_order_relaxed);
+    }
+    vlc_mutex_unlock(&block_pool.lock);
+}
+
+static void block_pool_Destroy(void *data)
+{
+    struct block_pool_cache *cache = data;
+
+    for (size_t i = 0; i < BLOCK_POOL_CLASSES; i++)
+        block_pool_Spill(cache, i, SIZE_MAX);
+
+    block_pool_Publish(cache);
+    block_pool_cache = NULL;
+    free(cache);
+}
+
+static void block_pool_Init(void)
+{
+    if (vlc_threadvar_create(&block_pool_key, block_pool_Destroy))
+        abort();
+}
+
+static struct block_pool_cache *block_pool_GetCache(void)
+{
+    struct block_pool_cache *cache = block_pool_cache;
+
+    if (likely(cache != NULL))
+        return cache;
+
+    static vlc_once_t once = VLC_STATIC_ONCE;
+    vlc_once(&once, block_pool_Init);
+
+    cache = calloc(1, sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+    if (vlc_threadvar_set(block_pool_key, cache))
+    {
+        free(cache);
+        return NULL;
+    }
+    block_pool_cache = cache;
+    return cache;
+}
+
+static size_t block_pool_Index(size_t alloc)
+{
+    for (size_t i = 0; i < BLOCK_POOL_CLASSES; i++)
+        if (alloc <= block_pool_sizes[i])
+            return i;
+    return BLOCK_POOL_CLASSES;
+}
+
+static void block_pool_Release(block_t *block)
+{
+    assert(block->p_start == (unsigned char *)(block + 1));
+
+    const size_t size = sizeof (*block) + block->i_size;
+    const size_t index = block_pool_Index(size);
+    struct block_pool_cache *cache = block_pool_GetCache();
+
+    assert(index < BLOCK_POOL_CLASSES && block_pool_sizes[index] == size);
+
+    if (unlikely(cache == NULL))
+    {
+        free(block);
+        return;
+    }
+
+    struct block_pool_list *list = &cache->lists[index];
+    const size_t limit = block_pool_limit(index);
+
+    if (list->count >= limit)
+    {
+        block_pool_Spill(cache, index, limit / 2);
+        block_pool_Publish(cache);
+    }
+
+    block->p_next = list->head;
+    list->head = block;
+    list->count++;
+    cache->bytes += size;
+}
+
+static const struct vlc_block_callbacks block_pool_cbs =
+{
+    block_pool_Release,
+};
+
+/** Gets a pooled block of the given allocation size, or NULL. */
+static block_t *block_pool_Get(size_t *restrict alloc)
+{
+    const size_t index = block_pool_Index(*alloc);
+
+    if (index >= BLOCK_POOL_CLASSES)
+        return NULL;
+
+    struct block_pool_cache *cache = block_pool_GetCache();
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    struct block_pool_list *list = &cache->lists[index];
+    const size_t size = block_pool_sizes[index];
+    block_t *b;
+
+    if (list->head == NULL)
+        block_pool_Refill(cache, index, block_pool_limit(index) / 2);
+
+    b = list->head;
+    if (b != NULL)
+    {
+        list->head = b->p_next;
+        list->count--;
+        cache->bytes -= size;
+        cache->hits++;
+    }
+    else
+    {
+        b = malloc(size);
+        cache->misses++;
+    }
+
+    if (cache->hits + cache->misses >= BLOCK_POOL_STATS_PERIOD)
+        block_pool_Publish(cache);
+
+    if (likely(b != NULL))
+        block_Init(b, &block_pool_cbs, b + 1, size - sizeof (*b));
+    *alloc = size;
+    return b;
+}
+#endif
+
+void block_PoolDrain(void)
+{
+#ifdef BLOCK_POOL
+    struct block_pool_cache *cache = block_pool_cache;
+
+    /* The main thread cache is not destroyed by the thread variable */
+    if (cache != NULL)
+    {
+        vlc_threadvar_set(block_pool_key, NULL);
+        block_pool_Destroy(cache);
+    }
+
+    for (size_t i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        struct block_pool_list *shared = &block_pool.lists[i];
+        block_t *b;
+
+        vlc_mutex_lock(&block_pool.lock);
+        b = shared->head;
+        atomic_fetch_sub_explicit(&block_pool.resident,
+                                  shared->count * block_pool_sizes[i],
+                                  memory_order_relaxed);
+        shared->head = NULL;
+        shared->count = 0;
+        vlc_mutex_unlock(&block_pool.lock);
+
+        while (b != NULL)
+        {
+            block_t *next = b->p_next;
+
+            free(b);
+            b = next;
+        }
+    }
+#endif
+}
+
+void block_PoolGetStats(struct vlc_block_pool_stats *stats)
+{
+#ifdef BLOCK_POOL
+    stats->hits = atomic_load_explicit(&block_pool.hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&block_pool.misses,
+                                         memory_order_relaxed);
+    stats->resident = atomic_load_explicit(&block_pool.resident,
+                                           memory_order_relaxed);
+#else
+    stats->hits = stats->misses = 0;
+    stats->resident = 0;
+#endif
+}
+
 block_t *block_Alloc (size_t size)
 {
     if (unlikely(size >> 27))
@@ -114,16 +449,23 @@ block_t *block_Alloc (size_t size)
     }
 
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
-        return NULL;
+    block_t *b;
+#ifdef BLOCK_POOL
+    b = block_pool_Get(&alloc);
+    if (b == NULL)
+#endif
+    {
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
 
-    block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
+        block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
+    }
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
@@ -26,6 +26,7 @@
 #endif
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 
 #include <vlc_common.h>
@@ -235,3 +236,183 @@ size_t block_FifoCount (block_fifo_t *fifo)
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
+
+/**
+ * Single-producer single-consumer queue
+ *
+ * The queue is a linked list of fixed-size rings of block pointers. The
+ * producer fills the tail segment and links a new one when it is full; the
+ * consumer drains the head segment and frees it once it moves past it.
+ * Each side only touches its own indexes; the published count orders the
+ * slot writes of the producer before the slot reads of the consumer.
+ */
+#define SPSC_SEGMENT_SIZE 256
+
+struct vlc_spsc_segment
+{
+    _Atomic(struct vlc_spsc_segment *) next;
+    block_t *slots[SPSC_SEGMENT_SIZE];
+};
+
+struct vlc_spsc_fifo
+{
+    /* Consumer side */
+    struct vlc_spsc_segment *head;
+    size_t head_index;
+
+    /* Producer side */
+    struct vlc_spsc_segment *tail;
+    size_t tail_index;
+
+    atomic_size_t count;
+    atomic_size_t bytes;
+
+    /* Consumer wake-up */
+    atomic_bool parked;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+};
+
+static struct vlc_spsc_segment *vlc_spsc_segment_New(void)
+{
+    struct vlc_spsc_segment *seg = malloc(sizeof (*seg));
+
+    if (likely(seg != NULL))
+        atomic_init(&seg->next, NULL);
+    return seg;
+}
+
+vlc_spsc_fifo_t *vlc_spsc_fifo_New(void)
+{
+    vlc_spsc_fifo_t *fifo = malloc(sizeof (*fifo));
+    if (unlikely(fifo == NULL))
+        return NULL;
+
+    fifo->head = fifo->tail = vlc_spsc_segment_New();
+    if (unlikely(fifo->head == NULL))
+    {
+        free(fifo);
+        return NULL;
+    }
+    fifo->head_index = fifo->tail_index = 0;
+    atomic_init(&fifo->count, 0);
+    atomic_init(&fifo->bytes, 0);
+    atomic_init(&fifo->parked, false);
+    vlc_mutex_init(&fifo->lock);
+    vlc_cond_init(&fifo->wait);
+    return fifo;
+}
+
+void vlc_spsc_fifo_Delete(vlc_spsc_fifo_t *fifo)
+{
+    block_t *block;
+
+    while ((block = vlc_spsc_fifo_Dequeue(fifo)) != NULL)
+        block_Release(block);
+
+    free(fifo->head);
+    vlc_cond_destroy(&fifo->wait);
+    vlc_mutex_destroy(&fifo->lock);
+    free(fifo);
+}
+
+void vlc_spsc_fifo_Queue(vlc_spsc_fifo_t *fifo, block_t *block)
+{
+    size_t count = 0, bytes = 0;
+
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = NULL;
+
+        if (fifo->tail_index == SPSC_SEGMENT_SIZE)
+        {
+            struct vlc_spsc_segment *seg = vlc_spsc_segment_New();
+            if (unlikely(seg == NULL))
+            {
+                block_ChainRelease(block);
+                break;
+            }
+            /* Published to the consumer by the count update below */
+            atomic_store_explicit(&fifo->tail->next, seg,
+                                  memory_order_relaxed);
+            fifo->tail = seg;
+            fifo->tail_index = 0;
+        }
+
+        fifo->tail->slots[fifo->tail_index++] = block;
+        count++;
+        bytes += block->i_buffer;
+        block = next;
+    }
+
+    if (count == 0)
+        return;
+
+    atomic_fetch_add_explicit(&fifo->bytes, bytes, memory_order_relaxed);
+    atomic_fetch_add(&fifo->count, count);
+
+    if (atomic_load(&fifo->parked))
+    {
+        vlc_mutex_lock(&fifo->lock);
+        vlc_cond_signal(&fifo->wait);
+        vlc_mutex_unlock(&fifo->lock);
+    }
+}
+
+block_t *vlc_spsc_fifo_Dequeue(vlc_spsc_fifo_t *fifo)
+{
+    if (atomic_load_explicit(&fifo->count, memory_order_acquire) == 0)
+        return NULL;
+
+    if (fifo->head_index == SPSC_SEGMENT_SIZE)
+    {
+        struct vlc_spsc_segment *next =
+            atomic_load_explicit(&fifo->head->next, memory_order_relaxed);
+
+        assert(next != NULL);
+        free(fifo->head);
+        fifo->head = next;
+        fifo->head_index = 0;
+    }
+
+    block_t *block = fifo->head->slots[fifo->head_index++];
+
+    atomic_fetch_sub_explicit(&fifo->bytes, block->i_buffer,
+                              memory_order_relaxed);
+    atomic_fetch_sub_explicit(&fifo->count, 1, memory_order_relaxed);
+    return block;
+}
+
+block_t *vlc_spsc_fifo_DequeueWait(vlc_spsc_fifo_t *fifo)
+{
+    block_t *block;
+
+    vlc_testcancel();
+
+    while ((block = vlc_spsc_fifo_Dequeue(fifo)) == NULL)
+    {
+        vlc_mutex_lock(&fifo->lock);
+        /* Pairs with the count update and parked check of the producer */
+        atomic_store(&fifo->parked, true);
+        mutex_cleanup_push(&fifo->lock);
+        while (atomic_load(&fifo->count) == 0)
+            vlc_cond_wait(&fifo->wait, &fifo->lock);
+        vlc_cleanup_pop();
+        atomic_store_explicit(&fifo->parked, false, memory_order_relaxed);
+        vlc_mutex_unlock(&fifo->lock);
+    }
+
+    return block;
+}
+
+size_t vlc_spsc_fifo_GetCount(const vlc_spsc_fifo_t *fifo)
+{
+    return atomic_load_explicit(&fifo->count, memory_order_relaxed);
+}
+
+size_t vlc_spsc_fifo_GetBytes(const vlc_spsc_fifo_t *fifo)
+{
+    return atomic_load_explicit(&fifo->bytes, memory_order_relaxed);
+}
@@ -69,6 +69,9 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* longest a deferred answer may be held, well within the client timeout */
+#define HTTPD_DEFERRED_MAX VLC_TICK_FROM_SEC(5)
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
@@ -131,6 +134,7 @@ enum
     HTTPD_CLIENT_SEND_DONE,
 
     HTTPD_CLIENT_WAITING,
+    HTTPD_CLIENT_DEFERRED,
 
     HTTPD_CLIENT_DEAD,
 
@@ -1801,6 +1805,7 @@ static void httpdLoop(httpd_host_t *host)
                         httpd_url_t *url;
                         int i_msg = query->i_type;
                         bool b_auth_failed = false;
+                        bool b_deferred = false;
 
                         /* Search the url and trigger callbacks */
                         vlc_list_foreach(url, &host->urls, node) {
@@ -1820,6 +1825,14 @@ static void httpdLoop(httpd_host_t *host)
                             if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
                                 continue;
 
+                            if (answer->i_type == HTTPD_MSG_NONE) {
+                                /* the callback will answer later */
+                                b_deferred = true;
+                                answer = NULL;
+                                cl->url = url;
+                                break;
+                            }
+
                             if (answer->i_proto == HTTPD_PROTO_NONE)
                                 cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
                             else
@@ -1855,7 +1868,8 @@ static void httpdLoop(httpd_host_t *host)
                                 httpd_MsgAdd(answer, "Connection", "close");
                         }
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
+                        cl->i_state = b_deferred ? HTTPD_CLIENT_DEFERRED
+                                                 : HTTPD_CLIENT_SENDING;
                     }
                 }
                 break;
@@ -1923,6 +1937,41 @@ static void httpdLoop(httpd_host_t *host)
                     cl->answer.i_body = 0;
                     cl->i_state = HTTPD_CLIENT_SENDING;
                 }
+                break;
+
+            case HTTPD_CLIENT_DEFERRED: {
+                int i_msg = cl->query.i_type;
+
+                httpd_MsgClean(&cl->answer);
+
+                if (cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                                             &cl->answer, &cl->query))
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                else if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                    cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                }
+                else if (now - cl->i_activity_date >= HTTPD_DEFERRED_MAX) {
+                    /* give up before the client connection times out */
+                    httpd_message_t *answer = &cl->answer;
+
+                    answer->i_proto  = cl->query.i_proto;
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_version= 0;
+                    answer->i_status = 503;
+
+                    char *p;
+                    answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                            cl->query.psz_url);
+                    answer->p_body = (uint8_t *)p;
+                    httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                    httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+
+                    cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                }
+                break;
+            }
         }
 
         pufd->fd = vlc_tls_GetPollFD(cl->sock, &pufd->events);
@@ -0,0 +1,564 @@
+/*****************************************************************************
+ * cache.c: preparsing results cache
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/stat.h>
+#include <errno.h>
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_configuration.h>
+#include <vlc_es.h>
+#include <vlc_input_item.h>
+#include <vlc_meta.h>
+#include <vlc_fs.h>
+#include <vlc_url.h>
+#include <vlc_md5.h>
+#include <vlc_memstream.h>
+#include <vlc_rand.h>
+
+#include "input/item.h"
+#include "cache.h"
+
+/* Each entry is a text file named after the MD5 of the item URI, made of
+ * tab separated fields, one line per value:
+ *
+ *   vlc-preparsed <version>
+ *   key <mtime> <size> <uri>
+ *   duration <ticks>
+ *   meta <vlc_meta_type_t> <value>
+ *   extra <name> <value>
+ *   es <category> <codec> ... <category specific fields>
+ *   info <category> <name> <value>
+ *
+ * Backslashes, tabs and line feeds are escaped within fields.
+ *
+ * Entries not used for PREPARSED_CACHE_MAX_AGE are removed: an entry is
+ * rewritten when it is used and older than PREPARSED_CACHE_REFRESH, and a
+ * few subdirectories are swept of expired entries on each start. */
+#define PREPARSED_CACHE_VERSION "2"
+#define PREPARSED_CACHE_MAX_FIELDS 24
+#define PREPARSED_CACHE_MAX_AGE (90 * 24 * 3600)
+#define PREPARSED_CACHE_REFRESH (30 * 24 * 3600)
+#define PREPARSED_CACHE_PRUNE_DIRS 16
+
+static char *PreparsedCacheGetPath( const char *psz_uri, bool b_create )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_root = NULL, *psz_dir = NULL, *psz_path = NULL;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_uri, strlen( psz_uri ) );
+    EndMD5( &md5 );
+    char *psz_hash = psz_md5_hash( &md5 );
+
+    if( unlikely( psz_cachedir == NULL || psz_hash == NULL ) )
+        goto end;
+
+    /* Spread the entries over subdirectories, there may be many of them */
+    if( asprintf( &psz_root, "%s" DIR_SEP "preparsed", psz_cachedir ) == -1 )
+    {
+        psz_root = NULL;
+        goto end;
+    }
+    if( asprintf( &psz_dir, "%s" DIR_SEP "%.2s", psz_root, psz_hash ) == -1 )
+    {
+        psz_dir = NULL;
+        goto end;
+    }
+
+    if( b_create )
+    {
+        vlc_mkdir( psz_cachedir, 0700 );
+        vlc_mkdir( psz_root, 0700 );
+        vlc_mkdir( psz_dir, 0700 );
+    }
+
+    if( asprintf( &psz_path, "%s" DIR_SEP "%s", psz_dir, psz_hash ) == -1 )
+        psz_path = NULL;
+
+end:
+    free( psz_dir );
+    free( psz_root );
+    free( psz_hash );
+    free( psz_cachedir );
+    return psz_path;
+}
+
+/* Returns the URI of the item if it is a local file, and its status */
+static char *PreparsedCacheGetKey( input_item_t *p_item, struct stat *p_st )
+{
+    char *psz_uri = NULL;
+
+    vlc_mutex_lock( &p_item->lock );
+    if( p_item->psz_uri != NULL && !p_item->b_net )
+        psz_uri = strdup( p_item->psz_uri );
+    vlc_mutex_unlock( &p_item->lock );
+
+    if( psz_uri == NULL )
+        return NULL;
+
+    char *psz_path = vlc_uri2path( psz_uri );
+    if( psz_path == NULL || vlc_stat( psz_path, p_st )
+     || !S_ISREG( p_st->st_mode ) )
+    {
+        free( psz_uri );
+        psz_uri = NULL;
+    }
+    free( psz_path );
+    return psz_uri;
+}
+
+static void PreparsedCachePutField( struct vlc_memstream *ms, const char *psz )
+{
+    vlc_memstream_putc( ms, '\t' );
+    if( psz == NULL )
+        return;
+
+    for( ; *psz != '\0'; psz++ )
+    {
+        switch( *psz )
+        {
+            case '\\':
+                vlc_memstream_puts( ms, "\\\\" );
+                break;
+            case '\t':
+                vlc_memstream_puts( ms, "\\t" );
+                break;
+            case '\n':
+                vlc_memstream_puts( ms, "\\n" );
+                break;
+            case '\r':
+                vlc_memstream_puts( ms, "\\r" );
+                break;
+            default:
+                vlc_memstream_putc( ms, *psz );
+        }
+    }
+}
+
+/* Splits and unescapes a line in place */
+static unsigned PreparsedCacheSplit( char *psz_line, char **ppsz_fields )
+{
+    unsigned i_count = 0;
+    char *psz_out = psz_line;
+
+    ppsz_fields[i_count++] = psz_out;
+    for( const char *psz = psz_line; *psz != '\0' && *psz != '\n'; psz++ )
+    {
+        if( *psz == '\t' )
+        {
+            if( i_count == PREPARSED_CACHE_MAX_FIELDS )
+                return 0;
+            *psz_out++ = '\0';
+            ppsz_fields[i_count++] = psz_out;
+        }
+        else if( *psz == '\\' && psz[1] != '\0' && psz[1] != '\n' )
+        {
+            psz++;
+            switch( *psz )
+            {
+                case 't':  *psz_out++ = '\t'; break;
+                case 'n':  *psz_out++ = '\n'; break;
+                case 'r':  *psz_out++ = '\r'; break;
+                default:   *psz_out++ = *psz; break;
+            }
+        }
+        else
+            *psz_out++ = *psz;
+    }
+    *psz_out = '\0';
+    return i_count;
+}
+
+static void PreparsedCachePutEs( struct vlc_memstream *ms,
+                                 const es_format_t *p_fmt )
+{
+    vlc_memstream_printf( ms, "es\t%d\t%"PRIu32"\t%"PRIu32"\t%d\t%d\t%d\t%d"
+                          "\t%d\t%u", p_fmt->i_cat, p_fmt->i_codec,
+                          p_fmt->i_original_fourcc, p_fmt->i_id,
+                          p_fmt->i_group, p_fmt->i_priority, p_fmt->i_profile,
+                          p_fmt->i_level, p_fmt->i_bitrate );
+    PreparsedCachePutField( ms, p_fmt->psz_language );
+    PreparsedCachePutField( ms, p_fmt->psz_description );
+
+    switch( p_fmt->i_cat )
+    {
+        case VIDEO_ES:
+        {
+            const video_format_t *p_vfmt = &p_fmt->video;
+            vlc_memstream_printf( ms, "\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%d\t%d",
+                                  p_vfmt->i_width, p_vfmt->i_height,
+                                  p_vfmt->i_visible_width,
+                                  p_vfmt->i_visible_height,
+                                  p_vfmt->i_sar_num, p_vfmt->i_sar_den,
+                                  p_vfmt->i_frame_rate,
+                                  p_vfmt->i_frame_rate_base,
+                                  (int)p_vfmt->orientation,
+                                  (int)p_vfmt->projection_mode );
+            break;
+        }
+        case AUDIO_ES:
+            vlc_memstream_printf( ms, "\t%u\t%u\t%u\t%u", p_fmt->audio.i_rate,
+                                  p_fmt->audio.i_channels,
+                                  p_fmt->audio.i_physical_channels,
+                                  p_fmt->audio.i_bitspersample );
+            break;
+        case SPU_ES:
+            PreparsedCachePutField( ms, p_fmt->subs.psz_encoding );
+            break;
+        default:
+            break;
+    }
+    vlc_memstream_putc( ms, '\n' );
+}
+
+static void PreparsedCacheGetEs( input_item_t *p_item, char **ppsz_fields,
+                                 unsigned i_count )
+{
+    if( i_count < 12 )
+        return;
+
+    int i_cat = atoi( ppsz_fields[1] );
+    unsigned i_min;
+    switch( i_cat )
+    {
+        case VIDEO_ES: i_min = 22; break;
+        case AUDIO_ES: i_min = 16; break;
+        case SPU_ES:   i_min = 13; break;
+        default:       i_min = 12; break;
+    }
+    if( i_count < i_min )
+        return;
+
+    es_format_t fmt;
+    es_format_Init( &fmt, i_cat, strtoul( ppsz_fields[2], NULL, 10 ) );
+    fmt.i_original_fourcc = strtoul( ppsz_fields[3], NULL, 10 );
+    fmt.i_id = atoi( ppsz_fields[4] );
+    fmt.i_group = atoi( ppsz_fields[5] );
+    fmt.i_priority = atoi( ppsz_fields[6] );
+    fmt.i_profile = atoi( ppsz_fields[7] );
+    fmt.i_level = atoi( ppsz_fields[8] );
+    fmt.i_bitrate = strtoul( ppsz_fields[9], NULL, 10 );
+    if( *ppsz_fields[10] )
+        fmt.psz_language = strdup( ppsz_fields[10] );
+    if( *ppsz_fields[11] )
+        fmt.psz_description = strdup( ppsz_fields[11] );
+
+    switch( i_cat )
+    {
+        case VIDEO_ES:
+            fmt.video.i_width = strtoul( ppsz_fields[12], NULL, 10 );
+            fmt.video.i_height = strtoul( ppsz_fields[13], NULL, 10 );
+            fmt.video.i_visible_width = strtoul( ppsz_fields[14], NULL, 10 );
+            fmt.video.i_visible_height = strtoul( ppsz_fields[15], NULL, 10 );
+            fmt.video.i_sar_num = strtoul( ppsz_fields[16], NULL, 10 );
+            fmt.video.i_sar_den = strtoul( ppsz_fields[17], NULL, 10 );
+            fmt.video.i_frame_rate = strtoul( ppsz_fields[18], NULL, 10 );
+            fmt.video.i_frame_rate_base = strtoul( ppsz_fields[19], NULL, 10 );
+            fmt.video.orientation = atoi( ppsz_fields[20] );
+            fmt.video.projection_mode = atoi( ppsz_fields[21] );
+            break;
+        case AUDIO_ES:
+            fmt.audio.i_rate = strtoul( ppsz_fields[12], NULL, 10 );
+            fmt.audio.i_channels = strtoul( ppsz_fields[13], NULL, 10 );
+            fmt.audio.i_physical_channels = strtoul( ppsz_fields[14], NULL, 10 );
+            fmt.audio.i_bitspersample = strtoul( ppsz_fields[15], NULL, 10 );
+            break;
+        case SPU_ES:
+            if( *ppsz_fields[12] )
+                fmt.subs.psz_encoding = strdup( ppsz_fields[12] );
+            break;
+        default:
+            break;
+    }
+
+    input_item_UpdateTracksInfo( p_item, &fmt );
+    es_format_Clean( &fmt );
+}
+
+int input_FindPreparsedInCache( vlc_object_t *obj, input_item_t *p_item )
+{
+    struct stat st;
+    char *psz_uri = PreparsedCacheGetKey( p_item, &st );
+    if( psz_uri == NULL )
+        return VLC_EGENERIC;
+
+    char *psz_path = PreparsedCacheGetPath( psz_uri, false );
+    FILE *f = psz_path != NULL ? vlc_fopen( psz_path, "rb" ) : NULL;
+    free( psz_path );
+    if( f == NULL )
+    {
+        free( psz_uri );
+        return VLC_EGENERIC;
+    }
+
+    char *psz_line = NULL;
+    size_t i_line = 0;
+    char *ppsz_fields[PREPARSED_CACHE_MAX_FIELDS];
+    int i_ret = VLC_EGENERIC;
+    struct stat entry;
+    bool b_refresh = !fstat( fileno( f ), &entry )
+                  && time( NULL ) - entry.st_mtime > PREPARSED_CACHE_REFRESH;
+
+    /* Check the format version, and that the file did not change */
+    if( getline( &psz_line, &i_line, f ) == -1
+     || PreparsedCacheSplit( psz_line, ppsz_fields ) != 2
+     || strcmp( ppsz_fields[0], "vlc-preparsed" )
+     || strcmp( ppsz_fields[1], PREPARSED_CACHE_VERSION ) )
+        goto end;
+
+    if( getline( &psz_line, &i_line, f ) == -1
+     || PreparsedCacheSplit( psz_line, ppsz_fields ) != 4
+     || strcmp( ppsz_fields[0], "key" )
+     || strtoll( ppsz_fields[1], NULL, 10 ) != (long long)st.st_mtime
+     || strtoll( ppsz_fields[2], NULL, 10 ) != (long long)st.st_size
+     || strcmp( ppsz_fields[3], psz_uri ) )
+        goto end;
+
+    while( getline( &psz_line, &i_line, f ) != -1 )
+    {
+        unsigned i_count = PreparsedCacheSplit( psz_line, ppsz_fields );
+        const char *psz_tag = ppsz_fields[0];
+
+        if( i_count == 2 && !strcmp( psz_tag, "duration" ) )
+            input_item_SetDuration( p_item,
+                                    strtoll( ppsz_fields[1], NULL, 10 ) );
+        else if( i_count == 3 && !strcmp( psz_tag, "meta" ) )
+        {
+            int i_type = atoi( ppsz_fields[1] );
+            if( i_type >= 0 && i_type < VLC_META_TYPE_COUNT )
+                input_item_SetMeta( p_item, i_type, ppsz_fields[2] );
+        }
+        else if( i_count == 3 && !strcmp( psz_tag, "extra" ) )
+        {
+            vlc_mutex_lock( &p_item->lock );
+            if( p_item->p_meta == NULL )
+                p_item->p_meta = vlc_meta_New();
+            if( p_item->p_meta != NULL )
+                vlc_meta_AddExtra( p_item->p_meta, ppsz_fields[1],
+                                   ppsz_fields[2] );
+            vlc_mutex_unlock( &p_item->lock );
+        }
+        else if( i_count > 0 && !strcmp( psz_tag, "es" ) )
+            PreparsedCacheGetEs( p_item, ppsz_fields, i_count );
+        else if( i_count == 4 && !strcmp( psz_tag, "info" ) )
+            input_item_AddInfo( p_item, ppsz_fields[1], ppsz_fields[2], "%s",
+                                ppsz_fields[3] );
+    }
+
+    msg_Dbg( obj, "preparsed data of %s found in cache", psz_uri );
+    i_ret = VLC_SUCCESS;
+
+end:
+    free( psz_line );
+    fclose( f );
+    free( psz_uri );
+
+    /* Keep the entries in use from expiring */
+    if( i_ret == VLC_SUCCESS && b_refresh )
+        input_SavePreparsedToCache( obj, p_item );
+    return i_ret;
+}
+
+void input_SavePreparsedToCache( vlc_object_t *obj, input_item_t *p_item )
+{
+    struct stat st;
+    char *psz_uri = PreparsedCacheGetKey( p_item, &st );
+    if( psz_uri == NULL )
+        return;
+
+    /* Embedded art can only be read through the input, which a cache hit
+     * skips: such items are not cached, so that they keep their art */
+    char *psz_art = input_item_GetArtURL( p_item );
+    bool b_attachment = psz_art != NULL
+                     && !strncmp( psz_art, "attachment://", 13 );
+    free( psz_art );
+    if( b_attachment )
+    {
+        free( psz_uri );
+        return;
+    }
+
+    struct vlc_memstream ms;
+    if( vlc_memstream_open( &ms ) )
+    {
+        free( psz_uri );
+        return;
+    }
+
+    vlc_memstream_puts( &ms, "vlc-preparsed\t" PREPARSED_CACHE_VERSION "\n" );
+    vlc_memstream_printf( &ms, "key\t%lld\t%lld", (long long)st.st_mtime,
+                          (long long)st.st_size );
+    PreparsedCachePutField( &ms, psz_uri );
+    vlc_memstream_putc( &ms, '\n' );
+
+    vlc_mutex_lock( &p_item->lock );
+
+    vlc_memstream_printf( &ms, "duration\t%"PRId64"\n", p_item->i_duration );
+
+    if( p_item->p_meta != NULL )
+    {
+        for( int i = 0; i < VLC_META_TYPE_COUNT; i++ )
+        {
+            const char *psz_value = vlc_meta_Get( p_item->p_meta, i );
+            if( psz_value == NULL )
+                continue;
+            vlc_memstream_printf( &ms, "meta\t%d", i );
+            PreparsedCachePutField( &ms, psz_value );
+            vlc_memstream_putc( &ms, '\n' );
+        }
+
+        char **ppsz_names = vlc_meta_CopyExtraNames( p_item->p_meta );
+        if( ppsz_names != NULL )
+        {
+            for( int i = 0; ppsz_names[i] != NULL; i++ )
+            {
+                vlc_memstream_puts( &ms, "extra" );
+                PreparsedCachePutField( &ms, ppsz_names[i] );
+                PreparsedCachePutField( &ms,
+                        vlc_meta_GetExtra( p_item->p_meta, ppsz_names[i] ) );
+                vlc_memstream_putc( &ms, '\n' );
+                free( ppsz_names[i] );
+            }
+            free( ppsz_names );
+        }
+    }
+
+    for( int i = 0; i < p_item->i_es; i++ )
+        PreparsedCachePutEs( &ms, p_item->es[i] );
+
+    for( int i = 0; i < p_item->i_categories; i++ )
+    {
+        info_category_t *p_cat = p_item->pp_categories[i];
+        info_t *p_info;
+
+        info_foreach( p_info, &p_cat->infos )
+        {
+            vlc_memstream_puts( &ms, "info" );
+            PreparsedCachePutField( &ms, p_cat->psz_name );
+            PreparsedCachePutField( &ms, p_info->psz_name );
+            PreparsedCachePutField( &ms, p_info->psz_value );
+            vlc_memstream_putc( &ms, '\n' );
+        }
+    }
+
+    vlc_mutex_unlock( &p_item->lock );
+
+    if( vlc_memstream_close( &ms ) )
+    {
+        free( psz_uri );
+        return;
+    }
+
+    char *psz_path = PreparsedCacheGetPath( psz_uri, true );
+    char *psz_tmp = NULL;
+    free( psz_uri );
+    if( psz_path == NULL
+     || asprintf( &psz_tmp, "%s.%lu", psz_path, vlc_thread_id() ) == -1 )
+    {
+        psz_tmp = NULL;
+        goto end;
+    }
+
+    /* Write to a temporary file first, so that readers never see a partial
+     * entry */
+    FILE *f = vlc_fopen( psz_tmp, "wb" );
+    if( f == NULL )
+    {
+        msg_Warn( obj, "cannot create %s: %s", psz_tmp, vlc_strerror_c(errno) );
+        goto end;
+    }
+
+    bool b_written = fwrite( ms.ptr, 1, ms.length, f ) == ms.length;
+    if( fclose( f ) )
+        b_written = false;
+    if( !b_written || vlc_rename( psz_tmp, psz_path ) )
+    {
+        msg_Warn( obj, "cannot write %s: %s", psz_path, vlc_strerror_c(errno) );
+        vlc_unlink( psz_tmp );
+    }
+
+end:
+    free( psz_tmp );
+    free( psz_path );
+    free( ms.ptr );
+}
+
+void input_PrunePreparsedCache( vlc_object_t *obj, atomic_bool *stop )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( unlikely( psz_cachedir == NULL ) )
+        return;
+
+    const time_t now = time( NULL );
+    unsigned i_first = vlc_mrand48() & 0xff;
+    unsigned i_removed = 0;
+
+    /* Sweeping every entry would take a while with large libraries: only
+     * check a few subdirectories, starting from a random one. */
+    for( unsigned i = 0; i < PREPARSED_CACHE_PRUNE_DIRS; i++ )
+    {
+        char *psz_dir;
+        if( asprintf( &psz_dir, "%s" DIR_SEP "preparsed" DIR_SEP "%02x",
+                      psz_cachedir, (i_first + i) & 0xff ) == -1 )
+            break;
+
+        DIR *dir = vlc_opendir( psz_dir );
+        if( dir == NULL )
+        {
+            free( psz_dir );
+            continue;
+        }
+
+        const char *psz_name;
+        while( !atomic_load( stop ) && ( psz_name = vlc_readdir( dir ) ) )
+        {
+            char *psz_path;
+            struct stat st;
+
+            if( psz_name[0] == '.' )
+                continue;
+            if( asprintf( &psz_path, "%s" DIR_SEP "%s", psz_dir,
+                          psz_name ) == -1 )
+                break;
+
+            /* Temporary files are left over by interrupted writes */
+            time_t max_age = strchr( psz_name, '.' ) != NULL
+                           ? 24 * 3600 : PREPARSED_CACHE_MAX_AGE;
+            if( !vlc_stat( psz_path, &st ) && S_ISREG( st.st_mode )
+             && now - st.st_mtime > max_age && !vlc_unlink( psz_path ) )
+                i_removed++;
+            free( psz_path );
+        }
+        closedir( dir );
+        free( psz_dir );
+    }
+
+    if( i_removed > 0 )
+        msg_Dbg( obj, "removed %u expired preparsed cache entries",
+                 i_removed );
+    free( psz_cachedir );
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * cache.h
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _INPUT_PREPARSER_CACHE_H
+#define _INPUT_PREPARSER_CACHE_H 1
+
+/**
+ * Restores the preparsing results of an item from the cache directory.
+ *
+ * Only local files are cached. An entry is only used if the modification
+ * time and the size of the file did not change since it was stored.
+ *
+ * @return VLC_SUCCESS if the meta data, duration, tracks and infos of the
+ * item were restored
+ */
+int input_FindPreparsedInCache( vlc_object_t *, input_item_t * );
+
+/**
+ * Stores the preparsing results of an item in the cache directory.
+ *
+ * Items with embedded art are not stored, as the art can only be extracted
+ * by opening the input.
+ */
+void input_SavePreparsedToCache( vlc_object_t *, input_item_t * );
+
+/**
+ * Removes the cache entries that were not used for a long time.
+ *
+ * Only a part of the cache directory is checked on each call. This may take
+ * a while: it should be called from a background thread.
+ *
+ * @param stop set to true to interrupt the sweep
+ */
+void input_PrunePreparsedCache( vlc_object_t *, atomic_bool *stop );
+
+#endif
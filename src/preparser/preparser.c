@@ -24,18 +24,47 @@
 
 #include <vlc_common.h>
 #include <vlc_atomic.h>
+#include <vlc_list.h>
+#include <vlc_url.h>
 
 #include "misc/background_worker.h"
 #include "input/input_interface.h"
 #include "input/input_internal.h"
 #include "preparser.h"
 #include "fetcher.h"
+#include "cache.h"
+
+/* Local items are preparsed by a single pool of threads. Remote items are
+ * dispatched to one pool per host, so that a slow or busy server is not
+ * flooded with requests, and does not delay the other items.
+ *
+ * At most PREPARSER_MAX_HOSTS host pools are kept: the least recently used
+ * idle pool is given to a new host, and if all of them are busy, the new
+ * host shares the least recently used one. */
+#define PREPARSER_MAX_HOSTS 16
+
+struct preparser_worker
+{
+    input_preparser_t *preparser;
+    struct background_worker *worker;
+    char *host; /**< NULL for local items */
+    struct vlc_list node;
+};
 
 struct input_preparser_t
 {
     vlc_object_t* owner;
     input_fetcher_t* fetcher;
-    struct background_worker* worker;
+    struct preparser_worker local;
+    vlc_mutex_t lock;
+    struct vlc_list hosts; /**< remote items workers, most recently used
+                                first, protected by lock */
+    unsigned host_count;
+    vlc_tick_t timeout;
+    int host_threads;
+    bool use_cache;
+    bool pruning; /**< whether the cache prune thread was started */
+    vlc_thread_t prune_thread;
     atomic_bool deactivated;
 };
 
@@ -50,11 +79,12 @@ typedef struct input_preparser_req_t
 typedef struct input_preparser_task_t
 {
     input_preparser_req_t *req;
-    input_preparser_t* preparser;
+    struct preparser_worker* worker;
     int preparse_status;
-    input_item_parser_id_t *parser;
+    input_item_parser_id_t *parser; /**< NULL if found in the cache */
     atomic_int state;
     atomic_bool done;
+    atomic_bool subtree;
 } input_preparser_task_t;
 
 static input_preparser_req_t *ReqCreate(input_item_t *item,
@@ -96,7 +126,7 @@ static void OnParserEnded(input_item_t *item, int status, void *task_)
 
     atomic_store( &task->state, status );
     atomic_store( &task->done, true );
-    background_worker_RequestProbe( task->preparser->worker );
+    background_worker_RequestProbe( task->worker->worker );
 }
 
 static void OnParserSubtreeAdded(input_item_t *item, input_item_node_t *subtree,
@@ -106,13 +136,15 @@ static void OnParserSubtreeAdded(input_item_t *item, input_item_node_t *subtree,
     input_preparser_task_t* task = task_;
     input_preparser_req_t *req = task->req;
 
+    atomic_store( &task->subtree, true );
     if (req->cbs && req->cbs->on_subtree_added)
         req->cbs->on_subtree_added(req->item, subtree, req->userdata);
 }
 
-static int PreparserOpenInput( void* preparser_, void* req_, void** out )
+static int PreparserOpenInput( void* worker_, void* req_, void** out )
 {
-    input_preparser_t* preparser = preparser_;
+    struct preparser_worker* worker = worker_;
+    input_preparser_t* preparser = worker->preparser;
     input_preparser_req_t *req = req_;
     input_preparser_task_t* task = malloc( sizeof *task );
 
@@ -126,10 +158,24 @@ static int PreparserOpenInput( void* preparser_, void* req_, void** out )
 
     atomic_init( &task->state, VLC_ETIMEOUT );
     atomic_init( &task->done, false );
+    atomic_init( &task->subtree, false );
 
-    task->preparser = preparser_;
+    task->worker = worker;
     task->req = req;
     task->preparse_status = -1;
+    task->parser = NULL;
+
+    if( preparser->use_cache
+     && input_FindPreparsedInCache( preparser->owner, req->item ) == VLC_SUCCESS )
+    {
+        /* Nothing to wait for, probe right away */
+        atomic_store( &task->state, VLC_SUCCESS );
+        atomic_store( &task->done, true );
+        *out = task;
+        background_worker_RequestProbe( worker->worker );
+        return VLC_SUCCESS;
+    }
+
     task->parser = input_item_Parse( req->item, preparser->owner, &cbs,
                                      task );
     if( !task->parser )
@@ -146,11 +192,11 @@ error:
     return VLC_EGENERIC;
 }
 
-static int PreparserProbeInput( void* preparser_, void* task_ )
+static int PreparserProbeInput( void* worker_, void* task_ )
 {
     input_preparser_task_t* task = task_;
     return atomic_load( &task->done );
-    VLC_UNUSED( preparser_ );
+    VLC_UNUSED( worker_ );
 }
 
 static void on_art_fetch_ended(input_item_t *item, bool fetched, void *userdata)
@@ -173,12 +219,13 @@ static const input_fetcher_callbacks_t input_fetcher_callbacks = {
     .on_art_fetch_ended = on_art_fetch_ended,
 };
 
-static void PreparserCloseInput( void* preparser_, void* task_ )
+static void PreparserCloseInput( void* worker_, void* task_ )
 {
     input_preparser_task_t* task = task_;
     input_preparser_req_t *req = task->req;
 
-    input_preparser_t* preparser = preparser_;
+    struct preparser_worker* worker = worker_;
+    input_preparser_t* preparser = worker->preparser;
     input_item_t* item = req->item;
 
     int status;
@@ -195,7 +242,15 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
             break;
     }
 
-    input_item_parser_id_Release( task->parser );
+    if( task->parser != NULL )
+    {
+        input_item_parser_id_Release( task->parser );
+
+        /* Items expanding to sub-items (playlists) are always parsed again */
+        if( status == ITEM_PREPARSE_DONE && preparser->use_cache
+         && !atomic_load( &task->subtree ) )
+            input_SavePreparsedToCache( preparser->owner, item );
+    }
 
     if( preparser->fetcher )
     {
@@ -215,16 +270,24 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
         req->cbs->on_preparse_ended(req->item, status, req->userdata);
 }
 
+static void *PreparserPruneCache( void *preparser_ )
+{
+    input_preparser_t *preparser = preparser_;
+
+    input_PrunePreparsedCache( preparser->owner, &preparser->deactivated );
+    return NULL;
+}
+
 static void ReqHoldVoid(void *item) { ReqHold(item); }
 static void ReqReleaseVoid(void *item) { ReqRelease(item); }
 
-input_preparser_t* input_preparser_New( vlc_object_t *parent )
+static int PreparserWorkerInit( input_preparser_t *preparser,
+                               struct preparser_worker *worker,
+                               int max_threads )
 {
-    input_preparser_t* preparser = malloc( sizeof *preparser );
-
     struct background_worker_config conf = {
-        .default_timeout = VLC_TICK_FROM_MS(var_InheritInteger( parent, "preparse-timeout" )),
-        .max_threads = var_InheritInteger( parent, "preparse-threads" ),
+        .default_timeout = preparser->timeout,
+        .max_threads = max_threads,
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
@@ -232,23 +295,112 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
         .pf_hold = ReqHoldVoid
     };
 
+    worker->preparser = preparser;
+    worker->worker = background_worker_New( worker, &conf );
+    return worker->worker != NULL ? VLC_SUCCESS : VLC_ENOMEM;
+}
+
+/* Returns the worker of the item host; preparser->lock must be held */
+static struct preparser_worker *
+PreparserGetHostWorker( input_preparser_t *preparser, input_item_t *item )
+{
+    vlc_url_t url;
+
+    vlc_mutex_lock( &item->lock );
+    vlc_UrlParse( &url, item->psz_uri );
+    vlc_mutex_unlock( &item->lock );
+
+    const char *host = url.psz_host != NULL ? url.psz_host : "";
+    struct preparser_worker *worker, *lru = NULL, *idle = NULL;
+
+    vlc_list_foreach( worker, &preparser->hosts, node )
+    {
+        if( !strcasecmp( worker->host, host ) )
+            goto end;
+        lru = worker;
+    }
+
+    if( preparser->host_count >= PREPARSER_MAX_HOSTS )
+    {
+        vlc_list_foreach( worker, &preparser->hosts, node )
+            if( background_worker_IsIdle( worker->worker ) )
+                idle = worker;
+
+        char *psz_host = idle != NULL ? strdup( host ) : NULL;
+        if( psz_host != NULL )
+        {   /* Hand the idle pool over to the new host */
+            worker = idle;
+            free( worker->host );
+            worker->host = psz_host;
+        }
+        else
+            worker = lru;
+        goto end;
+    }
+
+    worker = malloc( sizeof( *worker ) );
+    if( likely( worker != NULL ) )
+    {
+        worker->host = strdup( host );
+        if( unlikely( worker->host == NULL )
+         || PreparserWorkerInit( preparser, worker, preparser->host_threads ) )
+        {
+            free( worker->host );
+            free( worker );
+            worker = NULL;
+        }
+        else
+        {
+            vlc_list_prepend( &worker->node, &preparser->hosts );
+            preparser->host_count++;
+        }
+    }
+    vlc_UrlClean( &url );
+    return worker;
+
+end:
+    vlc_list_remove( &worker->node );
+    vlc_list_prepend( &worker->node, &preparser->hosts );
+    vlc_UrlClean( &url );
+    return worker;
+}
+
+input_preparser_t* input_preparser_New( vlc_object_t *parent )
+{
+    input_preparser_t* preparser = malloc( sizeof *preparser );
+    if( unlikely( !preparser ) )
+        return NULL;
+
+    preparser->timeout =
+        VLC_TICK_FROM_MS(var_InheritInteger( parent, "preparse-timeout" ));
+    preparser->host_threads = var_InheritInteger( parent, "preparse-host-threads" );
+    preparser->use_cache = var_InheritBool( parent, "preparse-cache" );
 
-    if( likely( preparser ) )
-        preparser->worker = background_worker_New( preparser, &conf );
+    int threads = var_InheritInteger( parent, "preparse-threads" );
+    if( threads <= 0 )
+        threads = vlc_GetCPUCount();
 
-    if( unlikely( !preparser || !preparser->worker ) )
+    if( PreparserWorkerInit( preparser, &preparser->local, threads ) )
     {
         free( preparser );
         return NULL;
     }
+    preparser->local.host = NULL;
 
     preparser->owner = parent;
     preparser->fetcher = input_fetcher_New( parent );
+    vlc_mutex_init( &preparser->lock );
+    vlc_list_init( &preparser->hosts );
+    preparser->host_count = 0;
     atomic_init( &preparser->deactivated, false );
 
     if( unlikely( !preparser->fetcher ) )
         msg_Warn( parent, "unable to create art fetcher" );
 
+    preparser->pruning = preparser->use_cache
+        && !vlc_clone( &preparser->prune_thread, PreparserPruneCache,
+                       preparser, VLC_THREAD_PRIORITY_LOW );
+
     return preparser;
 }
 
@@ -281,8 +433,22 @@ void input_preparser_Push( input_preparser_t *preparser,
     }
 
     struct input_preparser_req_t *req = ReqCreate(item, cbs, cbs_userdata);
+    int ret;
+
+    if (b_net)
+    {
+        /* Queue the item before its host pool can be handed over */
+        vlc_mutex_lock(&preparser->lock);
+        struct preparser_worker *worker = PreparserGetHostWorker(preparser, item);
+        ret = worker != NULL
+            ? background_worker_Push(worker->worker, req, id, timeout)
+            : VLC_ENOMEM;
+        vlc_mutex_unlock(&preparser->lock);
+    }
+    else
+        ret = background_worker_Push(preparser->local.worker, req, id, timeout);
 
-    if (background_worker_Push(preparser->worker, req, id, timeout))
+    if (ret != VLC_SUCCESS)
         if (req->cbs && cbs->on_preparse_ended)
             cbs->on_preparse_ended(item, ITEM_PREPARSE_FAILED, cbs_userdata);
 
@@ -300,18 +466,41 @@ void input_preparser_fetcher_Push( input_preparser_t *preparser,
 
 void input_preparser_Cancel( input_preparser_t *preparser, void *id )
 {
-    background_worker_Cancel( preparser->worker, id );
+    struct preparser_worker *worker;
+
+    background_worker_Cancel( preparser->local.worker, id );
+
+    vlc_mutex_lock( &preparser->lock );
+    vlc_list_foreach( worker, &preparser->hosts, node )
+        background_worker_Cancel( worker->worker, id );
+    vlc_mutex_unlock( &preparser->lock );
 }
 
 void input_preparser_Deactivate( input_preparser_t* preparser )
 {
     atomic_store( &preparser->deactivated, true );
-    background_worker_Cancel( preparser->worker, NULL );
+    input_preparser_Cancel( preparser, NULL );
 }
 
 void input_preparser_Delete( input_preparser_t *preparser )
 {
-    background_worker_Delete( preparser->worker );
+    struct preparser_worker *worker;
+
+    if( preparser->pruning )
+    {
+        atomic_store( &preparser->deactivated, true );
+        vlc_join( preparser->prune_thread, NULL );
+    }
+
+    background_worker_Delete( preparser->local.worker );
+
+    vlc_list_foreach( worker, &preparser->hosts, node )
+    {
+        background_worker_Delete( worker->worker );
+        free( worker->host );
+        free( worker );
+    }
+    vlc_mutex_destroy( &preparser->lock );
 
     if( preparser->fetcher )
         input_fetcher_Delete( preparser->fetcher );
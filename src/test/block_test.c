@@ -86,11 +86,137 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Pool (void)
+{
+    struct vlc_block_pool_stats before, after;
+    block_t *blocks[64];
+
+    for (size_t i = 0; i < ARRAY_SIZE(blocks); i++)
+    {
+        blocks[i] = block_Alloc (188 * (i + 1));
+        assert (blocks[i] != NULL);
+        assert (blocks[i]->i_buffer == 188 * (i + 1));
+        assert (((uintptr_t)blocks[i]->p_buffer % 32) == 0);
+        memset (blocks[i]->p_buffer, i, blocks[i]->i_buffer);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(blocks); i++)
+        block_Release (blocks[i]);
+
+    block_PoolGetStats (&before);
+
+    /* Recycled blocks must look like new ones */
+    for (unsigned round = 0; round < 1000; round++)
+    {
+        block_t *block = block_Alloc (sizeof (text));
+        assert (block != NULL);
+        assert (block->i_buffer == sizeof (text));
+        assert (block->p_next == NULL);
+        assert (block->i_flags == 0);
+        assert (block->i_pts == VLC_TICK_INVALID);
+        memcpy (block->p_buffer, text, sizeof (text));
+
+        block = block_Realloc (block, 100, sizeof (text) + 100);
+        assert (block != NULL);
+        assert (!memcmp (block->p_buffer + 100, text, sizeof (text)));
+        block->i_flags = BLOCK_FLAG_DISCONTINUITY;
+        block->i_pts = round;
+        block_Release (block);
+    }
+
+    block_PoolGetStats (&after);
+    if (after.hits + after.misses == 0)
+        return; /* no pool, e.g. with AddressSanitizer */
+
+    /* Each thread publishes its statistics every 256 operations: the 2000
+     * allocations above must have published at least 1745 of them. */
+    assert (after.hits + after.misses >= before.hits + before.misses + 1745);
+    assert (after.hits - before.hits > after.misses - before.misses);
+
+    /* A freed block is reused by the next allocation of its size class */
+    block_t *block = block_Alloc (1000);
+    assert (block != NULL);
+    void *ptr = block;
+    block_Release (block);
+    block = block_Alloc (900);
+    assert (block == ptr);
+    block_Release (block);
+}
+
+#define FIFO_BLOCKS 100000
+
+static void *test_spsc_fifo_Producer (void *data)
+{
+    vlc_spsc_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_Alloc (sizeof (i));
+        assert (block != NULL);
+        memcpy (block->p_buffer, &i, sizeof (i));
+        vlc_spsc_fifo_Queue (fifo, block);
+    }
+    return NULL;
+}
+
+static void test_spsc_fifo (void)
+{
+    vlc_spsc_fifo_t *fifo = vlc_spsc_fifo_New ();
+    assert (fifo != NULL);
+    assert (vlc_spsc_fifo_IsEmpty (fifo));
+    assert (vlc_spsc_fifo_Dequeue (fifo) == NULL);
+
+    /* Chains are queued as individual blocks */
+    block_t *chain = NULL;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        block_t *block = block_Alloc (10);
+        assert (block != NULL);
+        block->p_next = chain;
+        chain = block;
+    }
+    vlc_spsc_fifo_Queue (fifo, chain);
+    assert (vlc_spsc_fifo_GetCount (fifo) == 3);
+    assert (vlc_spsc_fifo_GetBytes (fifo) == 30);
+
+    block_t *block = vlc_spsc_fifo_Dequeue (fifo);
+    assert (block != NULL && block->p_next == NULL);
+    block_Release (block);
+    assert (vlc_spsc_fifo_GetCount (fifo) == 2);
+    assert (vlc_spsc_fifo_GetBytes (fifo) == 20);
+    vlc_spsc_fifo_Delete (fifo);
+
+    /* Ordering across threads */
+    fifo = vlc_spsc_fifo_New ();
+    assert (fifo != NULL);
+
+    vlc_thread_t th;
+    int val = vlc_clone (&th, test_spsc_fifo_Producer, fifo,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        unsigned j;
+
+        block = vlc_spsc_fifo_DequeueWait (fifo);
+        assert (block->i_buffer == sizeof (j));
+        memcpy (&j, block->p_buffer, sizeof (j));
+        assert (i == j);
+        block_Release (block);
+    }
+
+    vlc_join (th, NULL);
+    assert (vlc_spsc_fifo_IsEmpty (fifo));
+    vlc_spsc_fifo_Delete (fifo);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Pool ();
+    test_spsc_fifo ();
     return 0;
 }
 
@@ -71,6 +71,14 @@ struct spu_channel {
 
 typedef struct VLC_VECTOR(struct spu_channel) spu_channel_vector;
 
+/* Filters used to render regions, one set per rendering thread */
+typedef struct {
+    filter_t *text;
+    filter_t *scale_yuvp;
+    filter_t *scale;
+    unsigned text_generation;
+} spu_render_ctx_t;
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     input_thread_t *input;
@@ -81,6 +89,9 @@ struct spu_private_t {
     filter_t *text;                              /**< text renderer module */
     filter_t *scale_yuvp;                     /**< scaling module for YUVP */
     filter_t *scale;                    /**< scaling module (all but YUVP) */
+    unsigned text_generation;           /**< incremented on text reloads */
+    int render_threads;           /**< rendering threads, 1 to disable */
+    struct spu_render_pool *render_pool;                /**< created lazily */
     bool force_crop;                     /**< force cropping of subpicture */
     struct {
         int x;
@@ -305,13 +316,11 @@ static filter_t *SpuRenderCreateAndLoadScale(vlc_object_t *object,
     return scale;
 }
 
-static void SpuRenderText(spu_t *spu, bool *rerender_text,
+static void SpuRenderText(filter_t *text, bool *rerender_text,
                           subpicture_region_t *region,
                           const vlc_fourcc_t *chroma_list,
                           vlc_tick_t elapsed_time)
 {
-    filter_t *text = spu->p->text;
-
     assert(region->fmt.i_chroma == VLC_CODEC_TEXT);
 
     /* Setup 3 variables which can be used to render
@@ -767,35 +776,73 @@ spu_SelectSubpictures(spu_t *spu, vlc_tick_t system_now,
 
 
 
+/* Rendering of one region, split between a step that may run on any
+ * rendering thread and the placement done in order on the vout thread */
+typedef struct {
+    const spu_render_entry_t *entry;
+    subpicture_region_t *region;
+    spu_scale_t scale;                   /**< from original to output size */
+    spu_scale_t virtual_scale;                  /**< applied by the core */
+    vlc_tick_t render_date;
+
+    video_format_t fmt_original;
+    bool restore_text;
+    bool scaled;                 /**< region->p_private is the picture */
+    bool failed;
+} spu_region_job_t;
+
+struct spu_render_worker {
+    vlc_thread_t thread;
+    spu_t *spu;
+    spu_render_ctx_t ctx;
+};
+
+/* Fork/join pool rendering the regions of one frame concurrently */
+struct spu_render_pool {
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    vlc_cond_t done;
+    spu_region_job_t *jobs;
+    size_t job_count;
+    size_t job_next;
+    size_t running;
+    const vlc_fourcc_t *chroma_list;
+    unsigned text_generation;
+    bool exit;
+
+    size_t worker_count;
+    struct spu_render_worker workers[];
+};
+
 /**
- * It will transform the provided region into another region suitable for rendering.
+ * It renders the text and scales the provided region into its cache.
+ *
+ * It only depends on the region itself and the rendering filters, so it can
+ * run concurrently for different regions.
  */
-static void SpuRenderRegion(spu_t *spu,
-                            subpicture_region_t **dst_ptr, spu_area_t *dst_area,
-                            const spu_render_entry_t *entry, subpicture_region_t *region,
-                            const spu_scale_t scale_size,
-                            const vlc_fourcc_t *chroma_list,
-                            const video_format_t *fmt,
-                            const spu_area_t *subtitle_area, size_t subtitle_area_count,
-                            vlc_tick_t render_date)
+static void SpuPrepareRegion(spu_t *spu, const spu_render_ctx_t *ctx,
+                             spu_region_job_t *job,
+                             const vlc_fourcc_t *chroma_list)
 {
+    const spu_render_entry_t *entry = job->entry;
     subpicture_t *subpic = entry->subpic;
+    subpicture_region_t *region = job->region;
+    const spu_scale_t scale_size = job->virtual_scale;
     spu_private_t *sys = spu->p;
 
-    video_format_t fmt_original = region->fmt;
-    bool restore_text = false;
-    int x_offset;
-    int y_offset;
-
-    video_format_t region_fmt;
-    picture_t *region_picture;
-
-    /* Invalidate area by default */
-    *dst_area = spu_area_create(0,0, 0,0, scale_size);
-    *dst_ptr  = NULL;
+    job->fmt_original = region->fmt;
+    job->restore_text = false;
+    job->scaled = false;
+    job->failed = false;
 
     /* Render text region */
     if (region->fmt.i_chroma == VLC_CODEC_TEXT) {
+        filter_t *text = ctx->text;
+        if (!text) {
+            job->failed = true;
+            return;
+        }
+
         // assume rendered text is in sRGB if nothing is set
         if (region->fmt.transfer == TRANSFER_FUNC_UNDEF)
             region->fmt.transfer = TRANSFER_FUNC_SRGB;
@@ -806,13 +853,22 @@ static void SpuRenderRegion(spu_t *spu,
         if (region->fmt.color_range == COLOR_RANGE_UNDEF)
             region->fmt.color_range = COLOR_RANGE_FULL;
 
-        SpuRenderText(spu, &restore_text, region,
+        /* FIXME aspect ratio ? */
+        text->fmt_out.video.i_width          =
+        text->fmt_out.video.i_visible_width  = subpic->i_original_picture_width;
+
+        text->fmt_out.video.i_height         =
+        text->fmt_out.video.i_visible_height = subpic->i_original_picture_height;
+
+        SpuRenderText(text, &job->restore_text, region,
                       chroma_list,
-                      render_date - entry->start);
+                      job->render_date - entry->start);
 
         /* Check if the rendering has failed ... */
-        if (region->fmt.i_chroma == VLC_CODEC_TEXT)
-            goto exit;
+        if (region->fmt.i_chroma == VLC_CODEC_TEXT) {
+            job->failed = true;
+            return;
+        }
     }
 
     video_format_AdjustColorSpace(&region->fmt);
@@ -823,77 +879,8 @@ static void SpuRenderRegion(spu_t *spu,
      */
     const bool using_palette = region->fmt.i_chroma == VLC_CODEC_YUVP;
     const bool force_palette = using_palette && sys->palette.i_entries > 0;
-    const bool crop_requested = (force_palette && sys->force_crop) ||
-                                region->i_max_width || region->i_max_height;
     bool changed_palette     = false;
 
-    /* Compute the margin which is expressed in destination pixel unit
-     * The margin is applied only to subtitle and when no forced crop is
-     * requested (dvd menu).
-     * Note: Margin will also be applied to secondary subtitles if they exist
-     * to ensure that overlap does not occur. */
-    int y_margin = 0;
-    if (!crop_requested && subpic->b_subtitle)
-        y_margin = spu_invscale_h(sys->margin, scale_size);
-
-    /* Place the picture
-     * We compute the position in the rendered size */
-
-    int i_align = region->i_align;
-    if (entry->channel_order == VLC_VOUT_ORDER_SECONDARY)
-        i_align = sys->secondary_alignment >= 0 ? sys->secondary_alignment : i_align;
-
-    SpuRegionPlace(&x_offset, &y_offset,
-                   subpic, region, i_align);
-
-    if (entry->channel_order == VLC_VOUT_ORDER_SECONDARY)
-    {
-        int secondary_margin =
-            spu_invscale_h(sys->secondary_margin, scale_size);
-        if (!subpic->b_absolute)
-        {
-            /* Move the secondary subtitles by the secondary margin before
-             * overlap detection. This way, overlaps will be resolved if they
-             * still exist.  */
-            y_offset -= secondary_margin;
-        }
-        else
-        {
-            /* Use an absolute margin for secondary subpictures that have
-             * already been placed but have been moved by the user */
-            y_margin += secondary_margin;
-        }
-    }
-
-    /* Save this position for subtitle overlap support
-     * it is really important that there are given without scale_size applied */
-    *dst_area = spu_area_create(x_offset, y_offset,
-                                region->fmt.i_visible_width,
-                                region->fmt.i_visible_height,
-                                scale_size);
-
-    /* Handle overlapping subtitles when possible */
-    if (subpic->b_subtitle && !subpic->b_absolute)
-        SpuAreaFixOverlap(dst_area, subtitle_area, subtitle_area_count,
-                          i_align);
-
-    /* we copy the area: for the subtitle overlap support we want
-     * to only save the area without margin applied */
-    spu_area_t restrained = *dst_area;
-
-    /* apply margin to subtitles and correct if they go over the picture edge */
-    if (subpic->b_subtitle)
-        restrained.y -= y_margin;
-
-    spu_area_t display = spu_area_create(0, 0, fmt->i_visible_width,
-                                         fmt->i_visible_height,
-                                         spu_scale_unit());
-    SpuAreaFitInside(&restrained, &display);
-
-    /* Fix the position for the current scale_size */
-    x_offset = spu_scale_w(restrained.x, restrained.scale);
-    y_offset = spu_scale_h(restrained.y, restrained.scale);
-
     /* */
     if (force_palette) {
         video_palette_t *old_palette = region->fmt.p_palette;
@@ -940,13 +927,9 @@ static void SpuRenderRegion(spu_t *spu,
             *old_palette = new_palette;
     }
 
-    /* */
-    region_fmt = region->fmt;
-    region_picture = region->p_picture;
-
     bool convert_chroma = true;
     for (int i = 0; chroma_list[i] && convert_chroma; i++) {
-        if (region_fmt.i_chroma == chroma_list[i])
+        if (region->fmt.i_chroma == chroma_list[i])
             convert_chroma = false;
     }
 
@@ -956,6 +939,8 @@ static void SpuRenderRegion(spu_t *spu,
         const unsigned dst_width  = spu_scale_w(region->fmt.i_visible_width,  scale_size);
         const unsigned dst_height = spu_scale_h(region->fmt.i_visible_height, scale_size);
 
+        job->scaled = true;
+
         /* Destroy the cache if unusable */
         if (region->p_private) {
             subpicture_region_private_t *private = region->p_private;
@@ -981,14 +966,14 @@ static void SpuRenderRegion(spu_t *spu,
 
         /* Scale if needed into cache */
         if (!region->p_private && dst_width > 0 && dst_height > 0) {
-            filter_t *scale = sys->scale;
+            filter_t *scale = ctx->scale;
 
             picture_t *picture = region->p_picture;
             picture_Hold(picture);
 
             /* Convert YUVP to YUVA/RGBA first for better scaling quality */
             if (using_palette) {
-                filter_t *scale_yuvp = sys->scale_yuvp;
+                filter_t *scale_yuvp = ctx->scale_yuvp;
 
                 scale_yuvp->fmt_in.video = region->fmt;
 
@@ -1045,12 +1030,118 @@ static void SpuRenderRegion(spu_t *spu,
                 }
             }
         }
+    }
+}
 
-        /* And use the scaled picture */
-        if (region->p_private) {
-            region_fmt     = region->p_private->fmt;
-            region_picture = region->p_private->p_picture;
+/**
+ * It will transform the provided region into another region suitable for rendering.
+ */
+static void SpuRenderRegion(spu_t *spu,
+                            subpicture_region_t **dst_ptr, spu_area_t *dst_area,
+                            const spu_region_job_t *job,
+                            const video_format_t *fmt,
+                            const spu_area_t *subtitle_area, size_t subtitle_area_count)
+{
+    const spu_render_entry_t *entry = job->entry;
+    subpicture_t *subpic = entry->subpic;
+    subpicture_region_t *region = job->region;
+    const spu_scale_t scale_size = job->virtual_scale;
+    const vlc_tick_t render_date = job->render_date;
+    spu_private_t *sys = spu->p;
+
+    int x_offset;
+    int y_offset;
+
+    video_format_t region_fmt;
+    picture_t *region_picture;
+
+    /* Invalidate area by default */
+    *dst_area = spu_area_create(0,0, 0,0, scale_size);
+    *dst_ptr  = NULL;
+
+    if (job->failed)
+        goto exit;
+
+    const bool using_palette = region->fmt.i_chroma == VLC_CODEC_YUVP;
+    const bool force_palette = using_palette && sys->palette.i_entries > 0;
+    const bool crop_requested = (force_palette && sys->force_crop) ||
+                                region->i_max_width || region->i_max_height;
+
+    /* Compute the margin which is expressed in destination pixel unit
+     * The margin is applied only to subtitle and when no forced crop is
+     * requested (dvd menu).
+     * Note: Margin will also be applied to secondary subtitles if they exist
+     * to ensure that overlap does not occur. */
+    int y_margin = 0;
+    if (!crop_requested && subpic->b_subtitle)
+        y_margin = spu_invscale_h(sys->margin, scale_size);
+
+    /* Place the picture
+     * We compute the position in the rendered size */
+
+    int i_align = region->i_align;
+    if (entry->channel_order == VLC_VOUT_ORDER_SECONDARY)
+        i_align = sys->secondary_alignment >= 0 ? sys->secondary_alignment : i_align;
+
+    SpuRegionPlace(&x_offset, &y_offset,
+                   subpic, region, i_align);
+
+    if (entry->channel_order == VLC_VOUT_ORDER_SECONDARY)
+    {
+        int secondary_margin =
+            spu_invscale_h(sys->secondary_margin, scale_size);
+        if (!subpic->b_absolute)
+        {
+            /* Move the secondary subtitles by the secondary margin before
+             * overlap detection. This way, overlaps will be resolved if they
+             * still exist.  */
+            y_offset -= secondary_margin;
         }
+        else
+        {
+            /* Use an absolute margin for secondary subpictures that have
+             * already been placed but have been moved by the user */
+            y_margin += secondary_margin;
+        }
+    }
+
+    /* Save this position for subtitle overlap support
+     * it is really important that there are given without scale_size applied */
+    *dst_area = spu_area_create(x_offset, y_offset,
+                                region->fmt.i_visible_width,
+                                region->fmt.i_visible_height,
+                                scale_size);
+
+    /* Handle overlapping subtitles when possible */
+    if (subpic->b_subtitle && !subpic->b_absolute)
+        SpuAreaFixOverlap(dst_area, subtitle_area, subtitle_area_count,
+                          i_align);
+
+    /* we copy the area: for the subtitle overlap support we want
+     * to only save the area without margin applied */
+    spu_area_t restrained = *dst_area;
+
+    /* apply margin to subtitles and correct if they go over the picture edge */
+    if (subpic->b_subtitle)
+        restrained.y -= y_margin;
+
+    spu_area_t display = spu_area_create(0, 0, fmt->i_visible_width,
+                                         fmt->i_visible_height,
+                                         spu_scale_unit());
+    SpuAreaFitInside(&restrained, &display);
+
+    /* Fix the position for the current scale_size */
+    x_offset = spu_scale_w(restrained.x, restrained.scale);
+    y_offset = spu_scale_h(restrained.y, restrained.scale);
+
+    /* */
+    region_fmt = region->fmt;
+    region_picture = region->p_picture;
+
+    /* And use the scaled picture */
+    if (job->scaled && region->p_private) {
+        region_fmt     = region->p_private->fmt;
+        region_picture = region->p_private->p_picture;
     }
 
     /* Force cropping if requested */
@@ -1122,7 +1213,7 @@ static void SpuRenderRegion(spu_t *spu,
     }
 
 exit:
-    if (restore_text) {
+    if (job->restore_text) {
         /* Some forms of subtitles need to be re-rendered more than
          * once, eg. karaoke. We therefore restore the region to its
          * pre-rendered state, so the next time through everything is
@@ -1136,8 +1227,200 @@ exit:
             subpicture_region_private_Delete(region->p_private);
             region->p_private = NULL;
         }
-        region->fmt = fmt_original;
+        region->fmt = job->fmt_original;
+    }
+}
+
+/*****************************************************************************
+ * Region rendering pool
+ *****************************************************************************/
+static void SpuRenderCtxClean(spu_render_ctx_t *ctx)
+{
+    if (ctx->text)
+        FilterRelease(ctx->text);
+    if (ctx->scale_yuvp)
+        FilterRelease(ctx->scale_yuvp);
+    if (ctx->scale)
+        FilterRelease(ctx->scale);
+}
+
+static int SpuRenderCtxInit(spu_t *spu, spu_render_ctx_t *ctx)
+{
+    ctx->text = SpuRenderCreateAndLoadText(spu);
+    ctx->scale = SpuRenderCreateAndLoadScale(VLC_OBJECT(spu),
+                                             VLC_CODEC_YUVA, VLC_CODEC_RGBA, true);
+    ctx->scale_yuvp = SpuRenderCreateAndLoadScale(VLC_OBJECT(spu),
+                                                  VLC_CODEC_YUVP, VLC_CODEC_YUVA, false);
+    ctx->text_generation = spu->p->text_generation;
+
+    if (!ctx->text || !ctx->scale || !ctx->scale_yuvp)
+    {
+        SpuRenderCtxClean(ctx);
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void *SpuRenderWorker(void *data)
+{
+    struct spu_render_worker *worker = data;
+    spu_t *spu = worker->spu;
+    struct spu_render_pool *pool = spu->p->render_pool;
+
+    vlc_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->exit && pool->job_next >= pool->job_count)
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        if (pool->exit)
+            break;
+
+        spu_region_job_t *job = &pool->jobs[pool->job_next++];
+        const vlc_fourcc_t *chroma_list = pool->chroma_list;
+        const unsigned text_generation = pool->text_generation;
+        pool->running++;
+        vlc_mutex_unlock(&pool->lock);
+
+        /* The text renderer of the vout thread was reloaded (attachments) */
+        if (worker->ctx.text_generation != text_generation)
+        {
+            if (worker->ctx.text)
+                FilterRelease(worker->ctx.text);
+            worker->ctx.text = SpuRenderCreateAndLoadText(spu);
+            worker->ctx.text_generation = text_generation;
+        }
+        SpuPrepareRegion(spu, &worker->ctx, job, chroma_list);
+
+        vlc_mutex_lock(&pool->lock);
+        if (--pool->running == 0 && pool->job_next >= pool->job_count)
+            vlc_cond_signal(&pool->done);
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void SpuRenderPoolDelete(struct spu_render_pool *pool)
+{
+    vlc_mutex_lock(&pool->lock);
+    pool->exit = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->worker_count; i++)
+    {
+        vlc_join(pool->workers[i].thread, NULL);
+        SpuRenderCtxClean(&pool->workers[i].ctx);
+    }
+    free(pool);
+}
+
+static struct spu_render_pool *SpuRenderPoolNew(spu_t *spu, size_t count)
+{
+    struct spu_render_pool *pool =
+        malloc(sizeof(*pool) + count * sizeof(pool->workers[0]));
+    if (!pool)
+        return NULL;
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    vlc_cond_init(&pool->done);
+    pool->jobs = NULL;
+    pool->job_count = pool->job_next = 0;
+    pool->running = 0;
+    pool->exit = false;
+    pool->worker_count = 0;
+    spu->p->render_pool = pool;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        struct spu_render_worker *worker = &pool->workers[i];
+
+        worker->spu = spu;
+        if (SpuRenderCtxInit(spu, &worker->ctx))
+            break;
+        if (vlc_clone(&worker->thread, SpuRenderWorker, worker,
+                      VLC_THREAD_PRIORITY_OUTPUT))
+        {
+            SpuRenderCtxClean(&worker->ctx);
+            break;
+        }
+        pool->worker_count++;
     }
+
+    if (pool->worker_count == 0)
+    {
+        spu->p->render_pool = NULL;
+        free(pool);
+        return NULL;
+    }
+    msg_Dbg(spu, "rendering regions with %zu extra threads",
+            pool->worker_count);
+    return pool;
+}
+
+/* Regions with a rendered picture in their cache are cheap */
+static bool SpuRegionIsCached(const subpicture_region_t *region)
+{
+    return region->fmt.i_chroma != VLC_CODEC_TEXT && region->p_private;
+}
+
+/**
+ * Prepares all the regions, on the rendering pool when more than one region
+ * has to be rendered.
+ */
+static void SpuPrepareRegions(spu_t *spu, spu_region_job_t *jobs, size_t count,
+                              const vlc_fourcc_t *chroma_list)
+{
+    spu_private_t *sys = spu->p;
+    spu_render_ctx_t ctx = {
+        .text = sys->text,
+        .scale_yuvp = sys->scale_yuvp,
+        .scale = sys->scale,
+        .text_generation = sys->text_generation,
+    };
+
+    size_t uncached = 0;
+    for (size_t i = 0; i < count; i++)
+        if (!SpuRegionIsCached(jobs[i].region))
+            uncached++;
+
+    struct spu_render_pool *pool = sys->render_pool;
+    if (uncached > 1 && !pool && sys->render_threads > 1)
+    {
+        pool = SpuRenderPoolNew(spu, sys->render_threads - 1);
+        if (!pool)
+            sys->render_threads = 1; /* do not try again */
+    }
+
+    if (uncached <= 1 || !pool)
+    {
+        for (size_t i = 0; i < count; i++)
+            SpuPrepareRegion(spu, &ctx, &jobs[i], chroma_list);
+        return;
+    }
+
+    vlc_mutex_lock(&pool->lock);
+    pool->jobs = jobs;
+    pool->job_count = count;
+    pool->job_next = 0;
+    pool->chroma_list = chroma_list;
+    pool->text_generation = sys->text_generation;
+    vlc_cond_broadcast(&pool->wait);
+
+    /* the vout thread takes its share of the jobs */
+    while (pool->job_next < pool->job_count)
+    {
+        spu_region_job_t *job = &pool->jobs[pool->job_next++];
+        vlc_mutex_unlock(&pool->lock);
+        SpuPrepareRegion(spu, &ctx, job, chroma_list);
+        vlc_mutex_lock(&pool->lock);
+    }
+    while (pool->running > 0)
+        vlc_cond_wait(&pool->done, &pool->lock);
+
+    pool->jobs = NULL;
+    pool->job_count = pool->job_next = 0;
+    vlc_mutex_unlock(&pool->lock);
 }
 
 /**
@@ -1153,8 +1436,6 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
                                           vlc_tick_t render_subtitle_date,
                                           bool external_scale)
 {
-    spu_private_t *sys = spu->p;
-
     /* Count the number of regions and subtitle regions */
     unsigned int subtitle_region_count = 0;
     unsigned int region_count          = 0;
@@ -1172,25 +1453,32 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
     if (region_count <= 0)
         return NULL;
 
+    /* Allocate the rendering jobs */
+    spu_region_job_t job_buffer[16];
+    spu_region_job_t *jobs = job_buffer;
+    size_t job_count = 0;
+
+    if (region_count > ARRAY_SIZE(job_buffer))
+    {
+        jobs = vlc_alloc(region_count, sizeof(*jobs));
+        if (!jobs)
+            return NULL;
+    }
+
     /* Create the output subpicture */
     subpicture_t *output = subpicture_New(NULL);
     if (!output)
+    {
+        if (jobs != job_buffer)
+            free(jobs);
         return NULL;
+    }
     output->i_order = p_entries[i_subpicture - 1].subpic->i_order;
     output->i_original_picture_width  = fmt_dst->i_visible_width;
     output->i_original_picture_height = fmt_dst->i_visible_height;
     subpicture_region_t **output_last_ptr = &output->p_region;
 
-    /* Allocate area array for subtitle overlap */
-    spu_area_t subtitle_area_buffer[100];
-    spu_area_t *subtitle_area;
-    size_t subtitle_area_count = 0;
-
-    subtitle_area = subtitle_area_buffer;
-    if (subtitle_region_count > sizeof(subtitle_area_buffer)/sizeof(*subtitle_area_buffer))
-        subtitle_area = calloc(subtitle_region_count, sizeof(*subtitle_area));
-
-    /* Process all subpictures and regions (in the right order) */
+    /* Collect all subpictures and regions (in the right order) */
     for (size_t index = 0; index < i_subpicture; index++) {
         const spu_render_entry_t *entry = &p_entries[index];
         subpicture_t *subpic = entry->subpic;
@@ -1213,20 +1501,7 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
             subpic->i_original_picture_height = fmt_src->i_visible_height;
         }
 
-        /* FIXME aspect ratio ? */
-        sys->text->fmt_out.video.i_width          =
-        sys->text->fmt_out.video.i_visible_width  = subpic->i_original_picture_width;
-
-        sys->text->fmt_out.video.i_height         =
-        sys->text->fmt_out.video.i_visible_height = subpic->i_original_picture_height;
-
-        /* Render all regions
-         * We always transform non absolute subtitle into absolute one on the
-         * first rendering to allow good subtitle overlap support.
-         */
         for (region = subpic->p_region; region != NULL; region = region->p_next) {
-            spu_area_t area;
-
             /* Compute region scale AR */
             video_format_t region_fmt = region->fmt;
             if (region_fmt.i_sar_num <= 0 || region_fmt.i_sar_den <= 0) {
@@ -1253,44 +1528,75 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
             if (scale.w <= 0 || scale.h <= 0)
                 continue;
 
-            const bool do_external_scale = external_scale && region->fmt.i_chroma != VLC_CODEC_TEXT;
-            spu_scale_t virtual_scale = external_scale ? (spu_scale_t){ SCALE_UNIT, SCALE_UNIT } : scale;
+            spu_region_job_t *job = &jobs[job_count++];
+            job->entry = entry;
+            job->region = region;
+            job->scale = scale;
+            job->virtual_scale = external_scale ? (spu_scale_t){ SCALE_UNIT, SCALE_UNIT } : scale;
+            job->render_date = subpic->b_subtitle ? render_subtitle_date : system_now;
+        }
+    }
 
-            /* */
-            SpuRenderRegion(spu, output_last_ptr, &area,
-                            entry, region, virtual_scale,
-                            chroma_list, fmt_dst,
-                            subtitle_area, subtitle_area_count,
-                            subpic->b_subtitle ? render_subtitle_date : system_now);
-            if (*output_last_ptr)
+    /* Render the text and scale the regions, possibly concurrently */
+    SpuPrepareRegions(spu, jobs, job_count, chroma_list);
+
+    /* Allocate area array for subtitle overlap */
+    spu_area_t subtitle_area_buffer[100];
+    spu_area_t *subtitle_area;
+    size_t subtitle_area_count = 0;
+
+    subtitle_area = subtitle_area_buffer;
+    if (subtitle_region_count > sizeof(subtitle_area_buffer)/sizeof(*subtitle_area_buffer))
+        subtitle_area = calloc(subtitle_region_count, sizeof(*subtitle_area));
+
+    /* Place all regions
+     * We always transform non absolute subtitle into absolute one on the
+     * first rendering to allow good subtitle overlap support.
+     */
+    for (size_t i = 0; i < job_count; i++) {
+        const spu_region_job_t *job = &jobs[i];
+        subpicture_t *subpic = job->entry->subpic;
+        subpicture_region_t *region = job->region;
+        const spu_scale_t scale = job->scale;
+        spu_area_t area;
+
+        const bool do_external_scale = external_scale && job->fmt_original.i_chroma != VLC_CODEC_TEXT;
+
+        /* */
+        SpuRenderRegion(spu, output_last_ptr, &area, job, fmt_dst,
+                        subtitle_area, subtitle_area_count);
+        if (*output_last_ptr)
+        {
+            if (do_external_scale)
             {
-                if (do_external_scale)
+                if (scale.h != SCALE_UNIT)
                 {
-                    if (scale.h != SCALE_UNIT)
-                    {
-                        (*output_last_ptr)->zoom_h.num = scale.h;
-                        (*output_last_ptr)->zoom_h.den = SCALE_UNIT;
-                    }
-                    if (scale.w != SCALE_UNIT)
-                    {
-                        (*output_last_ptr)->zoom_v.num = scale.w;
-                        (*output_last_ptr)->zoom_v.den = SCALE_UNIT;
-                    }
+                    (*output_last_ptr)->zoom_h.num = scale.h;
+                    (*output_last_ptr)->zoom_h.den = SCALE_UNIT;
+                }
+                if (scale.w != SCALE_UNIT)
+                {
+                    (*output_last_ptr)->zoom_v.num = scale.w;
+                    (*output_last_ptr)->zoom_v.den = SCALE_UNIT;
                 }
-
-                output_last_ptr = &(*output_last_ptr)->p_next;
             }
 
-            if (subpic->b_subtitle) {
-                area = spu_area_unscaled(area, scale);
-                if (!subpic->b_absolute && area.width > 0 && area.height > 0) {
-                    region->i_x = area.x;
-                    region->i_y = area.y;
-                }
-                if (subtitle_area)
-                    subtitle_area[subtitle_area_count++] = area;
+            output_last_ptr = &(*output_last_ptr)->p_next;
+        }
+
+        if (subpic->b_subtitle) {
+            area = spu_area_unscaled(area, scale);
+            if (!subpic->b_absolute && area.width > 0 && area.height > 0) {
+                region->i_x = area.x;
+                region->i_y = area.y;
             }
+            if (subtitle_area)
+                subtitle_area[subtitle_area_count++] = area;
         }
+    }
+
+    for (size_t index = 0; index < i_subpicture; index++) {
+        subpicture_t *subpic = p_entries[index].subpic;
         if (subpic->b_subtitle && subpic->p_region)
             subpic->b_absolute = true;
     }
@@ -1298,6 +1604,8 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
     /* */
     if (subtitle_area != subtitle_area_buffer)
         free(subtitle_area);
+    if (jobs != job_buffer)
+        free(jobs);
 
     return output;
 }
@@ -1476,6 +1784,12 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
 
     /* Load text and scale module */
     sys->text = SpuRenderCreateAndLoadText(spu);
+    sys->text_generation = 0;
+
+    sys->render_threads = var_InheritInteger(spu, "spu-render-threads");
+    if (sys->render_threads <= 0)
+        sys->render_threads = __MIN(vlc_GetCPUCount(), 4);
+    sys->render_pool = NULL;
 
     /* XXX spu->p_scale is used for all conversion/scaling except yuvp to
      * yuva/rgba */
@@ -1511,6 +1825,9 @@ void spu_Destroy(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    if (sys->render_pool)
+        SpuRenderPoolDelete(sys->render_pool);
+
     if (sys->text)
         FilterRelease(sys->text);
 
@@ -1560,6 +1877,7 @@ void spu_Attach(spu_t *spu, input_thread_t *input)
         if (spu->p->text)
             FilterRelease(spu->p->text);
         spu->p->text = SpuRenderCreateAndLoadText(spu);
+        spu->p->text_generation++;
     }
     vlc_mutex_unlock(&spu->p->lock);
 }
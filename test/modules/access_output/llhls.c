@@ -0,0 +1,207 @@
+/*****************************************************************************
+ * llhls.c: test the low latency HLS server playlist and blocking requests
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_sout.h>
+#include <vlc_network.h>
+
+#define FRAME_LENGTH   VLC_TICK_FROM_MS(40)
+#define SEGMENT_FRAMES 25 /* sout-llhls-seglen=1 */
+#define GOP_FRAMES     (2 * SEGMENT_FRAMES)
+#define FRAME_SIZE     188
+
+static unsigned GetFreePort(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof(addr);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(getsockname(fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    net_Close(fd);
+    return ntohs(addr.sin_port);
+}
+
+static void WriteFrames(sout_access_out_t *access, unsigned from, unsigned to)
+{
+    for (unsigned i = from; i < to; i++)
+    {
+        block_t *block = block_Alloc(FRAME_SIZE);
+        assert(block != NULL);
+        memset(block->p_buffer, 0x47, FRAME_SIZE);
+        block->i_dts = block->i_pts = VLC_TICK_0 + i * FRAME_LENGTH;
+        block->i_length = FRAME_LENGTH;
+        block->i_flags = i % GOP_FRAMES ? BLOCK_FLAG_TYPE_P : BLOCK_FLAG_TYPE_I;
+        assert(sout_AccessOutWrite(access, block) == FRAME_SIZE);
+    }
+}
+
+static int Request(vlc_object_t *obj, unsigned port, const char *path)
+{
+    int fd = net_ConnectTCP(obj, "127.0.0.1", port);
+    assert(fd >= 0);
+
+    char req[256];
+    int len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\n"
+                       "Host: 127.0.0.1\r\n\r\n", path);
+    assert(len > 0 && (size_t)len < sizeof(req));
+    assert(send(fd, req, len, 0) == len);
+    return fd;
+}
+
+/* Returns the status code and the NUL-terminated body */
+static int Response(int fd, char **body)
+{
+    char *buf = NULL;
+    size_t size = 0;
+    char *headers_end = NULL;
+    size_t total = 0;
+
+    for (;;)
+    {
+        if (headers_end != NULL && total >= (size_t)(headers_end - buf) + size)
+            break;
+
+        char chunk[4096];
+        ssize_t val = recv(fd, chunk, sizeof(chunk), 0);
+        assert(val > 0);
+        char *p = realloc(buf, total + val + 1);
+        assert(p != NULL);
+        buf = p;
+        memcpy(&buf[total], chunk, val);
+        total += val;
+        buf[total] = '\0';
+
+        if (headers_end == NULL && (p = strstr(buf, "\r\n\r\n")) != NULL)
+        {
+            headers_end = p + 4;
+            const char *cl = strstr(buf, "Content-Length:");
+            assert(cl != NULL && cl < headers_end);
+            size = strtoul(cl + strlen("Content-Length:"), NULL, 10);
+        }
+    }
+    net_Close(fd);
+
+    int status;
+    assert(sscanf(buf, "HTTP/1.%*d %d", &status) == 1);
+    *body = strdup(headers_end);
+    assert(*body != NULL);
+    free(buf);
+    return status;
+}
+
+static int Get(vlc_object_t *obj, unsigned port, const char *path, char **body)
+{
+    return Response(Request(obj, port, path), body);
+}
+
+/* Checks that no listed duration exceeds its target */
+static unsigned CheckDurations(const char *playlist, const char *tag,
+                               double target)
+{
+    unsigned count = 0;
+    for (const char *p = playlist; (p = strstr(p, tag)) != NULL; count++)
+    {
+        p += strlen(tag);
+        assert(strtod(p, NULL) <= target);
+    }
+    return count;
+}
+
+static void CheckPlaylist(const char *playlist)
+{
+    /* the targets are fixed even though the keyframes are further apart */
+    assert(!strncmp(playlist, "#EXTM3U\n", 8));
+    assert(strstr(playlist, "#EXT-X-TARGETDURATION:1\n") != NULL);
+    assert(strstr(playlist, "PART-TARGET=0.400\n") != NULL);
+
+    assert(CheckDurations(playlist, "#EXTINF:", 1.) == 2);
+    assert(CheckDurations(playlist, "#EXT-X-PART:DURATION=", .4) > 0);
+    assert(strstr(playlist, "#EXT-X-PRELOAD-HINT:TYPE=PART,"
+                            "URI=\"segment?msn=2&part=0\"\n") != NULL);
+}
+
+int main(void)
+{
+    test_init();
+
+    static const char *argv[] = {
+        "-v",
+        "--ignore-config",
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+    vlc_object_t *root = VLC_OBJECT(vlc->p_libvlc_int);
+
+    unsigned port = GetFreePort();
+    char psz_path[32];
+    snprintf(psz_path, sizeof(psz_path), "127.0.0.1:%u/live.m3u8", port);
+
+    sout_access_out_t *access =
+        sout_AccessOutNew(root, "llhls{seglen=1,partlen=400}", psz_path);
+    assert(access != NULL);
+
+    char *body;
+
+    /* two forced segments and the start of a third one */
+    WriteFrames(access, 0, 2 * SEGMENT_FRAMES + 10);
+    assert(Get(root, port, "/live.m3u8", &body) == 200);
+    CheckPlaylist(body);
+    free(body);
+
+    assert(Get(root, port, "/segment?msn=0", &body) == 200);
+    free(body);
+    /* an ongoing segment is not waited for as a whole */
+    assert(Get(root, port, "/segment?msn=2", &body) == 404);
+    free(body);
+
+    /* the blocking reload is answered once the part is complete */
+    int fd = Request(root, port, "/live.m3u8?_HLS_msn=2&_HLS_part=0");
+    struct pollfd ufd = { .fd = fd, .events = POLLIN };
+    assert(poll(&ufd, 1, 200) == 0);
+    WriteFrames(access, 2 * SEGMENT_FRAMES + 10, 2 * SEGMENT_FRAMES + 20);
+    assert(Response(fd, &body) == 200);
+    assert(strstr(body, "#EXT-X-PART:DURATION=0.400,"
+                        "URI=\"segment?msn=2&part=0\"\n") != NULL);
+    free(body);
+
+    /* a hint that never completes is given up on before the client is */
+    vlc_tick_t start = vlc_tick_now();
+    assert(Get(root, port, "/segment?msn=2&part=1", &body) == 503);
+    assert(vlc_tick_now() - start >= VLC_TICK_FROM_SEC(4));
+    free(body);
+
+    sout_AccessOutDelete(access);
+    libvlc_release(vlc);
+    return 0;
+}
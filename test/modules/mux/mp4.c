@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * mp4.c: test the fragmented MP4 muxer CMAF chunks
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_util.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_sout.h>
+
+#include <string.h>
+
+#define FRAME_LENGTH  VLC_TICK_FROM_MS(40)
+#define GOP_FRAMES    25  /* one keyframe per second */
+#define CHUNK_FRAMES  3   /* sout-mp4-chunk-duration=120 */
+/* segments last FRAGMENT_LENGTH (1.5s) up to the next keyframe */
+#define SEGMENT_FRAMES (2 * GOP_FRAMES)
+#define FRAME_COUNT   (4 * SEGMENT_FRAMES + 7)
+
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x020000
+#define TRUN_DATA_OFFSET          0x000001
+
+struct output
+{
+    uint8_t *p_data;
+    size_t i_size;
+};
+
+static ssize_t Write(sout_access_out_t *p_access, block_t *p_block)
+{
+    struct output *p_out = p_access->p_sys;
+    ssize_t i_total = 0;
+
+    while (p_block != NULL)
+    {
+        block_t *p_next = p_block->p_next;
+        uint8_t *p_data = realloc(p_out->p_data, p_out->i_size + p_block->i_buffer);
+        assert(p_data != NULL);
+        memcpy(&p_data[p_out->i_size], p_block->p_buffer, p_block->i_buffer);
+        p_out->p_data = p_data;
+        p_out->i_size += p_block->i_buffer;
+        i_total += p_block->i_buffer;
+        block_Release(p_block);
+        p_block = p_next;
+    }
+    return i_total;
+}
+
+static void Mux(libvlc_instance_t *vlc, unsigned i_tracks, struct output *p_out)
+{
+    vlc_object_t *root = VLC_OBJECT(vlc->p_libvlc_int);
+
+    sout_instance_t *p_sout = vlc_object_create(root, sizeof(*p_sout));
+    assert(p_sout != NULL);
+    sout_access_out_t *p_access = vlc_object_create(root, sizeof(*p_access));
+    assert(p_access != NULL);
+    p_access->pf_write = Write;
+    p_access->p_sys = p_out;
+
+    sout_mux_t *p_mux = sout_MuxNew(p_sout, "mp4frag{chunk-duration=120}",
+                                    p_access);
+    assert(p_mux != NULL);
+
+    sout_input_t *inputs[2];
+    assert(i_tracks <= ARRAY_SIZE(inputs));
+    for (unsigned i = 0; i < i_tracks; i++)
+    {
+        es_format_t fmt;
+        es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_MP4V);
+        fmt.video.i_width = fmt.video.i_visible_width = 64;
+        fmt.video.i_height = fmt.video.i_visible_height = 64;
+        fmt.video.i_frame_rate = 25;
+        fmt.video.i_frame_rate_base = 1;
+        inputs[i] = sout_MuxAddStream(p_mux, &fmt);
+        assert(inputs[i] != NULL);
+        es_format_Clean(&fmt);
+    }
+
+    for (unsigned i_frame = 0; i_frame < FRAME_COUNT; i_frame++)
+    {
+        for (unsigned i = 0; i < i_tracks; i++)
+        {
+            block_t *p_block = block_Alloc(100 + i_frame);
+            assert(p_block != NULL);
+            memset(p_block->p_buffer, i_frame, p_block->i_buffer);
+            p_block->i_dts = p_block->i_pts = VLC_TICK_0 + i_frame * FRAME_LENGTH;
+            p_block->i_length = FRAME_LENGTH;
+            p_block->i_flags = i_frame % GOP_FRAMES ? BLOCK_FLAG_TYPE_P
+                                                    : BLOCK_FLAG_TYPE_I;
+            sout_MuxSendBuffer(p_mux, inputs[i], p_block);
+        }
+    }
+
+    for (unsigned i = 0; i < i_tracks; i++)
+        sout_MuxDeleteStream(p_mux, inputs[i]);
+    sout_MuxDelete(p_mux);
+    vlc_object_delete(p_access);
+    vlc_object_delete(p_sout);
+}
+
+/* Finds the next box of the given type in [p_data, p_end) */
+static const uint8_t *FindBox(const uint8_t *p_data, const uint8_t *p_end,
+                              const char *psz_type)
+{
+    while (p_end - p_data >= 8)
+    {
+        uint32_t i_size = GetDWBE(p_data);
+        assert(i_size >= 8 && i_size <= p_end - p_data);
+        if (!memcmp(&p_data[4], psz_type, 4))
+            return p_data;
+        p_data += i_size;
+    }
+    return NULL;
+}
+
+static bool HasBrand(const uint8_t *p_box, vlc_fourcc_t i_brand)
+{
+    uint32_t i_size = GetDWBE(p_box);
+    for (uint32_t i = 8; i + 4 <= i_size; i += 4)
+        if (i != 12 && !memcmp(&p_box[i], &i_brand, 4))
+            return true;
+    return false;
+}
+
+static void CheckOutput(const struct output *p_out, unsigned i_tracks)
+{
+    const bool b_cmaf = i_tracks == 1;
+    const uint8_t *p_data = p_out->p_data;
+    const uint8_t *p_end = p_data + p_out->i_size;
+
+    const uint8_t *p_ftyp = FindBox(p_data, p_end, "ftyp");
+    assert(p_ftyp == p_data);
+    assert(HasBrand(p_ftyp, VLC_FOURCC('c','m','f','c')) == b_cmaf);
+    assert(HasBrand(p_ftyp, VLC_FOURCC('i','s','o','6')) == b_cmaf);
+
+    unsigned i_chunks = 0;
+    unsigned i_frames = 0; /* of the first track */
+    const uint8_t *p_box = p_data;
+    while ((p_box = FindBox(p_box, p_end, "moof")) != NULL)
+    {
+        const uint8_t *p_moof = p_box;
+        const uint8_t *p_moof_end = p_moof + GetDWBE(p_moof);
+        const uint8_t *p_mdat = FindBox(p_moof_end, p_end, "mdat");
+        assert(p_mdat == p_moof_end);
+
+        /* styp and prft, only claiming CMAF for a single track */
+        const uint8_t *p_styp = FindBox(p_data, p_moof, "styp");
+        const uint8_t *p_prft = FindBox(p_data, p_moof, "prft");
+        assert(p_prft != NULL);
+        assert(p_prft + GetDWBE(p_prft) == p_moof);
+        if (b_cmaf)
+        {
+            assert(p_styp != NULL);
+            assert(p_styp + GetDWBE(p_styp) == p_prft);
+            /* a segment starts on each keyframe past FRAGMENT_LENGTH */
+            const bool b_segment = i_frames % SEGMENT_FRAMES == 0;
+            assert(!memcmp(&p_styp[8], b_segment ? "cmfs" : "cmfl", 4));
+            assert(HasBrand(p_styp, VLC_FOURCC('c','m','f','c')));
+        }
+        else
+            assert(p_styp == NULL);
+
+        unsigned i_trafs = 0;
+        unsigned i_samples = 0;
+        bool b_data_offset = false;
+        const uint8_t *p_traf = p_moof + 8;
+        while ((p_traf = FindBox(p_traf, p_moof_end, "traf")) != NULL)
+        {
+            const uint8_t *p_traf_end = p_traf + GetDWBE(p_traf);
+            const uint8_t *p_tfhd = FindBox(p_traf + 8, p_traf_end, "tfhd");
+            const uint8_t *p_trun = FindBox(p_traf + 8, p_traf_end, "trun");
+            assert(p_tfhd != NULL);
+
+            const uint32_t i_tfhd_flags = GetDWBE(&p_tfhd[8]) & 0xFFFFFF;
+            assert(!!(i_tfhd_flags & TFHD_DEFAULT_BASE_IS_MOOF) == b_cmaf);
+
+            const uint32_t i_count = p_trun ? GetDWBE(&p_trun[12]) : 0;
+            if (p_trun && !b_data_offset)
+            {
+                /* the samples start right in the following mdat */
+                assert(GetDWBE(&p_trun[8]) & TRUN_DATA_OFFSET);
+                assert(p_moof + GetDWBE(&p_trun[16]) == p_mdat + 8);
+                b_data_offset = true;
+            }
+            assert(i_count <= CHUNK_FRAMES);
+            if (i_trafs == 0)
+                i_samples = i_count;
+
+            i_trafs++;
+            p_traf = p_traf_end;
+        }
+        assert(i_trafs == i_tracks);
+        assert(b_data_offset);
+
+        /* chunks never exceed the chunk duration nor cross a segment */
+        if (b_cmaf)
+        {
+            assert(i_samples > 0);
+            assert(i_frames / SEGMENT_FRAMES ==
+                   (i_frames + i_samples - 1) / SEGMENT_FRAMES);
+        }
+
+        i_frames += i_samples;
+        i_chunks++;
+        p_data = p_box = p_mdat + GetDWBE(p_mdat);
+    }
+
+    /* the muxer does not drain the other inputs when they are deleted */
+    if (b_cmaf)
+        assert(i_frames == FRAME_COUNT);
+    assert(i_chunks >= i_frames / CHUNK_FRAMES);
+}
+
+int main(void)
+{
+    test_init();
+
+    static const char *argv[] = {
+        "-v",
+        "--ignore-config",
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    for (unsigned i_tracks = 1; i_tracks <= 2; i_tracks++)
+    {
+        struct output out = { NULL, 0 };
+        Mux(vlc, i_tracks, &out);
+        CheckOutput(&out, i_tracks);
+        free(out.p_data);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
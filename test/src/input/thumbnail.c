@@ -27,6 +27,7 @@
 #include <vlc_picture.h>
 
 #include <errno.h>
+#include <string.h>
 
 #define MOCK_DURATION VLC_TICK_FROM_SEC( 5 * 60 )
 
@@ -65,6 +66,7 @@ struct test_ctx
     vlc_mutex_t lock;
     size_t test_idx;
     bool b_done;
+    picture_t* p_pic;
 };
 
 static void thumbnailer_callback( void* data, picture_t* thumbnail )
@@ -207,6 +209,120 @@ static void test_cancel_thumbnail( libvlc_instance_t* p_vlc )
     vlc_thumbnailer_Release( p_thumbnailer );
 }
 
+static void thumbnailer_callback_same_item( void* data, picture_t* thumbnail )
+{
+    struct test_ctx* p_ctx = data;
+    assert( thumbnail != NULL );
+    assert( thumbnail->format.i_chroma == VLC_CODEC_ARGB );
+    vlc_mutex_lock( &p_ctx->lock );
+    p_ctx->p_pic = picture_Hold( thumbnail );
+    p_ctx->b_done = true;
+    vlc_mutex_unlock( &p_ctx->lock );
+    vlc_cond_signal( &p_ctx->cond );
+}
+
+static picture_t* request_same_item( vlc_thumbnailer_t* p_thumbnailer,
+                                     struct test_ctx* p_ctx,
+                                     input_item_t* p_item, vlc_tick_t i_time,
+                                     bool b_fast_seek, vlc_tick_t* pi_latency )
+{
+    vlc_tick_t i_start = vlc_tick_now();
+
+    vlc_mutex_lock( &p_ctx->lock );
+    p_ctx->b_done = false;
+    p_ctx->p_pic = NULL;
+    vlc_thumbnailer_request_t* p_req = vlc_thumbnailer_RequestByTime(
+        p_thumbnailer, i_time, b_fast_seek ? VLC_THUMBNAILER_SEEK_FAST :
+                                             VLC_THUMBNAILER_SEEK_PRECISE,
+        p_item, VLC_TICK_FROM_SEC( 1 ), thumbnailer_callback_same_item,
+        p_ctx );
+    assert( p_req != NULL );
+    while ( p_ctx->b_done == false )
+    {
+        vlc_tick_t timeout = vlc_tick_now() + VLC_TICK_FROM_SEC( 1 );
+        int res = vlc_cond_timedwait( &p_ctx->cond, &p_ctx->lock, timeout );
+        assert( res != ETIMEDOUT );
+    }
+    picture_t* p_pic = p_ctx->p_pic;
+    vlc_mutex_unlock( &p_ctx->lock );
+
+    *pi_latency = vlc_tick_now() - i_start;
+    /* The mock demuxer outputs a frame exactly at the seek time, which the
+     * thumbnailer returns undated by any clock */
+    assert( p_pic->date == i_time && "Unexpected picture date" );
+    return p_pic;
+}
+
+static bool picture_Equal( const picture_t* a, const picture_t* b )
+{
+    if ( a->i_planes != b->i_planes )
+        return false;
+    for ( int i = 0; i < a->i_planes; ++i )
+    {
+        const plane_t* pa = &a->p[i], *pb = &b->p[i];
+
+        if ( pa->i_visible_lines != pb->i_visible_lines ||
+             pa->i_visible_pitch != pb->i_visible_pitch )
+            return false;
+        for ( int y = 0; y < pa->i_visible_lines; ++y )
+            if ( memcmp( &pa->p_pixels[y * pa->i_pitch],
+                         &pb->p_pixels[y * pb->i_pitch],
+                         pa->i_visible_pitch ) )
+                return false;
+    }
+    return true;
+}
+
+static void test_thumbnails_same_item( libvlc_instance_t* p_vlc )
+{
+    vlc_thumbnailer_t* p_thumbnailer = vlc_thumbnailer_Create(
+                VLC_OBJECT( p_vlc->p_libvlc_int ) );
+    assert( p_thumbnailer != NULL );
+
+    struct test_ctx ctx;
+    vlc_cond_init( &ctx.cond );
+    vlc_mutex_init( &ctx.lock );
+
+    char* psz_mrl;
+    if ( asprintf( &psz_mrl, "mock://video_track_count=1;length=%" PRId64
+                   ";video_chroma=ARGB", MOCK_DURATION ) < 0 )
+        assert( !"Failed to allocate mock mrl" );
+    input_item_t* p_item = input_item_New( psz_mrl, "mock item" );
+    assert( p_item != NULL );
+
+    /* Consecutive requests on the same item, e.g. to build a sprite sheet.
+     * Only the first one opens the demuxer and the decoder. */
+    vlc_tick_t i_first_latency, i_min_latency = INT64_MAX;
+    picture_t* p_first = request_same_item( p_thumbnailer, &ctx, p_item,
+                                            VLC_TICK_0, false,
+                                            &i_first_latency );
+    for ( int i = 1; i < 10; ++i )
+    {
+        vlc_tick_t i_latency;
+        picture_t* p_pic = request_same_item( p_thumbnailer, &ctx, p_item,
+                                VLC_TICK_0 + i * MOCK_DURATION / 10, i % 2,
+                                &i_latency );
+        assert( !picture_Equal( p_pic, p_first ) );
+        picture_Release( p_pic );
+        if ( i_latency < i_min_latency )
+            i_min_latency = i_latency;
+    }
+    assert( i_min_latency < i_first_latency &&
+            "Requests on the same item are not faster than the first one" );
+
+    /* Going back gives the same picture: the reused decoder was flushed */
+    vlc_tick_t i_latency;
+    picture_t* p_pic = request_same_item( p_thumbnailer, &ctx, p_item,
+                                          VLC_TICK_0, false, &i_latency );
+    assert( picture_Equal( p_pic, p_first ) );
+    picture_Release( p_pic );
+    picture_Release( p_first );
+
+    input_item_Release( p_item );
+    free( psz_mrl );
+    vlc_thumbnailer_Release( p_thumbnailer );
+}
+
 int main()
 {
     test_init();
@@ -219,6 +335,7 @@ int main()
     assert(vlc);
 
     test_thumbnails( vlc );
+    test_thumbnails_same_item( vlc );
     test_cancel_thumbnail( vlc );
 
     libvlc_release( vlc );
@@ -0,0 +1,383 @@
+/*****************************************************************************
+ * preparser.c: test the preparser results cache and scheduling
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_input_item.h>
+#include <vlc_interface.h>
+#include <vlc_url.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <dirent.h>
+#include <errno.h>
+#include <ftw.h>
+#include <poll.h>
+#include <string.h>
+#include <utime.h>
+
+struct test_ctx
+{
+    vlc_mutex_t lock;
+    vlc_cond_t cond;
+    unsigned pending;
+};
+
+struct test_req
+{
+    struct test_ctx *ctx;
+    input_item_t *item;
+    bool ended;
+    enum input_item_preparse_status status;
+};
+
+static void on_preparse_ended( input_item_t *item,
+                               enum input_item_preparse_status status,
+                               void *data )
+{
+    struct test_req *req = data;
+    struct test_ctx *ctx = req->ctx;
+
+    vlc_mutex_lock( &ctx->lock );
+    assert( item == req->item && !req->ended );
+    req->ended = true;
+    req->status = status;
+    assert( ctx->pending > 0 );
+    ctx->pending--;
+    vlc_cond_broadcast( &ctx->cond );
+    vlc_mutex_unlock( &ctx->lock );
+}
+
+static const input_preparser_callbacks_t preparser_cbs = {
+    .on_preparse_ended = on_preparse_ended,
+};
+
+static void request( libvlc_instance_t *vlc, struct test_ctx *ctx,
+                     struct test_req *req, input_item_t *item )
+{
+    req->ctx = ctx;
+    req->item = item;
+    req->ended = false;
+
+    vlc_mutex_lock( &ctx->lock );
+    ctx->pending++;
+    vlc_mutex_unlock( &ctx->lock );
+
+    int ret = libvlc_MetadataRequest( vlc->p_libvlc_int, item,
+                                      META_REQUEST_OPTION_SCOPE_ANY,
+                                      &preparser_cbs, req, -1, NULL );
+    assert( ret == VLC_SUCCESS );
+}
+
+static void wait_ended( struct test_ctx *ctx, const struct test_req *req )
+{
+    vlc_tick_t deadline = vlc_tick_now() + VLC_TICK_FROM_SEC( 5 );
+
+    vlc_mutex_lock( &ctx->lock );
+    while( req != NULL ? !req->ended : ctx->pending > 0 )
+        assert( vlc_cond_timedwait( &ctx->cond, &ctx->lock,
+                                    deadline ) != ETIMEDOUT );
+    vlc_mutex_unlock( &ctx->lock );
+}
+
+static bool has_ended( struct test_ctx *ctx, const struct test_req *req )
+{
+    vlc_mutex_lock( &ctx->lock );
+    bool ended = req->ended;
+    vlc_mutex_unlock( &ctx->lock );
+    return ended;
+}
+
+/* Finds the only entry of the preparsed cache */
+static bool stat_cache_entry( const char *dir, struct stat *st )
+{
+    char *root;
+    bool found = false;
+
+    assert( asprintf( &root, "%s/vlc/preparsed", dir ) != -1 );
+    DIR *d = opendir( root );
+    for( struct dirent *e; d != NULL && ( e = readdir( d ) ) != NULL; )
+    {
+        char *sub;
+
+        if( e->d_name[0] == '.' )
+            continue;
+        assert( asprintf( &sub, "%s/%s", root, e->d_name ) != -1 );
+        DIR *sd = opendir( sub );
+        assert( sd != NULL );
+        for( struct dirent *f; ( f = readdir( sd ) ) != NULL; )
+        {
+            char *path;
+
+            if( f->d_name[0] == '.' )
+                continue;
+            assert( !found );
+            assert( asprintf( &path, "%s/%s", sub, f->d_name ) != -1 );
+            assert( stat( path, st ) == 0 );
+            found = true;
+            free( path );
+        }
+        closedir( sd );
+        free( sub );
+    }
+    if( d != NULL )
+        closedir( d );
+    free( root );
+    return found;
+}
+
+/* Preparses a local item, and tells whether it was found in the cache: the
+ * cache entry is replaced whenever the item is parsed again */
+static bool preparse( libvlc_instance_t *vlc, struct test_ctx *ctx,
+                      const char *dir, const char *uri,
+                      vlc_tick_t *duration, int *es_count )
+{
+    struct stat before, after;
+    struct test_req req;
+
+    bool cached = stat_cache_entry( dir, &before );
+
+    input_item_t *item = input_item_New( uri, "sample" );
+    assert( item != NULL );
+    request( vlc, ctx, &req, item );
+    wait_ended( ctx, &req );
+    assert( req.status == ITEM_PREPARSE_DONE );
+
+    vlc_mutex_lock( &item->lock );
+    *duration = item->i_duration;
+    *es_count = item->i_es;
+    vlc_mutex_unlock( &item->lock );
+    input_item_Release( item );
+
+    assert( stat_cache_entry( dir, &after ) );
+    return cached && before.st_ino == after.st_ino
+        && before.st_mtim.tv_sec == after.st_mtim.tv_sec
+        && before.st_mtim.tv_nsec == after.st_mtim.tv_nsec;
+}
+
+static void copy_file( const char *from, const char *to )
+{
+    FILE *in = fopen( from, "rb" ), *out = fopen( to, "wb" );
+    char buf[4096];
+    size_t len;
+
+    assert( in != NULL && out != NULL );
+    while( ( len = fread( buf, 1, sizeof (buf), in ) ) > 0 )
+        assert( fwrite( buf, 1, len, out ) == len );
+    fclose( in );
+    assert( fclose( out ) == 0 );
+}
+
+static void test_cache( libvlc_instance_t *vlc, struct test_ctx *ctx,
+                        const char *dir )
+{
+    char *path, *uri;
+    vlc_tick_t duration, cached_duration;
+    int es_count, cached_es_count;
+
+    assert( asprintf( &path, "%s/sample.voc", dir ) != -1 );
+    copy_file( test_default_sample, path );
+    uri = vlc_path2uri( path, NULL );
+    assert( uri != NULL );
+
+    test_log( "cache round trip\n" );
+    assert( !preparse( vlc, ctx, dir, uri, &duration, &es_count ) );
+    assert( preparse( vlc, ctx, dir, uri, &cached_duration,
+                      &cached_es_count ) );
+    assert( cached_duration == duration );
+    assert( cached_es_count == es_count );
+
+    test_log( "cache invalidation on modification time change\n" );
+    struct stat st;
+    assert( stat( path, &st ) == 0 );
+    struct utimbuf times = { st.st_atime, st.st_mtime + 10 };
+    assert( utime( path, &times ) == 0 );
+    assert( !preparse( vlc, ctx, dir, uri, &duration, &es_count ) );
+    assert( preparse( vlc, ctx, dir, uri, &duration, &es_count ) );
+
+    test_log( "cache invalidation on size change\n" );
+    FILE *f = fopen( path, "ab" );
+    assert( f != NULL );
+    fputc( 0, f );
+    assert( fclose( f ) == 0 );
+    assert( utime( path, &times ) == 0 ); /* same modification time */
+    assert( !preparse( vlc, ctx, dir, uri, &cached_duration,
+                       &cached_es_count ) );
+    assert( preparse( vlc, ctx, dir, uri, &cached_duration,
+                      &cached_es_count ) );
+
+    test_log( "cache lookup by modification time and size only\n" );
+    assert( stat( path, &st ) == 0 );
+    f = fopen( path, "r+b" );
+    assert( f != NULL );
+    for( off_t i = 0; i < st.st_size; i++ )
+        fputc( 0, f );
+    assert( fclose( f ) == 0 );
+    assert( utime( path, &times ) == 0 );
+    /* the garbled file is not parsed again */
+    assert( preparse( vlc, ctx, dir, uri, &duration, &es_count ) );
+    assert( duration == cached_duration );
+    assert( es_count == cached_es_count );
+
+    unlink( path );
+    free( uri );
+    free( path );
+}
+
+static input_item_t *net_item( const char *uri )
+{
+    input_item_t *item = input_item_NewExt( uri, "remote item",
+                                            INPUT_DURATION_UNSET,
+                                            ITEM_TYPE_FILE, ITEM_NET );
+    assert( item != NULL );
+    return item;
+}
+
+/* Items of a host are preparsed one at a time (preparse-host-threads=1),
+ * and a stalled host does not delay the other ones */
+static void test_hosts( libvlc_instance_t *vlc, struct test_ctx *ctx )
+{
+    test_log( "per host dispatch\n" );
+
+    /* a server that accepts connections but never answers */
+    int srv = socket( AF_INET, SOCK_STREAM, 0 );
+    assert( srv != -1 );
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl( INADDR_LOOPBACK ),
+    };
+    socklen_t addrlen = sizeof (addr);
+    assert( bind( srv, (struct sockaddr *)&addr, addrlen ) == 0 );
+    assert( listen( srv, 4 ) == 0 );
+    assert( getsockname( srv, (struct sockaddr *)&addr, &addrlen ) == 0 );
+
+    struct test_req stalled[2], other;
+    for( size_t i = 0; i < ARRAY_SIZE(stalled); i++ )
+    {
+        char *uri;
+
+        assert( asprintf( &uri, "http://127.0.0.1:%u/%zu.mp4",
+                          ntohs( addr.sin_port ), i ) != -1 );
+        request( vlc, ctx, &stalled[i], net_item( uri ) );
+        free( uri );
+    }
+    request( vlc, ctx, &other,
+             net_item( "mock://other/;video_track_count=1" ) );
+
+    /* the other host is served while the first one is stalled */
+    int cl = accept( srv, NULL, NULL );
+    assert( cl != -1 );
+    wait_ended( ctx, &other );
+    assert( other.status == ITEM_PREPARSE_DONE );
+    vlc_mutex_lock( &other.item->lock );
+    assert( other.item->i_es == 1 );
+    vlc_mutex_unlock( &other.item->lock );
+
+    /* and the stalled host gets a single connection at a time */
+    struct pollfd ufd = { .fd = srv, .events = POLLIN };
+    assert( poll( &ufd, 1, 500 ) == 0 );
+    for( size_t i = 0; i < ARRAY_SIZE(stalled); i++ )
+        assert( !has_ended( ctx, &stalled[i] ) );
+
+    /* further connections are refused */
+    close( srv );
+    close( cl );
+    wait_ended( ctx, NULL );
+
+    for( size_t i = 0; i < ARRAY_SIZE(stalled); i++ )
+    {
+        assert( stalled[i].status != ITEM_PREPARSE_DONE );
+        input_item_Release( stalled[i].item );
+    }
+    input_item_Release( other.item );
+}
+
+/* Hosts beyond the limit of host pools are served too */
+static void test_many_hosts( libvlc_instance_t *vlc, struct test_ctx *ctx )
+{
+    struct test_req reqs[40];
+
+    test_log( "many hosts\n" );
+
+    for( size_t i = 0; i < ARRAY_SIZE(reqs); i++ )
+    {
+        char *uri;
+
+        assert( asprintf( &uri, "mock://host%zu/;video_track_count=1"
+                          ";audio_track_count=%zu", i % 20, i ) != -1 );
+        request( vlc, ctx, &reqs[i], net_item( uri ) );
+        free( uri );
+    }
+    wait_ended( ctx, NULL );
+
+    for( size_t i = 0; i < ARRAY_SIZE(reqs); i++ )
+    {
+        assert( reqs[i].status == ITEM_PREPARSE_DONE );
+        vlc_mutex_lock( &reqs[i].item->lock );
+        assert( reqs[i].item->i_es == (int)(1 + i) );
+        vlc_mutex_unlock( &reqs[i].item->lock );
+        input_item_Release( reqs[i].item );
+    }
+}
+
+static int remove_entry( const char *path, const struct stat *st, int flag,
+                         struct FTW *ftw )
+{
+    (void) st; (void) flag; (void) ftw;
+    return remove( path );
+}
+
+int main( void )
+{
+    test_init();
+
+    char dir[] = "/tmp/vlc-preparser-XXXXXX";
+    assert( mkdtemp( dir ) != NULL );
+    /* Keep the cache entries of the test out of the user cache */
+    setenv( "XDG_CACHE_HOME", dir, 1 );
+    unsetenv( "http_proxy" );
+
+    static const char *argv[] = {
+        "-v",
+        "--ignore-config",
+        "--preparse-host-threads=1",
+    };
+    libvlc_instance_t *vlc = libvlc_new( ARRAY_SIZE(argv), argv );
+    assert( vlc != NULL );
+
+    struct test_ctx ctx = { .pending = 0 };
+    vlc_mutex_init( &ctx.lock );
+    vlc_cond_init( &ctx.cond );
+
+    test_cache( vlc, &ctx, dir );
+    test_hosts( vlc, &ctx );
+    test_many_hosts( vlc, &ctx );
+
+    libvlc_release( vlc );
+    vlc_cond_destroy( &ctx.cond );
+    vlc_mutex_destroy( &ctx.lock );
+
+    assert( nftw( dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS ) == 0 );
+    return 0;
+}